@@ -0,0 +1,400 @@
+/** @file
+  Block I/O Example - asynchronous multi-queue reader over BlockIo2.
+
+  Slot state is only changed at TPL_CALLBACK: completion notifications run
+  there, and the submit/collect loop raises to it while it scans the slots.
+  A driver that completes a request inside ReadBlocksEx () therefore cannot
+  run the notification until the submitting loop has finished its
+  bookkeeping.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "AsyncBlockReader.h"
+#include "BlockTrace.h"
+
+///
+/// Sequential range state for AsyncBlockReaderReadRange ()
+///
+typedef struct {
+  EFI_LBA                  NextLba;
+  EFI_LBA                  EndLba;
+  UINTN                    BlocksPerRequest;
+  UINT32                   BlockSize;
+  ASYNC_BLOCK_READ_DONE    Done;
+  VOID                     *Context;
+} ASYNC_RANGE_CONTEXT;
+
+/**
+  Completion notification for one request.
+**/
+STATIC
+VOID
+EFIAPI
+AsyncReadComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  ASYNC_BLOCK_REQUEST  *Request;
+
+  Request                = (ASYNC_BLOCK_REQUEST *)Context;
+  Request->CompleteTicks = BenchmarkGetTicks ();
+  Request->State         = AsyncRequestComplete;
+  BlockTraceComplete (Request->TraceId, Request->Token.TransactionStatus);
+  gBS->SignalEvent (Request->Reader->Wake);
+}
+
+/**
+  Create a reader with QueueDepth slots of RequestSize bytes each.
+
+  @param[out]  Reader       Reader to initialize.
+  @param[in]   BlockIo2     Device to read.
+  @param[in]   QueueDepth   Requests kept in flight, 1 to
+                            ASYNC_BLOCK_READER_MAX_DEPTH.
+  @param[in]   RequestSize  Largest request in bytes. Rounded up to a block
+                            and to a page, or to IoAlign if that is larger.
+
+  @retval EFI_SUCCESS            The reader is ready.
+  @retval EFI_INVALID_PARAMETER  A parameter is out of range.
+  @retval EFI_NO_MEDIA           The device has no media.
+  @retval EFI_OUT_OF_RESOURCES   Slots or buffers could not be allocated.
+**/
+EFI_STATUS
+AsyncBlockReaderInit (
+  OUT ASYNC_BLOCK_READER      *Reader,
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2,
+  IN  UINTN                   QueueDepth,
+  IN  UINTN                   RequestSize
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINTN               Index;
+  UINTN               Alignment;
+
+  if ((Reader == NULL) || (BlockIo2 == NULL) || (QueueDepth == 0) ||
+      (QueueDepth > ASYNC_BLOCK_READER_MAX_DEPTH) || (RequestSize == 0))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Media = BlockIo2->Media;
+  if (!Media->MediaPresent) {
+    return EFI_NO_MEDIA;
+  }
+
+  ZeroMem (Reader, sizeof (*Reader));
+  Reader->BlockIo2    = BlockIo2;
+  Reader->MediaId     = Media->MediaId;
+  Reader->BlockSize   = Media->BlockSize;
+  Reader->QueueDepth  = QueueDepth;
+  Reader->RequestSize = ALIGN_VALUE (RequestSize, Media->BlockSize);
+  Reader->InOrder     = TRUE;
+
+  //
+  // Slots follow each other in one allocation, so every slot starts on the
+  // allocation's alignment only if the slot size is a multiple of it
+  //
+  Alignment           = MAX (Media->IoAlign, EFI_PAGE_SIZE);
+  Reader->RequestSize = ALIGN_VALUE (Reader->RequestSize, Alignment);
+  Reader->BufferPages = EFI_SIZE_TO_PAGES (Reader->RequestSize * QueueDepth);
+  Reader->Buffers     = AllocateAlignedPages (Reader->BufferPages, Alignment);
+  Reader->Requests    = AllocateZeroPool (QueueDepth * sizeof (ASYNC_BLOCK_REQUEST));
+  if ((Reader->Buffers == NULL) || (Reader->Requests == NULL)) {
+    AsyncBlockReaderFree (Reader);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Reader->Wake);
+  if (EFI_ERROR (Status)) {
+    AsyncBlockReaderFree (Reader);
+    return Status;
+  }
+
+  for (Index = 0; Index < QueueDepth; Index++) {
+    Reader->Requests[Index].Reader = Reader;
+    Reader->Requests[Index].Buffer = Reader->Buffers + Index * Reader->RequestSize;
+    Status                         = gBS->CreateEvent (
+                                            EVT_NOTIFY_SIGNAL,
+                                            TPL_CALLBACK,
+                                            AsyncReadComplete,
+                                            &Reader->Requests[Index],
+                                            &Reader->Requests[Index].Token.Event
+                                            );
+    if (EFI_ERROR (Status)) {
+      AsyncBlockReaderFree (Reader);
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a reader's events and buffers. No requests may be in flight.
+
+  @param[in]  Reader  Reader to free.
+**/
+VOID
+AsyncBlockReaderFree (
+  IN ASYNC_BLOCK_READER  *Reader
+  )
+{
+  UINTN  Index;
+
+  ASSERT (Reader->InFlight == 0);
+
+  if (Reader->Requests != NULL) {
+    for (Index = 0; Index < Reader->QueueDepth; Index++) {
+      if (Reader->Requests[Index].Token.Event != NULL) {
+        gBS->CloseEvent (Reader->Requests[Index].Token.Event);
+      }
+    }
+
+    FreePool (Reader->Requests);
+  }
+
+  if (Reader->Wake != NULL) {
+    gBS->CloseEvent (Reader->Wake);
+  }
+
+  if (Reader->Buffers != NULL) {
+    FreeAlignedPages (Reader->Buffers, Reader->BufferPages);
+  }
+
+  ZeroMem (Reader, sizeof (*Reader));
+}
+
+/**
+  Find the next completed request to hand back, or NULL.
+
+  Called at TPL_CALLBACK. In order mode only the oldest outstanding request
+  qualifies, so a caller streaming the data sees it in LBA order.
+**/
+STATIC
+ASYNC_BLOCK_REQUEST *
+FindCompleted (
+  IN ASYNC_BLOCK_READER  *Reader
+  )
+{
+  UINTN                Index;
+  ASYNC_BLOCK_REQUEST  *Request;
+
+  for (Index = 0; Index < Reader->QueueDepth; Index++) {
+    Request = &Reader->Requests[Index];
+    if (Request->State != AsyncRequestComplete) {
+      continue;
+    }
+
+    if (!Reader->InOrder || (Request->Sequence == Reader->NextDelivery)) {
+      return Request;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Issue reads from Next until it runs dry, keeping QueueDepth in flight.
+
+  @param[in]  Reader   Reader to run.
+  @param[in]  Next     Request source.
+  @param[in]  Done     Completion consumer, or NULL.
+  @param[in]  Context  Passed to Next and Done.
+
+  @retval EFI_SUCCESS  Every request completed successfully.
+  @retval Others       The first submission, transfer or Done error.
+**/
+EFI_STATUS
+AsyncBlockReaderRun (
+  IN ASYNC_BLOCK_READER     *Reader,
+  IN ASYNC_BLOCK_READ_NEXT  Next,
+  IN ASYNC_BLOCK_READ_DONE  Done OPTIONAL,
+  IN VOID                   *Context
+  )
+{
+  EFI_STATUS           Status;
+  EFI_STATUS           Result;
+  EFI_TPL              OldTpl;
+  BOOLEAN              Exhausted;
+  UINTN                Index;
+  UINTN                WaitIndex;
+  ASYNC_BLOCK_REQUEST  *Request;
+
+  Result    = EFI_SUCCESS;
+  Exhausted = FALSE;
+
+  for ( ; ;) {
+    OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+    //
+    // Refill every free slot unless the source is done or a request failed
+    //
+    for (Index = 0; Index < Reader->QueueDepth; Index++) {
+      Request = &Reader->Requests[Index];
+      if (Exhausted || EFI_ERROR (Result)) {
+        break;
+      }
+
+      if (Request->State != AsyncRequestFree) {
+        continue;
+      }
+
+      if (!Next (Context, &Request->Lba, &Request->Length)) {
+        Exhausted = TRUE;
+        break;
+      }
+
+      ASSERT (Request->Length <= Reader->RequestSize);
+
+      Request->Sequence                = Reader->NextSequence;
+      Request->State                   = AsyncRequestInFlight;
+      Request->Token.TransactionStatus = EFI_NOT_READY;
+      Request->SubmitTicks             = BenchmarkGetTicks ();
+      Request->TraceId                 = BlockTraceSubmit (
+                                           Reader->BlockIo2->Media,
+                                           Request->Lba,
+                                           Request->Length,
+                                           TRUE
+                                           );
+
+      Status = Reader->BlockIo2->ReadBlocksEx (
+                                   Reader->BlockIo2,
+                                   Reader->MediaId,
+                                   Request->Lba,
+                                   &Request->Token,
+                                   Request->Length,
+                                   Request->Buffer
+                                   );
+      if (EFI_ERROR (Status)) {
+        BlockTraceComplete (Request->TraceId, Status);
+        Request->State = AsyncRequestFree;
+        Result         = Status;
+        break;
+      }
+
+      Reader->NextSequence++;
+      Reader->InFlight++;
+    }
+
+    Request = FindCompleted (Reader);
+    if (Request != NULL) {
+      Reader->InFlight--;
+      Reader->NextDelivery = Request->Sequence + 1;
+    }
+
+    gBS->RestoreTPL (OldTpl);
+
+    if (Request != NULL) {
+      Status = Request->Token.TransactionStatus;
+      if (!EFI_ERROR (Status)) {
+        Reader->BytesRead += Request->Length;
+        Reader->RequestsDone++;
+        if (Done != NULL) {
+          Status = Done (Context, Request);
+        }
+      }
+
+      if (EFI_ERROR (Status) && !EFI_ERROR (Result)) {
+        Result = Status;
+      }
+
+      Request->State = AsyncRequestFree;
+      continue;
+    }
+
+    if (Reader->InFlight == 0) {
+      break;
+    }
+
+    gBS->WaitForEvent (1, &Reader->Wake, &WaitIndex);
+  }
+
+  return Result;
+}
+
+/**
+  Next callback for a sequential range.
+**/
+STATIC
+BOOLEAN
+RangeNext (
+  IN  VOID     *Context,
+  OUT EFI_LBA  *Lba,
+  OUT UINTN    *Length
+  )
+{
+  ASYNC_RANGE_CONTEXT  *Range;
+  UINT64               Blocks;
+
+  Range = (ASYNC_RANGE_CONTEXT *)Context;
+  if (Range->NextLba >= Range->EndLba) {
+    return FALSE;
+  }
+
+  Blocks          = MIN (Range->BlocksPerRequest, Range->EndLba - Range->NextLba);
+  *Lba            = Range->NextLba;
+  *Length         = (UINTN)Blocks * Range->BlockSize;
+  Range->NextLba += Blocks;
+
+  return TRUE;
+}
+
+/**
+  Done callback for a sequential range; forwards to the caller's consumer.
+**/
+STATIC
+EFI_STATUS
+RangeDone (
+  IN VOID                 *Context,
+  IN ASYNC_BLOCK_REQUEST  *Request
+  )
+{
+  ASYNC_RANGE_CONTEXT  *Range;
+
+  Range = (ASYNC_RANGE_CONTEXT *)Context;
+  return Range->Done (Range->Context, Request);
+}
+
+/**
+  Read Blocks consecutive blocks from StartLba in RequestSize pieces.
+
+  @param[in]  Reader    Reader to run.
+  @param[in]  StartLba  First block.
+  @param[in]  Blocks    Number of blocks.
+  @param[in]  Done      Completion consumer, or NULL.
+  @param[in]  Context   Passed to Done.
+
+  @retval EFI_SUCCESS  The range was read.
+  @retval Others       As for AsyncBlockReaderRun ().
+**/
+EFI_STATUS
+AsyncBlockReaderReadRange (
+  IN ASYNC_BLOCK_READER     *Reader,
+  IN EFI_LBA                StartLba,
+  IN UINT64                 Blocks,
+  IN ASYNC_BLOCK_READ_DONE  Done OPTIONAL,
+  IN VOID                   *Context
+  )
+{
+  ASYNC_RANGE_CONTEXT  Range;
+
+  Range.NextLba          = StartLba;
+  Range.EndLba           = StartLba + Blocks;
+  Range.BlocksPerRequest = Reader->RequestSize / Reader->BlockSize;
+  Range.BlockSize        = Reader->BlockSize;
+  Range.Done             = Done;
+  Range.Context          = Context;
+
+  return AsyncBlockReaderRun (Reader, RangeNext, (Done != NULL) ? RangeDone : NULL, &Range);
+}
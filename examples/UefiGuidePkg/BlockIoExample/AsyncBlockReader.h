@@ -0,0 +1,176 @@
+/** @file
+  Block I/O Example - asynchronous multi-queue reader over BlockIo2.
+
+  An ASYNC_BLOCK_READER owns QueueDepth request slots, each with its own
+  EFI_BLOCK_IO2_TOKEN, event and buffer. AsyncBlockReaderRun () keeps every
+  free slot filled with ReadBlocksEx () requests, completion events mark the
+  slots done from TPL_CALLBACK, and finished requests are handed to the
+  caller at TPL_APPLICATION before their slot is reused.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef ASYNC_BLOCK_READER_H_
+#define ASYNC_BLOCK_READER_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo2.h>
+
+#define ASYNC_BLOCK_READER_MAX_DEPTH  64
+
+typedef struct _ASYNC_BLOCK_READER ASYNC_BLOCK_READER;
+
+typedef enum {
+  AsyncRequestFree,
+  AsyncRequestInFlight,
+  AsyncRequestComplete
+} ASYNC_REQUEST_STATE;
+
+///
+/// One request slot. Lba, Length and Buffer describe the read; the rest is
+/// filled in by the reader.
+///
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN             Token;
+  ASYNC_BLOCK_READER              *Reader;
+  volatile ASYNC_REQUEST_STATE    State;
+  UINT64                          Sequence;       ///< Submission order
+  EFI_LBA                         Lba;
+  UINTN                           Length;         ///< Bytes; a block multiple
+  VOID                            *Buffer;        ///< Slot buffer, IoAlign aligned
+  UINT64                          SubmitTicks;
+  UINT64                          CompleteTicks;
+  UINT64                          TraceId;        ///< BlockTraceSubmit () id
+} ASYNC_BLOCK_REQUEST;
+
+/**
+  Supply the next read for a free slot. Runs at TPL_CALLBACK.
+
+  @param[in]   Context  Caller context passed to AsyncBlockReaderRun ().
+  @param[out]  Lba      First block to read.
+  @param[out]  Length   Bytes to read, a block multiple no larger than the
+                        reader's RequestSize.
+
+  @retval TRUE   A request was returned.
+  @retval FALSE  There is nothing more to read.
+**/
+typedef
+BOOLEAN
+(*ASYNC_BLOCK_READ_NEXT)(
+  IN  VOID     *Context,
+  OUT EFI_LBA  *Lba,
+  OUT UINTN    *Length
+  );
+
+/**
+  Consume a completed read. Runs at TPL_APPLICATION.
+
+  Returning an error stops the run once the requests in flight drain.
+
+  @param[in]  Context  Caller context passed to AsyncBlockReaderRun ().
+  @param[in]  Request  The completed request. Token.TransactionStatus holds
+                       the result.
+**/
+typedef
+EFI_STATUS
+(*ASYNC_BLOCK_READ_DONE)(
+  IN VOID                 *Context,
+  IN ASYNC_BLOCK_REQUEST  *Request
+  );
+
+struct _ASYNC_BLOCK_READER {
+  EFI_BLOCK_IO2_PROTOCOL    *BlockIo2;
+  UINT32                    MediaId;
+  UINT32                    BlockSize;
+  UINTN                     QueueDepth;
+  UINTN                     RequestSize;        ///< Bytes per slot buffer
+  BOOLEAN                   InOrder;            ///< Deliver in submission order
+  ASYNC_BLOCK_REQUEST       *Requests;
+  UINT8                     *Buffers;
+  UINTN                     BufferPages;
+  EFI_EVENT                 Wake;               ///< Signalled on every completion
+  UINTN                     InFlight;
+  UINT64                    NextSequence;
+  UINT64                    NextDelivery;
+  UINT64                    BytesRead;
+  UINT64                    RequestsDone;
+};
+
+/**
+  Create a reader with QueueDepth slots of RequestSize bytes each.
+
+  @param[out]  Reader       Reader to initialize.
+  @param[in]   BlockIo2     Device to read.
+  @param[in]   QueueDepth   Requests kept in flight, 1 to
+                            ASYNC_BLOCK_READER_MAX_DEPTH.
+  @param[in]   RequestSize  Largest request in bytes. Rounded up to a block
+                            and to a page, or to IoAlign if that is larger.
+
+  @retval EFI_SUCCESS            The reader is ready.
+  @retval EFI_INVALID_PARAMETER  A parameter is out of range.
+  @retval EFI_NO_MEDIA           The device has no media.
+  @retval EFI_OUT_OF_RESOURCES   Slots or buffers could not be allocated.
+**/
+EFI_STATUS
+AsyncBlockReaderInit (
+  OUT ASYNC_BLOCK_READER      *Reader,
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2,
+  IN  UINTN                   QueueDepth,
+  IN  UINTN                   RequestSize
+  );
+
+/**
+  Release a reader's events and buffers. No requests may be in flight.
+
+  @param[in]  Reader  Reader to free.
+**/
+VOID
+AsyncBlockReaderFree (
+  IN ASYNC_BLOCK_READER  *Reader
+  );
+
+/**
+  Issue reads from Next until it runs dry, keeping QueueDepth in flight.
+
+  Returns only after every submitted request has completed, so all slot
+  buffers are idle again.
+
+  @param[in]  Reader   Reader to run.
+  @param[in]  Next     Request source.
+  @param[in]  Done     Completion consumer, or NULL.
+  @param[in]  Context  Passed to Next and Done.
+
+  @retval EFI_SUCCESS  Every request completed successfully.
+  @retval Others       The first submission, transfer or Done error.
+**/
+EFI_STATUS
+AsyncBlockReaderRun (
+  IN ASYNC_BLOCK_READER     *Reader,
+  IN ASYNC_BLOCK_READ_NEXT  Next,
+  IN ASYNC_BLOCK_READ_DONE  Done OPTIONAL,
+  IN VOID                   *Context
+  );
+
+/**
+  Read Blocks consecutive blocks from StartLba in RequestSize pieces.
+
+  @param[in]  Reader    Reader to run.
+  @param[in]  StartLba  First block.
+  @param[in]  Blocks    Number of blocks.
+  @param[in]  Done      Completion consumer, or NULL.
+  @param[in]  Context   Passed to Done.
+
+  @retval EFI_SUCCESS  The range was read.
+  @retval Others       As for AsyncBlockReaderRun ().
+**/
+EFI_STATUS
+AsyncBlockReaderReadRange (
+  IN ASYNC_BLOCK_READER     *Reader,
+  IN EFI_LBA                StartLba,
+  IN UINT64                 Blocks,
+  IN ASYNC_BLOCK_READ_DONE  Done OPTIONAL,
+  IN VOID                   *Context
+  );
+
+#endif // ASYNC_BLOCK_READER_H_
@@ -0,0 +1,388 @@
+/** @file
+  Block I/O Example - LRU block cache with sequential read-ahead.
+
+  Every slot is BLOCK_CACHE_MAX_BLOCK_SIZE bytes of one page-aligned run, so
+  any device with blocks up to that size can share the cache. Misses are
+  filled through a staging buffer: one ReadBlocks () covers the rest of the
+  caller's request, plus ReadAhead blocks when the miss continues a
+  sequential stream, and the blocks are then copied into slots taken from
+  the LRU tail.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "BlockCache.h"
+#include "BlockTrace.h"
+
+//
+// Smallest staging buffer, so multi-block requests still fill in one read
+// when ReadAhead is small
+//
+#define BLOCK_CACHE_MIN_FILL  16
+
+/**
+  Hash a cache key into a bucket index.
+**/
+STATIC
+UINTN
+BlockCacheBucket (
+  IN BLOCK_CACHE            *Cache,
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN UINT32                 MediaId,
+  IN EFI_LBA                Lba
+  )
+{
+  UINT32  Hash;
+
+  Hash = (UINT32)Lba * 0x9E3779B1 ^ (UINT32)((UINTN)BlockIo >> 4) ^ MediaId;
+  return (Hash ^ (Hash >> 16)) & Cache->BucketMask;
+}
+
+/**
+  Find a cached block.
+**/
+STATIC
+BLOCK_CACHE_ENTRY *
+BlockCacheLookup (
+  IN BLOCK_CACHE            *Cache,
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN UINT32                 MediaId,
+  IN EFI_LBA                Lba
+  )
+{
+  LIST_ENTRY         *Bucket;
+  LIST_ENTRY         *Link;
+  BLOCK_CACHE_ENTRY  *Entry;
+
+  Bucket = &Cache->Buckets[BlockCacheBucket (Cache, BlockIo, MediaId, Lba)];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    Entry = BASE_CR (Link, BLOCK_CACHE_ENTRY, Hash);
+    if ((Entry->Lba == Lba) && (Entry->BlockIo == BlockIo) && (Entry->MediaId == MediaId)) {
+      return Entry;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Move an entry to the most recently used end.
+**/
+STATIC
+VOID
+BlockCacheTouch (
+  IN BLOCK_CACHE        *Cache,
+  IN BLOCK_CACHE_ENTRY  *Entry
+  )
+{
+  RemoveEntryList (&Entry->Lru);
+  InsertHeadList (&Cache->Lru, &Entry->Lru);
+}
+
+/**
+  Take the least recently used slot and give it a new key.
+**/
+STATIC
+BLOCK_CACHE_ENTRY *
+BlockCacheClaim (
+  IN BLOCK_CACHE            *Cache,
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN UINT32                 MediaId,
+  IN EFI_LBA                Lba
+  )
+{
+  BLOCK_CACHE_ENTRY  *Entry;
+
+  Entry = BASE_CR (Cache->Lru.BackLink, BLOCK_CACHE_ENTRY, Lru);
+  if (Entry->BlockIo != NULL) {
+    RemoveEntryList (&Entry->Hash);
+    Cache->Evictions++;
+  }
+
+  Entry->BlockIo    = BlockIo;
+  Entry->MediaId    = MediaId;
+  Entry->Lba        = Lba;
+  Entry->Prefetched = FALSE;
+  InsertHeadList (&Cache->Buckets[BlockCacheBucket (Cache, BlockIo, MediaId, Lba)], &Entry->Hash);
+  BlockCacheTouch (Cache, Entry);
+  return Entry;
+}
+
+/**
+  Fill a missing block, the rest of the request and any read-ahead with one
+  device read. Loaded receives the number of blocks read from Lba on.
+**/
+STATIC
+EFI_STATUS
+BlockCacheFill (
+  IN  BLOCK_CACHE            *Cache,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  Wanted,
+  OUT BLOCK_CACHE_ENTRY      **Filled,
+  OUT UINTN                  *Loaded
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  BLOCK_CACHE_ENTRY   *Entry;
+  UINTN               Count;
+  UINTN               Index;
+
+  Media = BlockIo->Media;
+  Count = Wanted;
+  if ((BlockIo == Cache->StreamBlockIo) && (Lba == Cache->StreamNextLba)) {
+    Count += Cache->ReadAhead;
+  }
+
+  Count = MIN (Count, Cache->StagingBlocks);
+  Count = (UINTN)MIN (Count, Media->LastBlock + 1 - Lba);
+
+  Status = BlockTraceReadBlocks (BlockIo, Media->MediaId, Lba, Count * Media->BlockSize, Cache->Staging);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Cache->DeviceReads++;
+  Cache->DeviceBlocks += Count;
+  *Loaded              = Count;
+
+  //
+  // Count never exceeds Capacity, so the first slot claimed survives the loop
+  //
+  *Filled = NULL;
+  for (Index = 0; Index < Count; Index++) {
+    Entry = BlockCacheLookup (Cache, BlockIo, Media->MediaId, Lba + Index);
+    if (Entry == NULL) {
+      Entry = BlockCacheClaim (Cache, BlockIo, Media->MediaId, Lba + Index);
+      CopyMem (Entry->Data, Cache->Staging + Index * Media->BlockSize, Media->BlockSize);
+      if (Index >= Wanted) {
+        Entry->Prefetched = TRUE;
+        Cache->ReadAheadBlocks++;
+      }
+    }
+
+    if (Index == 0) {
+      *Filled = Entry;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Initialize a block cache.
+
+  @param[out]  Cache      Cache to initialize.
+  @param[in]   Capacity   Number of blocks to hold. 0 makes every read go
+                          straight to the device, which still counts device
+                          reads for comparison.
+  @param[in]   ReadAhead  Extra blocks fetched on a sequential miss.
+
+  @retval EFI_SUCCESS           The cache is ready.
+  @retval EFI_OUT_OF_RESOURCES  The slots could not be allocated.
+**/
+EFI_STATUS
+BlockCacheInit (
+  OUT BLOCK_CACHE  *Cache,
+  IN  UINTN        Capacity,
+  IN  UINTN        ReadAhead
+  )
+{
+  UINTN  Buckets;
+  UINTN  Index;
+
+  ZeroMem (Cache, sizeof (*Cache));
+  Cache->Capacity  = Capacity;
+  Cache->ReadAhead = ReadAhead;
+  InitializeListHead (&Cache->Lru);
+  if (Capacity == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Buckets = 1;
+  while (Buckets < Capacity) {
+    Buckets <<= 1;
+  }
+
+  Cache->BucketMask    = Buckets - 1;
+  Cache->SlotPages     = EFI_SIZE_TO_PAGES (Capacity * BLOCK_CACHE_MAX_BLOCK_SIZE);
+  Cache->StagingBlocks = MIN (Capacity, MAX (ReadAhead + 1, BLOCK_CACHE_MIN_FILL));
+  Cache->StagingPages  = EFI_SIZE_TO_PAGES (Cache->StagingBlocks * BLOCK_CACHE_MAX_BLOCK_SIZE);
+  Cache->Entries       = AllocateZeroPool (Capacity * sizeof (BLOCK_CACHE_ENTRY));
+  Cache->Buckets       = AllocatePool (Buckets * sizeof (LIST_ENTRY));
+  Cache->Slots         = AllocatePages (Cache->SlotPages);
+  Cache->Staging       = AllocatePages (Cache->StagingPages);
+  if ((Cache->Entries == NULL) || (Cache->Buckets == NULL) ||
+      (Cache->Slots == NULL) || (Cache->Staging == NULL))
+  {
+    BlockCacheFree (Cache);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < Buckets; Index++) {
+    InitializeListHead (&Cache->Buckets[Index]);
+  }
+
+  for (Index = 0; Index < Capacity; Index++) {
+    Cache->Entries[Index].Data = Cache->Slots + Index * BLOCK_CACHE_MAX_BLOCK_SIZE;
+    InsertTailList (&Cache->Lru, &Cache->Entries[Index].Lru);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a cache's memory.
+
+  @param[in]  Cache  Cache to free.
+**/
+VOID
+BlockCacheFree (
+  IN BLOCK_CACHE  *Cache
+  )
+{
+  if (Cache->Entries != NULL) {
+    FreePool (Cache->Entries);
+  }
+
+  if (Cache->Buckets != NULL) {
+    FreePool (Cache->Buckets);
+  }
+
+  if (Cache->Slots != NULL) {
+    FreePages (Cache->Slots, Cache->SlotPages);
+  }
+
+  if (Cache->Staging != NULL) {
+    FreePages (Cache->Staging, Cache->StagingPages);
+  }
+
+  ZeroMem (Cache, sizeof (*Cache));
+  InitializeListHead (&Cache->Lru);
+}
+
+/**
+  Drop every cached block of one device, for example after writing to it.
+
+  @param[in]  Cache    Cache to update.
+  @param[in]  BlockIo  Device whose blocks are dropped, or NULL for all.
+**/
+VOID
+BlockCacheInvalidate (
+  IN BLOCK_CACHE            *Cache,
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo OPTIONAL
+  )
+{
+  BLOCK_CACHE_ENTRY  *Entry;
+  UINTN              Index;
+
+  for (Index = 0; Index < Cache->Capacity; Index++) {
+    Entry = &Cache->Entries[Index];
+    if ((Entry->BlockIo == NULL) || ((BlockIo != NULL) && (Entry->BlockIo != BlockIo))) {
+      continue;
+    }
+
+    RemoveEntryList (&Entry->Hash);
+    RemoveEntryList (&Entry->Lru);
+    InsertTailList (&Cache->Lru, &Entry->Lru);
+    Entry->BlockIo = NULL;
+  }
+
+  if ((BlockIo == NULL) || (Cache->StreamBlockIo == BlockIo)) {
+    Cache->StreamBlockIo = NULL;
+  }
+}
+
+/**
+  Read blocks through the cache.
+
+  @param[in]   Cache       Cache to use.
+  @param[in]   BlockIo     Device to read.
+  @param[in]   Lba         First block.
+  @param[in]   BufferSize  Bytes to read, a multiple of the block size.
+  @param[out]  Buffer      Destination; any alignment.
+
+  @retval EFI_SUCCESS            The blocks were read.
+  @retval EFI_NO_MEDIA           The device has no media.
+  @retval EFI_BAD_BUFFER_SIZE    BufferSize is not a block multiple.
+  @retval EFI_INVALID_PARAMETER  The range is past the end of the device.
+  @retval Others                 ReadBlocks () failed.
+**/
+EFI_STATUS
+BlockCacheRead (
+  IN  BLOCK_CACHE            *Cache,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  BufferSize,
+  OUT VOID                   *Buffer
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  BLOCK_CACHE_ENTRY   *Entry;
+  UINTN               Blocks;
+  UINTN               Index;
+  UINTN               FillEnd;
+  UINTN               Loaded;
+
+  Media = BlockIo->Media;
+  if (!Media->MediaPresent) {
+    return EFI_NO_MEDIA;
+  }
+
+  if ((BufferSize % Media->BlockSize) != 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  Blocks = BufferSize / Media->BlockSize;
+  if ((Lba > Media->LastBlock) || (Blocks > Media->LastBlock + 1 - Lba)) {
+    return (Blocks == 0) ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+  }
+
+  if ((Cache->Capacity == 0) || (Media->BlockSize > BLOCK_CACHE_MAX_BLOCK_SIZE)) {
+    Cache->DeviceReads++;
+    Cache->DeviceBlocks += Blocks;
+    return BlockTraceReadBlocks (BlockIo, Media->MediaId, Lba, BufferSize, Buffer);
+  }
+
+  //
+  // Blocks this request's own fill brought in are misses, not hits
+  //
+  FillEnd = 0;
+  for (Index = 0; Index < Blocks; Index++) {
+    Entry = BlockCacheLookup (Cache, BlockIo, Media->MediaId, Lba + Index);
+    if ((Entry != NULL) && (Index < FillEnd)) {
+      Cache->Misses++;
+      BlockCacheTouch (Cache, Entry);
+    } else if (Entry != NULL) {
+      Cache->Hits++;
+      if (Entry->Prefetched) {
+        Entry->Prefetched = FALSE;
+        Cache->ReadAheadHits++;
+      }
+
+      BlockCacheTouch (Cache, Entry);
+    } else {
+      Cache->Misses++;
+      Status = BlockCacheFill (Cache, BlockIo, Lba + Index, Blocks - Index, &Entry, &Loaded);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      FillEnd = Index + Loaded;
+    }
+
+    CopyMem ((UINT8 *)Buffer + Index * Media->BlockSize, Entry->Data, Media->BlockSize);
+    Cache->StreamBlockIo = BlockIo;
+    Cache->StreamNextLba = Lba + Index + 1;
+  }
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,131 @@
+/** @file
+  Block I/O Example - LRU block cache with sequential read-ahead.
+
+  A BLOCK_CACHE holds a fixed number of single-block slots keyed by
+  (device, MediaId, LBA), found through a small hash table and evicted in
+  least-recently-used order. A miss that continues the previous read on the
+  same device is treated as a sequential stream and fills ReadAhead further
+  blocks with the same ReadBlocks () call. Because MediaId is part of the
+  key, blocks cached before a media change are never returned afterwards.
+
+  Partition-table and filesystem-metadata walks read the same few blocks
+  (LBA 0, the GPT header, the entry array) over and over in small pieces;
+  the cache turns those into a handful of larger device reads.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef BLOCK_CACHE_H_
+#define BLOCK_CACHE_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo.h>
+
+///
+/// Devices with larger blocks bypass the cache
+///
+#define BLOCK_CACHE_MAX_BLOCK_SIZE  SIZE_4KB
+
+///
+/// One cached block
+///
+typedef struct {
+  LIST_ENTRY               Lru;           ///< Most recently used first
+  LIST_ENTRY               Hash;
+  EFI_BLOCK_IO_PROTOCOL    *BlockIo;      ///< NULL while the slot is empty
+  UINT32                   MediaId;
+  EFI_LBA                  Lba;
+  BOOLEAN                  Prefetched;    ///< Read ahead and not used yet
+  UINT8                    *Data;
+} BLOCK_CACHE_ENTRY;
+
+typedef struct {
+  UINTN                    Capacity;      ///< Slots; 0 passes reads through
+  UINTN                    ReadAhead;     ///< Extra blocks on a sequential miss
+  BLOCK_CACHE_ENTRY        *Entries;
+  LIST_ENTRY               Lru;
+  LIST_ENTRY               *Buckets;
+  UINTN                    BucketMask;
+  UINT8                    *Slots;        ///< Capacity * BLOCK_CACHE_MAX_BLOCK_SIZE
+  UINTN                    SlotPages;
+  UINT8                    *Staging;      ///< Multi-block fill buffer
+  UINTN                    StagingBlocks;
+  UINTN                    StagingPages;
+  EFI_BLOCK_IO_PROTOCOL    *StreamBlockIo;
+  EFI_LBA                  StreamNextLba; ///< Block after the last one read
+  UINT64                   Hits;
+  UINT64                   Misses;
+  UINT64                   ReadAheadBlocks;
+  UINT64                   ReadAheadHits;
+  UINT64                   Evictions;
+  UINT64                   DeviceReads;
+  UINT64                   DeviceBlocks;
+} BLOCK_CACHE;
+
+/**
+  Initialize a block cache.
+
+  @param[out]  Cache      Cache to initialize.
+  @param[in]   Capacity   Number of blocks to hold. 0 makes every read go
+                          straight to the device, which still counts device
+                          reads for comparison.
+  @param[in]   ReadAhead  Extra blocks fetched on a sequential miss.
+
+  @retval EFI_SUCCESS           The cache is ready.
+  @retval EFI_OUT_OF_RESOURCES  The slots could not be allocated.
+**/
+EFI_STATUS
+BlockCacheInit (
+  OUT BLOCK_CACHE  *Cache,
+  IN  UINTN        Capacity,
+  IN  UINTN        ReadAhead
+  );
+
+/**
+  Release a cache's memory.
+
+  @param[in]  Cache  Cache to free.
+**/
+VOID
+BlockCacheFree (
+  IN BLOCK_CACHE  *Cache
+  );
+
+/**
+  Drop every cached block of one device, for example after writing to it.
+
+  @param[in]  Cache    Cache to update.
+  @param[in]  BlockIo  Device whose blocks are dropped, or NULL for all.
+**/
+VOID
+BlockCacheInvalidate (
+  IN BLOCK_CACHE            *Cache,
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo OPTIONAL
+  );
+
+/**
+  Read blocks through the cache.
+
+  @param[in]   Cache       Cache to use.
+  @param[in]   BlockIo     Device to read.
+  @param[in]   Lba         First block.
+  @param[in]   BufferSize  Bytes to read, a multiple of the block size.
+  @param[out]  Buffer      Destination; any alignment.
+
+  @retval EFI_SUCCESS            The blocks were read.
+  @retval EFI_NO_MEDIA           The device has no media.
+  @retval EFI_BAD_BUFFER_SIZE    BufferSize is not a block multiple.
+  @retval EFI_INVALID_PARAMETER  The range is past the end of the device.
+  @retval Others                 ReadBlocks () failed.
+**/
+EFI_STATUS
+BlockCacheRead (
+  IN  BLOCK_CACHE            *Cache,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  BufferSize,
+  OUT VOID                   *Buffer
+  );
+
+#endif // BLOCK_CACHE_H_
@@ -0,0 +1,436 @@
+/** @file
+  Block I/O Example - sequential and random read benchmark.
+
+  A small fio-style harness for one device:
+
+  - Sequential reads from LowestAlignedLba at every power-of-two transfer
+    size from one block to 1 MB, plus multiples of the device's
+    OptimalTransferLengthGranularity, each reported as MB/s, IOPS and
+    p50/p99/max latency.
+  - Random 4 KB reads over the whole LastBlock range, physically aligned,
+    synchronously and through the BlockIo2 reader at queue depth 32.
+
+  The last line suggests the smallest transfer size that reaches 90% of the
+  best sequential throughput, which is the number an imaging tool needs.
+
+  Usage: BlockIoExample.efi fio [device]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "AsyncBlockReader.h"
+#include "BlockTrace.h"
+
+#define SEQ_MAX_TRANSFER     SIZE_1MB
+#define SEQ_BYTES_PER_SIZE   SIZE_64MB
+#define SEQ_MAX_REQUESTS     4096
+#define SEQ_MAX_SIZES        24
+#define RANDOM_READ_SIZE     SIZE_4KB
+#define RANDOM_READS         4096
+#define RANDOM_QUEUE_DEPTH   32
+#define GRANULARITY_STEPS    5
+
+///
+/// Random read state shared by the sync loop and the async callbacks
+///
+typedef struct {
+  UINT64     Random;
+  EFI_LBA    FirstLba;
+  UINT64     Units;             ///< Physically aligned read slots in range
+  UINTN      UnitBlocks;        ///< Blocks between read slots
+  UINTN      ReadSize;
+  UINTN      Remaining;
+  UINT64     *Samples;
+  UINTN      SampleCount;
+} RANDOM_READ_CONTEXT;
+
+/**
+  64-bit xorshift generator; good enough to spread reads over a disk.
+**/
+STATIC
+UINT64
+NextRandom64 (
+  IN OUT UINT64  *State
+  )
+{
+  UINT64  Value;
+
+  Value  = *State;
+  Value ^= LShiftU64 (Value, 13);
+  Value ^= RShiftU64 (Value, 7);
+  Value ^= LShiftU64 (Value, 17);
+  *State = Value;
+  return Value;
+}
+
+/**
+  Pick the next random, physically aligned LBA.
+**/
+STATIC
+EFI_LBA
+NextRandomLba (
+  IN OUT RANDOM_READ_CONTEXT  *Random
+  )
+{
+  UINT64  Unit;
+
+  DivU64x64Remainder (NextRandom64 (&Random->Random), Random->Units, &Unit);
+  return Random->FirstLba + MultU64x32 (Unit, (UINT32)Random->UnitBlocks);
+}
+
+/**
+  Async reader source: RANDOM_READS random units.
+**/
+STATIC
+BOOLEAN
+RandomNext (
+  IN  VOID     *Context,
+  OUT EFI_LBA  *Lba,
+  OUT UINTN    *Length
+  )
+{
+  RANDOM_READ_CONTEXT  *Random;
+
+  Random = (RANDOM_READ_CONTEXT *)Context;
+  if (Random->Remaining == 0) {
+    return FALSE;
+  }
+
+  Random->Remaining--;
+  *Lba    = NextRandomLba (Random);
+  *Length = Random->ReadSize;
+  return TRUE;
+}
+
+/**
+  Async reader consumer: record each request's latency.
+**/
+STATIC
+EFI_STATUS
+RandomDone (
+  IN VOID                 *Context,
+  IN ASYNC_BLOCK_REQUEST  *Request
+  )
+{
+  RANDOM_READ_CONTEXT  *Random;
+
+  Random = (RANDOM_READ_CONTEXT *)Context;
+  if (Random->SampleCount < RANDOM_READS) {
+    Random->Samples[Random->SampleCount++] = BenchmarkElapsedNs (Request->SubmitTicks, Request->CompleteTicks);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Print one result row from latency samples and the wall time of the run.
+**/
+STATIC
+VOID
+PrintResult (
+  IN CONST CHAR16  *Label,
+  IN UINTN         TransferSize,
+  IN UINT64        *Samples,
+  IN UINTN         Count,
+  IN UINT64        ElapsedNs
+  )
+{
+  BENCHMARK_STATS  Stats;
+  UINT64           Iops;
+
+  BenchmarkComputeStats (Samples, Count, &Stats);
+  Iops = (ElapsedNs == 0) ? 0 : DivU64x64Remainder (MultU64x32 (Count, 1000000000), ElapsedNs, NULL);
+
+  Print (L"%-6s %7d %8ld %8ld %9ld %9ld %9ld\n",
+         Label,
+         TransferSize / SIZE_1KB,
+         BenchmarkMBps (MultU64x32 (Count, (UINT32)TransferSize), ElapsedNs),
+         Iops,
+         DivU64x32 (Stats.P50, 1000),
+         DivU64x32 (Stats.P99, 1000),
+         DivU64x32 (Stats.Max, 1000)
+         );
+}
+
+/**
+  Insert Size into the sorted Sizes array unless it is already there.
+**/
+STATIC
+VOID
+AddTransferSize (
+  IN OUT UINTN  *Sizes,
+  IN OUT UINTN  *Count,
+  IN     UINTN  Size
+  )
+{
+  UINTN  Index;
+  UINTN  Move;
+
+  if (*Count >= SEQ_MAX_SIZES) {
+    return;
+  }
+
+  for (Index = 0; Index < *Count; Index++) {
+    if (Sizes[Index] == Size) {
+      return;
+    }
+
+    if (Sizes[Index] > Size) {
+      break;
+    }
+  }
+
+  for (Move = *Count; Move > Index; Move--) {
+    Sizes[Move] = Sizes[Move - 1];
+  }
+
+  Sizes[Index] = Size;
+  (*Count)++;
+}
+
+/**
+  Time sequential reads of one transfer size, one latency sample per read.
+**/
+STATIC
+EFI_STATUS
+RunSequential (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  EFI_LBA                StartLba,
+  IN  UINTN                  TransferSize,
+  IN  VOID                   *Buffer,
+  IN  UINT64                 *Samples,
+  OUT UINTN                  *Count,
+  OUT UINT64                 *ElapsedNs
+  )
+{
+  EFI_STATUS  Status;
+  EFI_LBA     Lba;
+  UINTN       Requests;
+  UINTN       Index;
+  UINTN       BlocksPerRequest;
+  UINT64      Start;
+  UINT64      RunStart;
+
+  BlocksPerRequest = TransferSize / BlockIo->Media->BlockSize;
+  Requests         = MIN (SEQ_BYTES_PER_SIZE / TransferSize, SEQ_MAX_REQUESTS);
+  Requests         = (UINTN)MIN (Requests, DivU64x32 (BlockIo->Media->LastBlock + 1 - StartLba, (UINT32)BlocksPerRequest));
+  if (Requests == 0) {
+    return EFI_BAD_BUFFER_SIZE;
+  }
+
+  Lba      = StartLba;
+  RunStart = BenchmarkGetTicks ();
+  for (Index = 0; Index < Requests; Index++) {
+    Start  = BenchmarkGetTicks ();
+    Status = BlockTraceReadBlocks (BlockIo, BlockIo->Media->MediaId, Lba, TransferSize, Buffer);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Samples[Index] = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    Lba           += BlocksPerRequest;
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (RunStart, BenchmarkGetTicks ());
+  *Count     = Requests;
+  return EFI_SUCCESS;
+}
+
+/**
+  Run the sequential and random read benchmark on one device.
+**/
+EFI_STATUS
+DemoBlockBenchmark (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS              Status;
+  EFI_HANDLE              Handle;
+  EFI_BLOCK_IO_PROTOCOL   *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2;
+  EFI_BLOCK_IO_MEDIA      *Media;
+  ASYNC_BLOCK_READER      Reader;
+  RANDOM_READ_CONTEXT     Random;
+  UINT64                  *Samples;
+  VOID                    *Buffer;
+  UINTN                   Sizes[SEQ_MAX_SIZES];
+  UINTN                   SizeCount;
+  UINTN                   Size;
+  UINTN                   Index;
+  UINTN                   Count;
+  UINTN                   Granularity;
+  UINTN                   PhysicalBlocks;
+  EFI_LBA                 StartLba;
+  UINT64                  ElapsedNs;
+  UINT64                  Start;
+  UINT64                  MBps[SEQ_MAX_SIZES];
+  UINT64                  BestMBps;
+
+  Print (L"\n=== Block Read Benchmark ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = SelectBlockDevice ((Argc > 0) ? Argv[0] : NULL, &Handle, &BlockIo, &BlockIo2);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Media          = BlockIo->Media;
+  Granularity    = 0;
+  StartLba       = 0;
+  PhysicalBlocks = 1;
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION2) {
+    Granularity = Media->OptimalTransferLengthGranularity;
+  }
+
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION3) {
+    StartLba       = Media->LowestAlignedLba;
+    PhysicalBlocks = MAX (Media->LogicalBlocksPerPhysicalBlock, 1);
+  }
+
+  Print (L"Optimal transfer granularity: %d blocks, lowest aligned LBA %ld, %d logical per physical\n\n",
+         Granularity, StartLba, PhysicalBlocks);
+
+  //
+  // Power-of-two sizes from one block, then granularity multiples
+  //
+  SizeCount = 0;
+  for (Size = Media->BlockSize; Size <= MAX (SEQ_MAX_TRANSFER, Media->BlockSize); Size *= 2) {
+    AddTransferSize (Sizes, &SizeCount, Size);
+  }
+
+  for (Index = 1; (Granularity > 1) && (Index <= (1 << (GRANULARITY_STEPS - 1))); Index *= 2) {
+    AddTransferSize (Sizes, &SizeCount, Granularity * Index * Media->BlockSize);
+  }
+
+  Samples = AllocatePool (MAX (SEQ_MAX_REQUESTS, RANDOM_READS) * sizeof (UINT64));
+  Buffer  = AllocateAlignedPages (
+              EFI_SIZE_TO_PAGES (Sizes[SizeCount - 1]),
+              MAX (Media->IoAlign, EFI_PAGE_SIZE)
+              );
+  if ((Samples == NULL) || (Buffer == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Print (L"Sequential read from LBA %ld (* = granularity multiple)\n\n", StartLba);
+  Print (L"Type   Size KB     MB/s     IOPS    p50 us    p99 us    max us\n");
+  Print (L"------ ------- -------- -------- --------- --------- ---------\n");
+
+  BestMBps = 0;
+  for (Index = 0; Index < SizeCount; Index++) {
+    MBps[Index] = 0;
+    Status      = RunSequential (BlockIo, StartLba, Sizes[Index], Buffer, Samples, &Count, &ElapsedNs);
+    if (EFI_ERROR (Status)) {
+      Print (L"seq    %7d read failed: %r\n", Sizes[Index] / SIZE_1KB, Status);
+      continue;
+    }
+
+    MBps[Index] = BenchmarkMBps (MultU64x32 (Count, (UINT32)Sizes[Index]), ElapsedNs);
+    BestMBps    = MAX (BestMBps, MBps[Index]);
+    PrintResult (
+      ((Granularity > 1) && ((Sizes[Index] / Media->BlockSize) % Granularity == 0)) ? L"seq*" : L"seq",
+      Sizes[Index],
+      Samples,
+      Count,
+      ElapsedNs
+      );
+  }
+
+  //
+  // Random reads start on a physical block boundary so a 512e disk is not
+  // charged for straddling two physical sectors
+  //
+  ZeroMem (&Random, sizeof (Random));
+  Random.Random     = 0x9E3779B97F4A7C15ULL;
+  Random.FirstLba   = StartLba;
+  Random.ReadSize   = MAX (RANDOM_READ_SIZE, Media->BlockSize);
+  Random.UnitBlocks = MAX (Random.ReadSize / Media->BlockSize, PhysicalBlocks);
+  Random.Units      = DivU64x32 (Media->LastBlock + 1 - StartLba, (UINT32)Random.UnitBlocks);
+  Random.Samples    = Samples;
+  if (Random.Units == 0) {
+    Print (L"\nDevice too small for random reads\n");
+    Status = EFI_SUCCESS;
+    goto Done;
+  }
+
+  Print (L"\nRandom %d KB reads over %ld MB, %d reads\n\n",
+         Random.ReadSize / SIZE_1KB,
+         DivU64x32 (MultU64x32 (Media->LastBlock + 1 - StartLba, Media->BlockSize), SIZE_1MB),
+         RANDOM_READS);
+  Print (L"Type   Size KB     MB/s     IOPS    p50 us    p99 us    max us\n");
+  Print (L"------ ------- -------- -------- --------- --------- ---------\n");
+
+  Start = BenchmarkGetTicks ();
+  for (Index = 0; Index < RANDOM_READS; Index++) {
+    Samples[Index] = BenchmarkGetTicks ();
+    Status         = BlockTraceReadBlocks (BlockIo, Media->MediaId, NextRandomLba (&Random), Random.ReadSize, Buffer);
+    if (EFI_ERROR (Status)) {
+      Print (L"Random read failed: %r\n", Status);
+      goto Done;
+    }
+
+    Samples[Index] = BenchmarkElapsedNs (Samples[Index], BenchmarkGetTicks ());
+  }
+
+  PrintResult (L"qd1", Random.ReadSize, Samples, RANDOM_READS, BenchmarkElapsedNs (Start, BenchmarkGetTicks ()));
+
+  if (BlockIo2 != NULL) {
+    Status = AsyncBlockReaderInit (&Reader, BlockIo2, RANDOM_QUEUE_DEPTH, Random.ReadSize);
+    if (!EFI_ERROR (Status)) {
+      Reader.InOrder     = FALSE;
+      Random.Remaining   = RANDOM_READS;
+      Random.SampleCount = 0;
+
+      Start     = BenchmarkGetTicks ();
+      Status    = AsyncBlockReaderRun (&Reader, RandomNext, RandomDone, &Random);
+      ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+      AsyncBlockReaderFree (&Reader);
+    }
+
+    if (EFI_ERROR (Status)) {
+      Print (L"qd%d    async random reads failed: %r\n", RANDOM_QUEUE_DEPTH, Status);
+    } else {
+      PrintResult (L"qd32", Random.ReadSize, Samples, Random.SampleCount, ElapsedNs);
+    }
+  }
+
+  //
+  // Suggest the smallest transfer that gets within 90% of the best
+  //
+  for (Index = 0; Index < SizeCount; Index++) {
+    if ((BestMBps != 0) && (MBps[Index] * 10 >= BestMBps * 9)) {
+      Print (L"\nSmallest transfer within 90%% of peak sequential (%ld MB/s): %d KB\n",
+             BestMBps, Sizes[Index] / SIZE_1KB);
+      break;
+    }
+  }
+
+  Status = EFI_SUCCESS;
+
+Done:
+  if (Buffer != NULL) {
+    FreeAlignedPages (Buffer, EFI_SIZE_TO_PAGES (Sizes[SizeCount - 1]));
+  }
+
+  if (Samples != NULL) {
+    FreePool (Samples);
+  }
+
+  return Status;
+}
@@ -7,6 +7,10 @@
   3. Read raw blocks from disk
   4. Understand partition schemes (GPT/MBR)
 
+  Usage: BlockIoExample.efi [mode] [device]
+         Without a mode the block devices are listed and analysed.
+         "BlockIoExample.efi help" lists the benchmark modes.
+
   Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
@@ -15,13 +19,20 @@
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/PcdLib.h>
 #include <Protocol/BlockIo.h>
 #include <Protocol/BlockIo2.h>
 #include <Protocol/DiskIo.h>
 #include <Protocol/DevicePath.h>
+#include <Protocol/ShellParameters.h>
+
+#include "BlockIoExample.h"
+#include "BlockCache.h"
+#include "GptParser.h"
 
 //
 // MBR signature location
@@ -34,6 +45,35 @@
 //
 #define GPT_SIGNATURE  "EFI PART"
 
+//
+// Block cache shared by the partition analysis and block dumps of the
+// default device listing
+//
+STATIC BLOCK_CACHE  mBlockCache;
+
+typedef struct {
+  CONST CHAR16                      *Name;
+  BLOCK_IO_EXAMPLE_MODE_FUNCTION    Function;
+  CONST CHAR16                      *Description;
+} BLOCK_IO_EXAMPLE_MODE;
+
+//
+// Optional modes selected by the first command line argument. Arguments
+// after the mode are passed on; most take a device number.
+//
+STATIC CONST BLOCK_IO_EXAMPLE_MODE  mModes[] = {
+  { L"async",     DemoAsyncQueueDepth,  L"BlockIo2 async read MB/s and IOPS vs queue depth"  },
+  { L"fio",       DemoBlockBenchmark,   L"Sequential and random 4 KB reads with percentiles" },
+  { L"align",     DemoAlignedTransfers, L"Physical-block aligned byte-range reads vs naive"  },
+  { L"cache",     DemoBlockCache,       L"Block cache hit rates on repeated partition walks" },
+  { L"gpt",       DemoGptParse,         L"CRC-verified GPT parse with type and name lookup"  },
+  { L"probe",     DemoParallelProbe,    L"Read LBA 0/1 of every device at once vs serially"  },
+  { L"hash",      DemoDiskHash,         L"SHA-256 of a block range, naive vs overlapped I/O" },
+  { L"diskio",    DemoDiskRangeReads,   L"Odd-offset metadata reads, BlockIo vs DiskIo2"     },
+  { L"write",     DemoBlockWrites,      L"Write-through vs combined writes (destructive)"    },
+  { L"trace",     DemoBlockTrace,       L"Trace another mode's reads to BlockTrace.json"     },
+};
+
 /**
   Display media information for a block device.
 **/
@@ -113,6 +153,7 @@ AnalyzePartitionTable (
   UINT8       *Buffer;
   UINT8       *GptBuffer;
   UINT32      BlockSize;
+  GPT_TABLE   Gpt;
 
   BlockSize = BlockIo->Media->BlockSize;
 
@@ -129,13 +170,7 @@ AnalyzePartitionTable (
   }
 
   // Read LBA 0 (MBR or protective MBR for GPT)
-  Status = BlockIo->ReadBlocks (
-                      BlockIo,
-                      BlockIo->Media->MediaId,
-                      0,
-                      BlockSize,
-                      Buffer
-                      );
+  Status = BlockCacheRead (&mBlockCache, BlockIo, 0, BlockSize, Buffer);
 
   if (EFI_ERROR (Status)) {
     Print (L"  Failed to read LBA 0: %r\n", Status);
@@ -155,25 +190,26 @@ AnalyzePartitionTable (
   // Check for GPT (read LBA 1)
   GptBuffer = AllocateZeroPool (BlockSize);
   if (GptBuffer != NULL) {
-    Status = BlockIo->ReadBlocks (
-                        BlockIo,
-                        BlockIo->Media->MediaId,
-                        1,
-                        BlockSize,
-                        GptBuffer
-                        );
+    Status = BlockCacheRead (&mBlockCache, BlockIo, 1, BlockSize, GptBuffer);
 
     if (!EFI_ERROR (Status) && CheckGpt (GptBuffer)) {
       Print (L"    GPT (GUID Partition Table) detected\n");
 
-      // Parse GPT header
-      UINT64 *FirstUsableLba = (UINT64 *)(GptBuffer + 40);
-      UINT64 *LastUsableLba = (UINT64 *)(GptBuffer + 48);
-      UINT32 *NumPartitionEntries = (UINT32 *)(GptBuffer + 80);
-
-      Print (L"    First Usable LBA: %ld\n", *FirstUsableLba);
-      Print (L"    Last Usable LBA: %ld\n", *LastUsableLba);
-      Print (L"    Partition Entries: %d\n", *NumPartitionEntries);
+      // Verify both headers and index the entry array
+      Status = GptParse (&Gpt, BlockIo);
+      if (EFI_ERROR (Status)) {
+        Print (L"    GPT verification failed: %r\n", Status);
+      } else {
+        Print (L"    Header CRC32: primary %s, backup %s%s\n",
+               Gpt.PrimaryValid ? L"ok" : L"BAD",
+               Gpt.BackupValid ? L"ok" : L"BAD",
+               Gpt.UsedBackup ? L" (using backup)" : L"");
+        Print (L"    First Usable LBA: %ld\n", Gpt.Header.FirstUsableLBA);
+        Print (L"    Last Usable LBA: %ld\n", Gpt.Header.LastUsableLBA);
+        Print (L"    Partition Entries: %d (%d in use)\n",
+               Gpt.Header.NumberOfPartitionEntries, Gpt.EntryCount);
+        GptFree (&Gpt);
+      }
     } else {
       Print (L"    MBR (Master Boot Record) detected\n");
 
@@ -222,13 +258,7 @@ DumpBlockData (
     return EFI_OUT_OF_RESOURCES;
   }
 
-  Status = BlockIo->ReadBlocks (
-                      BlockIo,
-                      BlockIo->Media->MediaId,
-                      Lba,
-                      BlockSize,
-                      Buffer
-                      );
+  Status = BlockCacheRead (&mBlockCache, BlockIo, Lba, BlockSize, Buffer);
 
   if (EFI_ERROR (Status)) {
     Print (L"  Failed to read LBA %ld: %r\n", Lba, Status);
@@ -283,6 +313,11 @@ EnumerateBlockDevices (
 
   Print (L"Found %d block device handle(s)\n", HandleCount);
 
+  //
+  // A failed init leaves a zero-capacity cache that reads straight through
+  //
+  BlockCacheInit (&mBlockCache, PcdGet32 (PcdBlockCacheBlocks), PcdGet32 (PcdBlockCacheReadAhead));
+
   for (Index = 0; Index < HandleCount; Index++) {
     Status = gBS->HandleProtocol (
                     HandleBuffer[Index],
@@ -337,10 +372,204 @@ EnumerateBlockDevices (
   gBS->FreePool (HandleBuffer);
 
   Print (L"\nTotal devices with media: %d\n", DeviceCount);
+  Print (L"Block cache: %ld hits, %ld misses, %ld device reads\n",
+         mBlockCache.Hits, mBlockCache.Misses, mBlockCache.DeviceReads);
+
+  BlockCacheFree (&mBlockCache);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Parse a command line argument that must be a whole decimal number.
+
+  @param[in]   Text   Argument text.
+  @param[out]  Value  Receives the number.
+
+  @retval EFI_SUCCESS            Text is a decimal number.
+  @retval EFI_INVALID_PARAMETER  Text is empty, has trailing characters, or
+                                 does not fit in 64 bits.
+**/
+EFI_STATUS
+ParseDecimal (
+  IN  CONST CHAR16  *Text,
+  OUT UINT64        *Value
+  )
+{
+  RETURN_STATUS  Status;
+  CHAR16         *End;
+
+  Status = StrDecimalToUint64S (Text, &End, Value);
+  if (RETURN_ERROR (Status) || (End == Text) || (*End != L'\0')) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Select a block device by the number shown in the default device listing.
+
+  Without an argument, or with 0, the first whole disk with media present
+  is chosen.
+
+  @param[in]   Argument  Device number as text, or NULL.
+  @param[out]  Handle    Receives the device handle.
+  @param[out]  BlockIo   Receives the device's Block I/O protocol.
+  @param[out]  BlockIo2  Receives the device's Block I/O 2 protocol, or NULL
+                         if it has none. Optional.
+**/
+EFI_STATUS
+SelectBlockDevice (
+  IN  CONST CHAR16            *Argument OPTIONAL,
+  OUT EFI_HANDLE              *Handle,
+  OUT EFI_BLOCK_IO_PROTOCOL   **BlockIo,
+  OUT EFI_BLOCK_IO2_PROTOCOL  **BlockIo2 OPTIONAL
+  )
+{
+  EFI_STATUS             Status;
+  EFI_HANDLE             *HandleBuffer;
+  UINTN                  HandleCount;
+  UINTN                  Index;
+  UINT64                 Wanted;
+  UINTN                  DeviceCount;
+  EFI_BLOCK_IO_PROTOCOL  *Candidate;
+
+  Wanted = 0;
+  if ((Argument != NULL) && EFI_ERROR (ParseDecimal (Argument, &Wanted))) {
+    Print (L"Invalid device number '%s'\n", Argument);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiBlockIoProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &HandleBuffer
+                  );
+
+  if (EFI_ERROR (Status)) {
+    Print (L"No block devices found: %r\n", Status);
+    return Status;
+  }
+
+  DeviceCount = 0;
+  Status      = EFI_NOT_FOUND;
+
+  //
+  // Number devices exactly as EnumerateBlockDevices () does
+  //
+  for (Index = 0; Index < HandleCount; Index++) {
+    if (EFI_ERROR (gBS->HandleProtocol (HandleBuffer[Index], &gEfiBlockIoProtocolGuid, (VOID **)&Candidate))) {
+      continue;
+    }
+
+    if (!Candidate->Media->MediaPresent) {
+      continue;
+    }
+
+    DeviceCount++;
+    if ((Wanted == DeviceCount) || ((Wanted == 0) && !Candidate->Media->LogicalPartition)) {
+      *Handle  = HandleBuffer[Index];
+      *BlockIo = Candidate;
+      Status   = EFI_SUCCESS;
+      break;
+    }
+  }
+
+  gBS->FreePool (HandleBuffer);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"Block device %s not found\n", (Argument != NULL) ? Argument : L"(whole disk)");
+    return Status;
+  }
+
+  if (BlockIo2 != NULL) {
+    if (EFI_ERROR (gBS->HandleProtocol (*Handle, &gEfiBlockIo2ProtocolGuid, (VOID **)BlockIo2))) {
+      *BlockIo2 = NULL;
+    }
+  }
+
+  Print (L"Device %d: %d-byte blocks, %ld MB%s\n",
+         DeviceCount,
+         (*BlockIo)->Media->BlockSize,
+         DivU64x32 (MultU64x32 ((*BlockIo)->Media->LastBlock + 1, (*BlockIo)->Media->BlockSize), SIZE_1MB),
+         (*BlockIo)->Media->LogicalPartition ? L" (partition)" : L""
+         );
 
   return EFI_SUCCESS;
 }
 
+/**
+  Get the shell command line arguments, if any.
+**/
+UINTN
+GetArguments (
+  IN  EFI_HANDLE  ImageHandle,
+  OUT CHAR16      ***Argv
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **)&ShellParameters
+                  );
+
+  if (EFI_ERROR (Status)) {
+    *Argv = NULL;
+    return 0;
+  }
+
+  *Argv = ShellParameters->Argv;
+  return ShellParameters->Argc;
+}
+
+/**
+  Print the available modes.
+**/
+VOID
+PrintUsage (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  Print (L"\nUsage: BlockIoExample.efi [mode] [device]\n\n");
+  Print (L"Without a mode the block devices are listed and analysed.\n");
+  Print (L"Device numbers follow that listing; the default is the first disk.\n\n");
+  Print (L"Modes:\n");
+  for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+    Print (L"  %-10s %s\n", mModes[Index].Name, mModes[Index].Description);
+  }
+}
+
+/**
+  Look up a mode by name.
+
+  @param[in]  Name  Mode name from the command line.
+
+  @return The mode's function, or NULL if there is no such mode.
+**/
+BLOCK_IO_EXAMPLE_MODE_FUNCTION
+FindMode (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+    if (StrCmp (Name, mModes[Index].Name) == 0) {
+      return mModes[Index].Function;
+    }
+  }
+
+  return NULL;
+}
+
 /**
   Application entry point.
 **/
@@ -351,9 +580,24 @@ BlockIoExampleMain (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
+  UINTN                           Argc;
+  CHAR16                          **Argv;
+  BLOCK_IO_EXAMPLE_MODE_FUNCTION  Mode;
+
   Print (L"Block I/O Example\n");
   Print (L"=================\n");
 
+  Argc = GetArguments (ImageHandle, &Argv);
+  if (Argc >= 2) {
+    Mode = FindMode (Argv[1]);
+    if (Mode != NULL) {
+      return Mode (ImageHandle, Argc - 2, Argv + 2);
+    }
+
+    PrintUsage ();
+    return (StrCmp (Argv[1], L"help") == 0) ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+  }
+
   EnumerateBlockDevices ();
 
   Print (L"\n=== Block I/O Operations Summary ===\n\n");
@@ -0,0 +1,184 @@
+/** @file
+  Block I/O Example - shared declarations for the example modes.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef BLOCK_IO_EXAMPLE_H_
+#define BLOCK_IO_EXAMPLE_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
+#include <Protocol/SimpleFileSystem.h>
+
+///
+/// A mode selected by the first command line argument. Argv starts after
+/// the mode name.
+///
+typedef
+EFI_STATUS
+(*BLOCK_IO_EXAMPLE_MODE_FUNCTION)(
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Enumerate all block devices.
+**/
+EFI_STATUS
+EnumerateBlockDevices (
+  VOID
+  );
+
+/**
+  Look up a mode by name.
+
+  @param[in]  Name  Mode name from the command line.
+
+  @return The mode's function, or NULL if there is no such mode.
+**/
+BLOCK_IO_EXAMPLE_MODE_FUNCTION
+FindMode (
+  IN CONST CHAR16  *Name
+  );
+
+/**
+  Parse a command line argument that must be a whole decimal number.
+
+  @param[in]   Text   Argument text.
+  @param[out]  Value  Receives the number.
+
+  @retval EFI_SUCCESS            Text is a decimal number.
+  @retval EFI_INVALID_PARAMETER  Text is empty, has trailing characters, or
+                                 does not fit in 64 bits.
+**/
+EFI_STATUS
+ParseDecimal (
+  IN  CONST CHAR16  *Text,
+  OUT UINT64        *Value
+  );
+
+/**
+  Select a block device by the number shown in the default device listing.
+
+  Without an argument, or with 0, the first whole disk with media present
+  is chosen.
+
+  @param[in]   Argument  Device number as text, or NULL.
+  @param[out]  Handle    Receives the device handle.
+  @param[out]  BlockIo   Receives the device's Block I/O protocol.
+  @param[out]  BlockIo2  Receives the device's Block I/O 2 protocol, or NULL
+                         if it has none. Optional.
+**/
+EFI_STATUS
+SelectBlockDevice (
+  IN  CONST CHAR16            *Argument OPTIONAL,
+  OUT EFI_HANDLE              *Handle,
+  OUT EFI_BLOCK_IO_PROTOCOL   **BlockIo,
+  OUT EFI_BLOCK_IO2_PROTOCOL  **BlockIo2 OPTIONAL
+  );
+
+/**
+  Measure async read throughput and IOPS against queue depth.
+**/
+EFI_STATUS
+DemoAsyncQueueDepth (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Run the sequential and random read benchmark on one device.
+**/
+EFI_STATUS
+DemoBlockBenchmark (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Compare naive and alignment-planned reads of unaligned byte ranges.
+**/
+EFI_STATUS
+DemoAlignedTransfers (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Show block cache hit rates on repeated partition-table walks.
+**/
+EFI_STATUS
+DemoBlockCache (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Parse and verify one disk's GPT and demonstrate lookups.
+**/
+EFI_STATUS
+DemoGptParse (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Probe every block device concurrently and compare with the serial path.
+**/
+EFI_STATUS
+DemoParallelProbe (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Hash a block range with and without overlapping I/O and compute.
+**/
+EFI_STATUS
+DemoDiskHash (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Compare Block I/O slicing with Disk I/O 2 byte-range reads.
+**/
+EFI_STATUS
+DemoDiskRangeReads (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Compare write-through and combined writes on a scratch region.
+**/
+EFI_STATUS
+DemoBlockWrites (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Run another mode with block read tracing and export the timeline.
+**/
+EFI_STATUS
+DemoBlockTrace (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+#endif // BLOCK_IO_EXAMPLE_H_
@@ -0,0 +1,484 @@
+/** @file
+  Block I/O Example - block read latency tracer.
+
+  Records are addressed by id modulo the ring capacity. BlockTraceSubmit ()
+  claims an id at TPL_CALLBACK so completion notifications cannot observe
+  a half-written record, and BlockTraceComplete () checks the record still
+  carries its id, so a completion that arrives after the ring has wrapped
+  is dropped instead of corrupting a newer record.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SortLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/ExportFileLib.h>
+
+#include "BlockIoExample.h"
+#include "BlockTrace.h"
+
+#define BLOCK_TRACE_MAX_DEVICES  32
+
+typedef struct {
+  BLOCK_TRACE_RECORD    *Records;
+  UINT32                Capacity;
+  UINT64                NextId;
+  BOOLEAN               Running;
+  UINT64                StartTicks;
+} BLOCK_TRACE;
+
+STATIC BLOCK_TRACE  mTrace;
+
+/**
+  Order latencies for PerformQuickSort ().
+**/
+STATIC
+INTN
+EFIAPI
+CompareLatency (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  UINT64  Left;
+  UINT64  Right;
+
+  Left  = *(CONST UINT64 *)Buffer1;
+  Right = *(CONST UINT64 *)Buffer2;
+  if (Left != Right) {
+    return (Left < Right) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/**
+  Return the record for an id that is still in the ring, or NULL.
+**/
+STATIC
+BLOCK_TRACE_RECORD *
+FindRecord (
+  IN UINT64  Id
+  )
+{
+  BLOCK_TRACE_RECORD  *Record;
+
+  if ((Id == BLOCK_TRACE_NO_ID) || (mTrace.Records == NULL)) {
+    return NULL;
+  }
+
+  Record = &mTrace.Records[ModU64x32 (Id, mTrace.Capacity)];
+  return (Record->Id == Id) ? Record : NULL;
+}
+
+/**
+  Return the id of the oldest record still in the ring.
+**/
+STATIC
+UINT64
+OldestId (
+  VOID
+  )
+{
+  return (mTrace.NextId > mTrace.Capacity) ? mTrace.NextId - mTrace.Capacity : 0;
+}
+
+/**
+  Map a device to a timeline row, numbering devices in order of appearance.
+**/
+STATIC
+UINTN
+DeviceRow (
+  IN     EFI_BLOCK_IO_MEDIA  *Media,
+  IN OUT EFI_BLOCK_IO_MEDIA  **Devices,
+  IN OUT UINTN               *DeviceCount
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < *DeviceCount; Index++) {
+    if (Devices[Index] == Media) {
+      return Index + 1;
+    }
+  }
+
+  if (*DeviceCount == BLOCK_TRACE_MAX_DEVICES) {
+    return 0;
+  }
+
+  Devices[(*DeviceCount)++] = Media;
+  return *DeviceCount;
+}
+
+/**
+  Allocate a ring of Capacity records and start recording.
+
+  @param[in]  Capacity  Records kept; older ones are overwritten.
+
+  @retval EFI_SUCCESS            Recording has started.
+  @retval EFI_INVALID_PARAMETER  Capacity is 0.
+  @retval EFI_ALREADY_STARTED    A trace is already running.
+  @retval EFI_OUT_OF_RESOURCES   The ring could not be allocated.
+**/
+EFI_STATUS
+BlockTraceStart (
+  IN UINTN  Capacity
+  )
+{
+  if ((Capacity == 0) || (Capacity > MAX_UINT32)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mTrace.Records != NULL) {
+    return EFI_ALREADY_STARTED;
+  }
+
+  mTrace.Records = AllocateZeroPool (Capacity * sizeof (BLOCK_TRACE_RECORD));
+  if (mTrace.Records == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mTrace.Capacity   = (UINT32)Capacity;
+  mTrace.NextId     = 0;
+  mTrace.StartTicks = BenchmarkGetTicks ();
+  mTrace.Running    = TRUE;
+
+  //
+  // Slot 0 must not match id 0 before it has been written
+  //
+  mTrace.Records[0].Id = BLOCK_TRACE_NO_ID;
+  return EFI_SUCCESS;
+}
+
+/**
+  Stop recording. The records stay available until BlockTraceFree ().
+**/
+VOID
+BlockTraceStop (
+  VOID
+  )
+{
+  mTrace.Running = FALSE;
+}
+
+/**
+  Release the ring.
+**/
+VOID
+BlockTraceFree (
+  VOID
+  )
+{
+  if (mTrace.Records != NULL) {
+    FreePool (mTrace.Records);
+  }
+
+  ZeroMem (&mTrace, sizeof (mTrace));
+}
+
+/**
+  Record the submission of a read.
+
+  Must be called at or below TPL_CALLBACK.
+
+  @param[in]  Media   Media of the device being read.
+  @param[in]  Lba     First block.
+  @param[in]  Length  Bytes requested.
+  @param[in]  Async   TRUE for ReadBlocksEx () with an event.
+
+  @return The record id to pass to BlockTraceComplete (), or
+          BLOCK_TRACE_NO_ID when no trace is running.
+**/
+UINT64
+BlockTraceSubmit (
+  IN EFI_BLOCK_IO_MEDIA  *Media,
+  IN EFI_LBA             Lba,
+  IN UINTN               Length,
+  IN BOOLEAN             Async
+  )
+{
+  EFI_TPL             OldTpl;
+  UINT64              Id;
+  BLOCK_TRACE_RECORD  *Record;
+
+  if (!mTrace.Running) {
+    return BLOCK_TRACE_NO_ID;
+  }
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  Id                  = mTrace.NextId++;
+  Record              = &mTrace.Records[ModU64x32 (Id, mTrace.Capacity)];
+  Record->Id          = Id;
+  Record->Media       = Media;
+  Record->Lba         = Lba;
+  Record->Length      = (UINT32)Length;
+  Record->Async       = Async;
+  Record->Completed   = FALSE;
+  Record->Status      = EFI_NOT_READY;
+  Record->SubmitTicks = BenchmarkGetTicks ();
+
+  gBS->RestoreTPL (OldTpl);
+  return Id;
+}
+
+/**
+  Record the completion of a read.
+
+  Ids that are BLOCK_TRACE_NO_ID or have already been overwritten are
+  ignored.
+
+  @param[in]  Id      Value returned by BlockTraceSubmit ().
+  @param[in]  Status  Result of the read.
+**/
+VOID
+BlockTraceComplete (
+  IN UINT64      Id,
+  IN EFI_STATUS  Status
+  )
+{
+  UINT64              Ticks;
+  BLOCK_TRACE_RECORD  *Record;
+
+  Ticks  = BenchmarkGetTicks ();
+  Record = FindRecord (Id);
+  if (Record == NULL) {
+    return;
+  }
+
+  Record->CompleteTicks = Ticks;
+  Record->Status        = Status;
+  Record->Completed     = TRUE;
+}
+
+/**
+  ReadBlocks () with tracing.
+
+  @param[in]   BlockIo     Device to read.
+  @param[in]   MediaId     Media the read is for.
+  @param[in]   Lba         First block.
+  @param[in]   BufferSize  Bytes to read.
+  @param[out]  Buffer      Receives the data.
+
+  @return The ReadBlocks () result.
+**/
+EFI_STATUS
+BlockTraceReadBlocks (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  UINT32                 MediaId,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  BufferSize,
+  OUT VOID                   *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Id;
+
+  Id     = BlockTraceSubmit (BlockIo->Media, Lba, BufferSize, FALSE);
+  Status = BlockIo->ReadBlocks (BlockIo, MediaId, Lba, BufferSize, Buffer);
+  BlockTraceComplete (Id, Status);
+  return Status;
+}
+
+/**
+  Print record counts and latency percentiles per kind of read.
+**/
+VOID
+BlockTracePrintSummary (
+  VOID
+  )
+{
+  UINT64              *Latency;
+  UINTN               Count;
+  UINTN               Errors;
+  UINTN               Pending;
+  UINTN               Kind;
+  UINT64              Id;
+  BLOCK_TRACE_RECORD  *Record;
+
+  if (mTrace.NextId == 0) {
+    Print (L"No reads recorded\n");
+    return;
+  }
+
+  Print (L"%ld reads recorded", mTrace.NextId);
+  if (OldestId () != 0) {
+    Print (L", oldest %ld overwritten", OldestId ());
+  }
+
+  Print (L"\n\nKind      Reads Errors   p50 us   p90 us   p99 us   max us\n");
+  Print (L"------ -------- ------ -------- -------- -------- --------\n");
+
+  Latency = AllocatePool ((UINTN)MIN (mTrace.NextId, mTrace.Capacity) * sizeof (UINT64));
+  if (Latency == NULL) {
+    return;
+  }
+
+  Pending = 0;
+  for (Kind = 0; Kind < 2; Kind++) {
+    Count  = 0;
+    Errors = 0;
+    for (Id = OldestId (); Id < mTrace.NextId; Id++) {
+      Record = FindRecord (Id);
+      if ((Record == NULL) || (Record->Async != (Kind == 1))) {
+        continue;
+      }
+
+      if (!Record->Completed) {
+        Pending++;
+      } else if (EFI_ERROR (Record->Status)) {
+        Errors++;
+      } else {
+        Latency[Count++] = BenchmarkElapsedNs (Record->SubmitTicks, Record->CompleteTicks);
+      }
+    }
+
+    if (Count + Errors == 0) {
+      continue;
+    }
+
+    Print (L"%-6s %8d %6d", (Kind == 1) ? L"async" : L"sync", Count + Errors, Errors);
+    if (Count == 0) {
+      Print (L"\n");
+      continue;
+    }
+
+    PerformQuickSort (Latency, Count, sizeof (UINT64), CompareLatency);
+    Print (L" %8ld %8ld %8ld %8ld\n",
+           DivU64x32 (Latency[Count / 2], 1000),
+           DivU64x32 (Latency[Count * 90 / 100], 1000),
+           DivU64x32 (Latency[Count * 99 / 100], 1000),
+           DivU64x32 (Latency[Count - 1], 1000)
+           );
+  }
+
+  if (Pending != 0) {
+    Print (L"%d read(s) never completed\n", Pending);
+  }
+
+  FreePool (Latency);
+}
+
+/**
+  Write the recorded reads as Chrome trace-event JSON.
+
+  Synchronous reads become complete ("X") events and asynchronous reads
+  become async begin/end pairs, one timeline row per device.
+
+  @param[in]  File  Open, empty file to write.
+
+  @retval EFI_SUCCESS    The trace was written.
+  @retval EFI_NOT_READY  Nothing has been recorded.
+  @retval Others         A file write failed.
+**/
+EFI_STATUS
+BlockTraceExport (
+  IN EFI_FILE_PROTOCOL  *File
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Devices[BLOCK_TRACE_MAX_DEVICES];
+  UINTN               DeviceCount;
+  UINTN               Row;
+  UINTN               Index;
+  UINT64              Id;
+  UINT64              StartNs;
+  UINT64              EndNs;
+  UINT32              StartFraction;
+  UINT32              EndFraction;
+  BLOCK_TRACE_RECORD  *Record;
+
+  if (mTrace.NextId == 0) {
+    return EFI_NOT_READY;
+  }
+
+  DeviceCount = 0;
+  Status      = FilePrint (File, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  if (!EFI_ERROR (Status)) {
+    Status = FilePrint (
+               File,
+               "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"BlockIoExample\"}}"
+               );
+  }
+
+  for (Id = OldestId (); Id < mTrace.NextId && !EFI_ERROR (Status); Id++) {
+    Record = FindRecord (Id);
+    if ((Record == NULL) || !Record->Completed) {
+      continue;
+    }
+
+    //
+    // Timestamps are microseconds from BlockTraceStart () with ns precision
+    //
+    Row     = DeviceRow (Record->Media, Devices, &DeviceCount);
+    StartNs = DivU64x32Remainder (BenchmarkElapsedNs (mTrace.StartTicks, Record->SubmitTicks), 1000, &StartFraction);
+    EndNs   = DivU64x32Remainder (BenchmarkElapsedNs (mTrace.StartTicks, Record->CompleteTicks), 1000, &EndFraction);
+
+    if (!Record->Async) {
+      Status = FilePrint (
+                 File,
+                 ",\n{\"name\":\"read\",\"cat\":\"sync\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%ld.%03d,"
+                 "\"dur\":%ld,\"args\":{\"lba\":%ld,\"bytes\":%d,\"status\":\"%r\"}}",
+                 Row,
+                 StartNs,
+                 StartFraction,
+                 DivU64x32 (BenchmarkElapsedNs (Record->SubmitTicks, Record->CompleteTicks), 1000),
+                 Record->Lba,
+                 Record->Length,
+                 Record->Status
+                 );
+      continue;
+    }
+
+    Status = FilePrint (
+               File,
+               ",\n{\"name\":\"read\",\"cat\":\"async\",\"ph\":\"b\",\"id\":%ld,\"pid\":1,\"tid\":%d,\"ts\":%ld.%03d,"
+               "\"args\":{\"lba\":%ld,\"bytes\":%d,\"status\":\"%r\"}}",
+               Record->Id,
+               Row,
+               StartNs,
+               StartFraction,
+               Record->Lba,
+               Record->Length,
+               Record->Status
+               );
+    if (!EFI_ERROR (Status)) {
+      Status = FilePrint (
+                 File,
+                 ",\n{\"name\":\"read\",\"cat\":\"async\",\"ph\":\"e\",\"id\":%ld,\"pid\":1,\"tid\":%d,"
+                 "\"ts\":%ld.%03d}",
+                 Record->Id,
+                 Row,
+                 EndNs,
+                 EndFraction
+                 );
+    }
+  }
+
+  //
+  // Name each device row
+  //
+  for (Index = 0; Index < DeviceCount && !EFI_ERROR (Status); Index++) {
+    Status = FilePrint (
+               File,
+               ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+               "\"args\":{\"name\":\"%a %d (%d-byte blocks)\"}}",
+               Index + 1,
+               Devices[Index]->LogicalPartition ? "partition" : "disk",
+               Index + 1,
+               Devices[Index]->BlockSize
+               );
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = FilePrint (File, "\n]}\n");
+  }
+
+  return Status;
+}
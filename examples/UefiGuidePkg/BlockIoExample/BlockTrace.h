@@ -0,0 +1,155 @@
+/** @file
+  Block I/O Example - block read latency tracer.
+
+  While a trace is running every read issued by the example records its
+  device, LBA, length, submit and completion time and status into a ring of
+  BLOCK_TRACE_RECORDs allocated by BlockTraceStart (). Recording never
+  allocates; once the ring is full the oldest records are overwritten.
+  BlockTraceExport () writes the ring as Chrome trace-event JSON, which
+  chrome://tracing and Perfetto display as a per-device timeline.
+
+  Synchronous reads go through BlockTraceReadBlocks (). Asynchronous
+  readers call BlockTraceSubmit () before ReadBlocksEx () and
+  BlockTraceComplete () from their completion notification.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef BLOCK_TRACE_H_
+#define BLOCK_TRACE_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/SimpleFileSystem.h>
+
+///
+/// Returned by BlockTraceSubmit () when no trace is running
+///
+#define BLOCK_TRACE_NO_ID  MAX_UINT64
+
+typedef struct {
+  UINT64                Id;             ///< Submission sequence number
+  EFI_BLOCK_IO_MEDIA    *Media;         ///< Identifies the device
+  EFI_LBA               Lba;
+  UINT32                Length;
+  BOOLEAN               Async;
+  BOOLEAN               Completed;
+  EFI_STATUS            Status;
+  UINT64                SubmitTicks;
+  UINT64                CompleteTicks;
+} BLOCK_TRACE_RECORD;
+
+/**
+  Allocate a ring of Capacity records and start recording.
+
+  @param[in]  Capacity  Records kept; older ones are overwritten.
+
+  @retval EFI_SUCCESS            Recording has started.
+  @retval EFI_INVALID_PARAMETER  Capacity is 0.
+  @retval EFI_ALREADY_STARTED    A trace is already running.
+  @retval EFI_OUT_OF_RESOURCES   The ring could not be allocated.
+**/
+EFI_STATUS
+BlockTraceStart (
+  IN UINTN  Capacity
+  );
+
+/**
+  Stop recording. The records stay available until BlockTraceFree ().
+**/
+VOID
+BlockTraceStop (
+  VOID
+  );
+
+/**
+  Release the ring.
+**/
+VOID
+BlockTraceFree (
+  VOID
+  );
+
+/**
+  Record the submission of a read.
+
+  Must be called at or below TPL_CALLBACK.
+
+  @param[in]  Media   Media of the device being read.
+  @param[in]  Lba     First block.
+  @param[in]  Length  Bytes requested.
+  @param[in]  Async   TRUE for ReadBlocksEx () with an event.
+
+  @return The record id to pass to BlockTraceComplete (), or
+          BLOCK_TRACE_NO_ID when no trace is running.
+**/
+UINT64
+BlockTraceSubmit (
+  IN EFI_BLOCK_IO_MEDIA  *Media,
+  IN EFI_LBA             Lba,
+  IN UINTN               Length,
+  IN BOOLEAN             Async
+  );
+
+/**
+  Record the completion of a read.
+
+  Ids that are BLOCK_TRACE_NO_ID or have already been overwritten are
+  ignored.
+
+  @param[in]  Id      Value returned by BlockTraceSubmit ().
+  @param[in]  Status  Result of the read.
+**/
+VOID
+BlockTraceComplete (
+  IN UINT64      Id,
+  IN EFI_STATUS  Status
+  );
+
+/**
+  ReadBlocks () with tracing.
+
+  @param[in]   BlockIo     Device to read.
+  @param[in]   MediaId     Media the read is for.
+  @param[in]   Lba         First block.
+  @param[in]   BufferSize  Bytes to read.
+  @param[out]  Buffer      Receives the data.
+
+  @return The ReadBlocks () result.
+**/
+EFI_STATUS
+BlockTraceReadBlocks (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  UINT32                 MediaId,
+  IN  EFI_LBA                Lba,
+  IN  UINTN                  BufferSize,
+  OUT VOID                   *Buffer
+  );
+
+/**
+  Print record counts and latency percentiles per kind of read.
+**/
+VOID
+BlockTracePrintSummary (
+  VOID
+  );
+
+/**
+  Write the recorded reads as Chrome trace-event JSON.
+
+  Synchronous reads become complete ("X") events and asynchronous reads
+  become async begin/end pairs, one timeline row per device.
+
+  @param[in]  File  Open, empty file to write.
+
+  @retval EFI_SUCCESS    The trace was written.
+  @retval EFI_NOT_READY  Nothing has been recorded.
+  @retval Others         A file write failed.
+**/
+EFI_STATUS
+BlockTraceExport (
+  IN EFI_FILE_PROTOCOL  *File
+  );
+
+#endif // BLOCK_TRACE_H_
@@ -0,0 +1,95 @@
+/** @file
+  Block I/O Example - trace another mode's block reads.
+
+  Starts the latency tracer, runs the given mode (or the default device
+  listing) with its arguments, then prints latency percentiles for the
+  synchronous and asynchronous reads it issued and writes the timeline to
+  \BlockTrace.json on the boot volume. Open the file in chrome://tracing or
+  ui.perfetto.dev: each device is a row, synchronous reads are solid spans,
+  and overlapping async reads show the queue depth actually reached.
+
+  Usage: BlockIoExample.efi trace [mode] [mode arguments]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/PcdLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/ExportFileLib.h>
+
+#include "BlockIoExample.h"
+#include "BlockTrace.h"
+
+#define TRACE_FILE  L"\\BlockTrace.json"
+
+/**
+  Run another mode with block read tracing and export the timeline.
+**/
+EFI_STATUS
+DemoBlockTrace (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS                      Status;
+  EFI_STATUS                      ExportStatus;
+  BLOCK_IO_EXAMPLE_MODE_FUNCTION  Mode;
+  EFI_FILE_PROTOCOL               *File;
+  UINT64                          Size;
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Mode = NULL;
+  if (Argc > 0) {
+    Mode = FindMode (Argv[0]);
+    if ((Mode == NULL) || (Mode == DemoBlockTrace)) {
+      Print (L"Cannot trace \"%s\"\n", Argv[0]);
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  Status = BlockTraceStart (PcdGet32 (PcdBlockTraceRecords));
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot start the trace: %r\n", Status);
+    return Status;
+  }
+
+  if (Mode != NULL) {
+    Status = Mode (ImageHandle, Argc - 1, Argv + 1);
+  } else {
+    Status = EnumerateBlockDevices ();
+  }
+
+  BlockTraceStop ();
+
+  Print (L"\n=== Block Read Trace ===\n\n");
+  BlockTracePrintSummary ();
+
+  ExportStatus = OpenBootVolumeFile (ImageHandle, TRACE_FILE, &File);
+  if (!EFI_ERROR (ExportStatus)) {
+    ExportStatus = BlockTraceExport (File);
+    Size         = 0;
+    File->GetPosition (File, &Size);
+    File->Flush (File);
+    File->Close (File);
+    if (!EFI_ERROR (ExportStatus)) {
+      Print (L"\nTimeline written to %s (%ld bytes)\n", TRACE_FILE, Size);
+    }
+  }
+
+  if (EFI_ERROR (ExportStatus)) {
+    Print (L"\nCannot write %s: %r\n", TRACE_FILE, ExportStatus);
+  }
+
+  BlockTraceFree ();
+  return Status;
+}
@@ -0,0 +1,333 @@
+/** @file
+  Block I/O Example - write-through versus combined block writes.
+
+  Replays an image-patching style workload: every block of a region is
+  written one at a time, then every third block is patched again. The same
+  workload runs three ways: WriteBlocks () plus FlushBlocks () per write,
+  WriteBlocks () per write with one flush at the end, and the BLOCK_WRITER,
+  which merges the writes into large WriteBlocksEx () calls and flushes only
+  at barriers. The region is cleared before each run and read back after
+  it, so every method has to leave exactly the same data on the disk.
+
+  THIS MODE WRITES TO THE DISK. The region is saved first and restored at
+  the end, but a reset part-way through leaves it modified. Use a scratch
+  disk, for example a QEMU file-backed drive.
+
+  Usage: BlockIoExample.efi write <device> <lba> [barrier blocks]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "BlockWriter.h"
+#include "BlockTrace.h"
+
+#define WRITE_REGION_BLOCKS  2048
+#define WRITE_PATCH_STRIDE   3
+#define WRITE_COMBINE_SIZE   SIZE_256KB
+
+typedef enum {
+  WriteThrough,
+  WriteFlushAtEnd,
+  WriteCombined
+} WRITE_METHOD;
+
+///
+/// Device and buffers shared by every run
+///
+typedef struct {
+  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL    *BlockIo2;
+  EFI_LBA                   Lba;
+  UINTN                     Blocks;
+  UINT64                    BarrierBlocks;
+  UINT8                     *Block;           ///< One block, IoAlign aligned
+  UINT8                     *Region;          ///< Whole region, IoAlign aligned
+  UINTN                     RegionPages;
+} WRITE_TEST;
+
+/**
+  Fill a block with a stamp identifying its LBA and the pass that wrote it.
+**/
+STATIC
+VOID
+StampBlock (
+  OUT UINT8    *Block,
+  IN  UINT32   BlockSize,
+  IN  EFI_LBA  Lba,
+  IN  UINTN    Pass
+  )
+{
+  SetMem32 (Block, BlockSize, (UINT32)Lba * 4 + (UINT32)Pass + 1);
+}
+
+/**
+  Replay the workload with one method and report it.
+**/
+STATIC
+EFI_STATUS
+RunWrites (
+  IN WRITE_TEST    *Test,
+  IN WRITE_METHOD  Method,
+  IN CONST CHAR16  *Label
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  UINT32                 BlockSize;
+  BLOCK_WRITER           Writer;
+  UINTN                  Pass;
+  UINTN                  Index;
+  UINT64                 Writes;
+  UINT64                 DeviceWrites;
+  UINT64                 Flushes;
+  UINT64                 Start;
+  UINT64                 ElapsedNs;
+  EFI_LBA                Lba;
+
+  BlockIo   = Test->BlockIo;
+  BlockSize = BlockIo->Media->BlockSize;
+
+  //
+  // Start from a zeroed region so a method that writes nothing fails
+  //
+  ZeroMem (Test->Region, Test->Blocks * BlockSize);
+  Status = BlockIo->WriteBlocks (BlockIo, BlockIo->Media->MediaId, Test->Lba, Test->Blocks * BlockSize, Test->Region);
+  if (!EFI_ERROR (Status)) {
+    Status = BlockIo->FlushBlocks (BlockIo);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Print (L"%-16s clearing the region failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  if (Method == WriteCombined) {
+    Status = BlockWriterInit (&Writer, BlockIo, Test->BlockIo2, WRITE_COMBINE_SIZE, Test->BarrierBlocks);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  Writes       = 0;
+  DeviceWrites = 0;
+  Flushes      = 0;
+  Start        = BenchmarkGetTicks ();
+
+  for (Pass = 0; Pass < 2 && !EFI_ERROR (Status); Pass++) {
+    for (Index = 0; Index < Test->Blocks && !EFI_ERROR (Status); Index += (Pass == 0) ? 1 : WRITE_PATCH_STRIDE) {
+      Lba = Test->Lba + Index;
+      StampBlock (Test->Block, BlockSize, Lba, Pass);
+      Writes++;
+
+      if (Method == WriteCombined) {
+        Status = BlockWriterWrite (&Writer, Lba, BlockSize, Test->Block);
+        continue;
+      }
+
+      Status = BlockIo->WriteBlocks (BlockIo, BlockIo->Media->MediaId, Lba, BlockSize, Test->Block);
+      DeviceWrites++;
+      if (!EFI_ERROR (Status) && (Method == WriteThrough)) {
+        Status = BlockIo->FlushBlocks (BlockIo);
+        Flushes++;
+      }
+    }
+  }
+
+  if (Method == WriteCombined) {
+    if (!EFI_ERROR (Status)) {
+      Status = BlockWriterBarrier (&Writer);
+    }
+
+    DeviceWrites = Writer.DeviceWrites;
+    Flushes      = Writer.Flushes;
+    BlockWriterFree (&Writer);
+  } else if (!EFI_ERROR (Status) && (Method == WriteFlushAtEnd)) {
+    Status = BlockIo->FlushBlocks (BlockIo);
+    Flushes++;
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  if (EFI_ERROR (Status)) {
+    Print (L"%-16s failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  //
+  // Read back and check the last stamp of every block
+  //
+  Status = BlockTraceReadBlocks (BlockIo, BlockIo->Media->MediaId, Test->Lba, Test->Blocks * BlockSize, Test->Region);
+  if (EFI_ERROR (Status)) {
+    Print (L"%-16s read back failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  for (Index = 0; Index < Test->Blocks; Index++) {
+    StampBlock (Test->Block, BlockSize, Test->Lba + Index, ((Index % WRITE_PATCH_STRIDE) == 0) ? 1 : 0);
+    if (CompareMem (Test->Region + Index * BlockSize, Test->Block, BlockSize) != 0) {
+      Print (L"%-16s DATA MISMATCH at LBA %ld\n", Label, Test->Lba + Index);
+      return EFI_VOLUME_CORRUPTED;
+    }
+  }
+
+  Print (L"%-16s %6ld %8ld %7ld %8ld %10ld\n",
+         Label,
+         Writes,
+         DeviceWrites,
+         Flushes,
+         DivU64x32 (ElapsedNs, 1000000),
+         (ElapsedNs != 0) ? DivU64x64Remainder (MultU64x32 (Writes, 1000000000), ElapsedNs, NULL) : 0
+         );
+  return EFI_SUCCESS;
+}
+
+/**
+  Compare write-through and combined writes on a scratch region.
+**/
+EFI_STATUS
+DemoBlockWrites (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS          Status;
+  EFI_STATUS          RestoreStatus;
+  EFI_HANDLE          Handle;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  WRITE_TEST          Test;
+  UINT8               *Saved;
+  UINTN               Bytes;
+  UINT64              Device;
+
+  Print (L"\n=== Write-Through vs Combined Writes ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Never pick a device or region by default for a destructive test
+  //
+  if (Argc < 2) {
+    Print (L"Usage: BlockIoExample.efi write <device> <lba> [barrier blocks]\n");
+    Print (L"This mode overwrites %d blocks from <lba>; use a scratch disk.\n", WRITE_REGION_BLOCKS);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // A mistyped argument must not fall back to the boot disk or to LBA 0
+  //
+  ZeroMem (&Test, sizeof (Test));
+  if (EFI_ERROR (ParseDecimal (Argv[0], &Device)) || (Device == 0)) {
+    Print (L"Invalid device '%s'; give the device number from the listing\n", Argv[0]);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EFI_ERROR (ParseDecimal (Argv[1], &Test.Lba))) {
+    Print (L"Invalid LBA '%s'\n", Argv[1]);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Argc > 2) && EFI_ERROR (ParseDecimal (Argv[2], &Test.BarrierBlocks))) {
+    Print (L"Invalid barrier block count '%s'\n", Argv[2]);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = SelectBlockDevice (Argv[0], &Handle, &Test.BlockIo, &Test.BlockIo2);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Media = Test.BlockIo->Media;
+  if (Media->ReadOnly) {
+    Print (L"Device is read-only\n");
+    return EFI_WRITE_PROTECTED;
+  }
+
+  Test.Blocks = WRITE_REGION_BLOCKS;
+  if ((Test.Lba > Media->LastBlock) || (Media->LastBlock + 1 - Test.Lba < Test.Blocks)) {
+    Print (L"LBA %ld + %d blocks is past the end of the device\n", Test.Lba, Test.Blocks);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Bytes            = Test.Blocks * Media->BlockSize;
+  Test.RegionPages = EFI_SIZE_TO_PAGES (Bytes);
+  Test.Region      = AllocateAlignedPages (Test.RegionPages, MAX (Media->IoAlign, EFI_PAGE_SIZE));
+  Test.Block       = AllocateAlignedPages (EFI_SIZE_TO_PAGES (Media->BlockSize), MAX (Media->IoAlign, EFI_PAGE_SIZE));
+  Saved            = AllocatePool (Bytes);
+  if ((Test.Region == NULL) || (Test.Block == NULL) || (Saved == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Status = BlockTraceReadBlocks (Test.BlockIo, Media->MediaId, Test.Lba, Bytes, Saved);
+  if (EFI_ERROR (Status)) {
+    Print (L"Saving the region failed: %r\n", Status);
+    goto Done;
+  }
+
+  Print (L"WARNING: writing LBA %ld-%ld; the contents are restored afterwards\n",
+         Test.Lba, Test.Lba + Test.Blocks - 1);
+  Print (L"%d-byte blocks, %d KB combine buffer, Block I/O 2 %s, barrier ",
+         Media->BlockSize, WRITE_COMBINE_SIZE / SIZE_1KB, (Test.BlockIo2 != NULL) ? L"yes" : L"no");
+  if (Test.BarrierBlocks == 0) {
+    Print (L"at end only\n\n");
+  } else {
+    Print (L"every %ld blocks\n\n", Test.BarrierBlocks);
+  }
+
+  Print (L"Method           Writes  Dev I/O Flushes       ms   Writes/s\n");
+  Print (L"---------------- ------ -------- ------- -------- ----------\n");
+
+  Status = RunWrites (&Test, WriteThrough, L"write-through");
+  if (!EFI_ERROR (Status)) {
+    Status = RunWrites (&Test, WriteFlushAtEnd, L"flush at end");
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = RunWrites (&Test, WriteCombined, L"combined");
+  }
+
+  //
+  // Put the original contents back even if a run failed
+  //
+  CopyMem (Test.Region, Saved, Bytes);
+  RestoreStatus = Test.BlockIo->WriteBlocks (Test.BlockIo, Media->MediaId, Test.Lba, Bytes, Test.Region);
+  if (!EFI_ERROR (RestoreStatus)) {
+    RestoreStatus = Test.BlockIo->FlushBlocks (Test.BlockIo);
+  }
+
+  if (EFI_ERROR (RestoreStatus)) {
+    Print (L"\nRESTORE FAILED: %r; LBA %ld-%ld are modified\n",
+           RestoreStatus, Test.Lba, Test.Lba + Test.Blocks - 1);
+    Status = EFI_ERROR (Status) ? Status : RestoreStatus;
+  } else {
+    Print (L"\nRegion restored\n");
+  }
+
+Done:
+  if (Saved != NULL) {
+    FreePool (Saved);
+  }
+
+  if (Test.Block != NULL) {
+    FreeAlignedPages (Test.Block, EFI_SIZE_TO_PAGES (Media->BlockSize));
+  }
+
+  if (Test.Region != NULL) {
+    FreeAlignedPages (Test.Region, Test.RegionPages);
+  }
+
+  return Status;
+}
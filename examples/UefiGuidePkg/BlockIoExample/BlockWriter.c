@@ -0,0 +1,470 @@
+/** @file
+  Block I/O Example - write-combining block writer.
+
+  The writer never lets two writes to the same block be in flight at once:
+  before a slot is submitted, any in-flight slot that overlaps it is waited
+  for, so a later write of a block always reaches the device after an
+  earlier one.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "BlockWriter.h"
+
+/**
+  Completion notification for one combined write.
+**/
+STATIC
+VOID
+EFIAPI
+BlockWriteComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  BLOCK_WRITER_SLOT  *Slot;
+  BLOCK_WRITER       *Writer;
+
+  Slot   = (BLOCK_WRITER_SLOT *)Context;
+  Writer = Slot->Writer;
+  if (EFI_ERROR (Slot->Token.TransactionStatus) && !EFI_ERROR (Writer->Status)) {
+    Writer->Status = Slot->Token.TransactionStatus;
+  }
+
+  Slot->InFlight = FALSE;
+  gBS->SignalEvent (Writer->Wake);
+}
+
+/**
+  Return the end of the combine window that contains Lba.
+**/
+STATIC
+EFI_LBA
+WindowEnd (
+  IN BLOCK_WRITER  *Writer,
+  IN EFI_LBA       Lba
+  )
+{
+  UINT32  Rest;
+
+  //
+  // The blocks below LowestAlignedLba are a short window of their own
+  //
+  if (Lba < Writer->AlignedLba) {
+    return Writer->AlignedLba;
+  }
+
+  DivU64x32Remainder (Lba - Writer->AlignedLba, (UINT32)Writer->CombineBlocks, &Rest);
+  return Lba - Rest + Writer->CombineBlocks;
+}
+
+/**
+  Wait until a slot's write has completed.
+**/
+STATIC
+VOID
+WaitSlot (
+  IN BLOCK_WRITER       *Writer,
+  IN BLOCK_WRITER_SLOT  *Slot
+  )
+{
+  UINTN  WaitIndex;
+
+  while (Slot->InFlight) {
+    gBS->WaitForEvent (1, &Writer->Wake, &WaitIndex);
+  }
+}
+
+/**
+  Wait for every write in flight and flush the device.
+**/
+STATIC
+EFI_STATUS
+Drain (
+  IN BLOCK_WRITER  *Writer
+  )
+{
+  EFI_STATUS           Status;
+  EFI_BLOCK_IO2_TOKEN  Token;
+  UINTN                Index;
+
+  for (Index = 0; Index < BLOCK_WRITER_SLOTS; Index++) {
+    WaitSlot (Writer, &Writer->Slots[Index]);
+  }
+
+  if (EFI_ERROR (Writer->Status)) {
+    return Writer->Status;
+  }
+
+  if (Writer->UnflushedBlocks == 0) {
+    return EFI_SUCCESS;
+  }
+
+  if (Writer->BlockIo2 != NULL) {
+    Token.Event             = NULL;
+    Token.TransactionStatus = EFI_SUCCESS;
+    Status                  = Writer->BlockIo2->FlushBlocksEx (Writer->BlockIo2, &Token);
+  } else {
+    Status = Writer->BlockIo->FlushBlocks (Writer->BlockIo);
+  }
+
+  Writer->Flushes++;
+  Writer->UnflushedBlocks = 0;
+  if (EFI_ERROR (Status)) {
+    Writer->Status = Status;
+  }
+
+  return Status;
+}
+
+/**
+  Write out the slot being filled and switch to the other one.
+**/
+STATIC
+EFI_STATUS
+Commit (
+  IN BLOCK_WRITER  *Writer
+  )
+{
+  EFI_STATUS         Status;
+  BLOCK_WRITER_SLOT  *Slot;
+  BLOCK_WRITER_SLOT  *Other;
+  UINTN              Index;
+
+  Slot = &Writer->Slots[Writer->Current];
+  if (Slot->Blocks == 0) {
+    return Writer->Status;
+  }
+
+  //
+  // Keep writes of the same block in order
+  //
+  for (Index = 0; Index < BLOCK_WRITER_SLOTS; Index++) {
+    Other = &Writer->Slots[Index];
+    if ((Other != Slot) && Other->InFlight &&
+        (Other->Lba < Slot->Lba + Slot->Blocks) && (Slot->Lba < Other->Lba + Other->Blocks))
+    {
+      WaitSlot (Writer, Other);
+    }
+  }
+
+  if (EFI_ERROR (Writer->Status)) {
+    return Writer->Status;
+  }
+
+  if (Writer->BlockIo2 != NULL) {
+    Slot->InFlight                = TRUE;
+    Slot->Token.TransactionStatus = EFI_NOT_READY;
+    Status                        = Writer->BlockIo2->WriteBlocksEx (
+                                                        Writer->BlockIo2,
+                                                        Writer->MediaId,
+                                                        Slot->Lba,
+                                                        &Slot->Token,
+                                                        Slot->Blocks * Writer->BlockSize,
+                                                        Slot->Buffer
+                                                        );
+    if (EFI_ERROR (Status)) {
+      Slot->InFlight = FALSE;
+    }
+  } else {
+    Status = Writer->BlockIo->WriteBlocks (
+                                Writer->BlockIo,
+                                Writer->MediaId,
+                                Slot->Lba,
+                                Slot->Blocks * Writer->BlockSize,
+                                Slot->Buffer
+                                );
+  }
+
+  if (EFI_ERROR (Status)) {
+    Writer->Status = Status;
+    return Status;
+  }
+
+  Writer->DeviceWrites++;
+  Writer->BlocksWritten   += Slot->Blocks;
+  Writer->UnflushedBlocks += Slot->Blocks;
+
+  //
+  // Fill the other slot while this one is in flight
+  //
+  Writer->Current = (Writer->Current + 1) % BLOCK_WRITER_SLOTS;
+  Slot            = &Writer->Slots[Writer->Current];
+  WaitSlot (Writer, Slot);
+  Slot->Blocks = 0;
+
+  if ((Writer->BarrierBlocks != 0) && (Writer->UnflushedBlocks >= Writer->BarrierBlocks)) {
+    return Drain (Writer);
+  }
+
+  return Writer->Status;
+}
+
+/**
+  Create a writer with two combine buffers of CombineSize bytes.
+
+  @param[out]  Writer         Writer to initialize.
+  @param[in]   BlockIo        Device to write.
+  @param[in]   BlockIo2       Block I/O 2 of the same device, or NULL to
+                              write synchronously.
+  @param[in]   CombineSize    Largest combined write in bytes. Rounded up to
+                              whole physical blocks and, when a granule fits
+                              in it, to whole optimal transfer granules.
+  @param[in]   BarrierBlocks  Flush after this many blocks have been
+                              written; 0 flushes only in BlockWriterBarrier ().
+
+  @retval EFI_SUCCESS            The writer is ready.
+  @retval EFI_INVALID_PARAMETER  CombineSize is 0.
+  @retval EFI_WRITE_PROTECTED    The media is read-only.
+  @retval EFI_OUT_OF_RESOURCES   Buffers or events could not be allocated.
+**/
+EFI_STATUS
+BlockWriterInit (
+  OUT BLOCK_WRITER            *Writer,
+  IN  EFI_BLOCK_IO_PROTOCOL   *BlockIo,
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2 OPTIONAL,
+  IN  UINTN                   CombineSize,
+  IN  UINT64                  BarrierBlocks
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINTN               SlotSize;
+  UINTN               Alignment;
+  UINTN               Index;
+  UINTN               Blocks;
+  UINTN               PhysicalBlocks;
+  UINTN               Granularity;
+  UINTN               Unit;
+
+  if (CombineSize == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Media = BlockIo->Media;
+  if (Media->ReadOnly) {
+    return EFI_WRITE_PROTECTED;
+  }
+
+  ZeroMem (Writer, sizeof (*Writer));
+  Writer->BlockIo       = BlockIo;
+  Writer->BlockIo2      = BlockIo2;
+  Writer->MediaId       = Media->MediaId;
+  Writer->BlockSize     = Media->BlockSize;
+  Writer->BarrierBlocks = BarrierBlocks;
+
+  PhysicalBlocks = 1;
+  Granularity    = 1;
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION2) {
+    Granularity = MAX (Media->OptimalTransferLengthGranularity, 1);
+  }
+
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION3) {
+    PhysicalBlocks     = MAX (Media->LogicalBlocksPerPhysicalBlock, 1);
+    Writer->AlignedLba = Media->LowestAlignedLba;
+  }
+
+  //
+  // Windows are whole physical blocks, and whole granules when a granule
+  // fits in the requested combine size
+  //
+  Blocks = (CombineSize + Media->BlockSize - 1) / Media->BlockSize;
+  Unit   = PhysicalBlocks;
+  while ((Unit % Granularity != 0) && (Unit <= Blocks)) {
+    Unit += PhysicalBlocks;
+  }
+
+  if ((Unit % Granularity != 0) || (Unit > Blocks)) {
+    Unit = PhysicalBlocks;
+  }
+
+  Writer->CombineBlocks = (Blocks + Unit - 1) / Unit * Unit;
+
+  //
+  // Round each slot to the buffer alignment so the second slot keeps it
+  //
+  Alignment           = MAX (Media->IoAlign, EFI_PAGE_SIZE);
+  SlotSize            = ALIGN_VALUE (Writer->CombineBlocks * Media->BlockSize, Alignment);
+  Writer->BufferPages = EFI_SIZE_TO_PAGES (SlotSize * BLOCK_WRITER_SLOTS);
+  Writer->Buffers     = AllocateAlignedPages (Writer->BufferPages, Alignment);
+  if (Writer->Buffers == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Writer->Wake);
+  if (EFI_ERROR (Status)) {
+    BlockWriterFree (Writer);
+    return Status;
+  }
+
+  for (Index = 0; Index < BLOCK_WRITER_SLOTS; Index++) {
+    Writer->Slots[Index].Writer = Writer;
+    Writer->Slots[Index].Buffer = Writer->Buffers + Index * SlotSize;
+    if (BlockIo2 == NULL) {
+      continue;
+    }
+
+    Status = gBS->CreateEvent (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    BlockWriteComplete,
+                    &Writer->Slots[Index],
+                    &Writer->Slots[Index].Token.Event
+                    );
+    if (EFI_ERROR (Status)) {
+      BlockWriterFree (Writer);
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release a writer's buffers and event.
+
+  Pending data is discarded; call BlockWriterBarrier () first to keep it.
+
+  @param[in]  Writer  Writer to free.
+**/
+VOID
+BlockWriterFree (
+  IN BLOCK_WRITER  *Writer
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < BLOCK_WRITER_SLOTS; Index++) {
+    if (Writer->Wake != NULL) {
+      WaitSlot (Writer, &Writer->Slots[Index]);
+    }
+
+    if (Writer->Slots[Index].Token.Event != NULL) {
+      gBS->CloseEvent (Writer->Slots[Index].Token.Event);
+    }
+  }
+
+  if (Writer->Wake != NULL) {
+    gBS->CloseEvent (Writer->Wake);
+  }
+
+  if (Writer->Buffers != NULL) {
+    FreeAlignedPages (Writer->Buffers, Writer->BufferPages);
+  }
+
+  ZeroMem (Writer, sizeof (*Writer));
+}
+
+/**
+  Queue a block write.
+
+  The data is copied before returning, so Buffer may be reused at once.
+  It reaches the device no later than the next barrier.
+
+  @param[in]  Writer      Writer to use.
+  @param[in]  Lba         First block to write.
+  @param[in]  BufferSize  Bytes to write, a block multiple.
+  @param[in]  Buffer      Data to write.
+
+  @retval EFI_SUCCESS            The write was queued.
+  @retval EFI_INVALID_PARAMETER  BufferSize is not a block multiple or the
+                                 range is past the end of the media.
+  @retval Others                 An earlier write or flush failed.
+**/
+EFI_STATUS
+BlockWriterWrite (
+  IN BLOCK_WRITER  *Writer,
+  IN EFI_LBA       Lba,
+  IN UINTN         BufferSize,
+  IN CONST VOID    *Buffer
+  )
+{
+  EFI_STATUS         Status;
+  BLOCK_WRITER_SLOT  *Slot;
+  CONST UINT8        *Data;
+  UINTN              Remaining;
+  UINTN              Offset;
+  UINTN              Count;
+
+  if (((BufferSize % Writer->BlockSize) != 0) ||
+      (Lba + BufferSize / Writer->BlockSize > Writer->BlockIo->Media->LastBlock + 1))
+  {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (EFI_ERROR (Writer->Status)) {
+    return Writer->Status;
+  }
+
+  Writer->Writes++;
+  Data      = Buffer;
+  Remaining = BufferSize / Writer->BlockSize;
+  while (Remaining > 0) {
+    Slot = &Writer->Slots[Writer->Current];
+
+    //
+    // Extend or overwrite the pending run, otherwise start a new one
+    //
+    if (Slot->Blocks == 0) {
+      Slot->Lba = Lba;
+      Slot->End = WindowEnd (Writer, Lba);
+      Offset    = 0;
+    } else if ((Lba >= Slot->Lba) && (Lba <= Slot->Lba + Slot->Blocks) && (Lba < Slot->End)) {
+      Offset = (UINTN)(Lba - Slot->Lba);
+    } else {
+      Status = Commit (Writer);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      continue;
+    }
+
+    Count = (UINTN)MIN (Remaining, Slot->End - Lba);
+    CopyMem (Slot->Buffer + Offset * Writer->BlockSize, Data, Count * Writer->BlockSize);
+    Slot->Blocks = MAX (Slot->Blocks, Offset + Count);
+
+    Data      += Count * Writer->BlockSize;
+    Lba       += Count;
+    Remaining -= Count;
+
+    if (Slot->Lba + Slot->Blocks == Slot->End) {
+      Status = Commit (Writer);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write out everything queued, wait for it, and flush the device.
+
+  @param[in]  Writer  Writer to drain.
+
+  @retval EFI_SUCCESS  All queued data is on stable storage.
+  @retval Others       The first write or flush error.
+**/
+EFI_STATUS
+BlockWriterBarrier (
+  IN BLOCK_WRITER  *Writer
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = Commit (Writer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return Drain (Writer);
+}
@@ -0,0 +1,147 @@
+/** @file
+  Block I/O Example - write-combining block writer.
+
+  A BLOCK_WRITER collects small block writes in an IoAlign-aligned combine
+  buffer. Writes that continue or overwrite the pending run are copied into
+  it; anything else, or a full buffer, commits the run as one WriteBlocksEx ()
+  and starts the next run in the second buffer while the first is still in
+  flight. FlushBlocksEx () is only issued at barriers: explicitly through
+  BlockWriterBarrier (), and optionally every BarrierBlocks blocks.
+
+  Devices without Block I/O 2 fall back to synchronous WriteBlocks () and
+  FlushBlocks () with the same combining.
+
+  Runs never cross a window boundary. Windows are CombineBlocks long, a
+  whole number of physical blocks (LogicalBlocksPerPhysicalBlock) and,
+  when it fits, of OptimalTransferLengthGranularity, and are laid out from
+  LowestAlignedLba. A sequential stream therefore reaches the device as
+  aligned, full-window writes after at most one short write. Only blocks
+  that were actually written are sent; a run that starts or ends inside a
+  physical block is not padded by reading the rest of it.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef BLOCK_WRITER_H_
+#define BLOCK_WRITER_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
+
+#define BLOCK_WRITER_SLOTS  2
+
+typedef struct _BLOCK_WRITER BLOCK_WRITER;
+
+///
+/// One combine buffer and the write it carries
+///
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN    Token;
+  BLOCK_WRITER           *Writer;
+  volatile BOOLEAN       InFlight;
+  UINT8                  *Buffer;
+  EFI_LBA                Lba;
+  UINTN                  Blocks;        ///< Pending or in-flight blocks
+  EFI_LBA                End;           ///< Window boundary the run stops at
+} BLOCK_WRITER_SLOT;
+
+struct _BLOCK_WRITER {
+  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL    *BlockIo2;          ///< NULL for synchronous writes
+  UINT32                    MediaId;
+  UINT32                    BlockSize;
+  UINTN                     CombineBlocks;      ///< Capacity of each slot and window size
+  EFI_LBA                   AlignedLba;         ///< Where the window grid starts
+  UINT64                    BarrierBlocks;      ///< 0 flushes only on request
+  BLOCK_WRITER_SLOT         Slots[BLOCK_WRITER_SLOTS];
+  UINT8                     *Buffers;
+  UINTN                     BufferPages;
+  UINTN                     Current;            ///< Slot being filled
+  EFI_EVENT                 Wake;               ///< Signalled on every completion
+  EFI_STATUS                Status;             ///< First error, sticky
+  UINT64                    UnflushedBlocks;
+  UINT64                    Writes;
+  UINT64                    DeviceWrites;
+  UINT64                    Flushes;
+  UINT64                    BlocksWritten;
+};
+
+/**
+  Create a writer with two combine buffers of CombineSize bytes.
+
+  @param[out]  Writer         Writer to initialize.
+  @param[in]   BlockIo        Device to write.
+  @param[in]   BlockIo2       Block I/O 2 of the same device, or NULL to
+                              write synchronously.
+  @param[in]   CombineSize    Largest combined write in bytes. Rounded up to
+                              whole physical blocks and, when a granule fits
+                              in it, to whole optimal transfer granules.
+  @param[in]   BarrierBlocks  Flush after this many blocks have been
+                              written; 0 flushes only in BlockWriterBarrier ().
+
+  @retval EFI_SUCCESS            The writer is ready.
+  @retval EFI_INVALID_PARAMETER  CombineSize is 0.
+  @retval EFI_WRITE_PROTECTED    The media is read-only.
+  @retval EFI_OUT_OF_RESOURCES   Buffers or events could not be allocated.
+**/
+EFI_STATUS
+BlockWriterInit (
+  OUT BLOCK_WRITER            *Writer,
+  IN  EFI_BLOCK_IO_PROTOCOL   *BlockIo,
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2 OPTIONAL,
+  IN  UINTN                   CombineSize,
+  IN  UINT64                  BarrierBlocks
+  );
+
+/**
+  Release a writer's buffers and event.
+
+  Pending data is discarded; call BlockWriterBarrier () first to keep it.
+
+  @param[in]  Writer  Writer to free.
+**/
+VOID
+BlockWriterFree (
+  IN BLOCK_WRITER  *Writer
+  );
+
+/**
+  Queue a block write.
+
+  The data is copied before returning, so Buffer may be reused at once.
+  It reaches the device no later than the next barrier.
+
+  @param[in]  Writer      Writer to use.
+  @param[in]  Lba         First block to write.
+  @param[in]  BufferSize  Bytes to write, a block multiple.
+  @param[in]  Buffer      Data to write.
+
+  @retval EFI_SUCCESS            The write was queued.
+  @retval EFI_INVALID_PARAMETER  BufferSize is not a block multiple or the
+                                 range is past the end of the media.
+  @retval Others                 An earlier write or flush failed.
+**/
+EFI_STATUS
+BlockWriterWrite (
+  IN BLOCK_WRITER  *Writer,
+  IN EFI_LBA       Lba,
+  IN UINTN         BufferSize,
+  IN CONST VOID    *Buffer
+  );
+
+/**
+  Write out everything queued, wait for it, and flush the device.
+
+  @param[in]  Writer  Writer to drain.
+
+  @retval EFI_SUCCESS  All queued data is on stable storage.
+  @retval Others       The first write or flush error.
+**/
+EFI_STATUS
+BlockWriterBarrier (
+  IN BLOCK_WRITER  *Writer
+  );
+
+#endif // BLOCK_WRITER_H_
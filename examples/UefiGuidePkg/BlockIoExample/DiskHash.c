@@ -0,0 +1,348 @@
+/** @file
+  Block I/O Example - streaming SHA-256 over a block range.
+
+  Hashes a device or LBA range twice. The naive loop reads a chunk with
+  ReadBlocks (), hashes it, and only then reads the next, so the disk sits
+  idle while the CPU hashes and the CPU sits idle while the disk reads. The
+  overlapped path runs the BlockIo2 async reader with two in-order slots:
+  while one buffer is being hashed the next is already being filled, so the
+  total approaches the slower of I/O and hashing instead of their sum.
+
+  Both digests are printed and must agree. An expected digest may be given
+  to verify a golden image.
+
+  Usage: BlockIoExample.efi hash [device] [lba] [blocks] [sha256]
+         Without a block count the first 256 MB are hashed; 0 hashes to
+         the end of the device.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "AsyncBlockReader.h"
+#include "BlockTrace.h"
+
+#define HASH_CHUNK_SIZE     SIZE_1MB
+#define HASH_DEFAULT_BYTES  SIZE_256MB
+#define HASH_BUFFERS        2
+
+///
+/// Running hash shared with the completion callback
+///
+typedef struct {
+  VOID      *Sha256;
+  UINT64    HashNs;
+} HASH_STATE;
+
+/**
+  Feed one buffer into the hash and account the time spent.
+**/
+STATIC
+EFI_STATUS
+HashUpdate (
+  IN HASH_STATE  *State,
+  IN CONST VOID  *Data,
+  IN UINTN       Length
+  )
+{
+  UINT64   Start;
+  BOOLEAN  Ok;
+
+  Start          = BenchmarkGetTicks ();
+  Ok             = Sha256Update (State->Sha256, Data, Length);
+  State->HashNs += BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return Ok ? EFI_SUCCESS : EFI_ABORTED;
+}
+
+/**
+  Hash each completed async read; requests arrive in LBA order.
+**/
+STATIC
+EFI_STATUS
+HashDone (
+  IN VOID                 *Context,
+  IN ASYNC_BLOCK_REQUEST  *Request
+  )
+{
+  return HashUpdate ((HASH_STATE *)Context, Request->Buffer, Request->Length);
+}
+
+/**
+  Format a digest as upper-case hex.
+**/
+STATIC
+VOID
+DigestToText (
+  IN  CONST UINT8  *Digest,
+  OUT CHAR16       *Text
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < SHA256_DIGEST_SIZE; Index++) {
+    UnicodeSPrint (Text + Index * 2, 3 * sizeof (CHAR16), L"%02X", Digest[Index]);
+  }
+}
+
+/**
+  Compare a hex digest argument with a digest, ignoring case.
+**/
+STATIC
+BOOLEAN
+DigestMatches (
+  IN CONST CHAR16  *Expected,
+  IN CONST UINT8   *Digest
+  )
+{
+  CHAR16  Text[SHA256_DIGEST_SIZE * 2 + 1];
+  UINTN   Index;
+
+  DigestToText (Digest, Text);
+  for (Index = 0; Text[Index] != L'\0'; Index++) {
+    if (CharToUpper (Expected[Index]) != Text[Index]) {
+      return FALSE;
+    }
+  }
+
+  return Expected[Index] == L'\0';
+}
+
+/**
+  Read and hash the range one chunk at a time.
+**/
+STATIC
+EFI_STATUS
+HashNaive (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  EFI_LBA                StartLba,
+  IN  UINT64                 Blocks,
+  IN  HASH_STATE             *State,
+  OUT UINT64                 *IoNs
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      BlockSize;
+  UINTN       ChunkBlocks;
+  UINTN       Count;
+  UINTN       Pages;
+  UINT8       *Buffer;
+  UINT64      Done;
+  UINT64      Start;
+
+  BlockSize   = BlockIo->Media->BlockSize;
+  ChunkBlocks = MAX (HASH_CHUNK_SIZE / BlockSize, 1);
+  Pages       = EFI_SIZE_TO_PAGES (ChunkBlocks * BlockSize);
+  Buffer      = AllocateAlignedPages (Pages, MAX (BlockIo->Media->IoAlign, EFI_PAGE_SIZE));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  *IoNs  = 0;
+  for (Done = 0; Done < Blocks && !EFI_ERROR (Status); Done += Count) {
+    Count  = (UINTN)MIN (ChunkBlocks, Blocks - Done);
+    Start  = BenchmarkGetTicks ();
+    Status = BlockTraceReadBlocks (BlockIo, BlockIo->Media->MediaId, StartLba + Done, Count * BlockSize, Buffer);
+    *IoNs += BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    if (!EFI_ERROR (Status)) {
+      Status = HashUpdate (State, Buffer, Count * BlockSize);
+    }
+  }
+
+  FreeAlignedPages (Buffer, Pages);
+  return Status;
+}
+
+/**
+  Hash the range with reads overlapping the hashing.
+**/
+STATIC
+EFI_STATUS
+HashOverlapped (
+  IN EFI_BLOCK_IO2_PROTOCOL  *BlockIo2,
+  IN EFI_LBA                 StartLba,
+  IN UINT64                  Blocks,
+  IN HASH_STATE              *State
+  )
+{
+  EFI_STATUS          Status;
+  ASYNC_BLOCK_READER  Reader;
+
+  Status = AsyncBlockReaderInit (&Reader, BlockIo2, HASH_BUFFERS, HASH_CHUNK_SIZE);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // SHA-256 is order dependent
+  //
+  Reader.InOrder = TRUE;
+  Status         = AsyncBlockReaderReadRange (&Reader, StartLba, Blocks, HashDone, State);
+  AsyncBlockReaderFree (&Reader);
+  return Status;
+}
+
+/**
+  Run one hashing method and print its result line.
+**/
+STATIC
+EFI_STATUS
+RunHash (
+  IN  CONST CHAR16            *Label,
+  IN  EFI_BLOCK_IO_PROTOCOL   *BlockIo,
+  IN  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2 OPTIONAL,
+  IN  EFI_LBA                 StartLba,
+  IN  UINT64                  Blocks,
+  OUT UINT8                   *Digest
+  )
+{
+  EFI_STATUS  Status;
+  HASH_STATE  State;
+  UINT64      Start;
+  UINT64      ElapsedNs;
+  UINT64      IoNs;
+  UINT64      Bytes;
+  CHAR16      Text[SHA256_DIGEST_SIZE * 2 + 1];
+
+  State.HashNs = 0;
+  State.Sha256 = AllocatePool (Sha256GetContextSize ());
+  if (State.Sha256 == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (!Sha256Init (State.Sha256)) {
+    FreePool (State.Sha256);
+    return EFI_ABORTED;
+  }
+
+  IoNs  = 0;
+  Start = BenchmarkGetTicks ();
+  if (BlockIo2 == NULL) {
+    Status = HashNaive (BlockIo, StartLba, Blocks, &State, &IoNs);
+  } else {
+    Status = HashOverlapped (BlockIo2, StartLba, Blocks, &State);
+  }
+
+  if (!EFI_ERROR (Status) && !Sha256Final (State.Sha256, Digest)) {
+    Status = EFI_ABORTED;
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  FreePool (State.Sha256);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"%-10s failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  Bytes = MultU64x32 (Blocks, BlockIo->Media->BlockSize);
+  DigestToText (Digest, Text);
+  Print (L"%-10s %6ld MB/s  %8ld ms  (hash %ld ms", Label,
+         BenchmarkMBps (Bytes, ElapsedNs), DivU64x32 (ElapsedNs, 1000000), DivU64x32 (State.HashNs, 1000000));
+  if (BlockIo2 == NULL) {
+    Print (L", read %ld ms", DivU64x32 (IoNs, 1000000));
+  }
+
+  Print (L")\n  %s\n", Text);
+  return EFI_SUCCESS;
+}
+
+/**
+  Hash a block range with and without overlapping I/O and compute.
+**/
+EFI_STATUS
+DemoDiskHash (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS              Status;
+  EFI_HANDLE              Handle;
+  EFI_BLOCK_IO_PROTOCOL   *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2;
+  EFI_BLOCK_IO_MEDIA      *Media;
+  EFI_LBA                 StartLba;
+  UINT64                  Blocks;
+  UINT8                   NaiveDigest[SHA256_DIGEST_SIZE];
+  UINT8                   OverlapDigest[SHA256_DIGEST_SIZE];
+
+  Print (L"\n=== Streaming SHA-256 ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = SelectBlockDevice ((Argc > 0) ? Argv[0] : NULL, &Handle, &BlockIo, &BlockIo2);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Media    = BlockIo->Media;
+  StartLba = 0;
+  if ((Argc > 1) && EFI_ERROR (ParseDecimal (Argv[1], &StartLba))) {
+    Print (L"Invalid LBA '%s'\n", Argv[1]);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (StartLba > Media->LastBlock) {
+    Print (L"LBA %ld is past the end of the device\n", StartLba);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Blocks = DivU64x32 (HASH_DEFAULT_BYTES, Media->BlockSize);
+  if ((Argc > 2) && EFI_ERROR (ParseDecimal (Argv[2], &Blocks))) {
+    Print (L"Invalid block count '%s'\n", Argv[2]);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if ((Blocks == 0) || (Blocks > Media->LastBlock + 1 - StartLba)) {
+    Blocks = Media->LastBlock + 1 - StartLba;
+  }
+
+  Print (L"Hashing LBA %ld, %ld blocks (%ld MB) in %d KB chunks\n\n",
+         StartLba, Blocks, DivU64x32 (MultU64x32 (Blocks, Media->BlockSize), SIZE_1MB), HASH_CHUNK_SIZE / SIZE_1KB);
+
+  Status = RunHash (L"naive", BlockIo, NULL, StartLba, Blocks, NaiveDigest);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (BlockIo2 == NULL) {
+    Print (L"No Block I/O 2 on this device; overlapped hashing skipped\n");
+    CopyMem (OverlapDigest, NaiveDigest, sizeof (OverlapDigest));
+  } else {
+    Status = RunHash (L"overlapped", BlockIo, BlockIo2, StartLba, Blocks, OverlapDigest);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (CompareMem (NaiveDigest, OverlapDigest, sizeof (NaiveDigest)) != 0) {
+      Print (L"\nDIGEST MISMATCH between the two passes\n");
+      return EFI_CRC_ERROR;
+    }
+  }
+
+  if (Argc > 3) {
+    if (!DigestMatches (Argv[3], OverlapDigest)) {
+      Print (L"\nVerification FAILED: expected %s\n", Argv[3]);
+      return EFI_CRC_ERROR;
+    }
+
+    Print (L"\nVerification passed\n");
+  }
+
+  return EFI_SUCCESS;
+}
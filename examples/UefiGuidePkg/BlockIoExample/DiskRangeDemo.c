@@ -0,0 +1,328 @@
+/** @file
+  Block I/O Example - byte-range metadata reads over Disk I/O 2.
+
+  Probing for filesystem and volume-manager signatures means reading a few
+  dozen small fields at odd byte offsets. This mode reads such a set three
+  ways: through Block I/O with a pool buffer covering each range and a copy
+  out, through Disk I/O 2 one blocking ReadDiskEx () per range, and through
+  the DISK_RANGE_READER, which merges neighbouring ranges and keeps the
+  transfers in flight together. The data from all three must match.
+
+  Usage: BlockIoExample.efi diskio [device]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "DiskRangeReader.h"
+#include "BlockTrace.h"
+
+#define DISKIO_REPEATS         50
+#define DISKIO_CLUSTER_COUNT   32
+#define DISKIO_CLUSTER_BASE    8192
+#define DISKIO_CLUSTER_STRIDE  256
+#define DISKIO_CLUSTER_LENGTH  128
+#define DISKIO_MERGE_GAP       SIZE_4KB
+#define DISKIO_MAX_TRANSFER    SIZE_1MB
+
+typedef struct {
+  UINT64    Offset;
+  UINTN     Length;
+} BYTE_RANGE;
+
+///
+/// Signature and header fields a partition or volume probe looks at
+///
+STATIC CONST BYTE_RANGE  mProbeFields[] = {
+  { 0x1FE,                   2    },    // MBR boot signature
+  { 0x200,                   92   },    // GPT header
+  { 0x218,                   32   },    // LVM2 label header
+  { 0x400,                   1024 },    // ext2/3/4 superblock
+  { 0x8001,                  5    },    // ISO 9660 "CD001"
+  { 0x10040,                 8    },    // Btrfs superblock magic
+  { SIZE_1MB + 0x1FE,        2    },    // First partition boot signature
+  { SIZE_1MB + 0x400,        1024 },    // Superblock in the first partition
+  { SIZE_64MB - 0x1000 + 3,  509  }     // Straddles a block boundary
+};
+
+/**
+  Build the range list: the probe fields plus a cluster of small
+  inode-table style reads, dropping anything past the end of the device.
+**/
+STATIC
+UINTN
+BuildRanges (
+  IN  UINT64      DeviceSize,
+  OUT DISK_RANGE  *Ranges
+  )
+{
+  UINTN   Count;
+  UINTN   Index;
+  UINT64  Offset;
+  UINTN   Length;
+
+  Count = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mProbeFields) + DISKIO_CLUSTER_COUNT; Index++) {
+    if (Index < ARRAY_SIZE (mProbeFields)) {
+      Offset = mProbeFields[Index].Offset;
+      Length = mProbeFields[Index].Length;
+    } else {
+      Offset = DISKIO_CLUSTER_BASE + (Index - ARRAY_SIZE (mProbeFields)) * DISKIO_CLUSTER_STRIDE;
+      Length = DISKIO_CLUSTER_LENGTH;
+    }
+
+    if (Offset + Length > DeviceSize) {
+      continue;
+    }
+
+    ZeroMem (&Ranges[Count], sizeof (DISK_RANGE));
+    Ranges[Count].Offset = Offset;
+    Ranges[Count].Length = Length;
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Point each range at its slice of Data.
+**/
+STATIC
+VOID
+AssignBuffers (
+  IN DISK_RANGE  *Ranges,
+  IN UINTN       Count,
+  IN UINT8       *Data
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Ranges[Index].Buffer = Data;
+    Data                += Ranges[Index].Length;
+  }
+}
+
+/**
+  Read every range through Block I/O: covering blocks into a pool buffer,
+  then copy the wanted bytes out.
+**/
+STATIC
+EFI_STATUS
+SliceRead (
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  DISK_RANGE             *Ranges,
+  IN  UINTN                  Count,
+  OUT UINT64                 *BytesRead
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      BlockSize;
+  UINT32      Skip;
+  EFI_LBA     Lba;
+  UINTN       Blocks;
+  UINTN       Index;
+  UINT8       *Bounce;
+
+  BlockSize  = BlockIo->Media->BlockSize;
+  *BytesRead = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Lba    = DivU64x32Remainder (Ranges[Index].Offset, BlockSize, &Skip);
+    Blocks = (Skip + Ranges[Index].Length + BlockSize - 1) / BlockSize;
+    Bounce = AllocatePool (Blocks * BlockSize);
+    if (Bounce == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = BlockTraceReadBlocks (BlockIo, BlockIo->Media->MediaId, Lba, Blocks * BlockSize, Bounce);
+    if (!EFI_ERROR (Status)) {
+      CopyMem (Ranges[Index].Buffer, Bounce + Skip, Ranges[Index].Length);
+    }
+
+    FreePool (Bounce);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    *BytesRead += Blocks * BlockSize;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Time DISKIO_REPEATS passes of one Disk I/O 2 reader configuration.
+**/
+STATIC
+EFI_STATUS
+RunReader (
+  IN  CONST CHAR16           *Label,
+  IN  EFI_DISK_IO2_PROTOCOL  *DiskIo2,
+  IN  UINT32                 MediaId,
+  IN  UINTN                  MaxTransfer,
+  IN  BOOLEAN                Blocking,
+  IN  DISK_RANGE             *Ranges,
+  IN  UINTN                  Count
+  )
+{
+  EFI_STATUS         Status;
+  DISK_RANGE_READER  Reader;
+  UINTN              Repeat;
+  UINT64             Start;
+  UINT64             ElapsedNs;
+
+  DiskRangeReaderInit (&Reader, DiskIo2, MediaId, DISKIO_MERGE_GAP, MaxTransfer, Blocking);
+
+  Status = EFI_SUCCESS;
+  Start  = BenchmarkGetTicks ();
+  for (Repeat = 0; Repeat < DISKIO_REPEATS && !EFI_ERROR (Status); Repeat++) {
+    Status = DiskRangeReaderRead (&Reader, Ranges, Count);
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  DiskRangeReaderFree (&Reader);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"%-22s failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  Print (L"%-22s %10ld %12ld %10ld\n",
+         Label,
+         DivU64x32 (Reader.Transfers, DISKIO_REPEATS),
+         DivU64x32 (Reader.BytesTransferred, DISKIO_REPEATS),
+         DivU64x32 (ElapsedNs, DISKIO_REPEATS * 1000)
+         );
+  return EFI_SUCCESS;
+}
+
+/**
+  Compare Block I/O slicing with Disk I/O 2 byte-range reads.
+**/
+EFI_STATUS
+DemoDiskRangeReads (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS             Status;
+  EFI_HANDLE             Handle;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  EFI_DISK_IO2_PROTOCOL  *DiskIo2;
+  EFI_BLOCK_IO_MEDIA     *Media;
+  DISK_RANGE             *Ranges;
+  UINTN                  Count;
+  UINTN                  Index;
+  UINTN                  Total;
+  UINTN                  Repeat;
+  UINT8                  *Expected;
+  UINT8                  *Actual;
+  UINT64                 BytesRead;
+  UINT64                 Start;
+  UINT64                 ElapsedNs;
+
+  Print (L"\n=== Disk I/O 2 Byte-Range Reads ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = SelectBlockDevice ((Argc > 0) ? Argv[0] : NULL, &Handle, &BlockIo, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gBS->HandleProtocol (Handle, &gEfiDiskIo2ProtocolGuid, (VOID **)&DiskIo2);
+  if (EFI_ERROR (Status)) {
+    Print (L"No Disk I/O 2 on this device\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Media  = BlockIo->Media;
+  Ranges = AllocatePool ((ARRAY_SIZE (mProbeFields) + DISKIO_CLUSTER_COUNT) * sizeof (DISK_RANGE));
+  if (Ranges == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Count = BuildRanges (MultU64x32 (Media->LastBlock + 1, Media->BlockSize), Ranges);
+  Total = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Total += Ranges[Index].Length;
+  }
+
+  Expected = AllocatePool (Total);
+  Actual   = AllocatePool (Total);
+  if ((Expected == NULL) || (Actual == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  Print (L"%d ranges, %d bytes wanted, %d-byte blocks, average of %d passes\n\n",
+         Count, Total, Media->BlockSize, DISKIO_REPEATS);
+  Print (L"Method                 Calls/pass   Bytes/pass    us/pass\n");
+  Print (L"---------------------- ---------- ------------ ----------\n");
+
+  AssignBuffers (Ranges, Count, Expected);
+  Start = BenchmarkGetTicks ();
+  for (Repeat = 0; Repeat < DISKIO_REPEATS; Repeat++) {
+    Status = SliceRead (BlockIo, Ranges, Count, &BytesRead);
+    if (EFI_ERROR (Status)) {
+      Print (L"Block I/O slicing failed: %r\n", Status);
+      goto Done;
+    }
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  Print (L"%-22s %10d %12ld %10ld\n",
+         L"BlockIo slice + copy", Count, BytesRead, DivU64x32 (ElapsedNs, DISKIO_REPEATS * 1000));
+
+  AssignBuffers (Ranges, Count, Actual);
+  ZeroMem (Actual, Total);
+  Status = RunReader (L"DiskIo2 per range", DiskIo2, Media->MediaId, 0, TRUE, Ranges, Count);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  if (CompareMem (Expected, Actual, Total) != 0) {
+    Print (L"DATA MISMATCH: DiskIo2 per-range reads\n");
+    Status = EFI_VOLUME_CORRUPTED;
+    goto Done;
+  }
+
+  ZeroMem (Actual, Total);
+  Status = RunReader (L"DiskIo2 merged async", DiskIo2, Media->MediaId, DISKIO_MAX_TRANSFER, FALSE, Ranges, Count);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  if (CompareMem (Expected, Actual, Total) != 0) {
+    Print (L"DATA MISMATCH: DiskIo2 merged reads\n");
+    Status = EFI_VOLUME_CORRUPTED;
+    goto Done;
+  }
+
+  Print (L"\nAll three methods returned identical data\n");
+
+Done:
+  if (Expected != NULL) {
+    FreePool (Expected);
+  }
+
+  if (Actual != NULL) {
+    FreePool (Actual);
+  }
+
+  FreePool (Ranges);
+  return Status;
+}
@@ -0,0 +1,415 @@
+/** @file
+  Block I/O Example - batched byte-range reader over Disk I/O 2.
+
+  A batch is processed in waves of up to DISK_RANGE_MAX_IN_FLIGHT transfers.
+  Each wave is planned first so the staging buffer can be sized for every
+  transfer in it that cannot land in the caller's memory. In asynchronous
+  mode the transfers are submitted at TPL_CALLBACK and the loop sleeps on
+  one shared event until the last one completes; blocking reads run at the
+  caller's TPL.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SortLib.h>
+
+#include "DiskRangeReader.h"
+
+///
+/// One ReadDiskEx () covering one or more sorted ranges
+///
+typedef struct {
+  EFI_DISK_IO2_TOKEN    Token;
+  EFI_EVENT             Wake;         ///< Shared; signalled on completion
+  volatile UINTN        *Completed;   ///< Shared completion count
+  UINT64                Offset;
+  UINTN                 Length;
+  UINT8                 *Buffer;      ///< Caller buffer or staging slice
+  UINTN                 First;        ///< Index of the first sorted range
+  UINTN                 Count;        ///< Ranges carried
+  BOOLEAN               InPlace;      ///< Ranges are back to back on disk and in memory
+  EFI_STATUS            Status;
+} DISK_RANGE_TRANSFER;
+
+/**
+  Completion notification for one transfer.
+**/
+STATIC
+VOID
+EFIAPI
+DiskRangeComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  DISK_RANGE_TRANSFER  *Transfer;
+
+  Transfer = (DISK_RANGE_TRANSFER *)Context;
+  (*Transfer->Completed)++;
+  gBS->SignalEvent (Transfer->Wake);
+}
+
+/**
+  Order range pointers by offset for PerformQuickSort ().
+**/
+STATIC
+INTN
+EFIAPI
+CompareByOffset (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST DISK_RANGE  *Left;
+  CONST DISK_RANGE  *Right;
+
+  Left  = *(CONST DISK_RANGE **)Buffer1;
+  Right = *(CONST DISK_RANGE **)Buffer2;
+  if (Left->Offset != Right->Offset) {
+    return (Left->Offset < Right->Offset) ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/**
+  Grow the staging buffer to at least Size bytes.
+**/
+STATIC
+EFI_STATUS
+EnsureStaging (
+  IN DISK_RANGE_READER  *Reader,
+  IN UINTN              Size
+  )
+{
+  if (Size <= Reader->StagingSize) {
+    return EFI_SUCCESS;
+  }
+
+  if (Reader->Staging != NULL) {
+    FreePool (Reader->Staging);
+  }
+
+  Reader->Staging     = AllocatePool (Size);
+  Reader->StagingSize = (Reader->Staging != NULL) ? Size : 0;
+  return (Reader->Staging != NULL) ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
+
+/**
+  Group sorted ranges starting at Next into at most
+  DISK_RANGE_MAX_IN_FLIGHT transfers. Returns the number of transfers and
+  the staging bytes the merged ones need.
+**/
+STATIC
+UINTN
+PlanWave (
+  IN  DISK_RANGE_READER    *Reader,
+  IN  DISK_RANGE           **Sorted,
+  IN  UINTN                Count,
+  IN  UINTN                Next,
+  OUT DISK_RANGE_TRANSFER  *Transfers,
+  OUT UINTN                *StagingBytes
+  )
+{
+  UINTN                Used;
+  DISK_RANGE           *Range;
+  DISK_RANGE_TRANSFER  *Transfer;
+  UINT8                *Expected;
+  UINT64               End;
+  UINT64               RangeEnd;
+
+  Used          = 0;
+  Transfer      = NULL;
+  End           = 0;
+  *StagingBytes = 0;
+
+  for ( ; Next < Count; Next++) {
+    Range    = Sorted[Next];
+    RangeEnd = Range->Offset + Range->Length;
+
+    if ((Transfer != NULL) &&
+        (Reader->MaxTransfer != 0) &&
+        (Range->Offset <= End + Reader->MergeGap) &&
+        (MAX (End, RangeEnd) - Transfer->Offset <= Reader->MaxTransfer))
+    {
+      //
+      // Stays in place only if the range continues both the disk run and the
+      // caller's memory without a hole or an overlap
+      //
+      Expected          = (UINT8 *)Sorted[Transfer->First]->Buffer + (UINTN)(End - Transfer->Offset);
+      Transfer->InPlace = Transfer->InPlace && (Range->Offset == End) && ((UINT8 *)Range->Buffer == Expected);
+      End               = MAX (End, RangeEnd);
+      Transfer->Length = (UINTN)(End - Transfer->Offset);
+      Transfer->Count++;
+      continue;
+    }
+
+    if (Used == DISK_RANGE_MAX_IN_FLIGHT) {
+      break;
+    }
+
+    Transfer         = &Transfers[Used++];
+    Transfer->Offset  = Range->Offset;
+    Transfer->Length  = Range->Length;
+    Transfer->First   = Next;
+    Transfer->Count   = 1;
+    Transfer->InPlace = TRUE;
+    End               = RangeEnd;
+  }
+
+  //
+  // Only transfers that bridge a gap, overlap, or scatter into separate
+  // caller buffers need staging
+  //
+  for (Transfer = Transfers; Transfer < Transfers + Used; Transfer++) {
+    if (!Transfer->InPlace) {
+      *StagingBytes += Transfer->Length;
+    }
+  }
+
+  return Used;
+}
+
+/**
+  Initialize a range reader.
+
+  @param[out]  Reader       Reader to initialize.
+  @param[in]   DiskIo2      Disk I/O 2 protocol of the device.
+  @param[in]   MediaId      Media the reads are for.
+  @param[in]   MergeGap     Largest hole between two ranges that is read
+                            and discarded to merge them.
+  @param[in]   MaxTransfer  Largest merged transfer in bytes. 0 reads every
+                            range on its own.
+  @param[in]   Blocking     TRUE to issue each transfer synchronously.
+**/
+VOID
+DiskRangeReaderInit (
+  OUT DISK_RANGE_READER      *Reader,
+  IN  EFI_DISK_IO2_PROTOCOL  *DiskIo2,
+  IN  UINT32                 MediaId,
+  IN  UINTN                  MergeGap,
+  IN  UINTN                  MaxTransfer,
+  IN  BOOLEAN                Blocking
+  )
+{
+  ZeroMem (Reader, sizeof (*Reader));
+  Reader->DiskIo2     = DiskIo2;
+  Reader->MediaId     = MediaId;
+  Reader->MergeGap    = MergeGap;
+  Reader->MaxTransfer = MaxTransfer;
+  Reader->Blocking    = Blocking;
+}
+
+/**
+  Release a reader's staging buffer.
+
+  @param[in]  Reader  Reader to free.
+**/
+VOID
+DiskRangeReaderFree (
+  IN DISK_RANGE_READER  *Reader
+  )
+{
+  if (Reader->Staging != NULL) {
+    FreePool (Reader->Staging);
+    Reader->Staging     = NULL;
+    Reader->StagingSize = 0;
+  }
+}
+
+/**
+  Read a batch of byte ranges.
+
+  The ranges may be given in any order and may overlap. Each range's
+  Status is set; the return value is the first error.
+
+  @param[in]      Reader  Reader to use.
+  @param[in,out]  Ranges  Ranges to read.
+  @param[in]      Count   Number of ranges.
+
+  @retval EFI_SUCCESS           Every range was read.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                The first ReadDiskEx () error.
+**/
+EFI_STATUS
+DiskRangeReaderRead (
+  IN     DISK_RANGE_READER  *Reader,
+  IN OUT DISK_RANGE         *Ranges,
+  IN     UINTN              Count
+  )
+{
+  EFI_STATUS           Status;
+  EFI_STATUS           Result;
+  DISK_RANGE           **Sorted;
+  DISK_RANGE_TRANSFER  *Transfers;
+  DISK_RANGE_TRANSFER  *Transfer;
+  DISK_RANGE           *Range;
+  EFI_EVENT            Wake;
+  volatile UINTN       Completed;
+  UINTN                Submitted;
+  UINTN                Planned;
+  UINTN                StagingBytes;
+  UINTN                StagingUsed;
+  UINTN                Next;
+  UINTN                Index;
+  UINTN                Member;
+  UINTN                WaitIndex;
+  EFI_TPL              OldTpl;
+
+  if (Count == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Sorted    = AllocatePool (Count * sizeof (DISK_RANGE *));
+  Transfers = AllocateZeroPool (DISK_RANGE_MAX_IN_FLIGHT * sizeof (DISK_RANGE_TRANSFER));
+  Wake      = NULL;
+  Status    = EFI_OUT_OF_RESOURCES;
+  if ((Sorted == NULL) || (Transfers == NULL)) {
+    goto Done;
+  }
+
+  if (!Reader->Blocking) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Wake);
+    if (EFI_ERROR (Status)) {
+      goto Done;
+    }
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    Sorted[Index]         = &Ranges[Index];
+    Ranges[Index].Status  = EFI_NOT_READY;
+    Reader->BytesWanted  += Ranges[Index].Length;
+  }
+
+  PerformQuickSort (Sorted, Count, sizeof (DISK_RANGE *), CompareByOffset);
+  Reader->Requests += Count;
+
+  Status = EFI_SUCCESS;
+  for (Next = 0; Next < Count; Next += Member) {
+    Planned = PlanWave (Reader, Sorted, Count, Next, Transfers, &StagingBytes);
+    Result  = EnsureStaging (Reader, StagingBytes);
+    if (EFI_ERROR (Result)) {
+      Status = Result;
+      break;
+    }
+
+    Completed   = 0;
+    Submitted   = 0;
+    StagingUsed = 0;
+
+    //
+    // Asynchronous completions wait until every transfer of the wave is
+    // accounted for; blocking reads are not issued at a raised TPL
+    //
+    OldTpl = TPL_APPLICATION;
+    if (!Reader->Blocking) {
+      OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+    }
+
+    for (Index = 0; Index < Planned; Index++) {
+      Transfer = &Transfers[Index];
+      if (Transfer->InPlace) {
+        Transfer->Buffer = Sorted[Transfer->First]->Buffer;
+      } else {
+        Transfer->Buffer = Reader->Staging + StagingUsed;
+        StagingUsed     += Transfer->Length;
+      }
+
+      Transfer->Wake                    = Wake;
+      Transfer->Completed               = &Completed;
+      Transfer->Token.Event             = NULL;
+      Transfer->Token.TransactionStatus = EFI_NOT_READY;
+      if (!Reader->Blocking) {
+        Transfer->Status = gBS->CreateEvent (
+                                  EVT_NOTIFY_SIGNAL,
+                                  TPL_CALLBACK,
+                                  DiskRangeComplete,
+                                  Transfer,
+                                  &Transfer->Token.Event
+                                  );
+        if (EFI_ERROR (Transfer->Status)) {
+          continue;
+        }
+      }
+
+      Transfer->Status = Reader->DiskIo2->ReadDiskEx (
+                                            Reader->DiskIo2,
+                                            Reader->MediaId,
+                                            Transfer->Offset,
+                                            &Transfer->Token,
+                                            Transfer->Length,
+                                            Transfer->Buffer
+                                            );
+      Reader->Transfers++;
+      Reader->BytesTransferred += Transfer->Length;
+      if (Transfer->InPlace) {
+        Reader->DirectTransfers++;
+      }
+
+      if (Transfer->Token.Event == NULL) {
+        continue;
+      }
+
+      if (EFI_ERROR (Transfer->Status)) {
+        gBS->CloseEvent (Transfer->Token.Event);
+        Transfer->Token.Event = NULL;
+        continue;
+      }
+
+      Submitted++;
+    }
+
+    if (!Reader->Blocking) {
+      gBS->RestoreTPL (OldTpl);
+    }
+
+    while (Completed < Submitted) {
+      gBS->WaitForEvent (1, &Wake, &WaitIndex);
+    }
+
+    //
+    // Collect statuses and copy staged transfers out
+    //
+    for (Index = 0, Member = 0; Index < Planned; Index++) {
+      Transfer = &Transfers[Index];
+      if (Transfer->Token.Event != NULL) {
+        Transfer->Status = Transfer->Token.TransactionStatus;
+        gBS->CloseEvent (Transfer->Token.Event);
+        Transfer->Token.Event = NULL;
+      }
+
+      if (EFI_ERROR (Transfer->Status) && !EFI_ERROR (Status)) {
+        Status = Transfer->Status;
+      }
+
+      for ( ; Member < Transfer->First + Transfer->Count - Next; Member++) {
+        Range         = Sorted[Next + Member];
+        Range->Status = Transfer->Status;
+        if (!Transfer->InPlace && !EFI_ERROR (Transfer->Status)) {
+          CopyMem (Range->Buffer, Transfer->Buffer + (UINTN)(Range->Offset - Transfer->Offset), Range->Length);
+        }
+      }
+    }
+  }
+
+Done:
+  if (Wake != NULL) {
+    gBS->CloseEvent (Wake);
+  }
+
+  if (Transfers != NULL) {
+    FreePool (Transfers);
+  }
+
+  if (Sorted != NULL) {
+    FreePool (Sorted);
+  }
+
+  return Status;
+}
@@ -0,0 +1,108 @@
+/** @file
+  Block I/O Example - batched byte-range reader over Disk I/O 2.
+
+  Callers describe a batch of arbitrary (offset, length) ranges. The reader
+  sorts them, merges ranges that touch or lie within MergeGap bytes of each
+  other into one transfer, and issues every transfer as an asynchronous
+  ReadDiskEx (). A transfer is read straight into the caller's memory when
+  its ranges follow each other with no hole both on disk and in the
+  callers' buffers, which covers every single-range transfer and batches
+  that fill one array; only transfers that bridge a gap, overlap, or
+  scatter into separate buffers land in a staging buffer and are copied
+  out. Disk I/O 2 handles the block rounding itself, so no caller ever
+  sees a whole-block buffer.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef DISK_RANGE_READER_H_
+#define DISK_RANGE_READER_H_
+
+#include <Uefi.h>
+#include <Protocol/DiskIo2.h>
+
+///
+/// Transfers kept in flight at once
+///
+#define DISK_RANGE_MAX_IN_FLIGHT  32
+
+///
+/// One caller range
+///
+typedef struct {
+  UINT64        Offset;
+  UINTN         Length;
+  VOID          *Buffer;
+  EFI_STATUS    Status;       ///< Set by DiskRangeReaderRead ()
+} DISK_RANGE;
+
+typedef struct {
+  EFI_DISK_IO2_PROTOCOL    *DiskIo2;
+  UINT32                   MediaId;
+  UINTN                    MergeGap;      ///< Bytes that may be read and dropped to merge
+  UINTN                    MaxTransfer;   ///< Merged transfer limit; 0 disables merging
+  BOOLEAN                  Blocking;      ///< Issue ReadDiskEx () without events
+  UINT8                    *Staging;
+  UINTN                    StagingSize;
+  UINT64                   Requests;
+  UINT64                   Transfers;
+  UINT64                   DirectTransfers;   ///< Read into caller memory, no staging
+  UINT64                   BytesWanted;
+  UINT64                   BytesTransferred;
+} DISK_RANGE_READER;
+
+/**
+  Initialize a range reader.
+
+  @param[out]  Reader       Reader to initialize.
+  @param[in]   DiskIo2      Disk I/O 2 protocol of the device.
+  @param[in]   MediaId      Media the reads are for.
+  @param[in]   MergeGap     Largest hole between two ranges that is read
+                            and discarded to merge them.
+  @param[in]   MaxTransfer  Largest merged transfer in bytes. 0 reads every
+                            range on its own.
+  @param[in]   Blocking     TRUE to issue each transfer synchronously.
+**/
+VOID
+DiskRangeReaderInit (
+  OUT DISK_RANGE_READER      *Reader,
+  IN  EFI_DISK_IO2_PROTOCOL  *DiskIo2,
+  IN  UINT32                 MediaId,
+  IN  UINTN                  MergeGap,
+  IN  UINTN                  MaxTransfer,
+  IN  BOOLEAN                Blocking
+  );
+
+/**
+  Release a reader's staging buffer.
+
+  @param[in]  Reader  Reader to free.
+**/
+VOID
+DiskRangeReaderFree (
+  IN DISK_RANGE_READER  *Reader
+  );
+
+/**
+  Read a batch of byte ranges.
+
+  The ranges may be given in any order and may overlap. Each range's
+  Status is set; the return value is the first error.
+
+  @param[in]      Reader  Reader to use.
+  @param[in,out]  Ranges  Ranges to read.
+  @param[in]      Count   Number of ranges.
+
+  @retval EFI_SUCCESS           Every range was read.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                The first ReadDiskEx () error.
+**/
+EFI_STATUS
+DiskRangeReaderRead (
+  IN     DISK_RANGE_READER  *Reader,
+  IN OUT DISK_RANGE         *Ranges,
+  IN     UINTN              Count
+  );
+
+#endif // DISK_RANGE_READER_H_
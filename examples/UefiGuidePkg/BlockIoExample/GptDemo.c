@@ -0,0 +1,201 @@
+/** @file
+  Block I/O Example - verified GPT parse and partition lookup.
+
+  Parses one disk's GPT with GptParse (), prints header verification and
+  the used partitions, looks up the EFI system partition by type GUID and,
+  if a name is given, a partition by name. It then times reading the entry
+  array one block at a time, as a simple walker does, against the single
+  ReadBlocks () the parser uses.
+
+  Usage: BlockIoExample.efi gpt [device] [name]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "GptParser.h"
+#include "BlockTrace.h"
+
+#define GPT_READ_REPEATS  50
+
+STATIC CONST EFI_GUID  mEspTypeGuid = EFI_PART_TYPE_EFI_SYSTEM_PART_GUID;
+
+/**
+  Print one partition entry.
+**/
+STATIC
+VOID
+PrintPartition (
+  IN EFI_PARTITION_ENTRY  *Entry,
+  IN UINT32               BlockSize
+  )
+{
+  CHAR16  Name[GPT_NAME_LENGTH + 1];
+
+  CopyMem (Name, Entry->PartitionName, sizeof (Entry->PartitionName));
+  Name[GPT_NAME_LENGTH] = L'\0';
+
+  Print (L"  %g %10ld %10ld %8ld  %s\n",
+         &Entry->PartitionTypeGUID,
+         Entry->StartingLBA,
+         Entry->EndingLBA,
+         DivU64x32 (MultU64x32 (Entry->EndingLBA - Entry->StartingLBA + 1, BlockSize), SIZE_1MB),
+         Name
+         );
+}
+
+/**
+  Time reading the entry array block by block and in one call.
+**/
+STATIC
+EFI_STATUS
+CompareEntryArrayReads (
+  IN GPT_TABLE  *Table
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  UINT32                 BlockSize;
+  UINTN                  Blocks;
+  UINTN                  Pages;
+  UINT8                  *Buffer;
+  UINTN                  Repeat;
+  UINTN                  Index;
+  UINT64                 Start;
+  UINT64                 PerBlockNs;
+  UINT64                 SingleNs;
+
+  BlockIo   = Table->BlockIo;
+  BlockSize = BlockIo->Media->BlockSize;
+  Blocks    = Table->Header.NumberOfPartitionEntries * Table->Header.SizeOfPartitionEntry;
+  Blocks    = (Blocks + BlockSize - 1) / BlockSize;
+  Pages     = EFI_SIZE_TO_PAGES (Blocks * BlockSize);
+  Buffer    = AllocateAlignedPages (Pages, MAX (BlockIo->Media->IoAlign, EFI_PAGE_SIZE));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  Start  = BenchmarkGetTicks ();
+  for (Repeat = 0; Repeat < GPT_READ_REPEATS && !EFI_ERROR (Status); Repeat++) {
+    for (Index = 0; Index < Blocks && !EFI_ERROR (Status); Index++) {
+      Status = BlockTraceReadBlocks (
+                 BlockIo,
+                 BlockIo->Media->MediaId,
+                 Table->Header.PartitionEntryLBA + Index,
+                 BlockSize,
+                 Buffer
+                 );
+    }
+  }
+
+  PerBlockNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+
+  Start = BenchmarkGetTicks ();
+  for (Repeat = 0; Repeat < GPT_READ_REPEATS && !EFI_ERROR (Status); Repeat++) {
+    Status = BlockTraceReadBlocks (
+               BlockIo,
+               BlockIo->Media->MediaId,
+               Table->Header.PartitionEntryLBA,
+               Blocks * BlockSize,
+               Buffer
+               );
+  }
+
+  SingleNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+
+  if (!EFI_ERROR (Status)) {
+    Print (L"\nEntry array: %d blocks, average of %d reads\n", Blocks, GPT_READ_REPEATS);
+    Print (L"  Block by block: %8ld us (%d ReadBlocks calls)\n",
+           DivU64x32 (PerBlockNs, GPT_READ_REPEATS * 1000), Blocks);
+    Print (L"  Single read:    %8ld us (1 ReadBlocks call)\n",
+           DivU64x32 (SingleNs, GPT_READ_REPEATS * 1000));
+  }
+
+  FreeAlignedPages (Buffer, Pages);
+  return Status;
+}
+
+/**
+  Parse and verify one disk's GPT and demonstrate lookups.
+**/
+EFI_STATUS
+DemoGptParse (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS             Status;
+  EFI_HANDLE             Handle;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  GPT_TABLE              Table;
+  EFI_PARTITION_ENTRY    **Matches;
+  EFI_PARTITION_ENTRY    *Entry;
+  UINTN                  Count;
+  UINTN                  Index;
+  UINT64                 Start;
+  UINT64                 ParseNs;
+
+  Print (L"\n=== GPT Parse and Verify ===\n\n");
+
+  Status = SelectBlockDevice ((Argc > 0) ? Argv[0] : NULL, &Handle, &BlockIo, NULL);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Start   = BenchmarkGetTicks ();
+  Status  = GptParse (&Table, BlockIo);
+  ParseNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  if (EFI_ERROR (Status)) {
+    Print (L"GptParse: %r\n", Status);
+    return Status;
+  }
+
+  Print (L"Primary header %s, backup header %s, entries from %s copy\n",
+         Table.PrimaryValid ? L"verified" : L"BAD",
+         Table.BackupValid ? L"verified" : L"BAD",
+         Table.UsedBackup ? L"backup" : L"primary");
+  Print (L"Disk GUID %g, usable LBA %ld-%ld\n",
+         &Table.Header.DiskGUID, Table.Header.FirstUsableLBA, Table.Header.LastUsableLBA);
+  Print (L"%d of %d entries used, %d device reads, parsed in %ld us\n\n",
+         Table.EntryCount, Table.Header.NumberOfPartitionEntries, Table.DeviceReads, DivU64x32 (ParseNs, 1000));
+
+  Print (L"  Type GUID                             Start LBA    End LBA  Size MB  Name\n");
+  for (Index = 0; Index < Table.EntryCount; Index++) {
+    PrintPartition (Table.ByType[Index], BlockIo->Media->BlockSize);
+  }
+
+  Count = GptFindByType (&Table, &mEspTypeGuid, &Matches);
+  Print (L"\nEFI system partitions: %d", Count);
+  if (Count > 0) {
+    Print (L", first at LBA %ld", Matches[0]->StartingLBA);
+  }
+
+  Print (L"\n");
+
+  if (Argc > 1) {
+    Entry = GptFindByName (&Table, Argv[1]);
+    if (Entry == NULL) {
+      Print (L"No partition named \"%s\"\n", Argv[1]);
+    } else {
+      Print (L"\"%s\" starts at LBA %ld\n", Argv[1], Entry->StartingLBA);
+    }
+  }
+
+  if (BenchmarkGetFrequency () != 0) {
+    Status = CompareEntryArrayReads (&Table);
+  }
+
+  GptFree (&Table);
+  return Status;
+}
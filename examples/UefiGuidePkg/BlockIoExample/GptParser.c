@@ -0,0 +1,473 @@
+/** @file
+  Block I/O Example - verified GPT parser.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/SortLib.h>
+
+#include "GptParser.h"
+#include "BlockTrace.h"
+
+//
+// Bytes of the header covered by the specification's field list
+//
+#define GPT_HEADER_MIN_SIZE  92
+
+/**
+  Allocate an I/O buffer that satisfies the device's IoAlign.
+**/
+STATIC
+VOID *
+AllocateIoBuffer (
+  IN EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN UINTN                  Pages
+  )
+{
+  return AllocateAlignedPages (Pages, MAX (BlockIo->Media->IoAlign, EFI_PAGE_SIZE));
+}
+
+/**
+  Read one GPT header and check its signature, CRC32, self LBA and bounds.
+
+  @retval EFI_SUCCESS           The header verified and was copied out.
+  @retval EFI_NOT_FOUND         The block has no GPT signature.
+  @retval EFI_CRC_ERROR         The header CRC32 does not match.
+  @retval EFI_VOLUME_CORRUPTED  A field is out of range.
+**/
+STATIC
+EFI_STATUS
+ReadGptHeader (
+  IN  GPT_TABLE                   *Table,
+  IN  EFI_LBA                     Lba,
+  IN  UINT8                       *Block,
+  OUT EFI_PARTITION_TABLE_HEADER  *Header
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_BLOCK_IO_MEDIA          *Media;
+  EFI_PARTITION_TABLE_HEADER  *OnDisk;
+  UINT32                      Stored;
+  UINT32                      Crc;
+  UINT64                      ArrayBytes;
+  UINT64                      ArrayBlocks;
+
+  Media  = Table->BlockIo->Media;
+  Status = BlockTraceReadBlocks (Table->BlockIo, Media->MediaId, Lba, Media->BlockSize, Block);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Table->DeviceReads++;
+
+  OnDisk = (EFI_PARTITION_TABLE_HEADER *)Block;
+  if (OnDisk->Header.Signature != EFI_PTAB_HEADER_ID) {
+    return EFI_NOT_FOUND;
+  }
+
+  if ((OnDisk->Header.HeaderSize < GPT_HEADER_MIN_SIZE) || (OnDisk->Header.HeaderSize > Media->BlockSize)) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  //
+  // The CRC32 covers HeaderSize bytes with the CRC32 field itself zeroed
+  //
+  Stored               = OnDisk->Header.CRC32;
+  OnDisk->Header.CRC32 = 0;
+  Status               = gBS->CalculateCrc32 (Block, OnDisk->Header.HeaderSize, &Crc);
+  OnDisk->Header.CRC32 = Stored;
+  if (EFI_ERROR (Status) || (Crc != Stored)) {
+    return EFI_CRC_ERROR;
+  }
+
+  if ((OnDisk->MyLBA != Lba) ||
+      (OnDisk->SizeOfPartitionEntry < sizeof (EFI_PARTITION_ENTRY)) ||
+      ((OnDisk->SizeOfPartitionEntry & (OnDisk->SizeOfPartitionEntry - 1)) != 0) ||
+      (OnDisk->FirstUsableLBA > OnDisk->LastUsableLBA) ||
+      (OnDisk->LastUsableLBA > Media->LastBlock))
+  {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  ArrayBytes = MultU64x32 (OnDisk->NumberOfPartitionEntries, OnDisk->SizeOfPartitionEntry);
+  if (ArrayBytes > GPT_MAX_ENTRY_ARRAY_SIZE) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  ArrayBlocks = DivU64x32 (ArrayBytes + Media->BlockSize - 1, Media->BlockSize);
+  if ((OnDisk->PartitionEntryLBA > Media->LastBlock) ||
+      (ArrayBlocks > Media->LastBlock + 1 - OnDisk->PartitionEntryLBA))
+  {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  CopyMem (Header, OnDisk, sizeof (*Header));
+  return EFI_SUCCESS;
+}
+
+/**
+  Read a header's whole entry array with one ReadBlocks () and check its
+  CRC32.
+**/
+STATIC
+EFI_STATUS
+ReadEntryArray (
+  IN GPT_TABLE                   *Table,
+  IN EFI_PARTITION_TABLE_HEADER  *Header
+  )
+{
+  EFI_STATUS          Status;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINTN               ArrayBytes;
+  UINTN               ReadBytes;
+  UINTN               Pages;
+  UINT8               *Array;
+  UINT32              Crc;
+
+  Media      = Table->BlockIo->Media;
+  ArrayBytes = Header->NumberOfPartitionEntries * Header->SizeOfPartitionEntry;
+  ReadBytes  = ALIGN_VALUE (ArrayBytes, Media->BlockSize);
+  if (ReadBytes == 0) {
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  Pages = EFI_SIZE_TO_PAGES (ReadBytes);
+  Array = AllocateIoBuffer (Table->BlockIo, Pages);
+  if (Array == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = BlockTraceReadBlocks (Table->BlockIo, Media->MediaId, Header->PartitionEntryLBA, ReadBytes, Array);
+  if (!EFI_ERROR (Status)) {
+    Table->DeviceReads++;
+    Status = gBS->CalculateCrc32 (Array, ArrayBytes, &Crc);
+    if (!EFI_ERROR (Status) && (Crc != Header->PartitionEntryArrayCRC32)) {
+      Status = EFI_CRC_ERROR;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreeAlignedPages (Array, Pages);
+    return Status;
+  }
+
+  Table->EntryArray      = Array;
+  Table->EntryArrayPages = Pages;
+  CopyMem (&Table->Header, Header, sizeof (*Header));
+  return EFI_SUCCESS;
+}
+
+/**
+  Order partition entries by type GUID, then start LBA, for PerformQuickSort ().
+**/
+STATIC
+INTN
+EFIAPI
+CompareByType (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  CONST EFI_PARTITION_ENTRY  *Left;
+  CONST EFI_PARTITION_ENTRY  *Right;
+  INTN                       Result;
+
+  Left   = *(EFI_PARTITION_ENTRY *CONST *)Buffer1;
+  Right  = *(EFI_PARTITION_ENTRY *CONST *)Buffer2;
+  Result = CompareMem (&Left->PartitionTypeGUID, &Right->PartitionTypeGUID, sizeof (EFI_GUID));
+  if (Result != 0) {
+    return Result;
+  }
+
+  if (Left->StartingLBA < Right->StartingLBA) {
+    return -1;
+  }
+
+  return (Left->StartingLBA > Right->StartingLBA) ? 1 : 0;
+}
+
+/**
+  Compare two partition names of at most GPT_NAME_LENGTH characters. A name
+  that fills the field has no terminator, so neither side is read past it.
+**/
+STATIC
+INTN
+CompareName (
+  IN CONST CHAR16  *Left,
+  IN CONST CHAR16  *Right
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < GPT_NAME_LENGTH; Index++) {
+    if (Left[Index] != Right[Index]) {
+      return (Left[Index] < Right[Index]) ? -1 : 1;
+    }
+
+    if (Left[Index] == L'\0') {
+      break;
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Order partition entries by name for PerformQuickSort ().
+**/
+STATIC
+INTN
+EFIAPI
+CompareByName (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  return CompareName (
+           (*(EFI_PARTITION_ENTRY *CONST *)Buffer1)->PartitionName,
+           (*(EFI_PARTITION_ENTRY *CONST *)Buffer2)->PartitionName
+           );
+}
+
+/**
+  Collect the used entries and sort the two indexes.
+**/
+STATIC
+EFI_STATUS
+BuildIndexes (
+  IN GPT_TABLE  *Table
+  )
+{
+  EFI_PARTITION_ENTRY  *Entry;
+  UINTN                Index;
+  UINTN                Used;
+
+  Used = 0;
+  for (Index = 0; Index < Table->Header.NumberOfPartitionEntries; Index++) {
+    Entry = (EFI_PARTITION_ENTRY *)(Table->EntryArray + Index * Table->Header.SizeOfPartitionEntry);
+    if (!IsZeroGuid (&Entry->PartitionTypeGUID)) {
+      Used++;
+    }
+  }
+
+  Table->EntryCount = Used;
+  if (Used == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Table->ByType = AllocatePool (2 * Used * sizeof (EFI_PARTITION_ENTRY *));
+  if (Table->ByType == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Table->ByName = Table->ByType + Used;
+
+  Used = 0;
+  for (Index = 0; Index < Table->Header.NumberOfPartitionEntries; Index++) {
+    Entry = (EFI_PARTITION_ENTRY *)(Table->EntryArray + Index * Table->Header.SizeOfPartitionEntry);
+    if (!IsZeroGuid (&Entry->PartitionTypeGUID)) {
+      Table->ByType[Used] = Entry;
+      Table->ByName[Used] = Entry;
+      Used++;
+    }
+  }
+
+  PerformQuickSort (Table->ByType, Used, sizeof (EFI_PARTITION_ENTRY *), CompareByType);
+  PerformQuickSort (Table->ByName, Used, sizeof (EFI_PARTITION_ENTRY *), CompareByName);
+  return EFI_SUCCESS;
+}
+
+/**
+  Read, verify and index a disk's GPT.
+
+  @param[out]  Table    Receives the parsed table. Free with GptFree ().
+  @param[in]   BlockIo  Whole-disk Block I/O protocol.
+
+  @retval EFI_SUCCESS           At least one header and entry array verified.
+  @retval EFI_NOT_FOUND         Neither header carries a GPT signature.
+  @retval EFI_NO_MEDIA          The device has no media.
+  @retval EFI_VOLUME_CORRUPTED  A GPT was found but no copy verified.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                ReadBlocks () failed.
+**/
+EFI_STATUS
+GptParse (
+  OUT GPT_TABLE              *Table,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_STATUS                  PrimaryStatus;
+  EFI_STATUS                  BackupStatus;
+  EFI_PARTITION_TABLE_HEADER  Primary;
+  EFI_PARTITION_TABLE_HEADER  Backup;
+  EFI_LBA                     BackupLba;
+  UINT8                       *Block;
+  UINTN                       BlockPages;
+
+  ZeroMem (Table, sizeof (*Table));
+  Table->BlockIo = BlockIo;
+  if (!BlockIo->Media->MediaPresent) {
+    return EFI_NO_MEDIA;
+  }
+
+  BlockPages = EFI_SIZE_TO_PAGES (BlockIo->Media->BlockSize);
+  Block      = AllocateIoBuffer (BlockIo, BlockPages);
+  if (Block == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  PrimaryStatus = ReadGptHeader (Table, 1, Block, &Primary);
+  BackupLba     = EFI_ERROR (PrimaryStatus) ? BlockIo->Media->LastBlock : Primary.AlternateLBA;
+  BackupStatus  = ReadGptHeader (Table, BackupLba, Block, &Backup);
+  FreeAlignedPages (Block, BlockPages);
+
+  Table->PrimaryValid = !EFI_ERROR (PrimaryStatus);
+  Table->BackupValid  = !EFI_ERROR (BackupStatus);
+
+  Status = PrimaryStatus;
+  if (Table->PrimaryValid) {
+    Status = ReadEntryArray (Table, &Primary);
+  }
+
+  if (EFI_ERROR (Status) && (Status != EFI_OUT_OF_RESOURCES) && Table->BackupValid) {
+    Status            = ReadEntryArray (Table, &Backup);
+    Table->UsedBackup = !EFI_ERROR (Status);
+  }
+
+  //
+  // Only report "no GPT" when neither copy carries a signature
+  //
+  if ((Status == EFI_CRC_ERROR) || ((Status == EFI_NOT_FOUND) && (BackupStatus != EFI_NOT_FOUND))) {
+    Status = EFI_VOLUME_CORRUPTED;
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = BuildIndexes (Table);
+  }
+
+  if (EFI_ERROR (Status)) {
+    GptFree (Table);
+  }
+
+  return Status;
+}
+
+/**
+  Release a parsed table.
+
+  @param[in]  Table  Table from GptParse ().
+**/
+VOID
+GptFree (
+  IN GPT_TABLE  *Table
+  )
+{
+  if (Table->EntryArray != NULL) {
+    FreeAlignedPages (Table->EntryArray, Table->EntryArrayPages);
+    Table->EntryArray = NULL;
+  }
+
+  if (Table->ByType != NULL) {
+    FreePool (Table->ByType);
+    Table->ByType = NULL;
+    Table->ByName = NULL;
+  }
+
+  Table->EntryCount = 0;
+}
+
+/**
+  Find the partitions of one type.
+
+  @param[in]   Table     Parsed table.
+  @param[in]   TypeGuid  Partition type GUID.
+  @param[out]  Matches   Receives the first match in Table->ByType; the
+                         matches are consecutive and ordered by start LBA.
+
+  @return Number of matching partitions.
+**/
+UINTN
+GptFindByType (
+  IN  GPT_TABLE            *Table,
+  IN  CONST EFI_GUID       *TypeGuid,
+  OUT EFI_PARTITION_ENTRY  ***Matches
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+  UINTN  Count;
+
+  //
+  // Lower bound: first entry whose type is not below TypeGuid
+  //
+  Low  = 0;
+  High = Table->EntryCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (CompareMem (&Table->ByType[Middle]->PartitionTypeGUID, TypeGuid, sizeof (EFI_GUID)) < 0) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  Count = 0;
+  while ((Low + Count < Table->EntryCount) &&
+         CompareGuid (&Table->ByType[Low + Count]->PartitionTypeGUID, TypeGuid))
+  {
+    Count++;
+  }
+
+  *Matches = (Count == 0) ? NULL : &Table->ByType[Low];
+  return Count;
+}
+
+/**
+  Find a partition by name.
+
+  @param[in]  Table  Parsed table.
+  @param[in]  Name   Partition name, compared case-sensitively.
+
+  @return The partition entry, or NULL if no partition has that name.
+**/
+EFI_PARTITION_ENTRY *
+GptFindByName (
+  IN GPT_TABLE     *Table,
+  IN CONST CHAR16  *Name
+  )
+{
+  UINTN  Low;
+  UINTN  High;
+  UINTN  Middle;
+  INTN   Result;
+
+  if (StrnLenS (Name, GPT_NAME_LENGTH + 1) > GPT_NAME_LENGTH) {
+    return NULL;
+  }
+
+  Low  = 0;
+  High = Table->EntryCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    Result = CompareName (Name, Table->ByName[Middle]->PartitionName);
+    if (Result == 0) {
+      return Table->ByName[Middle];
+    }
+
+    if (Result < 0) {
+      High = Middle;
+    } else {
+      Low = Middle + 1;
+    }
+  }
+
+  return NULL;
+}
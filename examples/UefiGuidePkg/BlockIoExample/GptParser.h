@@ -0,0 +1,105 @@
+/** @file
+  Block I/O Example - verified GPT parser.
+
+  GptParse () reads the primary header at LBA 1 and the backup header at
+  its AlternateLBA, and checks each header's signature, CRC32, self LBA and
+  bounds. It then reads the whole partition entry array with one
+  ReadBlocks () call and checks it against the header's array CRC32. If the
+  primary header or its array is damaged, the backup copy is used instead.
+  The used entries are indexed by partition type GUID and by name, so a
+  boot flow can look up "the EFI system partition" or "the partition named
+  rootfs" without rescanning the array.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef GPT_PARSER_H_
+#define GPT_PARSER_H_
+
+#include <Uefi.h>
+#include <Uefi/UefiGpt.h>
+#include <Protocol/BlockIo.h>
+
+///
+/// Largest entry array accepted; the specification minimum is 16 KB
+///
+#define GPT_MAX_ENTRY_ARRAY_SIZE  SIZE_1MB
+
+#define GPT_NAME_LENGTH  36
+
+typedef struct {
+  EFI_BLOCK_IO_PROTOCOL         *BlockIo;
+  EFI_PARTITION_TABLE_HEADER    Header;         ///< The header in use
+  BOOLEAN                       PrimaryValid;   ///< Primary header verified
+  BOOLEAN                       BackupValid;    ///< Backup header verified
+  BOOLEAN                       UsedBackup;     ///< Header and entries came from the backup
+  UINT8                         *EntryArray;    ///< Whole array from one read
+  UINTN                         EntryArrayPages;
+  UINTN                         EntryCount;     ///< Used entries
+  EFI_PARTITION_ENTRY           **ByType;       ///< Sorted by type GUID, then start LBA
+  EFI_PARTITION_ENTRY           **ByName;       ///< Sorted by name
+  UINTN                         DeviceReads;
+} GPT_TABLE;
+
+/**
+  Read, verify and index a disk's GPT.
+
+  @param[out]  Table    Receives the parsed table. Free with GptFree ().
+  @param[in]   BlockIo  Whole-disk Block I/O protocol.
+
+  @retval EFI_SUCCESS           At least one header and entry array verified.
+  @retval EFI_NOT_FOUND         Neither header carries a GPT signature.
+  @retval EFI_NO_MEDIA          The device has no media.
+  @retval EFI_VOLUME_CORRUPTED  A GPT was found but no copy verified.
+  @retval EFI_OUT_OF_RESOURCES  Memory allocation failed.
+  @retval Others                ReadBlocks () failed.
+**/
+EFI_STATUS
+GptParse (
+  OUT GPT_TABLE              *Table,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo
+  );
+
+/**
+  Release a parsed table.
+
+  @param[in]  Table  Table from GptParse ().
+**/
+VOID
+GptFree (
+  IN GPT_TABLE  *Table
+  );
+
+/**
+  Find the partitions of one type.
+
+  @param[in]   Table     Parsed table.
+  @param[in]   TypeGuid  Partition type GUID.
+  @param[out]  Matches   Receives the first match in Table->ByType; the
+                         matches are consecutive and ordered by start LBA.
+
+  @return Number of matching partitions.
+**/
+UINTN
+GptFindByType (
+  IN  GPT_TABLE            *Table,
+  IN  CONST EFI_GUID       *TypeGuid,
+  OUT EFI_PARTITION_ENTRY  ***Matches
+  );
+
+/**
+  Find a partition by name.
+
+  @param[in]  Table  Parsed table.
+  @param[in]  Name   Partition name, compared case-sensitively.
+
+  @return The partition entry, or NULL if no partition has that name.
+**/
+EFI_PARTITION_ENTRY *
+GptFindByName (
+  IN GPT_TABLE     *Table,
+  IN CONST CHAR16  *Name
+  );
+
+#endif // GPT_PARSER_H_
@@ -0,0 +1,336 @@
+/** @file
+  Block I/O Example - probe every block device at once.
+
+  The default listing visits devices one at a time and waits for each
+  ReadBlocks () before touching the next, so the enumeration time grows
+  with the number of drives. This mode reads LBA 0 and 1 of every Block
+  I/O handle twice. The first pass submits a ReadBlocksEx () to every
+  device that has Block I/O 2 and collects the completions through events;
+  devices without it are read synchronously while the others are in flight.
+  The second pass reads them one by one. Both passes run the same 2-block
+  read, and the serial pass runs second, so any warm device cache favours
+  the serial time.
+
+  Usage: BlockIoExample.efi probe
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "BlockIoExample.h"
+#include "BlockTrace.h"
+
+#define PROBE_BLOCKS  2
+
+///
+/// One probed device
+///
+typedef struct {
+  EFI_BLOCK_IO_PROTOCOL     *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL    *BlockIo2;
+  EFI_BLOCK_IO2_TOKEN       Token;
+  EFI_EVENT                 Wake;           ///< Shared; signalled on completion
+  volatile UINTN            *Completed;     ///< Shared completion count
+  UINT8                     *Buffer;
+  UINTN                     Pages;
+  UINTN                     Length;
+  EFI_STATUS                AsyncStatus;
+  EFI_STATUS                SerialStatus;
+  UINT64                    SubmitTicks;
+  UINT64                    CompleteTicks;
+  UINT64                    SerialNs;
+  UINT64                    TraceId;
+} PROBE_DEVICE;
+
+/**
+  Completion notification for one device's probe.
+**/
+STATIC
+VOID
+EFIAPI
+ProbeComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  PROBE_DEVICE  *Device;
+
+  Device                = (PROBE_DEVICE *)Context;
+  Device->CompleteTicks = BenchmarkGetTicks ();
+  BlockTraceComplete (Device->TraceId, Device->Token.TransactionStatus);
+  (*Device->Completed)++;
+  gBS->SignalEvent (Device->Wake);
+}
+
+/**
+  Name the partition scheme found in a probe buffer.
+**/
+STATIC
+CONST CHAR16 *
+ProbeScheme (
+  IN PROBE_DEVICE  *Device
+  )
+{
+  UINT32  BlockSize;
+
+  BlockSize = Device->BlockIo->Media->BlockSize;
+  if ((Device->Length > BlockSize) && (CompareMem (Device->Buffer + BlockSize, "EFI PART", 8) == 0)) {
+    return L"GPT";
+  }
+
+  if ((BlockSize >= 512) && (Device->Buffer[510] == 0x55) && (Device->Buffer[511] == 0xAA)) {
+    return L"MBR";
+  }
+
+  return L"-";
+}
+
+/**
+  Submit every async probe, read the synchronous-only devices meanwhile,
+  and wait for the rest.
+**/
+STATIC
+EFI_STATUS
+ProbeParallel (
+  IN  PROBE_DEVICE  *Devices,
+  IN  UINTN         Count,
+  OUT UINT64        *ElapsedNs
+  )
+{
+  EFI_STATUS      Status;
+  EFI_EVENT       Wake;
+  volatile UINTN  Completed;
+  UINTN           Submitted;
+  UINTN           Index;
+  UINTN           WaitIndex;
+  UINT64          Start;
+  PROBE_DEVICE    *Device;
+
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Wake);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Completed = 0;
+  Submitted = 0;
+  Start     = BenchmarkGetTicks ();
+
+  for (Index = 0; Index < Count; Index++) {
+    Device = &Devices[Index];
+    if (Device->BlockIo2 == NULL) {
+      continue;
+    }
+
+    Device->Wake      = Wake;
+    Device->Completed = &Completed;
+    Status            = gBS->CreateEvent (EVT_NOTIFY_SIGNAL, TPL_CALLBACK, ProbeComplete, Device, &Device->Token.Event);
+    if (EFI_ERROR (Status)) {
+      Device->AsyncStatus = Status;
+      continue;
+    }
+
+    Device->Token.TransactionStatus = EFI_NOT_READY;
+    Device->TraceId                 = BlockTraceSubmit (Device->BlockIo2->Media, 0, Device->Length, TRUE);
+    Device->SubmitTicks             = BenchmarkGetTicks ();
+    Device->AsyncStatus             = Device->BlockIo2->ReadBlocksEx (
+                                                          Device->BlockIo2,
+                                                          Device->BlockIo2->Media->MediaId,
+                                                          0,
+                                                          &Device->Token,
+                                                          Device->Length,
+                                                          Device->Buffer
+                                                          );
+    if (EFI_ERROR (Device->AsyncStatus)) {
+      BlockTraceComplete (Device->TraceId, Device->AsyncStatus);
+      gBS->CloseEvent (Device->Token.Event);
+      Device->Token.Event = NULL;
+      continue;
+    }
+
+    Submitted++;
+  }
+
+  //
+  // Devices without Block I/O 2 overlap with the requests in flight
+  //
+  for (Index = 0; Index < Count; Index++) {
+    Device = &Devices[Index];
+    if (Device->BlockIo2 != NULL) {
+      continue;
+    }
+
+    Device->SubmitTicks   = BenchmarkGetTicks ();
+    Device->AsyncStatus   = BlockTraceReadBlocks (
+                              Device->BlockIo,
+                              Device->BlockIo->Media->MediaId,
+                              0,
+                              Device->Length,
+                              Device->Buffer
+                              );
+    Device->CompleteTicks = BenchmarkGetTicks ();
+  }
+
+  while (Completed < Submitted) {
+    gBS->WaitForEvent (1, &Wake, &WaitIndex);
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+
+  for (Index = 0; Index < Count; Index++) {
+    Device = &Devices[Index];
+    if (Device->Token.Event != NULL) {
+      Device->AsyncStatus = Device->Token.TransactionStatus;
+      gBS->CloseEvent (Device->Token.Event);
+      Device->Token.Event = NULL;
+    }
+  }
+
+  gBS->CloseEvent (Wake);
+  return EFI_SUCCESS;
+}
+
+/**
+  Read every device one at a time, the way the default listing does.
+**/
+STATIC
+VOID
+ProbeSerial (
+  IN  PROBE_DEVICE  *Devices,
+  IN  UINTN         Count,
+  OUT UINT64        *ElapsedNs
+  )
+{
+  UINTN         Index;
+  UINT64        Start;
+  UINT64        DeviceStart;
+  PROBE_DEVICE  *Device;
+
+  Start = BenchmarkGetTicks ();
+  for (Index = 0; Index < Count; Index++) {
+    Device               = &Devices[Index];
+    DeviceStart          = BenchmarkGetTicks ();
+    Device->SerialStatus = BlockTraceReadBlocks (
+                             Device->BlockIo,
+                             Device->BlockIo->Media->MediaId,
+                             0,
+                             Device->Length,
+                             Device->Buffer
+                             );
+    Device->SerialNs = BenchmarkElapsedNs (DeviceStart, BenchmarkGetTicks ());
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+}
+
+/**
+  Probe every block device concurrently and compare with the serial path.
+**/
+EFI_STATUS
+DemoParallelProbe (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS          Status;
+  EFI_HANDLE          *HandleBuffer;
+  UINTN               HandleCount;
+  UINTN               Index;
+  UINTN               Count;
+  PROBE_DEVICE        *Devices;
+  PROBE_DEVICE        *Device;
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINT64              ParallelNs;
+  UINT64              SerialNs;
+
+  Print (L"\n=== Parallel Device Probe ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gEfiBlockIoProtocolGuid, NULL, &HandleCount, &HandleBuffer);
+  if (EFI_ERROR (Status)) {
+    Print (L"No block devices found: %r\n", Status);
+    return Status;
+  }
+
+  Devices = AllocateZeroPool (HandleCount * sizeof (PROBE_DEVICE));
+  if (Devices == NULL) {
+    gBS->FreePool (HandleBuffer);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Count = 0;
+  for (Index = 0; Index < HandleCount; Index++) {
+    Device = &Devices[Count];
+    Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiBlockIoProtocolGuid, (VOID **)&Device->BlockIo);
+    if (EFI_ERROR (Status) || !Device->BlockIo->Media->MediaPresent) {
+      continue;
+    }
+
+    Media          = Device->BlockIo->Media;
+    Device->Length = (UINTN)MIN (PROBE_BLOCKS, Media->LastBlock + 1) * Media->BlockSize;
+    Device->Pages  = EFI_SIZE_TO_PAGES (Device->Length);
+    Device->Buffer = AllocateAlignedPages (Device->Pages, MAX (Media->IoAlign, EFI_PAGE_SIZE));
+    if (Device->Buffer == NULL) {
+      continue;
+    }
+
+    if (EFI_ERROR (gBS->HandleProtocol (HandleBuffer[Index], &gEfiBlockIo2ProtocolGuid, (VOID **)&Device->BlockIo2))) {
+      Device->BlockIo2 = NULL;
+    }
+
+    Count++;
+  }
+
+  gBS->FreePool (HandleBuffer);
+
+  Status = ProbeParallel (Devices, Count, &ParallelNs);
+  if (!EFI_ERROR (Status)) {
+    ProbeSerial (Devices, Count, &SerialNs);
+
+    Print (L"  # Kind   Block      Size MB Scheme   Async us  Serial us Status\n");
+    Print (L"--- ----- ------ ------------ ------- --------- ---------- ------\n");
+    for (Index = 0; Index < Count; Index++) {
+      Device = &Devices[Index];
+      Media  = Device->BlockIo->Media;
+      Print (L"%3d %-5s %6d %12ld %-7s %9ld %10ld %r\n",
+             Index + 1,
+             Media->LogicalPartition ? L"part" : L"disk",
+             Media->BlockSize,
+             DivU64x32 (MultU64x32 (Media->LastBlock + 1, Media->BlockSize), SIZE_1MB),
+             EFI_ERROR (Device->SerialStatus) ? L"?" : ProbeScheme (Device),
+             DivU64x32 (BenchmarkElapsedNs (Device->SubmitTicks, Device->CompleteTicks), 1000),
+             DivU64x32 (Device->SerialNs, 1000),
+             EFI_ERROR (Device->AsyncStatus) ? Device->AsyncStatus : Device->SerialStatus
+             );
+    }
+
+    Print (L"\n%d device(s): parallel %ld us, serial %ld us",
+           Count, DivU64x32 (ParallelNs, 1000), DivU64x32 (SerialNs, 1000));
+    if (ParallelNs != 0) {
+      Print (L", %ld.%ldx faster\n",
+             DivU64x64Remainder (SerialNs, ParallelNs, NULL),
+             DivU64x64Remainder (MultU64x32 (SerialNs, 10), ParallelNs, NULL) % 10);
+    } else {
+      Print (L"\n");
+    }
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    FreeAlignedPages (Devices[Index].Buffer, Devices[Index].Pages);
+  }
+
+  FreePool (Devices);
+  return Status;
+}
@@ -0,0 +1,455 @@
+/** @file
+  Block I/O Example - alignment-aware transfer planner.
+
+  A request is cut into up to three segments: a head from the physical
+  boundary at or below the first byte to the first boundary whose blocks are
+  wholly wanted, a middle of whole wanted physical blocks, and a tail back
+  out to the next physical boundary. Each segment is split at MaxTransfer.
+  When LowestAlignedLba is not 0, the blocks below it form a short first
+  physical block, so a plan that starts there ends its first transfer at
+  LowestAlignedLba. From then on every transfer starts on a physical
+  boundary, and because MaxTransfer is a whole number of physical blocks,
+  every transfer is physically aligned.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "TransferPlanner.h"
+#include "BlockTrace.h"
+
+///
+/// Iteration state over one request's plan
+///
+typedef struct {
+  UINT64     Offset;
+  UINTN      Length;
+  UINTN      Buffer;
+  EFI_LBA    Lba;
+  EFI_LBA    HeadLba;
+  EFI_LBA    TailLba;
+  EFI_LBA    StopLba;
+} PLAN_CURSOR;
+
+/**
+  Greatest common divisor.
+**/
+STATIC
+UINTN
+Gcd (
+  IN UINTN  A,
+  IN UINTN  B
+  )
+{
+  UINTN  Rest;
+
+  while (B != 0) {
+    Rest = A % B;
+    A    = B;
+    B    = Rest;
+  }
+
+  return A;
+}
+
+/**
+  Round an LBA down to a physical block boundary.
+**/
+STATIC
+EFI_LBA
+RoundDownPhysical (
+  IN TRANSFER_PLANNER  *Planner,
+  IN EFI_LBA           Lba
+  )
+{
+  UINT32  Rest;
+
+  if (Lba < Planner->AlignedLba) {
+    return 0;
+  }
+
+  DivU64x32Remainder (Lba - Planner->AlignedLba, Planner->PhysicalBlocks, &Rest);
+  return Lba - Rest;
+}
+
+/**
+  Round an LBA up to a physical block boundary, not past the end of media.
+**/
+STATIC
+EFI_LBA
+RoundUpPhysical (
+  IN TRANSFER_PLANNER  *Planner,
+  IN EFI_LBA           Lba
+  )
+{
+  EFI_LBA  Rounded;
+
+  Rounded = RoundDownPhysical (Planner, Lba);
+  if (Rounded != Lba) {
+    Rounded = (Lba < Planner->AlignedLba) ? Planner->AlignedLba : Rounded + Planner->PhysicalBlocks;
+  }
+
+  return MIN (Rounded, Planner->BlockIo->Media->LastBlock + 1);
+}
+
+/**
+  Check whether an LBA starts a physical block.
+**/
+STATIC
+BOOLEAN
+IsPhysicalBoundary (
+  IN TRANSFER_PLANNER  *Planner,
+  IN EFI_LBA           Lba
+  )
+{
+  return (Lba == 0) || (Lba == Planner->BlockIo->Media->LastBlock + 1) ||
+         (RoundDownPhysical (Planner, Lba) == Lba);
+}
+
+/**
+  Check whether the controller can transfer directly to Address.
+**/
+STATIC
+BOOLEAN
+IsIoAligned (
+  IN TRANSFER_PLANNER  *Planner,
+  IN UINTN             Address
+  )
+{
+  return (Planner->IoAlign <= 1) || ((Address & (Planner->IoAlign - 1)) == 0);
+}
+
+/**
+  Set up a cursor over a request's plan.
+**/
+STATIC
+VOID
+StartPlan (
+  IN  TRANSFER_PLANNER  *Planner,
+  IN  UINT64            Offset,
+  IN  UINTN             Length,
+  IN  VOID              *Buffer,
+  OUT PLAN_CURSOR       *Cursor
+  )
+{
+  EFI_LBA  FirstLba;
+  EFI_LBA  EndLba;
+  UINT32   Rest;
+
+  Cursor->Offset = Offset;
+  Cursor->Length = Length;
+  Cursor->Buffer = (UINTN)Buffer;
+
+  FirstLba = DivU64x32Remainder (Offset, Planner->BlockSize, &Rest);
+  EndLba   = DivU64x32 (Offset + Length + Planner->BlockSize - 1, Planner->BlockSize);
+
+  Cursor->Lba     = RoundDownPhysical (Planner, FirstLba);
+  Cursor->StopLba = RoundUpPhysical (Planner, EndLba);
+
+  //
+  // Whole wanted physical blocks lie between HeadLba and TailLba
+  //
+  Cursor->HeadLba = RoundUpPhysical (Planner, FirstLba + ((Rest != 0) ? 1 : 0));
+  Cursor->TailLba = RoundDownPhysical (Planner, DivU64x32 (Offset + Length, Planner->BlockSize));
+  if (Cursor->HeadLba >= Cursor->TailLba) {
+    Cursor->HeadLba = Cursor->StopLba;
+    Cursor->TailLba = Cursor->StopLba;
+  }
+}
+
+/**
+  Produce the next chunk of a plan.
+
+  @retval TRUE   Chunk was filled in.
+  @retval FALSE  The plan is complete.
+**/
+STATIC
+BOOLEAN
+NextChunk (
+  IN     TRANSFER_PLANNER  *Planner,
+  IN OUT PLAN_CURSOR       *Cursor,
+  OUT    TRANSFER_CHUNK    *Chunk
+  )
+{
+  EFI_LBA  Limit;
+  UINT64   ChunkStart;
+  UINT64   ChunkEnd;
+  UINT64   WantStart;
+  UINT64   WantEnd;
+
+  if (Cursor->Lba >= Cursor->StopLba) {
+    return FALSE;
+  }
+
+  if (Cursor->Lba < Cursor->HeadLba) {
+    Limit = Cursor->HeadLba;
+  } else if (Cursor->Lba < Cursor->TailLba) {
+    Limit = Cursor->TailLba;
+  } else {
+    Limit = Cursor->StopLba;
+  }
+
+  //
+  // [0, AlignedLba) is its own segment; cutting across it would shift every
+  // later chunk off the physical grid
+  //
+  if (Cursor->Lba < Planner->AlignedLba) {
+    Limit = MIN (Limit, Planner->AlignedLba);
+  }
+
+  Chunk->Lba    = Cursor->Lba;
+  Chunk->Blocks = (UINTN)MIN (Planner->MaxTransfer / Planner->BlockSize, Limit - Cursor->Lba);
+
+  ChunkStart = MultU64x32 (Chunk->Lba, Planner->BlockSize);
+  ChunkEnd   = ChunkStart + Chunk->Blocks * Planner->BlockSize;
+  WantStart  = MAX (ChunkStart, Cursor->Offset);
+  WantEnd    = MIN (ChunkEnd, Cursor->Offset + Cursor->Length);
+
+  Chunk->CopyOffset   = (UINTN)(WantStart - ChunkStart);
+  Chunk->CopyLength   = (WantEnd > WantStart) ? (UINTN)(WantEnd - WantStart) : 0;
+  Chunk->BufferOffset = (UINTN)(WantStart - Cursor->Offset);
+  Chunk->Bounce       = (WantStart != ChunkStart) || (WantEnd != ChunkEnd) ||
+                        !IsIoAligned (Planner, Cursor->Buffer + Chunk->BufferOffset);
+
+  Cursor->Lba += Chunk->Blocks;
+  return TRUE;
+}
+
+/**
+  Count what a naive split would have done wrong: transfers that start or
+  end inside a physical block, and transfers whose address in Buffer, where
+  the covering blocks would be read, breaks IoAlign.
+**/
+STATIC
+VOID
+CountNaive (
+  IN TRANSFER_PLANNER  *Planner,
+  IN UINT64            Offset,
+  IN UINTN             Length,
+  IN VOID              *Buffer
+  )
+{
+  EFI_LBA  Lba;
+  EFI_LBA  EndLba;
+  UINTN    MaxBlocks;
+  UINTN    Blocks;
+  UINTN    Done;
+
+  Lba       = DivU64x32 (Offset, Planner->BlockSize);
+  EndLba    = DivU64x32 (Offset + Length + Planner->BlockSize - 1, Planner->BlockSize);
+  MaxBlocks = Planner->MaxTransfer / Planner->BlockSize;
+  Done      = 0;
+
+  while (Lba < EndLba) {
+    Blocks = (UINTN)MIN (MaxBlocks, EndLba - Lba);
+    if (!IsPhysicalBoundary (Planner, Lba) || !IsPhysicalBoundary (Planner, Lba + Blocks)) {
+      Planner->SplitsAvoided++;
+    }
+
+    if (!IsIoAligned (Planner, (UINTN)Buffer + Done * Planner->BlockSize)) {
+      Planner->MisalignedAvoided++;
+    }
+
+    Lba  += Blocks;
+    Done += Blocks;
+  }
+}
+
+/**
+  Initialize a planner for one device.
+
+  @param[out]  Planner      Planner to initialize.
+  @param[in]   BlockIo      Device to plan for.
+  @param[in]   MaxTransfer  Largest transfer in bytes, rounded down to a
+                            multiple of the physical block and transfer
+                            granularity. 0 selects
+                            TRANSFER_PLANNER_DEFAULT_MAX.
+
+  @retval EFI_SUCCESS   The planner is ready.
+  @retval EFI_NO_MEDIA  The device has no media.
+**/
+EFI_STATUS
+TransferPlannerInit (
+  OUT TRANSFER_PLANNER       *Planner,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  UINTN                  MaxTransfer
+  )
+{
+  EFI_BLOCK_IO_MEDIA  *Media;
+  UINTN               Granularity;
+  UINTN               UnitBlocks;
+  UINTN               MaxBlocks;
+
+  Media = BlockIo->Media;
+  if (!Media->MediaPresent) {
+    return EFI_NO_MEDIA;
+  }
+
+  ZeroMem (Planner, sizeof (*Planner));
+  Planner->BlockIo        = BlockIo;
+  Planner->BlockSize      = Media->BlockSize;
+  Planner->IoAlign        = Media->IoAlign;
+  Planner->PhysicalBlocks = 1;
+  Granularity             = 1;
+
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION2) {
+    Granularity = MAX (Media->OptimalTransferLengthGranularity, 1);
+  }
+
+  if (BlockIo->Revision >= EFI_BLOCK_IO_PROTOCOL_REVISION3) {
+    Planner->PhysicalBlocks = MAX (Media->LogicalBlocksPerPhysicalBlock, 1);
+    Planner->AlignedLba     = Media->LowestAlignedLba;
+  }
+
+  //
+  // Transfers must be whole physical blocks and whole granules
+  //
+  UnitBlocks = Planner->PhysicalBlocks / Gcd (Planner->PhysicalBlocks, Granularity) * Granularity;
+  MaxBlocks  = ((MaxTransfer == 0) ? TRANSFER_PLANNER_DEFAULT_MAX : MaxTransfer) / Planner->BlockSize;
+  MaxBlocks  = MAX (MaxBlocks - MaxBlocks % UnitBlocks, UnitBlocks);
+
+  Planner->MaxTransfer = MaxBlocks * Planner->BlockSize;
+  return EFI_SUCCESS;
+}
+
+/**
+  Release the planner's bounce buffer.
+
+  @param[in]  Planner  Planner to free.
+**/
+VOID
+TransferPlannerFree (
+  IN TRANSFER_PLANNER  *Planner
+  )
+{
+  if (Planner->Bounce != NULL) {
+    FreeAlignedPages (Planner->Bounce, Planner->BouncePages);
+    Planner->Bounce = NULL;
+  }
+}
+
+/**
+  Plan a byte-range read into Buffer without issuing it.
+
+  @param[in]   Planner    Planner to use.
+  @param[in]   Offset     Device byte offset.
+  @param[in]   Length     Bytes wanted.
+  @param[in]   Buffer     Destination; decides which chunks can be direct.
+  @param[out]  Chunks     Receives the plan. NULL to only count chunks.
+  @param[in]   MaxChunks  Capacity of Chunks.
+
+  @return Number of chunks in the full plan, which may exceed MaxChunks.
+**/
+UINTN
+TransferPlannerPlan (
+  IN  TRANSFER_PLANNER  *Planner,
+  IN  UINT64            Offset,
+  IN  UINTN             Length,
+  IN  VOID              *Buffer,
+  OUT TRANSFER_CHUNK    *Chunks OPTIONAL,
+  IN  UINTN             MaxChunks
+  )
+{
+  PLAN_CURSOR     Cursor;
+  TRANSFER_CHUNK  Chunk;
+  UINTN           Count;
+
+  if (Length == 0) {
+    return 0;
+  }
+
+  Count = 0;
+  StartPlan (Planner, Offset, Length, Buffer, &Cursor);
+  while (NextChunk (Planner, &Cursor, &Chunk)) {
+    if ((Chunks != NULL) && (Count < MaxChunks)) {
+      CopyMem (&Chunks[Count], &Chunk, sizeof (Chunk));
+    }
+
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Read an arbitrary byte range using the planned transfers.
+
+  @param[in]   Planner  Planner to use.
+  @param[in]   Offset   Device byte offset.
+  @param[in]   Length   Bytes to read.
+  @param[out]  Buffer   Destination; any alignment.
+
+  @retval EFI_SUCCESS            The range was read.
+  @retval EFI_INVALID_PARAMETER  The range is past the end of the device.
+  @retval EFI_OUT_OF_RESOURCES   The bounce buffer could not be allocated.
+  @retval Others                 ReadBlocks () failed.
+**/
+EFI_STATUS
+TransferPlannerRead (
+  IN  TRANSFER_PLANNER  *Planner,
+  IN  UINT64            Offset,
+  IN  UINTN             Length,
+  OUT VOID              *Buffer
+  )
+{
+  EFI_STATUS             Status;
+  EFI_BLOCK_IO_PROTOCOL  *BlockIo;
+  PLAN_CURSOR            Cursor;
+  TRANSFER_CHUNK         Chunk;
+  UINT8                  *Target;
+
+  if (Length == 0) {
+    return EFI_SUCCESS;
+  }
+
+  BlockIo = Planner->BlockIo;
+  if (Offset + Length > MultU64x32 (BlockIo->Media->LastBlock + 1, Planner->BlockSize)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Planner->Requests++;
+  CountNaive (Planner, Offset, Length, Buffer);
+
+  StartPlan (Planner, Offset, Length, Buffer, &Cursor);
+  while (NextChunk (Planner, &Cursor, &Chunk)) {
+    if (Chunk.Bounce) {
+      if (Planner->Bounce == NULL) {
+        Planner->BouncePages = EFI_SIZE_TO_PAGES (Planner->MaxTransfer);
+        Planner->Bounce      = AllocateAlignedPages (Planner->BouncePages, MAX (Planner->IoAlign, EFI_PAGE_SIZE));
+        if (Planner->Bounce == NULL) {
+          return EFI_OUT_OF_RESOURCES;
+        }
+
+        Planner->BounceAllocations++;
+      }
+
+      Target = Planner->Bounce;
+      Planner->BounceChunks++;
+    } else {
+      Target = (UINT8 *)Buffer + Chunk.BufferOffset;
+      Planner->DirectChunks++;
+    }
+
+    Status = BlockTraceReadBlocks (
+               BlockIo,
+               BlockIo->Media->MediaId,
+               Chunk.Lba,
+               Chunk.Blocks * Planner->BlockSize,
+               Target
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (Chunk.Bounce && (Chunk.CopyLength != 0)) {
+      CopyMem ((UINT8 *)Buffer + Chunk.BufferOffset, Target + Chunk.CopyOffset, Chunk.CopyLength);
+    }
+  }
+
+  return EFI_SUCCESS;
+}
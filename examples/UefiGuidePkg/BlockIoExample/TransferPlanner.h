@@ -0,0 +1,131 @@
+/** @file
+  Block I/O Example - alignment-aware transfer planner.
+
+  Turns a byte-range request into block transfers that start and end on
+  physical block boundaries (LowestAlignedLba, LogicalBlocksPerPhysicalBlock),
+  are no larger than an optimal size derived from
+  OptimalTransferLengthGranularity, and land in memory that satisfies
+  Media->IoAlign. Chunks that cover whole blocks of the caller's buffer at a
+  suitable address are read in place; only the partial head and tail, or a
+  caller buffer the controller cannot DMA into, go through a bounce buffer.
+
+  On a 512e disk a 512-byte read or write that is not aligned to the 4 KB
+  physical sector makes the drive touch two physical sectors, and a write
+  becomes a read-modify-write inside the drive. The planner counts how many
+  of those a naive block-by-block split would have issued.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef TRANSFER_PLANNER_H_
+#define TRANSFER_PLANNER_H_
+
+#include <Uefi.h>
+#include <Protocol/BlockIo.h>
+
+#define TRANSFER_PLANNER_DEFAULT_MAX  SIZE_1MB
+
+///
+/// One planned block transfer and the part of it the caller wants
+///
+typedef struct {
+  EFI_LBA    Lba;
+  UINTN      Blocks;
+  UINTN      CopyOffset;          ///< First wanted byte within the transfer
+  UINTN      CopyLength;          ///< Wanted bytes
+  UINTN      BufferOffset;        ///< Where they go in the caller's buffer
+  BOOLEAN    Bounce;              ///< Read via the bounce buffer
+} TRANSFER_CHUNK;
+
+typedef struct {
+  EFI_BLOCK_IO_PROTOCOL    *BlockIo;
+  UINT32                   BlockSize;
+  UINT32                   PhysicalBlocks;    ///< Logical blocks per physical
+  EFI_LBA                  AlignedLba;        ///< First physically aligned LBA
+  UINT32                   IoAlign;
+  UINTN                    MaxTransfer;       ///< Bytes; whole physical blocks
+  VOID                     *Bounce;           ///< Allocated on first need
+  UINTN                    BouncePages;
+  UINT64                   Requests;
+  UINT64                   DirectChunks;
+  UINT64                   BounceChunks;
+  UINT64                   BounceAllocations;
+  UINT64                   SplitsAvoided;     ///< Naive partial-physical transfers
+  UINT64                   MisalignedAvoided; ///< Naive transfers breaking IoAlign
+} TRANSFER_PLANNER;
+
+/**
+  Initialize a planner for one device.
+
+  @param[out]  Planner      Planner to initialize.
+  @param[in]   BlockIo      Device to plan for.
+  @param[in]   MaxTransfer  Largest transfer in bytes, rounded down to a
+                            multiple of the physical block and transfer
+                            granularity. 0 selects
+                            TRANSFER_PLANNER_DEFAULT_MAX.
+
+  @retval EFI_SUCCESS   The planner is ready.
+  @retval EFI_NO_MEDIA  The device has no media.
+**/
+EFI_STATUS
+TransferPlannerInit (
+  OUT TRANSFER_PLANNER       *Planner,
+  IN  EFI_BLOCK_IO_PROTOCOL  *BlockIo,
+  IN  UINTN                  MaxTransfer
+  );
+
+/**
+  Release the planner's bounce buffer.
+
+  @param[in]  Planner  Planner to free.
+**/
+VOID
+TransferPlannerFree (
+  IN TRANSFER_PLANNER  *Planner
+  );
+
+/**
+  Plan a byte-range read into Buffer without issuing it.
+
+  @param[in]   Planner    Planner to use.
+  @param[in]   Offset     Device byte offset.
+  @param[in]   Length     Bytes wanted.
+  @param[in]   Buffer     Destination; decides which chunks can be direct.
+  @param[out]  Chunks     Receives the plan. NULL to only count chunks.
+  @param[in]   MaxChunks  Capacity of Chunks.
+
+  @return Number of chunks in the full plan, which may exceed MaxChunks.
+**/
+UINTN
+TransferPlannerPlan (
+  IN  TRANSFER_PLANNER  *Planner,
+  IN  UINT64            Offset,
+  IN  UINTN             Length,
+  IN  VOID              *Buffer,
+  OUT TRANSFER_CHUNK    *Chunks OPTIONAL,
+  IN  UINTN             MaxChunks
+  );
+
+/**
+  Read an arbitrary byte range using the planned transfers.
+
+  @param[in]   Planner  Planner to use.
+  @param[in]   Offset   Device byte offset.
+  @param[in]   Length   Bytes to read.
+  @param[out]  Buffer   Destination; any alignment.
+
+  @retval EFI_SUCCESS            The range was read.
+  @retval EFI_INVALID_PARAMETER  The range is past the end of the device.
+  @retval EFI_OUT_OF_RESOURCES   The bounce buffer could not be allocated.
+  @retval Others                 ReadBlocks () failed.
+**/
+EFI_STATUS
+TransferPlannerRead (
+  IN  TRANSFER_PLANNER  *Planner,
+  IN  UINT64            Offset,
+  IN  UINTN             Length,
+  OUT VOID              *Buffer
+  );
+
+#endif // TRANSFER_PLANNER_H_
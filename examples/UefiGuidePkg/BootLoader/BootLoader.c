@@ -16,10 +16,13 @@
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/PrintLib.h>
+#include <Library/MemoryMapLib.h>
+#include <Library/AsyncFileLib.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/LoadedImage.h>
 #include <Protocol/GraphicsOutput.h>
@@ -125,6 +128,8 @@ LoadKernel (
   EFI_FILE_INFO                    *FileInfo;
   UINTN                            InfoSize;
   VOID                             *Buffer;
+  EFI_PHYSICAL_ADDRESS             Address;
+  UINTN                            Alignment;
 
   *KernelBuffer = NULL;
   *KernelSize = 0;
@@ -160,13 +165,13 @@ LoadKernel (
   // Open kernel file
   Print (L"Loading kernel: %s\n", KernelPath);
 
-  Status = Root->Open (
-                   Root,
-                   &KernelFile,
-                   KernelPath,
-                   EFI_FILE_MODE_READ,
-                   0
-                   );
+  Status = AsyncFileOpen (
+             Root,
+             &KernelFile,
+             KernelPath,
+             EFI_FILE_MODE_READ,
+             0
+             );
 
   if (EFI_ERROR (Status)) {
     Print (L"Failed to open kernel file: %r\n", Status);
@@ -195,14 +200,15 @@ LoadKernel (
   Print (L"Kernel size: %d bytes\n", *KernelSize);
   FreePool (FileInfo);
 
-  // Allocate buffer for kernel (aligned pages)
+  // Allocate buffer for kernel, 2 MB aligned when large enough so the
+  // kernel can map its image with large pages
   UINTN Pages = EFI_SIZE_TO_PAGES (*KernelSize);
-  Status = gBS->AllocatePages (
-                  AllocateAnyPages,
-                  EfiLoaderData,
-                  Pages,
-                  (EFI_PHYSICAL_ADDRESS *)&Buffer
-                  );
+  Status = MemoryMapAllocateLargePages (
+             EfiLoaderData,
+             Pages,
+             &Address,
+             &Alignment
+             );
 
   if (EFI_ERROR (Status)) {
     Print (L"Failed to allocate memory for kernel\n");
@@ -211,8 +217,11 @@ LoadKernel (
     return Status;
   }
 
-  // Read kernel
-  Status = KernelFile->Read (KernelFile, KernelSize, Buffer);
+  // Read kernel with two ReadEx () requests in flight. A Process callback
+  // here could verify or decompress each chunk while the next one loads.
+  Print (L"Reading with %s I/O\n", AsyncFileSupported (KernelFile) ? L"overlapped" : L"blocking");
+  Buffer = (VOID *)(UINTN)Address;
+  Status = AsyncFileRead (KernelFile, KernelSize, Buffer, ASYNC_FILE_DEFAULT_CHUNK, NULL, NULL);
   if (EFI_ERROR (Status)) {
     Print (L"Failed to read kernel: %r\n", Status);
     gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
@@ -222,7 +231,7 @@ LoadKernel (
   }
 
   *KernelBuffer = Buffer;
-  Print (L"Kernel loaded at 0x%lx\n", (UINT64)(UINTN)Buffer);
+  Print (L"Kernel loaded at 0x%lx (%d KB aligned)\n", (UINT64)(UINTN)Buffer, Alignment / SIZE_1KB);
 
   KernelFile->Close (KernelFile);
   Root->Close (Root);
@@ -241,29 +250,10 @@ GetMemoryMapForExit (
   OUT UINTN                  *DescriptorSize
   )
 {
-  EFI_STATUS  Status;
-  UINT32      DescriptorVersion;
-
-  *MemoryMapSize = 0;
-  Status = gBS->GetMemoryMap (MemoryMapSize, NULL, MapKey,
-                              DescriptorSize, &DescriptorVersion);
-
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    return EFI_LOAD_ERROR;
-  }
-
-  // Add extra space for allocation
-  *MemoryMapSize += 2 * (*DescriptorSize);
-
-  *MemoryMap = AllocatePool (*MemoryMapSize);
-  if (*MemoryMap == NULL) {
-    return EFI_OUT_OF_RESOURCES;
-  }
-
-  Status = gBS->GetMemoryMap (MemoryMapSize, *MemoryMap, MapKey,
-                              DescriptorSize, &DescriptorVersion);
-
-  return Status;
+  //
+  // MemoryMapLib handles the size query, slack and retry on growth
+  //
+  return MemoryMapGet (MemoryMap, MemoryMapSize, MapKey, DescriptorSize, NULL);
 }
 
 /**
@@ -274,12 +264,14 @@ DemoBootProcess (
   IN EFI_HANDLE  ImageHandle
   )
 {
-  EFI_STATUS             Status;
-  BOOT_INFO              BootInfo;
-  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
-  UINTN                  MemoryMapSize;
-  UINTN                  MapKey;
-  UINTN                  DescriptorSize;
+  EFI_STATUS               Status;
+  BOOT_INFO                BootInfo;
+  EFI_MEMORY_DESCRIPTOR    *MemoryMap;
+  UINTN                    MemoryMapSize;
+  UINTN                    MapKey;
+  UINTN                    DescriptorSize;
+  MEMORY_MAP_SNAPSHOT      Snapshot;
+  CONST MEMORY_MAP_REGION  *Region;
 
   Print (L"\n=== Boot Loader Demo ===\n\n");
   Print (L"This demonstrates the boot process without actually booting.\n\n");
@@ -319,6 +311,24 @@ DemoBootProcess (
     FreePool (MemoryMap);
   }
 
+  // Check placement using a coalesced snapshot (binary-search lookups)
+  Status = MemoryMapSnapshotCapture (&Snapshot);
+  if (!EFI_ERROR (Status)) {
+    Print (L"Coalesced regions: %d, free memory: %ld MB\n",
+           Snapshot.RegionCount,
+           RShiftU64 (MemoryMapSnapshotTypePages (&Snapshot, EfiConventionalMemory), 8));
+
+    Region = MemoryMapSnapshotFind (&Snapshot, (EFI_PHYSICAL_ADDRESS)(UINTN)&BootInfo);
+    if (Region != NULL) {
+      Print (L"BootInfo lives in %s region 0x%lx-0x%lx\n",
+             MemoryTypeToString (Region->Type),
+             Region->Start,
+             Region->Start + EFI_PAGES_TO_SIZE (Region->NumberOfPages) - 1);
+    }
+
+    MemoryMapSnapshotFree (&Snapshot);
+  }
+
   // Show what would happen next
   Print (L"\nStep 4: Would load kernel from disk...\n");
   Print (L"  Example: LoadKernel(ImageHandle, L\"\\\\EFI\\\\kernel.elf\", ...);\n");
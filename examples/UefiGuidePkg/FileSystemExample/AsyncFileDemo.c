@@ -0,0 +1,337 @@
+/** @file
+  File System Example - SHA-256 of a file with blocking vs overlapped reads.
+
+  The blocking loop reads a chunk with File->Read (), hashes it, and only
+  then reads the next, so reading and hashing take turns. AsyncFileRead ()
+  keeps the next ReadEx () in flight while the current chunk is hashed,
+  which is how a loader can verify or decompress a kernel and initrd while
+  they are still arriving. Both digests are printed and must agree.
+
+  Without a path a 16 MB file is first written to \UefiTest with
+  AsyncFileOpen (), AsyncFileWrite () and AsyncFileFlush (). On volumes
+  older than EFI_FILE_PROTOCOL revision 2 the library falls back to the
+  blocking calls and the two passes take about the same time.
+
+  Usage: FileSystemExample.efi async [path]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/AsyncFileLib.h>
+
+#include "FileSystemExample.h"
+
+#define ASYNC_TEST_DIR    L"\\UefiTest"
+#define ASYNC_TEST_FILE   L"\\UefiTest\\async.bin"
+#define ASYNC_TEST_SIZE   SIZE_16MB
+#define ASYNC_CHUNK_SIZE  SIZE_1MB
+
+///
+/// Running hash shared with the AsyncFileRead () callback
+///
+typedef struct {
+  VOID      *Sha256;
+  UINT64    HashNs;
+} HASH_STATE;
+
+/**
+  Feed one chunk into the hash and account the time spent.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+HashChunk (
+  IN VOID        *Context,
+  IN CONST VOID  *Data,
+  IN UINTN       Length
+  )
+{
+  HASH_STATE  *State;
+  UINT64      Start;
+  BOOLEAN     Ok;
+
+  State          = Context;
+  Start          = BenchmarkGetTicks ();
+  Ok             = Sha256Update (State->Sha256, Data, Length);
+  State->HashNs += BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return Ok ? EFI_SUCCESS : EFI_ABORTED;
+}
+
+/**
+  Format a digest as upper-case hex.
+**/
+STATIC
+VOID
+DigestToText (
+  IN  CONST UINT8  *Digest,
+  OUT CHAR16       *Text
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < SHA256_DIGEST_SIZE; Index++) {
+    UnicodeSPrint (Text + Index * 2, 3 * sizeof (CHAR16), L"%02X", Digest[Index]);
+  }
+}
+
+/**
+  Write the pseudo-random test file with the async write path.
+**/
+STATIC
+EFI_STATUS
+WriteTestFile (
+  IN EFI_FILE_PROTOCOL  *Root,
+  IN CONST CHAR16       *Path,
+  IN UINTN              Size
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINT32             *Data;
+  UINT32             Seed;
+  UINTN              Index;
+  UINTN              Written;
+  UINT64             Start;
+  UINT64             ElapsedNs;
+
+  Data = AllocatePages (EFI_SIZE_TO_PAGES (Size));
+  if (Data == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Seed = 1;
+  for (Index = 0; Index < Size / sizeof (UINT32); Index++) {
+    Seed        = Seed * 1103515245 + 12345;
+    Data[Index] = Seed;
+  }
+
+  Status = AsyncFileOpen (
+             Root,
+             &File,
+             ASYNC_TEST_DIR,
+             EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+             EFI_FILE_DIRECTORY
+             );
+  if (!EFI_ERROR (Status)) {
+    File->Close (File);
+    Status = AsyncFileOpen (
+               Root,
+               &File,
+               Path,
+               EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+               0
+               );
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreePages (Data, EFI_SIZE_TO_PAGES (Size));
+    return Status;
+  }
+
+  Written = Size;
+  Start   = BenchmarkGetTicks ();
+  Status  = AsyncFileWrite (File, &Written, Data, ASYNC_CHUNK_SIZE);
+  if (!EFI_ERROR (Status)) {
+    Status = AsyncFileFlush (File);
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  File->Close (File);
+  FreePages (Data, EFI_SIZE_TO_PAGES (Size));
+
+  if (!EFI_ERROR (Status)) {
+    Print (
+      L"Wrote %d MB to %s in %ld ms (%ld MB/s)\n",
+      Written / SIZE_1MB,
+      Path,
+      DivU64x32 (ElapsedNs, 1000000),
+      BenchmarkMBps (Written, ElapsedNs)
+      );
+  }
+
+  return Status;
+}
+
+/**
+  Read and hash the file one chunk at a time with File->Read ().
+**/
+STATIC
+EFI_STATUS
+HashBlocking (
+  IN  EFI_FILE_PROTOCOL  *File,
+  IN  HASH_STATE         *State,
+  OUT UINT64             *Bytes,
+  OUT UINT64             *IoNs
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Buffer;
+  UINTN       Size;
+  UINT64      Start;
+
+  Buffer = AllocatePages (EFI_SIZE_TO_PAGES (ASYNC_CHUNK_SIZE));
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *Bytes = 0;
+  *IoNs  = 0;
+  do {
+    Size   = ASYNC_CHUNK_SIZE;
+    Start  = BenchmarkGetTicks ();
+    Status = File->Read (File, &Size, Buffer);
+    *IoNs += BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    if (!EFI_ERROR (Status) && (Size > 0)) {
+      *Bytes += Size;
+      Status  = HashChunk (State, Buffer, Size);
+    }
+  } while (!EFI_ERROR (Status) && (Size > 0));
+
+  FreePages (Buffer, EFI_SIZE_TO_PAGES (ASYNC_CHUNK_SIZE));
+  return Status;
+}
+
+/**
+  Run one hashing method and print its result line.
+**/
+STATIC
+EFI_STATUS
+RunHash (
+  IN  CONST CHAR16       *Label,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  BOOLEAN            Overlapped,
+  OUT UINT8              *Digest
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  HASH_STATE         State;
+  UINT64             Start;
+  UINT64             ElapsedNs;
+  UINT64             IoNs;
+  UINT64             Bytes;
+  UINTN              Size;
+  CHAR16             Text[SHA256_DIGEST_SIZE * 2 + 1];
+
+  State.HashNs = 0;
+  State.Sha256 = AllocatePool (Sha256GetContextSize ());
+  if (State.Sha256 == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (!Sha256Init (State.Sha256)) {
+    FreePool (State.Sha256);
+    return EFI_ABORTED;
+  }
+
+  IoNs  = 0;
+  Bytes = 0;
+  Start = BenchmarkGetTicks ();
+  if (Overlapped) {
+    Status = AsyncFileOpen (Root, &File, Path, EFI_FILE_MODE_READ, 0);
+    if (!EFI_ERROR (Status)) {
+      Size   = MAX_UINTN;
+      Status = AsyncFileRead (File, &Size, NULL, ASYNC_CHUNK_SIZE, HashChunk, &State);
+      Bytes  = Size;
+      File->Close (File);
+    }
+  } else {
+    Status = Root->Open (Root, &File, (CHAR16 *)Path, EFI_FILE_MODE_READ, 0);
+    if (!EFI_ERROR (Status)) {
+      Status = HashBlocking (File, &State, &Bytes, &IoNs);
+      File->Close (File);
+    }
+  }
+
+  if (!EFI_ERROR (Status) && !Sha256Final (State.Sha256, Digest)) {
+    Status = EFI_ABORTED;
+  }
+
+  ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  FreePool (State.Sha256);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"%-10s failed: %r\n", Label, Status);
+    return Status;
+  }
+
+  DigestToText (Digest, Text);
+  Print (L"%-10s %6ld MB/s  %8ld ms  (hash %ld ms", Label,
+         BenchmarkMBps (Bytes, ElapsedNs), DivU64x32 (ElapsedNs, 1000000), DivU64x32 (State.HashNs, 1000000));
+  if (!Overlapped) {
+    Print (L", read %ld ms", DivU64x32 (IoNs, 1000000));
+  }
+
+  Print (L")\n  %s\n", Text);
+  return EFI_SUCCESS;
+}
+
+/**
+  Hash a file with blocking reads and with overlapped async reads.
+**/
+EFI_STATUS
+DemoAsyncFileIo (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Root;
+  CONST CHAR16       *Path;
+  UINT8              BlockingDigest[SHA256_DIGEST_SIZE];
+  UINT8              OverlapDigest[SHA256_DIGEST_SIZE];
+
+  Print (L"\n=== Blocking vs Overlapped File Reads ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = OpenBootVolume (ImageHandle, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (AsyncFileSupported (Root)) {
+    Print (L"File protocol revision 2: ReadEx/WriteEx with token events\n");
+  } else {
+    Print (L"File protocol revision 1: async calls fall back to blocking I/O\n");
+  }
+
+  Path = (Argc > 0) ? Argv[0] : ASYNC_TEST_FILE;
+  if (Argc == 0) {
+    Status = WriteTestFile (Root, Path, ASYNC_TEST_SIZE);
+    if (EFI_ERROR (Status)) {
+      Print (L"Cannot write %s: %r\n", Path, Status);
+      Root->Close (Root);
+      return Status;
+    }
+  }
+
+  Print (L"Hashing %s in %d KB chunks\n\n", Path, ASYNC_CHUNK_SIZE / SIZE_1KB);
+
+  Status = RunHash (L"blocking", Root, Path, FALSE, BlockingDigest);
+  if (!EFI_ERROR (Status)) {
+    Status = RunHash (L"overlapped", Root, Path, TRUE, OverlapDigest);
+  }
+
+  if (!EFI_ERROR (Status) && (CompareMem (BlockingDigest, OverlapDigest, sizeof (BlockingDigest)) != 0)) {
+    Print (L"\nDIGEST MISMATCH between the two passes\n");
+    Status = EFI_CRC_ERROR;
+  }
+
+  Root->Close (Root);
+  return Status;
+}
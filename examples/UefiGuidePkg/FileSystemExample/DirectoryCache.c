@@ -0,0 +1,573 @@
+/** @file
+  File System Example - in-memory directory index for path lookups.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "DirectoryCache.h"
+
+#define DIRECTORY_CACHE_INITIAL_NAME_CHARS  64
+
+/**
+  FNV-1a over the first Length characters of an upper-cased path.
+**/
+STATIC
+UINT32
+HashPath (
+  IN CONST CHAR16  *Path,
+  IN UINTN         Length
+  )
+{
+  UINT32  Hash;
+  UINTN   Index;
+
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < Length; Index++) {
+    Hash = (Hash ^ Path[Index]) * 0x01000193;
+  }
+
+  return Hash;
+}
+
+/**
+  Length of the parent of the first Length characters of a path; the
+  parent of a top-level entry is the root, length 1.
+**/
+STATIC
+UINTN
+ParentLength (
+  IN CONST CHAR16  *Path,
+  IN UINTN         Length
+  )
+{
+  while (Length > 1 && Path[Length - 1] != L'\\') {
+    Length--;
+  }
+
+  return (Length > 1) ? Length - 1 : 1;
+}
+
+/**
+  Make the cache key for a path: upper case, leading backslash, no
+  trailing backslash except for the root.
+**/
+STATIC
+CHAR16 *
+NormalizePath (
+  IN CONST CHAR16  *Path
+  )
+{
+  CHAR16  *Key;
+  UINTN   Length;
+  UINTN   Index;
+
+  Length = StrLen (Path);
+  Key    = AllocatePool ((Length + 2) * sizeof (CHAR16));
+  if (Key == NULL) {
+    return NULL;
+  }
+
+  Index = 0;
+  if (Path[0] != L'\\') {
+    Key[Index++] = L'\\';
+  }
+
+  while (*Path != L'\0') {
+    Key[Index++] = CharToUpper (*Path++);
+  }
+
+  while (Index > 1 && Key[Index - 1] == L'\\') {
+    Index--;
+  }
+
+  Key[Index] = L'\0';
+  return Key;
+}
+
+/**
+  Check whether Path starts with the first Length characters of Key. Key
+  need not be NUL-terminated, and Path is never read past its terminator.
+**/
+STATIC
+BOOLEAN
+PathStartsWith (
+  IN CONST CHAR16  *Path,
+  IN CONST CHAR16  *Key,
+  IN UINTN         Length
+  )
+{
+  return (StrnLenS (Path, Length) == Length) && (CompareMem (Path, Key, Length * sizeof (CHAR16)) == 0);
+}
+
+/**
+  Find the node for the first Length characters of Key.
+**/
+STATIC
+DIRECTORY_CACHE_NODE *
+FindNode (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Key,
+  IN UINTN            Length
+  )
+{
+  LIST_ENTRY            *Bucket;
+  LIST_ENTRY            *Link;
+  DIRECTORY_CACHE_NODE  *Node;
+  UINT32                Hash;
+
+  Hash   = HashPath (Key, Length);
+  Bucket = &Cache->Buckets[Hash & Cache->BucketMask];
+  for (Link = GetFirstNode (Bucket); !IsNull (Bucket, Link); Link = GetNextNode (Bucket, Link)) {
+    Node = BASE_CR (Link, DIRECTORY_CACHE_NODE, Hash);
+    if ((Node->HashValue == Hash) && PathStartsWith (Node->Path, Key, Length) && (Node->Path[Length] == L'\0')) {
+      return Node;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Double the bucket array once the chains average more than two nodes.
+  Failing to grow only costs lookup speed.
+**/
+STATIC
+VOID
+GrowTable (
+  IN DIRECTORY_CACHE  *Cache
+  )
+{
+  LIST_ENTRY            *Buckets;
+  LIST_ENTRY            *Link;
+  DIRECTORY_CACHE_NODE  *Node;
+  UINTN                 Count;
+  UINTN                 Index;
+
+  Count   = (Cache->BucketMask + 1) * 2;
+  Buckets = AllocatePool (Count * sizeof (LIST_ENTRY));
+  if (Buckets == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    InitializeListHead (&Buckets[Index]);
+  }
+
+  for (Link = GetFirstNode (&Cache->Nodes); !IsNull (&Cache->Nodes, Link); Link = GetNextNode (&Cache->Nodes, Link)) {
+    Node = BASE_CR (Link, DIRECTORY_CACHE_NODE, Link);
+    InsertHeadList (&Buckets[Node->HashValue & (Count - 1)], &Node->Hash);
+  }
+
+  FreePool (Cache->Buckets);
+  Cache->Buckets    = Buckets;
+  Cache->BucketMask = Count - 1;
+}
+
+/**
+  Add or update the node for the first Length characters of Key.
+**/
+STATIC
+DIRECTORY_CACHE_NODE *
+StoreNode (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Key,
+  IN UINTN            Length,
+  IN UINT64           Size,
+  IN UINT64           Attribute
+  )
+{
+  DIRECTORY_CACHE_NODE  *Node;
+
+  Node = FindNode (Cache, Key, Length);
+  if (Node == NULL) {
+    Node = AllocatePool (OFFSET_OF (DIRECTORY_CACHE_NODE, Path) + (Length + 1) * sizeof (CHAR16));
+    if (Node == NULL) {
+      return NULL;
+    }
+
+    CopyMem (Node->Path, Key, Length * sizeof (CHAR16));
+    Node->Path[Length] = L'\0';
+    Node->HashValue    = HashPath (Key, Length);
+    Node->Listed       = FALSE;
+    InsertTailList (&Cache->Nodes, &Node->Link);
+    InsertHeadList (&Cache->Buckets[Node->HashValue & Cache->BucketMask], &Node->Hash);
+    Cache->NodeCount++;
+    if (Cache->NodeCount > 2 * (Cache->BucketMask + 1)) {
+      GrowTable (Cache);
+    }
+  }
+
+  Node->Size      = Size;
+  Node->Attribute = Attribute;
+  return Node;
+}
+
+/**
+  Unlink and free one node.
+**/
+STATIC
+VOID
+RemoveNode (
+  IN DIRECTORY_CACHE       *Cache,
+  IN DIRECTORY_CACHE_NODE  *Node
+  )
+{
+  RemoveEntryList (&Node->Link);
+  RemoveEntryList (&Node->Hash);
+  FreePool (Node);
+  Cache->NodeCount--;
+}
+
+/**
+  Read a directory from the volume and store all of its entries.
+**/
+STATIC
+EFI_STATUS
+ReadListing (
+  IN DIRECTORY_CACHE       *Cache,
+  IN DIRECTORY_CACHE_NODE  *Directory
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Dir;
+  CHAR16             *Key;
+  UINTN              KeySize;
+  UINTN              DirLength;
+  UINTN              NameLength;
+  UINTN              Size;
+  UINTN              Index;
+
+  Status = Cache->Root->Open (Cache->Root, &Dir, Directory->Path, EFI_FILE_MODE_READ, 0);
+  Cache->DriverCalls++;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Child keys are built in place after the directory's own path
+  //
+  DirLength = StrLen (Directory->Path);
+  if (DirLength == 1) {
+    DirLength = 0;
+  }
+
+  KeySize = 0;
+  Key     = NULL;
+  while (TRUE) {
+    Size   = Cache->InfoSize;
+    Status = Dir->Read (Dir, &Size, Cache->Info);
+    Cache->DriverCalls++;
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      FreePool (Cache->Info);
+      Cache->InfoSize = Size;
+      Cache->Info     = AllocatePool (Size);
+      if (Cache->Info == NULL) {
+        Cache->InfoSize = 0;
+        Status          = EFI_OUT_OF_RESOURCES;
+        break;
+      }
+
+      continue;
+    }
+
+    if (EFI_ERROR (Status) || (Size == 0)) {
+      break;
+    }
+
+    if ((StrCmp (Cache->Info->FileName, L".") == 0) || (StrCmp (Cache->Info->FileName, L"..") == 0)) {
+      continue;
+    }
+
+    NameLength = StrLen (Cache->Info->FileName);
+    if (KeySize < (DirLength + 1 + NameLength) * sizeof (CHAR16)) {
+      if (Key != NULL) {
+        FreePool (Key);
+      }
+
+      KeySize = (DirLength + 1 + NameLength) * sizeof (CHAR16) * 2;
+      Key     = AllocatePool (KeySize);
+      if (Key == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        break;
+      }
+
+      CopyMem (Key, Directory->Path, DirLength * sizeof (CHAR16));
+      Key[DirLength] = L'\\';
+    }
+
+    for (Index = 0; Index < NameLength; Index++) {
+      Key[DirLength + 1 + Index] = CharToUpper (Cache->Info->FileName[Index]);
+    }
+
+    if (StoreNode (Cache, Key, DirLength + 1 + NameLength, Cache->Info->FileSize, Cache->Info->Attribute) == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+      break;
+    }
+  }
+
+  if (Key != NULL) {
+    FreePool (Key);
+  }
+
+  Dir->Close (Dir);
+  if (!EFI_ERROR (Status)) {
+    Directory->Listed = TRUE;
+    Cache->Listings++;
+  }
+
+  return Status;
+}
+
+/**
+  Make sure the directory named by the first Length characters of Key,
+  and every ancestor it needs, has been listed.
+**/
+STATIC
+EFI_STATUS
+EnsureListed (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Key,
+  IN UINTN            Length
+  )
+{
+  EFI_STATUS            Status;
+  DIRECTORY_CACHE_NODE  *Node;
+
+  Node = FindNode (Cache, Key, Length);
+  if ((Node != NULL) && Node->Listed) {
+    return EFI_SUCCESS;
+  }
+
+  if (Length > 1) {
+    //
+    // The parent's listing says whether this directory exists at all
+    //
+    if (Node == NULL) {
+      Status = EnsureListed (Cache, Key, ParentLength (Key, Length));
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      Node = FindNode (Cache, Key, Length);
+      if (Node == NULL) {
+        return EFI_NOT_FOUND;
+      }
+    }
+
+    if ((Node->Attribute & EFI_FILE_DIRECTORY) == 0) {
+      return EFI_NOT_FOUND;
+    }
+  } else if (Node == NULL) {
+    Node = StoreNode (Cache, Key, 1, 0, EFI_FILE_DIRECTORY);
+    if (Node == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  return ReadListing (Cache, Node);
+}
+
+/**
+  Initialize an empty cache for one volume.
+
+  @param[out]  Cache    Cache to initialize.
+  @param[in]   Root     Root directory of the volume. Stays owned by the
+                        caller.
+  @param[in]   Buckets  Initial hash buckets, rounded up to a power of two;
+                        the table doubles as it fills.
+
+  @retval EFI_SUCCESS           The cache is ready.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+DirectoryCacheInit (
+  OUT DIRECTORY_CACHE    *Cache,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  UINTN              Buckets
+  )
+{
+  UINTN  Count;
+  UINTN  Index;
+
+  ZeroMem (Cache, sizeof (*Cache));
+  Cache->Root = Root;
+  InitializeListHead (&Cache->Nodes);
+
+  Count = 1;
+  while (Count < Buckets) {
+    Count <<= 1;
+  }
+
+  Cache->BucketMask = Count - 1;
+  Cache->Buckets    = AllocatePool (Count * sizeof (LIST_ENTRY));
+  Cache->InfoSize   = SIZE_OF_EFI_FILE_INFO + DIRECTORY_CACHE_INITIAL_NAME_CHARS * sizeof (CHAR16);
+  Cache->Info       = AllocatePool (Cache->InfoSize);
+  if ((Cache->Buckets == NULL) || (Cache->Info == NULL)) {
+    DirectoryCacheFree (Cache);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < Count; Index++) {
+    InitializeListHead (&Cache->Buckets[Index]);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Free every node and the table.
+
+  @param[in]  Cache  Cache to release.
+**/
+VOID
+DirectoryCacheFree (
+  IN DIRECTORY_CACHE  *Cache
+  )
+{
+  LIST_ENTRY  *Link;
+
+  while (!IsListEmpty (&Cache->Nodes)) {
+    Link = GetFirstNode (&Cache->Nodes);
+    RemoveEntryList (Link);
+    FreePool (BASE_CR (Link, DIRECTORY_CACHE_NODE, Link));
+  }
+
+  if (Cache->Buckets != NULL) {
+    FreePool (Cache->Buckets);
+  }
+
+  if (Cache->Info != NULL) {
+    FreePool (Cache->Info);
+  }
+
+  Cache->Buckets   = NULL;
+  Cache->Info      = NULL;
+  Cache->NodeCount = 0;
+}
+
+/**
+  Look up a path, listing uncached directories on the way.
+
+  @param[in]   Cache      Cache to query.
+  @param[in]   Path       Absolute path; case and a trailing backslash do
+                          not matter.
+  @param[out]  Size       Receives the file size. Optional.
+  @param[out]  Attribute  Receives the EFI_FILE_* attributes. Optional.
+
+  @retval EFI_SUCCESS           The path exists.
+  @retval EFI_NOT_FOUND         The path does not exist.
+  @retval EFI_OUT_OF_RESOURCES  A node could not be allocated.
+  @retval Others                A directory could not be read.
+**/
+EFI_STATUS
+DirectoryCacheLookup (
+  IN  DIRECTORY_CACHE  *Cache,
+  IN  CONST CHAR16     *Path,
+  OUT UINT64           *Size OPTIONAL,
+  OUT UINT64           *Attribute OPTIONAL
+  )
+{
+  EFI_STATUS            Status;
+  DIRECTORY_CACHE_NODE  *Node;
+  CHAR16                *Key;
+  UINTN                 Length;
+
+  Cache->Lookups++;
+
+  Key = NormalizePath (Path);
+  if (Key == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Length = StrLen (Key);
+  Node   = NULL;
+  if (Length == 1) {
+    Status = EnsureListed (Cache, Key, 1);
+  } else {
+    Status = EnsureListed (Cache, Key, ParentLength (Key, Length));
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Node   = FindNode (Cache, Key, Length);
+    Status = (Node != NULL) ? EFI_SUCCESS : EFI_NOT_FOUND;
+  }
+
+  FreePool (Key);
+  if (Node != NULL) {
+    if (Size != NULL) {
+      *Size = Node->Size;
+    }
+
+    if (Attribute != NULL) {
+      *Attribute = Node->Attribute;
+    }
+  }
+
+  return Status;
+}
+
+/**
+  Forget a path after it was written, created, deleted or renamed.
+
+  Drops Path and everything cached below it, and marks its parent
+  directory for a fresh listing on the next lookup.
+
+  @param[in]  Cache  Cache to update.
+  @param[in]  Path   Absolute path that changed.
+**/
+VOID
+DirectoryCacheInvalidate (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Path
+  )
+{
+  LIST_ENTRY            *Link;
+  LIST_ENTRY            *Next;
+  DIRECTORY_CACHE_NODE  *Node;
+  CHAR16                *Key;
+  CHAR16                *Normalized;
+  UINTN                 Length;
+
+  //
+  // If the path cannot be normalized, forget everything
+  //
+  Normalized = NormalizePath (Path);
+  Key        = (Normalized != NULL) ? Normalized : L"\\";
+
+  Cache->Invalidations++;
+  Length = StrLen (Key);
+
+  for (Link = GetFirstNode (&Cache->Nodes); !IsNull (&Cache->Nodes, Link); Link = Next) {
+    Next = GetNextNode (&Cache->Nodes, Link);
+    Node = BASE_CR (Link, DIRECTORY_CACHE_NODE, Link);
+    if ((Length == 1) ||
+        (PathStartsWith (Node->Path, Key, Length) &&
+         ((Node->Path[Length] == L'\0') || (Node->Path[Length] == L'\\'))))
+    {
+      RemoveNode (Cache, Node);
+    }
+  }
+
+  //
+  // Relist the nearest cached ancestor. A new path may sit under
+  // directories that did not exist when their parent was listed.
+  //
+  while (Length > 1) {
+    Length = ParentLength (Key, Length);
+    Node   = FindNode (Cache, Key, Length);
+    if (Node != NULL) {
+      Node->Listed = FALSE;
+      break;
+    }
+  }
+
+  if (Normalized != NULL) {
+    FreePool (Normalized);
+  }
+}
@@ -0,0 +1,122 @@
+/** @file
+  File System Example - in-memory directory index for path lookups.
+
+  A DIRECTORY_CACHE answers "does this path exist, and how big is it"
+  for one volume without going back to the file system driver each time.
+  The first lookup under a directory reads the whole directory once and
+  stores every entry in a hash table keyed by its upper-cased absolute path
+  (FAT names are case-insensitive). Later lookups in that directory, hits
+  and misses alike, are a hash probe. Ancestors are listed the same way on
+  the way down, so a probe under a vendor directory that does not exist
+  costs one listing of its parent and nothing after that.
+
+  The cache does not watch the volume. Code that creates, deletes, renames
+  or resizes a file must call DirectoryCacheInvalidate () for that path.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef DIRECTORY_CACHE_H_
+#define DIRECTORY_CACHE_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <Guid/FileInfo.h>
+
+#define DIRECTORY_CACHE_DEFAULT_BUCKETS  256
+
+///
+/// One known path
+///
+typedef struct {
+  LIST_ENTRY    Link;           ///< All nodes, for invalidation and teardown
+  LIST_ENTRY    Hash;
+  UINT32        HashValue;
+  BOOLEAN       Listed;         ///< Directory whose entries are all cached
+  UINT64        Size;
+  UINT64        Attribute;
+  CHAR16        Path[1];        ///< Upper-cased absolute path, NUL-terminated
+} DIRECTORY_CACHE_NODE;
+
+typedef struct {
+  EFI_FILE_PROTOCOL    *Root;
+  LIST_ENTRY           Nodes;
+  LIST_ENTRY           *Buckets;
+  UINTN                BucketMask;
+  UINTN                NodeCount;
+  EFI_FILE_INFO        *Info;             ///< Grown on EFI_BUFFER_TOO_SMALL
+  UINTN                InfoSize;
+  UINT64               Lookups;
+  UINT64               Listings;          ///< Directories read from the volume
+  UINT64               DriverCalls;       ///< Open () and Read () calls made
+  UINT64               Invalidations;
+} DIRECTORY_CACHE;
+
+/**
+  Initialize an empty cache for one volume.
+
+  @param[out]  Cache    Cache to initialize.
+  @param[in]   Root     Root directory of the volume. Stays owned by the
+                        caller.
+  @param[in]   Buckets  Initial hash buckets, rounded up to a power of two;
+                        the table doubles as it fills.
+
+  @retval EFI_SUCCESS           The cache is ready.
+  @retval EFI_OUT_OF_RESOURCES  The table could not be allocated.
+**/
+EFI_STATUS
+DirectoryCacheInit (
+  OUT DIRECTORY_CACHE    *Cache,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  UINTN              Buckets
+  );
+
+/**
+  Free every node and the table.
+
+  @param[in]  Cache  Cache to release.
+**/
+VOID
+DirectoryCacheFree (
+  IN DIRECTORY_CACHE  *Cache
+  );
+
+/**
+  Look up a path, listing uncached directories on the way.
+
+  @param[in]   Cache      Cache to query.
+  @param[in]   Path       Absolute path; case and a trailing backslash do
+                          not matter.
+  @param[out]  Size       Receives the file size. Optional.
+  @param[out]  Attribute  Receives the EFI_FILE_* attributes. Optional.
+
+  @retval EFI_SUCCESS           The path exists.
+  @retval EFI_NOT_FOUND         The path does not exist.
+  @retval EFI_OUT_OF_RESOURCES  A node could not be allocated.
+  @retval Others                A directory could not be read.
+**/
+EFI_STATUS
+DirectoryCacheLookup (
+  IN  DIRECTORY_CACHE  *Cache,
+  IN  CONST CHAR16     *Path,
+  OUT UINT64           *Size OPTIONAL,
+  OUT UINT64           *Attribute OPTIONAL
+  );
+
+/**
+  Forget a path after it was written, created, deleted or renamed.
+
+  Drops Path and everything cached below it, and marks its parent
+  directory for a fresh listing on the next lookup.
+
+  @param[in]  Cache  Cache to update.
+  @param[in]  Path   Absolute path that changed.
+**/
+VOID
+DirectoryCacheInvalidate (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Path
+  );
+
+#endif // DIRECTORY_CACHE_H_
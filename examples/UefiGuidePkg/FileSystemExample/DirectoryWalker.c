@@ -0,0 +1,391 @@
+/** @file
+  File System Example - iterative directory tree walker.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Guid/FileInfo.h>
+
+#include "DirectoryWalker.h"
+
+//
+// Names up to this long fit the initial info buffer; longer ones grow it
+//
+#define WALK_INITIAL_NAME_CHARS  64
+
+#define WALK_QUEUE_GROW  64
+
+typedef struct {
+  CHAR16    *Path;
+  UINTN     Depth;
+} WALK_ENTRY;
+
+///
+/// FIFO of directories still to read. Entries [Head, Tail) are live.
+///
+typedef struct {
+  WALK_ENTRY    *Entries;
+  UINTN         Capacity;
+  UINTN         Head;
+  UINTN         Tail;
+} WALK_QUEUE;
+
+/**
+  Append a directory to the queue, which takes ownership of Path.
+**/
+STATIC
+EFI_STATUS
+QueuePush (
+  IN WALK_QUEUE  *Queue,
+  IN CHAR16      *Path,
+  IN UINTN       Depth
+  )
+{
+  WALK_ENTRY  *Entries;
+
+  if (Queue->Tail == Queue->Capacity) {
+    if (Queue->Head > 0) {
+      //
+      // Reuse the space of entries already taken
+      //
+      CopyMem (Queue->Entries, Queue->Entries + Queue->Head, (Queue->Tail - Queue->Head) * sizeof (WALK_ENTRY));
+      Queue->Tail -= Queue->Head;
+      Queue->Head  = 0;
+    } else {
+      Entries = ReallocatePool (
+                  Queue->Capacity * sizeof (WALK_ENTRY),
+                  (Queue->Capacity + WALK_QUEUE_GROW) * sizeof (WALK_ENTRY),
+                  Queue->Entries
+                  );
+      if (Entries == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+
+      Queue->Entries   = Entries;
+      Queue->Capacity += WALK_QUEUE_GROW;
+    }
+  }
+
+  Queue->Entries[Queue->Tail].Path  = Path;
+  Queue->Entries[Queue->Tail].Depth = Depth;
+  Queue->Tail++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Build Parent\Name in a new pool buffer.
+**/
+STATIC
+CHAR16 *
+JoinPath (
+  IN CONST CHAR16  *Parent,
+  IN CONST CHAR16  *Name
+  )
+{
+  CHAR16  *Path;
+  UINTN   ParentLength;
+  UINTN   Size;
+
+  ParentLength = StrLen (Parent);
+  Size         = (ParentLength + 1 + StrLen (Name) + 1) * sizeof (CHAR16);
+  Path         = AllocatePool (Size);
+  if (Path == NULL) {
+    return NULL;
+  }
+
+  StrCpyS (Path, Size / sizeof (CHAR16), Parent);
+  if ((ParentLength == 0) || (Parent[ParentLength - 1] != L'\\')) {
+    StrCatS (Path, Size / sizeof (CHAR16), L"\\");
+  }
+
+  StrCatS (Path, Size / sizeof (CHAR16), Name);
+  return Path;
+}
+
+/**
+  Read the next directory entry, growing the info buffer as needed.
+**/
+STATIC
+EFI_STATUS
+ReadEntry (
+  IN     EFI_FILE_PROTOCOL     *Dir,
+  IN OUT EFI_FILE_INFO         **Info,
+  IN OUT UINTN                 *InfoSize,
+  OUT    UINTN                 *Size,
+  IN OUT DIRECTORY_WALK_STATS  *Stats
+  )
+{
+  EFI_STATUS  Status;
+
+  while (TRUE) {
+    *Size  = *InfoSize;
+    Status = Dir->Read (Dir, Size, *Info);
+    Stats->ReadCalls++;
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+      return Status;
+    }
+
+    //
+    // *Size now holds the size this entry needs; the position is unchanged
+    //
+    FreePool (*Info);
+    *InfoSize = *Size;
+    *Info     = AllocatePool (*InfoSize);
+    if (*Info == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Stats->InfoResizes++;
+  }
+}
+
+/**
+  Check that an open file is a directory, growing the info buffer as needed.
+
+  @retval EFI_SUCCESS            File is a directory.
+  @retval EFI_INVALID_PARAMETER  File is not a directory.
+  @retval Others                 GetInfo () failed.
+**/
+STATIC
+EFI_STATUS
+CheckDirectory (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT EFI_FILE_INFO      **Info,
+  IN OUT UINTN              *InfoSize
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  while (TRUE) {
+    Size   = *InfoSize;
+    Status = File->GetInfo (File, &gEfiFileInfoGuid, &Size, *Info);
+    if (Status != EFI_BUFFER_TOO_SMALL) {
+      break;
+    }
+
+    FreePool (*Info);
+    *InfoSize = Size;
+    *Info     = AllocatePool (*InfoSize);
+    if (*Info == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return (((*Info)->Attribute & EFI_FILE_DIRECTORY) != 0) ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+}
+
+/**
+  Keep Path if the file is among the largest seen so far.
+**/
+STATIC
+VOID
+RecordLargest (
+  IN OUT DIRECTORY_WALK_STATS  *Stats,
+  IN     CONST CHAR16          *Path,
+  IN     UINT64                Size
+  )
+{
+  CHAR16  *Copy;
+  UINTN   Index;
+
+  if ((Stats->LargestCount == DIRECTORY_WALK_LARGEST) &&
+      (Size <= Stats->Largest[DIRECTORY_WALK_LARGEST - 1].Size))
+  {
+    return;
+  }
+
+  Copy = AllocateCopyPool (StrSize (Path), Path);
+  if (Copy == NULL) {
+    return;
+  }
+
+  if (Stats->LargestCount == DIRECTORY_WALK_LARGEST) {
+    FreePool (Stats->Largest[DIRECTORY_WALK_LARGEST - 1].Path);
+    Stats->LargestCount--;
+  }
+
+  for (Index = Stats->LargestCount; Index > 0 && Stats->Largest[Index - 1].Size < Size; Index--) {
+    Stats->Largest[Index] = Stats->Largest[Index - 1];
+  }
+
+  Stats->Largest[Index].Path = Copy;
+  Stats->Largest[Index].Size = Size;
+  Stats->LargestCount++;
+}
+
+/**
+  Walk a directory tree and gather statistics.
+
+  Directories that cannot be opened, or that are no longer directories when
+  their turn comes, are counted in OpenErrors and skipped.
+
+  @param[in]   Root       Root directory of the volume.
+  @param[in]   StartPath  Absolute path of the directory to walk.
+  @param[in]   Visit      Called for every entry. Optional.
+  @param[in]   Context    Passed to Visit.
+  @param[out]  Stats      Receives the totals. Free with
+                          DirectoryWalkFreeStats ().
+
+  @retval EFI_SUCCESS            The walk completed.
+  @retval EFI_INVALID_PARAMETER  StartPath is not a directory.
+  @retval EFI_OUT_OF_RESOURCES   The queue or a path could not be allocated.
+  @retval Others                 StartPath could not be opened, a directory
+                                 read failed, or Visit stopped the walk.
+**/
+EFI_STATUS
+DirectoryWalk (
+  IN  EFI_FILE_PROTOCOL     *Root,
+  IN  CONST CHAR16          *StartPath,
+  IN  DIRECTORY_WALK_VISIT  Visit OPTIONAL,
+  IN  VOID                  *Context OPTIONAL,
+  OUT DIRECTORY_WALK_STATS  *Stats
+  )
+{
+  EFI_STATUS         Status;
+  WALK_QUEUE         Queue;
+  WALK_ENTRY         Entry;
+  EFI_FILE_PROTOCOL  *Dir;
+  EFI_FILE_INFO      *Info;
+  UINTN              InfoSize;
+  UINTN              Size;
+  CHAR16             *Path;
+  CHAR16             *Start;
+
+  ZeroMem (Stats, sizeof (*Stats));
+  ZeroMem (&Queue, sizeof (Queue));
+
+  InfoSize = SIZE_OF_EFI_FILE_INFO + WALK_INITIAL_NAME_CHARS * sizeof (CHAR16);
+  Info     = AllocatePool (InfoSize);
+  Start    = AllocateCopyPool (StrSize (StartPath), StartPath);
+  if ((Info == NULL) || (Start == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+  } else {
+    Status = QueuePush (&Queue, Start, 0);
+  }
+
+  if (EFI_ERROR (Status) && (Start != NULL)) {
+    FreePool (Start);
+  }
+
+  while (!EFI_ERROR (Status) && (Queue.Head < Queue.Tail)) {
+    Entry = Queue.Entries[Queue.Head++];
+
+    Status = Root->Open (Root, &Dir, Entry.Path, EFI_FILE_MODE_READ, 0);
+    if (!EFI_ERROR (Status)) {
+      //
+      // Read () on a file returns its data, not EFI_FILE_INFO entries
+      //
+      Status = CheckDirectory (Dir, &Info, &InfoSize);
+      if (EFI_ERROR (Status)) {
+        Dir->Close (Dir);
+      }
+    }
+
+    if ((Status == EFI_OUT_OF_RESOURCES) && (Info == NULL)) {
+      FreePool (Entry.Path);
+      break;
+    }
+
+    if (EFI_ERROR (Status)) {
+      if (Entry.Depth > 0) {
+        Stats->OpenErrors++;
+        Status = EFI_SUCCESS;
+      }
+
+      FreePool (Entry.Path);
+      continue;
+    }
+
+    while (TRUE) {
+      Status = ReadEntry (Dir, &Info, &InfoSize, &Size, Stats);
+      if (EFI_ERROR (Status) || (Size == 0)) {
+        break;
+      }
+
+      if ((StrCmp (Info->FileName, L".") == 0) || (StrCmp (Info->FileName, L"..") == 0)) {
+        continue;
+      }
+
+      Path = JoinPath (Entry.Path, Info->FileName);
+      if (Path == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        break;
+      }
+
+      Stats->MaxDepth = MAX (Stats->MaxDepth, Entry.Depth + 1);
+      if (Visit != NULL) {
+        Status = Visit (Context, Path, Info, Entry.Depth + 1);
+        if (EFI_ERROR (Status)) {
+          FreePool (Path);
+          break;
+        }
+      }
+
+      if ((Info->Attribute & EFI_FILE_DIRECTORY) != 0) {
+        Stats->Directories++;
+        Status = QueuePush (&Queue, Path, Entry.Depth + 1);
+        if (EFI_ERROR (Status)) {
+          FreePool (Path);
+          break;
+        }
+
+        Stats->QueuePeak = MAX (Stats->QueuePeak, Queue.Tail - Queue.Head);
+      } else {
+        Stats->Files++;
+        Stats->Bytes += Info->FileSize;
+        RecordLargest (Stats, Path, Info->FileSize);
+        FreePool (Path);
+      }
+    }
+
+    Dir->Close (Dir);
+    FreePool (Entry.Path);
+  }
+
+  //
+  // Anything left over after an error
+  //
+  while (Queue.Head < Queue.Tail) {
+    FreePool (Queue.Entries[Queue.Head++].Path);
+  }
+
+  if (Queue.Entries != NULL) {
+    FreePool (Queue.Entries);
+  }
+
+  Stats->InfoBufferSize = InfoSize;
+  if (Info != NULL) {
+    FreePool (Info);
+  }
+
+  return Status;
+}
+
+/**
+  Free the paths held by a DIRECTORY_WALK_STATS.
+
+  @param[in]  Stats  Statistics filled by DirectoryWalk ().
+**/
+VOID
+DirectoryWalkFreeStats (
+  IN DIRECTORY_WALK_STATS  *Stats
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Stats->LargestCount; Index++) {
+    FreePool (Stats->Largest[Index].Path);
+  }
+
+  Stats->LargestCount = 0;
+}
@@ -0,0 +1,105 @@
+/** @file
+  File System Example - iterative directory tree walker.
+
+  DirectoryWalk () visits a directory tree breadth first from a FIFO work
+  queue of directory paths instead of recursing, so deep trees cost queue
+  entries rather than stack frames. Each queue entry is a self-contained
+  absolute path, so entries could be handed to separate workers; the
+  walker itself runs them in order because file system drivers are not
+  multiprocessor safe. One EFI_FILE_INFO buffer is shared by the whole walk
+  and grown whenever Read () returns EFI_BUFFER_TOO_SMALL for a long name.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef DIRECTORY_WALKER_H_
+#define DIRECTORY_WALKER_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+#include <Guid/FileInfo.h>
+
+///
+/// Largest files kept in DIRECTORY_WALK_STATS
+///
+#define DIRECTORY_WALK_LARGEST  10
+
+typedef struct {
+  CHAR16    *Path;                ///< Pool allocated, freed by DirectoryWalkFreeStats ()
+  UINT64    Size;
+} DIRECTORY_WALK_FILE;
+
+typedef struct {
+  UINT64                 Files;
+  UINT64                 Directories;
+  UINT64                 Bytes;
+  UINTN                  MaxDepth;          ///< Start directory is depth 0
+  UINT64                 ReadCalls;         ///< Directory Read () calls
+  UINTN                  InfoResizes;       ///< EFI_BUFFER_TOO_SMALL retries
+  UINTN                  InfoBufferSize;    ///< Final size of the info buffer
+  UINTN                  QueuePeak;         ///< Most directories waiting at once
+  UINTN                  OpenErrors;        ///< Directories that could not be opened
+  DIRECTORY_WALK_FILE    Largest[DIRECTORY_WALK_LARGEST];  ///< Sorted by size, descending
+  UINTN                  LargestCount;
+} DIRECTORY_WALK_STATS;
+
+/**
+  Called for every entry found, before its directory is queued.
+
+  @param[in]  Context  Value passed to DirectoryWalk ().
+  @param[in]  Path     Absolute path of the entry.
+  @param[in]  Info     The entry's file information.
+  @param[in]  Depth    Depth of the entry; children of the start are 1.
+
+  @retval EFI_SUCCESS  Continue the walk.
+  @retval Others       Stop; DirectoryWalk () returns this status.
+**/
+typedef
+EFI_STATUS
+(*DIRECTORY_WALK_VISIT)(
+  IN VOID                 *Context,
+  IN CONST CHAR16         *Path,
+  IN CONST EFI_FILE_INFO  *Info,
+  IN UINTN                Depth
+  );
+
+/**
+  Walk a directory tree and gather statistics.
+
+  Directories that cannot be opened, or that are no longer directories when
+  their turn comes, are counted in OpenErrors and skipped.
+
+  @param[in]   Root       Root directory of the volume.
+  @param[in]   StartPath  Absolute path of the directory to walk.
+  @param[in]   Visit      Called for every entry. Optional.
+  @param[in]   Context    Passed to Visit.
+  @param[out]  Stats      Receives the totals. Free with
+                          DirectoryWalkFreeStats ().
+
+  @retval EFI_SUCCESS            The walk completed.
+  @retval EFI_INVALID_PARAMETER  StartPath is not a directory.
+  @retval EFI_OUT_OF_RESOURCES   The queue or a path could not be allocated.
+  @retval Others                 StartPath could not be opened, a directory
+                                 read failed, or Visit stopped the walk.
+**/
+EFI_STATUS
+DirectoryWalk (
+  IN  EFI_FILE_PROTOCOL     *Root,
+  IN  CONST CHAR16          *StartPath,
+  IN  DIRECTORY_WALK_VISIT  Visit OPTIONAL,
+  IN  VOID                  *Context OPTIONAL,
+  OUT DIRECTORY_WALK_STATS  *Stats
+  );
+
+/**
+  Free the paths held by a DIRECTORY_WALK_STATS.
+
+  @param[in]  Stats  Statistics filled by DirectoryWalk ().
+**/
+VOID
+DirectoryWalkFreeStats (
+  IN DIRECTORY_WALK_STATS  *Stats
+  );
+
+#endif // DIRECTORY_WALKER_H_
@@ -0,0 +1,320 @@
+/** @file
+  File System Example - buffered file read stream.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#include "FileStream.h"
+
+/**
+  Replace the buffer with the next chunk of the file.
+**/
+STATIC
+EFI_STATUS
+Refill (
+  IN FILE_STREAM  *Stream
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Stream->BufferPosition += Stream->Length;
+  Stream->Length          = 0;
+  Stream->Offset          = 0;
+
+  Size   = Stream->ChunkSize;
+  Status = Stream->File->Read (Stream->File, &Size, Stream->Buffer);
+  Stream->ReadCalls++;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Stream->Length    = Size;
+  Stream->EndOfFile = (Size == 0);
+  return EFI_SUCCESS;
+}
+
+/**
+  Open a file for buffered reading.
+
+  @param[out]  Stream     Stream to initialize.
+  @param[in]   Root       Directory Path is relative to.
+  @param[in]   Path       File to open.
+  @param[in]   ChunkSize  Buffer size, FILE_STREAM_MIN_CHUNK to
+                          FILE_STREAM_MAX_CHUNK, or 0 for
+                          FILE_STREAM_DEFAULT_CHUNK.
+
+  @retval EFI_SUCCESS            The stream is open.
+  @retval EFI_INVALID_PARAMETER  ChunkSize is out of range.
+  @retval EFI_OUT_OF_RESOURCES   The buffer could not be allocated.
+  @retval Others                 The file could not be opened.
+**/
+EFI_STATUS
+FileStreamOpen (
+  OUT FILE_STREAM        *Stream,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  UINTN              ChunkSize
+  )
+{
+  EFI_STATUS  Status;
+
+  if (ChunkSize == 0) {
+    ChunkSize = FILE_STREAM_DEFAULT_CHUNK;
+  }
+
+  if ((ChunkSize < FILE_STREAM_MIN_CHUNK) || (ChunkSize > FILE_STREAM_MAX_CHUNK)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Stream, sizeof (*Stream));
+  Stream->ChunkSize   = ALIGN_VALUE (ChunkSize, EFI_PAGE_SIZE);
+  Stream->BufferPages = EFI_SIZE_TO_PAGES (Stream->ChunkSize);
+  Stream->Buffer      = AllocatePages (Stream->BufferPages);
+  if (Stream->Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = Root->Open (Root, &Stream->File, (CHAR16 *)Path, EFI_FILE_MODE_READ, 0);
+  if (EFI_ERROR (Status)) {
+    FreePages (Stream->Buffer, Stream->BufferPages);
+    ZeroMem (Stream, sizeof (*Stream));
+  }
+
+  return Status;
+}
+
+/**
+  Close the file and release the buffer.
+
+  @param[in]  Stream  Stream to close.
+**/
+VOID
+FileStreamClose (
+  IN FILE_STREAM  *Stream
+  )
+{
+  if (Stream->File != NULL) {
+    Stream->File->Close (Stream->File);
+  }
+
+  if (Stream->Buffer != NULL) {
+    FreePages (Stream->Buffer, Stream->BufferPages);
+  }
+
+  ZeroMem (Stream, sizeof (*Stream));
+}
+
+/**
+  Read bytes from the stream.
+
+  @param[in]      Stream  Stream to read.
+  @param[in,out]  Size    Bytes wanted on input; bytes read on output,
+                          which is less only at the end of the file.
+  @param[out]     Buffer  Receives the data.
+
+  @retval EFI_SUCCESS  *Size bytes were read.
+  @retval Others       File->Read () failed.
+**/
+EFI_STATUS
+FileStreamRead (
+  IN     FILE_STREAM  *Stream,
+  IN OUT UINTN        *Size,
+  OUT    VOID         *Buffer
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Out;
+  UINTN       Remaining;
+  UINTN       Count;
+
+  Out       = Buffer;
+  Remaining = *Size;
+  Status    = EFI_SUCCESS;
+
+  while (Remaining > 0) {
+    if (Stream->Offset < Stream->Length) {
+      Count = MIN (Remaining, Stream->Length - Stream->Offset);
+      CopyMem (Out, Stream->Buffer + Stream->Offset, Count);
+      Stream->Offset += Count;
+    } else if (Stream->EndOfFile) {
+      break;
+    } else if (Remaining >= Stream->ChunkSize) {
+      //
+      // Large reads skip the copy; the buffer stays empty at the new position
+      //
+      Stream->BufferPosition += Stream->Length;
+      Stream->Length          = 0;
+      Stream->Offset          = 0;
+
+      Count  = Remaining;
+      Status = Stream->File->Read (Stream->File, &Count, Out);
+      Stream->ReadCalls++;
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      Stream->BufferPosition += Count;
+      Stream->EndOfFile       = (Count == 0);
+    } else {
+      Status = Refill (Stream);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      continue;
+    }
+
+    Out       += Count;
+    Remaining -= Count;
+  }
+
+  *Size -= Remaining;
+  return Status;
+}
+
+/**
+  Read one line, without its CR/LF terminator, as a NUL-terminated string.
+
+  @param[in]   Stream    Stream to read.
+  @param[out]  Line      Receives the line.
+  @param[in]   LineSize  Size of Line in bytes, including the terminator.
+  @param[out]  Length    Receives the length of the returned line. Optional.
+
+  @retval EFI_SUCCESS                A line was read.
+  @retval EFI_WARN_BUFFER_TOO_SMALL  The line was truncated; the rest of it
+                                     has been skipped.
+  @retval EFI_END_OF_FILE            There are no more lines.
+  @retval EFI_INVALID_PARAMETER      LineSize is 0.
+  @retval Others                     File->Read () failed.
+**/
+EFI_STATUS
+FileStreamReadLine (
+  IN  FILE_STREAM  *Stream,
+  OUT CHAR8        *Line,
+  IN  UINTN        LineSize,
+  OUT UINTN        *Length OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+  UINT8       *Start;
+  UINT8       *NewLine;
+  UINTN       Available;
+  UINTN       Segment;
+  UINTN       Count;
+  UINTN       Copy;
+  BOOLEAN     Found;
+  BOOLEAN     Truncated;
+  BOOLEAN     Consumed;
+
+  if (LineSize == 0) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Count     = 0;
+  Found     = FALSE;
+  Truncated = FALSE;
+  Consumed  = FALSE;
+
+  while (!Found) {
+    if (Stream->Offset == Stream->Length) {
+      if (!Stream->EndOfFile) {
+        Status = Refill (Stream);
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+      }
+
+      if (Stream->EndOfFile) {
+        break;
+      }
+    }
+
+    Start     = Stream->Buffer + Stream->Offset;
+    Available = Stream->Length - Stream->Offset;
+    NewLine   = ScanMem8 (Start, Available, '\n');
+    Segment   = (NewLine != NULL) ? (UINTN)(NewLine - Start) : Available;
+    Found     = (NewLine != NULL);
+
+    Copy = MIN (Segment, LineSize - 1 - Count);
+    CopyMem (Line + Count, Start, Copy);
+    Count += Copy;
+    if (Copy < Segment) {
+      Truncated = TRUE;
+    }
+
+    Stream->Offset += Segment + (Found ? 1 : 0);
+    Consumed        = TRUE;
+  }
+
+  if (!Consumed) {
+    Line[0] = '\0';
+    return EFI_END_OF_FILE;
+  }
+
+  if ((Count > 0) && (Line[Count - 1] == '\r')) {
+    Count--;
+  }
+
+  Line[Count] = '\0';
+  if (Length != NULL) {
+    *Length = Count;
+  }
+
+  return Truncated ? EFI_WARN_BUFFER_TOO_SMALL : EFI_SUCCESS;
+}
+
+/**
+  Move the read position. Seeks inside the buffered chunk cost no I/O.
+
+  @param[in]  Stream    Stream to seek.
+  @param[in]  Position  New byte offset in the file.
+
+  @retval EFI_SUCCESS  The position was set.
+  @retval Others       File->SetPosition () failed.
+**/
+EFI_STATUS
+FileStreamSeek (
+  IN FILE_STREAM  *Stream,
+  IN UINT64       Position
+  )
+{
+  EFI_STATUS  Status;
+
+  if ((Position >= Stream->BufferPosition) && (Position <= Stream->BufferPosition + Stream->Length)) {
+    Stream->Offset = (UINTN)(Position - Stream->BufferPosition);
+    return EFI_SUCCESS;
+  }
+
+  Status = Stream->File->SetPosition (Stream->File, Position);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Stream->BufferPosition = Position;
+  Stream->Length         = 0;
+  Stream->Offset         = 0;
+  Stream->EndOfFile      = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the current read position.
+
+  @param[in]  Stream  Stream to query.
+
+  @return Byte offset of the next byte FileStreamRead () returns.
+**/
+UINT64
+FileStreamGetPosition (
+  IN FILE_STREAM  *Stream
+  )
+{
+  return Stream->BufferPosition + Stream->Offset;
+}
@@ -0,0 +1,137 @@
+/** @file
+  File System Example - buffered file read stream.
+
+  A FILE_STREAM reads a file through one page-allocated buffer of
+  ChunkSize bytes, so callers that consume a few bytes or one line at a
+  time cost one EFI_FILE_PROTOCOL.Read () per chunk instead of one per
+  call. Reads of a chunk or more bypass the buffer and go straight into
+  the caller's memory.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef FILE_STREAM_H_
+#define FILE_STREAM_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define FILE_STREAM_MIN_CHUNK      SIZE_64KB
+#define FILE_STREAM_MAX_CHUNK      SIZE_4MB
+#define FILE_STREAM_DEFAULT_CHUNK  SIZE_1MB
+
+typedef struct {
+  EFI_FILE_PROTOCOL    *File;
+  UINT8                *Buffer;
+  UINTN                BufferPages;
+  UINTN                ChunkSize;
+  UINT64               BufferPosition;    ///< File offset of Buffer[0]
+  UINTN                Length;            ///< Valid bytes in Buffer
+  UINTN                Offset;            ///< Next byte to hand out
+  BOOLEAN              EndOfFile;
+  UINT64               ReadCalls;         ///< File->Read () calls issued
+} FILE_STREAM;
+
+/**
+  Open a file for buffered reading.
+
+  @param[out]  Stream     Stream to initialize.
+  @param[in]   Root       Directory Path is relative to.
+  @param[in]   Path       File to open.
+  @param[in]   ChunkSize  Buffer size, FILE_STREAM_MIN_CHUNK to
+                          FILE_STREAM_MAX_CHUNK, or 0 for
+                          FILE_STREAM_DEFAULT_CHUNK.
+
+  @retval EFI_SUCCESS            The stream is open.
+  @retval EFI_INVALID_PARAMETER  ChunkSize is out of range.
+  @retval EFI_OUT_OF_RESOURCES   The buffer could not be allocated.
+  @retval Others                 The file could not be opened.
+**/
+EFI_STATUS
+FileStreamOpen (
+  OUT FILE_STREAM        *Stream,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  UINTN              ChunkSize
+  );
+
+/**
+  Close the file and release the buffer.
+
+  @param[in]  Stream  Stream to close.
+**/
+VOID
+FileStreamClose (
+  IN FILE_STREAM  *Stream
+  );
+
+/**
+  Read bytes from the stream.
+
+  @param[in]      Stream  Stream to read.
+  @param[in,out]  Size    Bytes wanted on input; bytes read on output,
+                          which is less only at the end of the file.
+  @param[out]     Buffer  Receives the data.
+
+  @retval EFI_SUCCESS  *Size bytes were read.
+  @retval Others       File->Read () failed.
+**/
+EFI_STATUS
+FileStreamRead (
+  IN     FILE_STREAM  *Stream,
+  IN OUT UINTN        *Size,
+  OUT    VOID         *Buffer
+  );
+
+/**
+  Read one line, without its CR/LF terminator, as a NUL-terminated string.
+
+  @param[in]   Stream    Stream to read.
+  @param[out]  Line      Receives the line.
+  @param[in]   LineSize  Size of Line in bytes, including the terminator.
+  @param[out]  Length    Receives the length of the returned line. Optional.
+
+  @retval EFI_SUCCESS                A line was read.
+  @retval EFI_WARN_BUFFER_TOO_SMALL  The line was truncated; the rest of it
+                                     has been skipped.
+  @retval EFI_END_OF_FILE            There are no more lines.
+  @retval EFI_INVALID_PARAMETER      LineSize is 0.
+  @retval Others                     File->Read () failed.
+**/
+EFI_STATUS
+FileStreamReadLine (
+  IN  FILE_STREAM  *Stream,
+  OUT CHAR8        *Line,
+  IN  UINTN        LineSize,
+  OUT UINTN        *Length OPTIONAL
+  );
+
+/**
+  Move the read position. Seeks inside the buffered chunk cost no I/O.
+
+  @param[in]  Stream    Stream to seek.
+  @param[in]  Position  New byte offset in the file.
+
+  @retval EFI_SUCCESS  The position was set.
+  @retval Others       File->SetPosition () failed.
+**/
+EFI_STATUS
+FileStreamSeek (
+  IN FILE_STREAM  *Stream,
+  IN UINT64       Position
+  );
+
+/**
+  Return the current read position.
+
+  @param[in]  Stream  Stream to query.
+
+  @return Byte offset of the next byte FileStreamRead () returns.
+**/
+UINT64
+FileStreamGetPosition (
+  IN FILE_STREAM  *Stream
+  );
+
+#endif // FILE_STREAM_H_
@@ -8,6 +8,11 @@
   4. List directory contents
   5. Get file information
 
+  Usage: FileSystemExample.efi [mode] [arguments]
+         Without a mode the boot volume is listed and a test file is
+         written and read back. "FileSystemExample.efi help" lists the
+         benchmark modes.
+
   Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
@@ -19,10 +24,38 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
+#include <Library/BaseLib.h>
 #include <Protocol/SimpleFileSystem.h>
 #include <Protocol/LoadedImage.h>
+#include <Protocol/ShellParameters.h>
 #include <Guid/FileInfo.h>
 
+#include "FileSystemExample.h"
+#include "FileStream.h"
+#include "FileWriter.h"
+
+//
+// Lines of the file shown by ReadFile ()
+//
+#define READ_FILE_PREVIEW_LINES  20
+
+typedef struct {
+  CONST CHAR16                         *Name;
+  FILE_SYSTEM_EXAMPLE_MODE_FUNCTION    Function;
+  CONST CHAR16                         *Description;
+} FILE_SYSTEM_EXAMPLE_MODE;
+
+//
+// Optional modes selected by the first command line argument
+//
+STATIC CONST FILE_SYSTEM_EXAMPLE_MODE  mModes[] = {
+  { L"stream",    DemoStreamBenchmark,  L"File->Read piece size vs buffered stream chunks"   },
+  { L"async",     DemoAsyncFileIo,      L"SHA-256 of a file, blocking vs overlapped ReadEx"  },
+  { L"tree",      DemoDirectoryTree,    L"Tree walk: counts, sizes, depth and largest files" },
+  { L"probe",     DemoPathProbe,        L"Boot path probe on all volumes, direct vs cached"  },
+  { L"writer",    DemoFileWriter,       L"Per-line Write+Flush vs combining FileWriter"      },
+};
+
 /**
   List directory contents.
 **/
@@ -58,6 +91,17 @@ ListDirectory (
     UINTN Size = BufferSize;
     Status = Dir->Read (Dir, &Size, FileInfo);
 
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      // Long name: Size holds what this entry needs, so grow and retry
+      FreePool (FileInfo);
+      BufferSize = Size;
+      FileInfo = AllocatePool (BufferSize);
+      if (FileInfo == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+      continue;
+    }
+
     if (EFI_ERROR (Status) || Size == 0) {
       break;  // No more entries
     }
@@ -94,23 +138,18 @@ ReadFile (
   )
 {
   EFI_STATUS        Status;
-  EFI_FILE_PROTOCOL *File;
-  CHAR8             Buffer[512];
-  UINTN             BufferSize;
+  FILE_STREAM       Stream;
+  CHAR8             Line[128];
+  UINTN             Length;
+  UINTN             LineCount;
+  UINTN             Index;
   EFI_FILE_INFO     *FileInfo;
   UINTN             InfoSize;
 
   Print (L"\nReading file: %s\n", FileName);
 
-  // Open file
-  Status = Root->Open (
-                   Root,
-                   &File,
-                   FileName,
-                   EFI_FILE_MODE_READ,
-                   0
-                   );
-
+  // Open file through a buffered stream; the whole preview is one Read ()
+  Status = FileStreamOpen (&Stream, Root, FileName, FILE_STREAM_MIN_CHUNK);
   if (EFI_ERROR (Status)) {
     Print (L"Failed to open file: %r\n", Status);
     return Status;
@@ -120,7 +159,7 @@ ReadFile (
   InfoSize = sizeof(EFI_FILE_INFO) + 256 * sizeof(CHAR16);
   FileInfo = AllocatePool (InfoSize);
   if (FileInfo != NULL) {
-    Status = File->GetInfo (File, &gEfiFileInfoGuid, &InfoSize, FileInfo);
+    Status = Stream.File->GetInfo (Stream.File, &gEfiFileInfoGuid, &InfoSize, FileInfo);
     if (!EFI_ERROR (Status)) {
       Print (L"File size: %ld bytes\n", FileInfo->FileSize);
       Print (L"Created: %04d-%02d-%02d %02d:%02d:%02d\n",
@@ -134,32 +173,32 @@ ReadFile (
     FreePool (FileInfo);
   }
 
-  // Read file contents (first 500 bytes)
-  Print (L"\nContents (first 500 bytes):\n");
+  // Print file contents a line at a time
+  Print (L"\nContents (first %d lines):\n", READ_FILE_PREVIEW_LINES);
   Print (L"----------------------------------------\n");
 
-  BufferSize = sizeof(Buffer) - 1;
-  Status = File->Read (File, &BufferSize, Buffer);
-
-  if (!EFI_ERROR (Status) && BufferSize > 0) {
-    Buffer[BufferSize] = '\0';
-    // Print as ASCII
-    for (UINTN i = 0; i < BufferSize; i++) {
-      if (Buffer[i] == '\n') {
-        Print (L"\n");
-      } else if (Buffer[i] >= 0x20 && Buffer[i] < 0x7F) {
-        Print (L"%c", (CHAR16)Buffer[i]);
-      } else if (Buffer[i] == '\t') {
-        Print (L"  ");
+  for (LineCount = 0; LineCount < READ_FILE_PREVIEW_LINES; LineCount++) {
+    Status = FileStreamReadLine (&Stream, Line, sizeof(Line), &Length);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    // Keep binary data from driving the console
+    for (Index = 0; Index < Length; Index++) {
+      if (Line[Index] == '\t') {
+        Line[Index] = ' ';
+      } else if (Line[Index] < 0x20 || Line[Index] >= 0x7F) {
+        Line[Index] = '.';
       }
     }
-    Print (L"\n");
+
+    Print (L"%a%s\n", Line, (Status == EFI_WARN_BUFFER_TOO_SMALL) ? L"..." : L"");
   }
 
   Print (L"----------------------------------------\n");
 
-  File->Close (File);
-  return EFI_SUCCESS;
+  FileStreamClose (&Stream);
+  return (Status == EFI_END_OF_FILE || !EFI_ERROR (Status)) ? EFI_SUCCESS : Status;
 }
 
 /**
@@ -172,7 +211,7 @@ WriteFile (
   )
 {
   EFI_STATUS        Status;
-  EFI_FILE_PROTOCOL *File;
+  FILE_WRITER       Writer;
   CHAR8             *Content = "Hello from UEFI!\r\n"
                                "This file was created by FileSystemExample.\r\n"
                                "UEFI file system access is working.\r\n";
@@ -181,22 +220,25 @@ WriteFile (
   Print (L"\nWriting file: %s\n", FileName);
 
   // Create/overwrite file
-  Status = Root->Open (
-                   Root,
-                   &File,
-                   FileName,
-                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
-                   0
-                   );
+  Status = FileWriterOpen (&Writer, Root, FileName, FILE_WRITER_MIN_BUFFER, 0);
 
   if (EFI_ERROR (Status)) {
     Print (L"Failed to create file: %r\n", Status);
     return Status;
   }
 
-  // Write content
+  // Write content; it is buffered until the close
   ContentSize = AsciiStrLen (Content);
-  Status = File->Write (File, &ContentSize, Content);
+  Status = FileWriterWrite (&Writer, ContentSize, Content);
+
+  if (EFI_ERROR (Status)) {
+    Print (L"Failed to write: %r\n", Status);
+    FileWriterClose (&Writer);
+    return Status;
+  }
+
+  // Write out, flush and close
+  Status = FileWriterClose (&Writer);
 
   if (EFI_ERROR (Status)) {
     Print (L"Failed to write: %r\n", Status);
@@ -204,10 +246,6 @@ WriteFile (
     Print (L"Wrote %d bytes\n", ContentSize);
   }
 
-  // Flush and close
-  File->Flush (File);
-  File->Close (File);
-
   return Status;
 }
 
@@ -245,22 +283,20 @@ CreateDirectory (
 }
 
 /**
-  Application entry point.
+  Open the root directory of the volume this image was loaded from.
+
+  @param[in]   ImageHandle  Image handle of this application.
+  @param[out]  Root         Receives the root directory.
 **/
 EFI_STATUS
-EFIAPI
-FileSystemExampleMain (
-  IN EFI_HANDLE        ImageHandle,
-  IN EFI_SYSTEM_TABLE  *SystemTable
+OpenBootVolume (
+  IN  EFI_HANDLE         ImageHandle,
+  OUT EFI_FILE_PROTOCOL  **Root
   )
 {
   EFI_STATUS                       Status;
   EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem;
   EFI_LOADED_IMAGE_PROTOCOL        *LoadedImage;
-  EFI_FILE_PROTOCOL                *Root;
-
-  Print (L"File System Example\n");
-  Print (L"===================\n");
 
   //
   // Get loaded image protocol to find the volume we booted from
@@ -291,18 +327,122 @@ FileSystemExampleMain (
     return Status;
   }
 
-  Print (L"File system located on boot device\n");
-
   //
   // Open the root directory
   //
-  Status = FileSystem->OpenVolume (FileSystem, &Root);
+  Status = FileSystem->OpenVolume (FileSystem, Root);
   if (EFI_ERROR (Status)) {
     Print (L"Failed to open volume: %r\n", Status);
+  }
+
+  return Status;
+}
+
+/**
+  Get the shell command line arguments, if any.
+**/
+UINTN
+GetArguments (
+  IN  EFI_HANDLE  ImageHandle,
+  OUT CHAR16      ***Argv
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **)&ShellParameters
+                  );
+
+  if (EFI_ERROR (Status)) {
+    *Argv = NULL;
+    return 0;
+  }
+
+  *Argv = ShellParameters->Argv;
+  return ShellParameters->Argc;
+}
+
+/**
+  Print the available modes.
+**/
+VOID
+PrintUsage (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  Print (L"\nUsage: FileSystemExample.efi [mode] [arguments]\n\n");
+  Print (L"Without a mode the boot volume is listed and a test file is\n");
+  Print (L"written to \\UefiTest and read back.\n\n");
+  Print (L"Modes:\n");
+  for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+    Print (L"  %-10s %s\n", mModes[Index].Name, mModes[Index].Description);
+  }
+}
+
+/**
+  Look up a mode by name.
+
+  @param[in]  Name  Mode name from the command line.
+
+  @return The mode's function, or NULL if there is no such mode.
+**/
+FILE_SYSTEM_EXAMPLE_MODE_FUNCTION
+FindMode (
+  IN CONST CHAR16  *Name
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+    if (StrCmp (Name, mModes[Index].Name) == 0) {
+      return mModes[Index].Function;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Application entry point.
+**/
+EFI_STATUS
+EFIAPI
+FileSystemExampleMain (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                         Status;
+  EFI_FILE_PROTOCOL                  *Root;
+  UINTN                              Argc;
+  CHAR16                             **Argv;
+  FILE_SYSTEM_EXAMPLE_MODE_FUNCTION  Mode;
+
+  Print (L"File System Example\n");
+  Print (L"===================\n");
+
+  Argc = GetArguments (ImageHandle, &Argv);
+  if (Argc >= 2) {
+    Mode = FindMode (Argv[1]);
+    if (Mode != NULL) {
+      return Mode (ImageHandle, Argc - 2, Argv + 2);
+    }
+
+    PrintUsage ();
+    return (StrCmp (Argv[1], L"help") == 0) ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+  }
+
+  Status = OpenBootVolume (ImageHandle, &Root);
+  if (EFI_ERROR (Status)) {
     return Status;
   }
 
-  Print (L"Root directory opened\n");
+  Print (L"Root directory opened on boot device\n");
 
   //
   // List root directory
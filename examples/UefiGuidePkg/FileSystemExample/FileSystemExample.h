@@ -0,0 +1,101 @@
+/** @file
+  File System Example - shared declarations for the example modes.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef FILE_SYSTEM_EXAMPLE_H_
+#define FILE_SYSTEM_EXAMPLE_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+///
+/// A mode selected by the first command line argument. Argv starts after
+/// the mode name.
+///
+typedef
+EFI_STATUS
+(*FILE_SYSTEM_EXAMPLE_MODE_FUNCTION)(
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Open the root directory of the volume this image was loaded from.
+
+  @param[in]   ImageHandle  Image handle of this application.
+  @param[out]  Root         Receives the root directory.
+**/
+EFI_STATUS
+OpenBootVolume (
+  IN  EFI_HANDLE         ImageHandle,
+  OUT EFI_FILE_PROTOCOL  **Root
+  );
+
+/**
+  Look up a mode by name.
+
+  @param[in]  Name  Mode name from the command line.
+
+  @return The mode's function, or NULL if there is no such mode.
+**/
+FILE_SYSTEM_EXAMPLE_MODE_FUNCTION
+FindMode (
+  IN CONST CHAR16  *Name
+  );
+
+/**
+  Compare File->Read () piece sizes with buffered stream chunk sizes.
+**/
+EFI_STATUS
+DemoStreamBenchmark (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Hash a file with blocking reads and with overlapped async reads.
+**/
+EFI_STATUS
+DemoAsyncFileIo (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Walk a directory tree and print counts, sizes and the largest files.
+**/
+EFI_STATUS
+DemoDirectoryTree (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Probe well-known boot paths on every volume, directly and through a
+  directory cache.
+**/
+EFI_STATUS
+DemoPathProbe (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+/**
+  Compare per-line writes and flushes with the combining file writer.
+**/
+EFI_STATUS
+DemoFileWriter (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  );
+
+#endif // FILE_SYSTEM_EXAMPLE_H_
@@ -0,0 +1,279 @@
+/** @file
+  File System Example - write-combining file writer.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Guid/FileInfo.h>
+
+#include "FileWriter.h"
+
+/**
+  Set the size of an open file through EFI_FILE_INFO.
+**/
+STATIC
+EFI_STATUS
+SetFileSize (
+  IN EFI_FILE_PROTOCOL  *File,
+  IN UINT64             Size
+  )
+{
+  EFI_STATUS     Status;
+  EFI_FILE_INFO  *Info;
+  UINTN          InfoSize;
+
+  InfoSize = 0;
+  Status   = File->GetInfo (File, &gEfiFileInfoGuid, &InfoSize, NULL);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return EFI_ERROR (Status) ? Status : EFI_DEVICE_ERROR;
+  }
+
+  Info = AllocatePool (InfoSize);
+  if (Info == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = File->GetInfo (File, &gEfiFileInfoGuid, &InfoSize, Info);
+  if (!EFI_ERROR (Status) && (Info->FileSize != Size)) {
+    Info->FileSize = Size;
+    Status         = File->SetInfo (File, &gEfiFileInfoGuid, InfoSize, Info);
+  }
+
+  FreePool (Info);
+  return Status;
+}
+
+/**
+  Write the pending bytes to the file.
+**/
+STATIC
+EFI_STATUS
+Commit (
+  IN FILE_WRITER  *Writer
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  if (EFI_ERROR (Writer->Status) || (Writer->Length == 0)) {
+    return Writer->Status;
+  }
+
+  Size   = Writer->Length;
+  Status = Writer->File->Write (Writer->File, &Size, Writer->Buffer);
+  Writer->WriteCalls++;
+  if (EFI_ERROR (Status)) {
+    Writer->Status = Status;
+    return Status;
+  }
+
+  Writer->Position += Writer->Length;
+  Writer->Length    = 0;
+  return EFI_SUCCESS;
+}
+
+/**
+  Create or truncate a file for buffered writing.
+
+  @param[out]  Writer       Writer to initialize.
+  @param[in]   Root         Directory Path is relative to.
+  @param[in]   Path         File to write. An existing file is truncated.
+  @param[in]   BufferSize   Buffer size, FILE_WRITER_MIN_BUFFER to
+                            FILE_WRITER_MAX_BUFFER, or 0 for
+                            FILE_WRITER_DEFAULT_BUFFER. Rounded up to a page.
+  @param[in]   Preallocate  Expected file size to reserve up front, or 0.
+
+  @retval EFI_SUCCESS            The writer is open.
+  @retval EFI_INVALID_PARAMETER  BufferSize is out of range.
+  @retval EFI_OUT_OF_RESOURCES   The buffer could not be allocated.
+  @retval EFI_VOLUME_FULL        Preallocate bytes do not fit on the volume.
+  @retval Others                 The file could not be created or resized.
+**/
+EFI_STATUS
+FileWriterOpen (
+  OUT FILE_WRITER        *Writer,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  UINTN              BufferSize,
+  IN  UINT64             Preallocate
+  )
+{
+  EFI_STATUS  Status;
+
+  if (BufferSize == 0) {
+    BufferSize = FILE_WRITER_DEFAULT_BUFFER;
+  }
+
+  if ((BufferSize < FILE_WRITER_MIN_BUFFER) || (BufferSize > FILE_WRITER_MAX_BUFFER)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Writer, sizeof (*Writer));
+  Writer->BufferSize  = ALIGN_VALUE (BufferSize, EFI_PAGE_SIZE);
+  Writer->BufferPages = EFI_SIZE_TO_PAGES (Writer->BufferSize);
+  Writer->Buffer      = AllocatePages (Writer->BufferPages);
+  if (Writer->Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = Root->Open (
+                   Root,
+                   &Writer->File,
+                   (CHAR16 *)Path,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   0
+                   );
+  if (!EFI_ERROR (Status)) {
+    //
+    // Drops the old contents, and reserves the clusters when preallocating
+    //
+    Status = SetFileSize (Writer->File, Preallocate);
+    if (EFI_ERROR (Status)) {
+      Writer->File->Close (Writer->File);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    FreePages (Writer->Buffer, Writer->BufferPages);
+    ZeroMem (Writer, sizeof (*Writer));
+    return Status;
+  }
+
+  Writer->Preallocated = Preallocate;
+  return EFI_SUCCESS;
+}
+
+/**
+  Append bytes to the file.
+
+  The data is copied or written before returning, so Buffer may be reused
+  at once. Writes of a whole buffer or more at an aligned position go
+  straight to the file without a copy.
+
+  @param[in]  Writer  Writer to use.
+  @param[in]  Size    Bytes to write.
+  @param[in]  Buffer  Data to write.
+
+  @retval EFI_SUCCESS  The data was accepted.
+  @retval Others       This or an earlier File->Write () failed.
+**/
+EFI_STATUS
+FileWriterWrite (
+  IN FILE_WRITER  *Writer,
+  IN UINTN        Size,
+  IN CONST VOID   *Buffer
+  )
+{
+  EFI_STATUS   Status;
+  CONST UINT8  *Data;
+  UINTN        Capacity;
+  UINTN        Count;
+  UINTN        Written;
+
+  Data = Buffer;
+  while (!EFI_ERROR (Writer->Status) && (Size > 0)) {
+    //
+    // Fill only up to the next buffer-size boundary of the file
+    //
+    Capacity = Writer->BufferSize - ModU64x32 (Writer->Position, (UINT32)Writer->BufferSize);
+
+    if ((Writer->Length == 0) && (Capacity == Writer->BufferSize) && (Size >= Writer->BufferSize)) {
+      Count   = Size - Size % Writer->BufferSize;
+      Written = Count;
+      Status  = Writer->File->Write (Writer->File, &Written, (VOID *)Data);
+      Writer->WriteCalls++;
+      if (EFI_ERROR (Status)) {
+        Writer->Status = Status;
+        break;
+      }
+
+      Writer->Position += Count;
+    } else {
+      Count = MIN (Size, Capacity - Writer->Length);
+      CopyMem (Writer->Buffer + Writer->Length, Data, Count);
+      Writer->Length += Count;
+      if (Writer->Length == Capacity) {
+        Commit (Writer);
+      }
+    }
+
+    Data += Count;
+    Size -= Count;
+  }
+
+  return Writer->Status;
+}
+
+/**
+  Write out the pending bytes and flush the file.
+
+  The next buffer is filled only up to the following buffer-size boundary,
+  so writes are aligned again after one short write.
+
+  @param[in]  Writer  Writer to drain.
+
+  @retval EFI_SUCCESS  Everything written so far is on the volume.
+  @retval Others       The first write or flush error.
+**/
+EFI_STATUS
+FileWriterBarrier (
+  IN FILE_WRITER  *Writer
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = Commit (Writer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = Writer->File->Flush (Writer->File);
+  Writer->FlushCalls++;
+  if (EFI_ERROR (Status)) {
+    Writer->Status = Status;
+  }
+
+  return Status;
+}
+
+/**
+  Write out the pending bytes, trim any unused preallocation, flush and
+  close the file, and release the buffer. The call counters stay valid.
+
+  @param[in]  Writer  Writer to close.
+
+  @retval EFI_SUCCESS      The file is complete.
+  @retval EFI_NOT_STARTED  The writer is not open.
+  @retval Others           The first write, resize or flush error.
+**/
+EFI_STATUS
+FileWriterClose (
+  IN FILE_WRITER  *Writer
+  )
+{
+  EFI_STATUS  Status;
+
+  if (Writer->File == NULL) {
+    return EFI_NOT_STARTED;
+  }
+
+  Commit (Writer);
+  if (!EFI_ERROR (Writer->Status) && (Writer->Preallocated > Writer->Position)) {
+    Writer->Status = SetFileSize (Writer->File, Writer->Position);
+  }
+
+  FileWriterBarrier (Writer);
+
+  Status = Writer->Status;
+  Writer->File->Close (Writer->File);
+  FreePages (Writer->Buffer, Writer->BufferPages);
+  Writer->File   = NULL;
+  Writer->Buffer = NULL;
+  Writer->Length = 0;
+  return Status;
+}
@@ -0,0 +1,124 @@
+/** @file
+  File System Example - write-combining file writer.
+
+  A FILE_WRITER collects small writes in one page-allocated buffer and
+  hands them to EFI_FILE_PROTOCOL.Write () a full buffer at a time, at file
+  offsets that are multiples of the buffer size. On FAT every Write () may
+  walk and extend the cluster chain and update the directory entry, and
+  every Flush () writes the FAT and directory sectors back, so a log written
+  a line at a time with a flush per line spends most of its time on
+  metadata.
+
+  The file size can be preallocated when the file is opened, which grows the
+  cluster chain once instead of on every write; FileWriterClose () trims the
+  file back to the bytes actually written. The EDK II FAT driver zero-fills
+  the extended range, so there preallocation trades the per-write chain
+  growth for one extra pass of data writes; the "writer" mode measures both.
+  Flush () is only issued at FileWriterBarrier () and FileWriterClose ().
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef FILE_WRITER_H_
+#define FILE_WRITER_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define FILE_WRITER_MIN_BUFFER      SIZE_64KB
+#define FILE_WRITER_MAX_BUFFER      SIZE_16MB
+#define FILE_WRITER_DEFAULT_BUFFER  SIZE_1MB
+
+typedef struct {
+  EFI_FILE_PROTOCOL    *File;
+  UINT8                *Buffer;
+  UINTN                BufferPages;
+  UINTN                BufferSize;
+  UINTN                Length;            ///< Pending bytes in Buffer
+  UINT64               Position;          ///< File offset of Buffer[0]
+  UINT64               Preallocated;      ///< File size set at open, 0 if none
+  EFI_STATUS           Status;            ///< First error, sticky
+  UINT64               WriteCalls;        ///< File->Write () calls issued
+  UINT64               FlushCalls;        ///< File->Flush () calls issued
+} FILE_WRITER;
+
+/**
+  Create or truncate a file for buffered writing.
+
+  @param[out]  Writer       Writer to initialize.
+  @param[in]   Root         Directory Path is relative to.
+  @param[in]   Path         File to write. An existing file is truncated.
+  @param[in]   BufferSize   Buffer size, FILE_WRITER_MIN_BUFFER to
+                            FILE_WRITER_MAX_BUFFER, or 0 for
+                            FILE_WRITER_DEFAULT_BUFFER. Rounded up to a page.
+  @param[in]   Preallocate  Expected file size to reserve up front, or 0.
+
+  @retval EFI_SUCCESS            The writer is open.
+  @retval EFI_INVALID_PARAMETER  BufferSize is out of range.
+  @retval EFI_OUT_OF_RESOURCES   The buffer could not be allocated.
+  @retval EFI_VOLUME_FULL        Preallocate bytes do not fit on the volume.
+  @retval Others                 The file could not be created or resized.
+**/
+EFI_STATUS
+FileWriterOpen (
+  OUT FILE_WRITER        *Writer,
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  UINTN              BufferSize,
+  IN  UINT64             Preallocate
+  );
+
+/**
+  Append bytes to the file.
+
+  The data is copied or written before returning, so Buffer may be reused
+  at once. Writes of a whole buffer or more at an aligned position go
+  straight to the file without a copy.
+
+  @param[in]  Writer  Writer to use.
+  @param[in]  Size    Bytes to write.
+  @param[in]  Buffer  Data to write.
+
+  @retval EFI_SUCCESS  The data was accepted.
+  @retval Others       This or an earlier File->Write () failed.
+**/
+EFI_STATUS
+FileWriterWrite (
+  IN FILE_WRITER  *Writer,
+  IN UINTN        Size,
+  IN CONST VOID   *Buffer
+  );
+
+/**
+  Write out the pending bytes and flush the file.
+
+  The next buffer is filled only up to the following buffer-size boundary,
+  so writes are aligned again after one short write.
+
+  @param[in]  Writer  Writer to drain.
+
+  @retval EFI_SUCCESS  Everything written so far is on the volume.
+  @retval Others       The first write or flush error.
+**/
+EFI_STATUS
+FileWriterBarrier (
+  IN FILE_WRITER  *Writer
+  );
+
+/**
+  Write out the pending bytes, trim any unused preallocation, flush and
+  close the file, and release the buffer. The call counters stay valid.
+
+  @param[in]  Writer  Writer to close.
+
+  @retval EFI_SUCCESS      The file is complete.
+  @retval EFI_NOT_STARTED  The writer is not open.
+  @retval Others           The first write, resize or flush error.
+**/
+EFI_STATUS
+FileWriterClose (
+  IN FILE_WRITER  *Writer
+  );
+
+#endif // FILE_WRITER_H_
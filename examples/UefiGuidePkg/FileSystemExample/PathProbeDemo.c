@@ -0,0 +1,476 @@
+/** @file
+  File System Example - probe boot paths on every volume, direct vs cached.
+
+  A boot manager looking for something to boot checks the same list of
+  well-known loader paths on every volume it finds. Done directly, each
+  probe is an Open () that the FAT driver resolves one path component at a
+  time, and a miss costs as much as a hit. With a DIRECTORY_CACHE per volume
+  the first round lists the handful of directories involved and every later
+  probe is a hash lookup.
+
+  Both methods run the same rounds over the same paths. The first round
+  shows the cold cost, the later rounds the steady state, and the found
+  sets must agree. Afterwards a file is created and deleted on the boot
+  volume to show that the cache only sees the change once it is invalidated.
+
+  Usage: FileSystemExample.efi probe
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "FileSystemExample.h"
+#include "DirectoryCache.h"
+
+#define PROBE_ROUNDS     10
+#define PROBE_TEST_DIR   L"\\UefiTest"
+#define PROBE_TEST_FILE  L"\\UefiTest\\probe.txt"
+#define PROBE_TEST_TEXT  "probe"
+
+//
+// Large enough for a GetInfo () of any FAT long name
+//
+#define PROBE_INFO_SIZE  (SIZE_OF_EFI_FILE_INFO + 256 * sizeof (CHAR16))
+
+STATIC CONST CHAR16  *mProbePaths[] = {
+  L"\\EFI\\BOOT\\BOOTX64.EFI",
+  L"\\EFI\\BOOT\\BOOTIA32.EFI",
+  L"\\EFI\\BOOT\\BOOTAA64.EFI",
+  L"\\EFI\\BOOT\\BOOTRISCV64.EFI",
+  L"\\EFI\\Microsoft\\Boot\\bootmgfw.efi",
+  L"\\EFI\\Microsoft\\Boot\\BCD",
+  L"\\EFI\\ubuntu\\shimx64.efi",
+  L"\\EFI\\ubuntu\\grubx64.efi",
+  L"\\EFI\\ubuntu\\grub.cfg",
+  L"\\EFI\\fedora\\shimx64.efi",
+  L"\\EFI\\fedora\\grubx64.efi",
+  L"\\EFI\\debian\\shimx64.efi",
+  L"\\EFI\\debian\\grubx64.efi",
+  L"\\EFI\\opensuse\\shim.efi",
+  L"\\EFI\\centos\\shimx64.efi",
+  L"\\EFI\\systemd\\systemd-bootx64.efi",
+  L"\\EFI\\refind\\refind_x64.efi",
+  L"\\loader\\loader.conf",
+  L"\\startup.nsh",
+  L"\\UefiGuide\\kernel.efi"
+};
+
+#define PROBE_PATH_COUNT  ARRAY_SIZE (mProbePaths)
+
+typedef struct {
+  UINT64    FirstRoundNs;
+  UINT64    LaterRoundsNs;
+  UINT64    DriverCalls;
+  UINTN     Found;              ///< Hits in one round
+} PROBE_RESULT;
+
+/**
+  Probe one path by opening it and reading its size.
+**/
+STATIC
+EFI_STATUS
+DirectProbe (
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  CONST CHAR16       *Path,
+  IN  EFI_FILE_INFO      *Info,
+  OUT UINT64             *Size,
+  OUT UINT64             *DriverCalls
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+  UINTN              InfoSize;
+
+  Status = Root->Open (Root, &File, (CHAR16 *)Path, EFI_FILE_MODE_READ, 0);
+  (*DriverCalls)++;
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  InfoSize = PROBE_INFO_SIZE;
+  Status   = File->GetInfo (File, &gEfiFileInfoGuid, &InfoSize, Info);
+  (*DriverCalls)++;
+  *Size = EFI_ERROR (Status) ? 0 : Info->FileSize;
+
+  File->Close (File);
+  return EFI_SUCCESS;
+}
+
+/**
+  Run every round of one method over all volumes and paths.
+
+  Found[] holds one entry per volume and path. With Check FALSE it is
+  filled in; with Check TRUE every result is compared against it.
+**/
+STATIC
+EFI_STATUS
+RunProbes (
+  IN     EFI_FILE_PROTOCOL  **Roots,
+  IN     DIRECTORY_CACHE    *Caches OPTIONAL,
+  IN     UINTN              VolumeCount,
+  IN     EFI_FILE_INFO      *Info,
+  IN OUT UINT64             *Found,
+  IN     BOOLEAN            Check,
+  OUT    PROBE_RESULT       *Result
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Round;
+  UINTN       Volume;
+  UINTN       Index;
+  UINT64      Start;
+  UINT64      Elapsed;
+  UINT64      Size;
+  UINT64      Calls;
+  UINTN       Mismatches;
+
+  ZeroMem (Result, sizeof (*Result));
+  Mismatches = 0;
+
+  for (Round = 0; Round < PROBE_ROUNDS; Round++) {
+    Result->Found = 0;
+    Calls         = 0;
+    Start         = BenchmarkGetTicks ();
+    for (Volume = 0; Volume < VolumeCount; Volume++) {
+      for (Index = 0; Index < PROBE_PATH_COUNT; Index++) {
+        Size = 0;
+        if (Caches == NULL) {
+          Status = DirectProbe (Roots[Volume], mProbePaths[Index], Info, &Size, &Calls);
+        } else {
+          Status = DirectoryCacheLookup (&Caches[Volume], mProbePaths[Index], &Size, NULL);
+        }
+
+        if (EFI_ERROR (Status) && (Status != EFI_NOT_FOUND)) {
+          return Status;
+        }
+
+        //
+        // A missing file is recorded as MAX_UINT64 so sizes compare too
+        //
+        if (!EFI_ERROR (Status)) {
+          Result->Found++;
+        } else {
+          Size = MAX_UINT64;
+        }
+
+        if (!Check) {
+          Found[Volume * PROBE_PATH_COUNT + Index] = Size;
+        } else if (Found[Volume * PROBE_PATH_COUNT + Index] != Size) {
+          Mismatches++;
+        }
+      }
+    }
+
+    Elapsed = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    if (Round == 0) {
+      Result->FirstRoundNs = Elapsed;
+    } else {
+      Result->LaterRoundsNs += Elapsed;
+    }
+
+    Result->DriverCalls += Calls;
+  }
+
+  if (Caches != NULL) {
+    for (Volume = 0; Volume < VolumeCount; Volume++) {
+      Result->DriverCalls += Caches[Volume].DriverCalls;
+    }
+  }
+
+  if (Mismatches > 0) {
+    Print (L"Cached results differ from direct Open (): %d mismatches\n", Mismatches);
+    return EFI_VOLUME_CORRUPTED;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Print one row of the comparison table.
+**/
+STATIC
+VOID
+PrintResult (
+  IN CONST CHAR16        *Method,
+  IN CONST PROBE_RESULT  *Result,
+  IN UINTN               LookupsPerRound
+  )
+{
+  UINT64  LaterRoundNs;
+
+  LaterRoundNs = DivU64x32 (Result->LaterRoundsNs, PROBE_ROUNDS - 1);
+  Print (
+    L"%-8s %5d %15ld %16ld %10ld %13ld\n",
+    Method,
+    Result->Found,
+    DivU64x32 (Result->FirstRoundNs, 1000),
+    DivU64x32 (LaterRoundNs, 1000),
+    DivU64x32 (LaterRoundNs, (UINT32)LookupsPerRound),
+    Result->DriverCalls
+    );
+}
+
+/**
+  Print what the cache currently says about the test file.
+**/
+STATIC
+VOID
+PrintLookup (
+  IN DIRECTORY_CACHE  *Cache,
+  IN CONST CHAR16     *Step
+  )
+{
+  EFI_STATUS  Status;
+  UINT64      Size;
+
+  Status = DirectoryCacheLookup (Cache, PROBE_TEST_FILE, &Size, NULL);
+  if (EFI_ERROR (Status)) {
+    Print (L"  %-28s %r\n", Step, Status);
+  } else {
+    Print (L"  %-28s %r, %ld bytes\n", Step, Status, Size);
+  }
+}
+
+/**
+  Create and delete a file on the boot volume and show what the cache
+  reports before and after each invalidation.
+**/
+STATIC
+EFI_STATUS
+ShowInvalidation (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Root;
+  EFI_FILE_PROTOCOL  *File;
+  DIRECTORY_CACHE    Cache;
+  UINTN              Size;
+
+  Status = OpenBootVolume (ImageHandle, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = DirectoryCacheInit (&Cache, Root, DIRECTORY_CACHE_DEFAULT_BUCKETS);
+  if (EFI_ERROR (Status)) {
+    Root->Close (Root);
+    return Status;
+  }
+
+  //
+  // Start without the file, and with the directory in place
+  //
+  Status = Root->Open (Root, &File, PROBE_TEST_FILE, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR (Status)) {
+    File->Delete (File);
+  }
+
+  Status = Root->Open (
+                   Root,
+                   &File,
+                   PROBE_TEST_DIR,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   EFI_FILE_DIRECTORY
+                   );
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot create %s: %r\n", PROBE_TEST_DIR, Status);
+    goto Done;
+  }
+
+  File->Close (File);
+
+  Print (L"\nInvalidation on the boot volume (%s):\n", PROBE_TEST_FILE);
+  PrintLookup (&Cache, L"Before create:");
+
+  Status = Root->Open (
+                   Root,
+                   &File,
+                   PROBE_TEST_FILE,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   0
+                   );
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot create %s: %r\n", PROBE_TEST_FILE, Status);
+    goto Done;
+  }
+
+  Size   = sizeof (PROBE_TEST_TEXT) - 1;
+  Status = File->Write (File, &Size, PROBE_TEST_TEXT);
+  File->Close (File);
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot write %s: %r\n", PROBE_TEST_FILE, Status);
+    goto Done;
+  }
+
+  PrintLookup (&Cache, L"After create, stale:");
+  DirectoryCacheInvalidate (&Cache, PROBE_TEST_FILE);
+  PrintLookup (&Cache, L"After invalidate:");
+
+  Status = Root->Open (Root, &File, PROBE_TEST_FILE, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR (Status)) {
+    Status = File->Delete (File);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot delete %s: %r\n", PROBE_TEST_FILE, Status);
+    goto Done;
+  }
+
+  PrintLookup (&Cache, L"After delete, stale:");
+  DirectoryCacheInvalidate (&Cache, PROBE_TEST_FILE);
+  PrintLookup (&Cache, L"After invalidate:");
+
+  Print (
+    L"  %ld lookups, %ld directory listings, %ld invalidations\n",
+    Cache.Lookups,
+    Cache.Listings,
+    Cache.Invalidations
+    );
+
+Done:
+  DirectoryCacheFree (&Cache);
+  Root->Close (Root);
+  return Status;
+}
+
+/**
+  Probe well-known boot paths on every volume, directly and through a
+  directory cache.
+**/
+EFI_STATUS
+DemoPathProbe (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_HANDLE                       *Handles;
+  UINTN                            HandleCount;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem;
+  EFI_FILE_PROTOCOL                **Roots;
+  DIRECTORY_CACHE                  *Caches;
+  UINTN                            VolumeCount;
+  UINTN                            CacheCount;
+  UINTN                            Index;
+  EFI_FILE_INFO                    *Info;
+  UINT64                           *Found;
+  PROBE_RESULT                     Direct;
+  PROBE_RESULT                     Cached;
+
+  Print (L"\n=== Boot Path Probe ===\n\n");
+
+  VolumeCount = 0;
+  CacheCount  = 0;
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiSimpleFileSystemProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &Handles
+                  );
+  if (EFI_ERROR (Status)) {
+    Print (L"No file systems found: %r\n", Status);
+    return Status;
+  }
+
+  Roots  = AllocateZeroPool (HandleCount * sizeof (EFI_FILE_PROTOCOL *));
+  Caches = AllocateZeroPool (HandleCount * sizeof (DIRECTORY_CACHE));
+  Found  = AllocatePool (HandleCount * PROBE_PATH_COUNT * sizeof (UINT64));
+  Info   = AllocatePool (PROBE_INFO_SIZE);
+  if ((Roots == NULL) || (Caches == NULL) || (Found == NULL) || (Info == NULL)) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiSimpleFileSystemProtocolGuid, (VOID **)&FileSystem);
+    if (!EFI_ERROR (Status)) {
+      Status = FileSystem->OpenVolume (FileSystem, &Roots[VolumeCount]);
+    }
+
+    if (!EFI_ERROR (Status)) {
+      VolumeCount++;
+    }
+  }
+
+  if (VolumeCount == 0) {
+    Print (L"No file system volume could be opened\n");
+    Status = EFI_NOT_FOUND;
+    goto Done;
+  }
+
+  Status = EFI_SUCCESS;
+  while (!EFI_ERROR (Status) && (CacheCount < VolumeCount)) {
+    Status = DirectoryCacheInit (&Caches[CacheCount], Roots[CacheCount], DIRECTORY_CACHE_DEFAULT_BUCKETS);
+    if (!EFI_ERROR (Status)) {
+      CacheCount++;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
+  Print (L"Volumes: %d, candidate paths: %d, rounds: %d\n\n", VolumeCount, PROBE_PATH_COUNT, PROBE_ROUNDS);
+
+  Status = RunProbes (Roots, NULL, VolumeCount, Info, Found, FALSE, &Direct);
+  if (!EFI_ERROR (Status)) {
+    Status = RunProbes (Roots, Caches, VolumeCount, Info, Found, TRUE, &Cached);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Print (L"Probe failed: %r\n", Status);
+    goto Done;
+  }
+
+  Print (L"Method   Found  First round us  Later rounds us  ns/lookup  Driver calls\n");
+  PrintResult (L"direct", &Direct, VolumeCount * PROBE_PATH_COUNT);
+  PrintResult (L"cached", &Cached, VolumeCount * PROBE_PATH_COUNT);
+  Print (L"\nLater rounds are the average per round; driver calls cover all rounds.\n");
+
+  Status = ShowInvalidation (ImageHandle);
+
+Done:
+  for (Index = 0; Index < CacheCount; Index++) {
+    DirectoryCacheFree (&Caches[Index]);
+  }
+
+  for (Index = 0; Index < VolumeCount; Index++) {
+    Roots[Index]->Close (Roots[Index]);
+  }
+
+  if (Info != NULL) {
+    FreePool (Info);
+  }
+
+  if (Found != NULL) {
+    FreePool (Found);
+  }
+
+  if (Caches != NULL) {
+    FreePool (Caches);
+  }
+
+  if (Roots != NULL) {
+    FreePool (Roots);
+  }
+
+  FreePool (Handles);
+  return Status;
+}
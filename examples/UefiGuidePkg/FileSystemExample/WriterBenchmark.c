@@ -0,0 +1,355 @@
+/** @file
+  File System Example - small writes with flushes vs the combining writer.
+
+  Writes the same firmware-log style file, about 75 bytes per line, in
+  several ways: one File->Write () and File->Flush () per line, one
+  File->Write () per line with a single flush at the end, and through a
+  FILE_WRITER with different buffer sizes, with and without preallocating
+  the file size. Every File->Write () on FAT may extend the cluster chain
+  and update the directory entry, and every File->Flush () writes the FAT
+  and directory sectors back, so the per-line rows are bound by metadata
+  updates rather than by the data. Each row reads the file back and prints
+  a checksum that must match the others.
+
+  Usage: FileSystemExample.efi writer [megabytes]
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "FileSystemExample.h"
+#include "FileStream.h"
+#include "FileWriter.h"
+
+#define WRITER_TEST_DIR       L"\\UefiTest"
+#define WRITER_TEST_FILE      L"\\UefiTest\\writer.log"
+#define WRITER_DEFAULT_MB     4
+#define WRITER_MAX_MB         64
+#define WRITER_LINE_SIZE      128
+#define WRITER_VERIFY_PIECE   SIZE_64KB
+
+typedef enum {
+  WriteFlushEach,
+  WriteFlushAtEnd,
+  WriteCombined
+} WRITER_BENCH_METHOD;
+
+typedef struct {
+  CONST CHAR16           *Method;
+  WRITER_BENCH_METHOD    Kind;
+  UINTN                  BufferSize;      ///< FILE_WRITER buffer, 0 for direct writes
+  BOOLEAN                Preallocate;
+} WRITER_BENCH_ROW;
+
+STATIC CONST WRITER_BENCH_ROW  mRows[] = {
+  { L"Write+Flush", WriteFlushEach,  0,          FALSE },
+  { L"Write",       WriteFlushAtEnd, 0,          FALSE },
+  { L"FileWriter",  WriteCombined,   SIZE_64KB,  FALSE },
+  { L"FileWriter",  WriteCombined,   SIZE_1MB,   FALSE },
+  { L"FileWriter",  WriteCombined,   SIZE_1MB,   TRUE  },
+  { L"FileWriter",  WriteCombined,   SIZE_4MB,   TRUE  },
+};
+
+/**
+  Fold a buffer into a running checksum.
+**/
+STATIC
+UINT32
+Checksum (
+  IN UINT32       Sum,
+  IN CONST UINT8  *Data,
+  IN UINTN        Length
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < Length; Index++) {
+    Sum = ((Sum << 5) | (Sum >> 27)) ^ Data[Index];
+  }
+
+  return Sum;
+}
+
+/**
+  Format log line Number and return its length.
+**/
+STATIC
+UINTN
+FormatLine (
+  OUT CHAR8  *Line,
+  IN  UINTN  Number
+  )
+{
+  return AsciiSPrint (
+           Line,
+           WRITER_LINE_SIZE,
+           "%08d: [DXE] Driver %04x started, status %08x, heap in use %d KB\r\n",
+           (UINT32)Number,
+           (UINT32)(Number % 0x1000),
+           (UINT32)Number * 0x9E3779B1,
+           (UINT32)(Number % 65536)
+           );
+}
+
+/**
+  Delete the test file if it exists, so every row starts from nothing.
+**/
+STATIC
+VOID
+DeleteTestFile (
+  IN EFI_FILE_PROTOCOL  *Root
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *File;
+
+  Status = Root->Open (Root, &File, WRITER_TEST_FILE, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR (Status)) {
+    File->Delete (File);
+  }
+}
+
+/**
+  Write the test file with one method.
+**/
+STATIC
+EFI_STATUS
+RunRow (
+  IN  EFI_FILE_PROTOCOL       *Root,
+  IN  CONST WRITER_BENCH_ROW  *Row,
+  IN  UINT64                  TotalSize,
+  OUT UINT64                  *Writes,
+  OUT UINT64                  *Flushes,
+  OUT UINT64                  *Bytes
+  )
+{
+  EFI_STATUS         Status;
+  EFI_STATUS         CloseStatus;
+  EFI_FILE_PROTOCOL  *File;
+  FILE_WRITER        Writer;
+  CHAR8              Line[WRITER_LINE_SIZE];
+  UINTN              Length;
+  UINTN              Size;
+  UINTN              Number;
+
+  *Writes  = 0;
+  *Flushes = 0;
+  *Bytes   = 0;
+
+  if (Row->Kind == WriteCombined) {
+    Status = FileWriterOpen (&Writer, Root, WRITER_TEST_FILE, Row->BufferSize, Row->Preallocate ? TotalSize : 0);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    for (Number = 0; !EFI_ERROR (Status) && (*Bytes < TotalSize); Number++) {
+      Length  = FormatLine (Line, Number);
+      Status  = FileWriterWrite (&Writer, Length, Line);
+      *Bytes += Length;
+    }
+
+    CloseStatus = FileWriterClose (&Writer);
+    *Writes     = Writer.WriteCalls;
+    *Flushes    = Writer.FlushCalls;
+    return EFI_ERROR (Status) ? Status : CloseStatus;
+  }
+
+  Status = Root->Open (
+                   Root,
+                   &File,
+                   WRITER_TEST_FILE,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   0
+                   );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  for (Number = 0; !EFI_ERROR (Status) && (*Bytes < TotalSize); Number++) {
+    Length = FormatLine (Line, Number);
+    Size   = Length;
+    Status = File->Write (File, &Size, Line);
+    (*Writes)++;
+    *Bytes += Size;
+    if (!EFI_ERROR (Status) && (Row->Kind == WriteFlushEach)) {
+      Status = File->Flush (File);
+      (*Flushes)++;
+    }
+  }
+
+  if (!EFI_ERROR (Status) && (Row->Kind == WriteFlushAtEnd)) {
+    Status = File->Flush (File);
+    (*Flushes)++;
+  }
+
+  File->Close (File);
+  return Status;
+}
+
+/**
+  Read the test file back and checksum it.
+**/
+STATIC
+EFI_STATUS
+VerifyFile (
+  IN  EFI_FILE_PROTOCOL  *Root,
+  IN  UINT8              *Piece,
+  OUT UINT64             *Bytes,
+  OUT UINT32             *Sum
+  )
+{
+  EFI_STATUS   Status;
+  FILE_STREAM  Stream;
+  UINTN        Size;
+
+  *Bytes = 0;
+  *Sum   = 0;
+
+  Status = FileStreamOpen (&Stream, Root, WRITER_TEST_FILE, FILE_STREAM_DEFAULT_CHUNK);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  do {
+    Size    = WRITER_VERIFY_PIECE;
+    Status  = FileStreamRead (&Stream, &Size, Piece);
+    *Bytes += Size;
+    *Sum    = Checksum (*Sum, Piece, Size);
+  } while (!EFI_ERROR (Status) && (Size != 0));
+
+  FileStreamClose (&Stream);
+  return Status;
+}
+
+/**
+  Compare per-line writes and flushes with the combining file writer.
+**/
+EFI_STATUS
+DemoFileWriter (
+  IN EFI_HANDLE  ImageHandle,
+  IN UINTN       Argc,
+  IN CHAR16      **Argv
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_PROTOCOL  *Root;
+  EFI_FILE_PROTOCOL  *Dir;
+  UINT8              *Piece;
+  UINTN              Megabytes;
+  UINTN              Index;
+  UINT64             TotalSize;
+  UINT64             Start;
+  UINT64             ElapsedNs;
+  UINT64             Writes;
+  UINT64             Flushes;
+  UINT64             Bytes;
+  UINT64             FileBytes;
+  UINT32             Sum;
+  UINT32             FirstSum;
+  BOOLEAN            HaveFirst;
+  CHAR16             Buffer[16];
+
+  Print (L"\n=== Small Writes vs Combining File Writer ===\n\n");
+
+  Megabytes = (Argc > 0) ? StrDecimalToUintn (Argv[0]) : WRITER_DEFAULT_MB;
+  if ((Megabytes == 0) || (Megabytes > WRITER_MAX_MB)) {
+    Print (L"Size must be 1 to %d MB\n", WRITER_MAX_MB);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = OpenBootVolume (ImageHandle, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Piece = AllocatePages (EFI_SIZE_TO_PAGES (WRITER_VERIFY_PIECE));
+  if (Piece == NULL) {
+    Root->Close (Root);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = Root->Open (
+                   Root,
+                   &Dir,
+                   WRITER_TEST_DIR,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   EFI_FILE_DIRECTORY
+                   );
+  if (EFI_ERROR (Status)) {
+    Print (L"Cannot create %s: %r\n", WRITER_TEST_DIR, Status);
+    goto Done;
+  }
+
+  Dir->Close (Dir);
+
+  TotalSize = MultU64x32 (Megabytes, SIZE_1MB);
+  HaveFirst = FALSE;
+  FirstSum  = 0;
+
+  Print (L"Writing %d MB to %s in log lines of about 75 bytes\n\n", Megabytes, WRITER_TEST_FILE);
+  Print (L"Method        Buffer Prealloc   Writes  Flushes       ms     MB/s  Checksum\n");
+  Print (L"----------- -------- -------- -------- -------- -------- --------  --------\n");
+
+  for (Index = 0; Index < ARRAY_SIZE (mRows); Index++) {
+    DeleteTestFile (Root);
+
+    Start     = BenchmarkGetTicks ();
+    Status    = RunRow (Root, &mRows[Index], TotalSize, &Writes, &Flushes, &Bytes);
+    ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    if (!EFI_ERROR (Status)) {
+      Status = VerifyFile (Root, Piece, &FileBytes, &Sum);
+      if (!EFI_ERROR (Status) && (FileBytes != Bytes)) {
+        Status = EFI_VOLUME_CORRUPTED;
+      }
+    }
+
+    if (EFI_ERROR (Status)) {
+      Print (L"%-11s failed: %r\n", mRows[Index].Method, Status);
+      continue;
+    }
+
+    if (!HaveFirst) {
+      FirstSum  = Sum;
+      HaveFirst = TRUE;
+    }
+
+    if (mRows[Index].BufferSize == 0) {
+      StrCpyS (Buffer, ARRAY_SIZE (Buffer), L"-");
+    } else {
+      UnicodeSPrint (Buffer, sizeof (Buffer), L"%d KB", mRows[Index].BufferSize / SIZE_1KB);
+    }
+
+    Print (
+      L"%-11s %8s %8s %8ld %8ld %8ld %8ld  %08x%s\n",
+      mRows[Index].Method,
+      Buffer,
+      mRows[Index].Preallocate ? L"yes" : L"no",
+      Writes,
+      Flushes,
+      DivU64x32 (ElapsedNs, 1000000),
+      BenchmarkMBps (Bytes, ElapsedNs),
+      Sum,
+      (Sum == FirstSum) ? L"" : L" MISMATCH"
+      );
+  }
+
+  DeleteTestFile (Root);
+
+Done:
+  FreePages (Piece, EFI_SIZE_TO_PAGES (WRITER_VERIFY_PIECE));
+  Root->Close (Root);
+  return Status;
+}
@@ -0,0 +1,161 @@
+/** @file
+  Async File Library - overlapped file I/O with EFI_FILE_PROTOCOL revision 2.
+
+  AsyncFileRead () reads a file in chunks with two requests in flight: while
+  the caller's Process function works on one chunk (hashing, decompressing,
+  parsing) the next is already being read with ReadEx (). AsyncFileWrite ()
+  likewise keeps two WriteEx () requests queued. Each request carries an
+  EFI_FILE_IO_TOKEN whose event the library waits on in submission order.
+
+  File systems older than EFI_FILE_PROTOCOL_REVISION2 have no Ex functions;
+  every call then falls back to the blocking Open (), Read (), Write () and
+  Flush () with the same results, just without the overlap. Whether the
+  overlap actually happens below the file system depends on the driver
+  stack: a FAT volume on a Block I/O 2 device completes requests
+  asynchronously, one on a plain Block I/O device completes them before
+  ReadEx () returns.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef ASYNC_FILE_LIB_H_
+#define ASYNC_FILE_LIB_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+#define ASYNC_FILE_DEFAULT_CHUNK  SIZE_1MB
+
+///
+/// Requests AsyncFileRead () and AsyncFileWrite () keep in flight
+///
+#define ASYNC_FILE_SLOTS  2
+
+/**
+  Consume one chunk read by AsyncFileRead ().
+
+  Chunks arrive in file order. The next chunk is being read while this
+  function runs; the data stays valid only until it returns.
+
+  @param[in]  Context  Value passed to AsyncFileRead ().
+  @param[in]  Data     Chunk contents.
+  @param[in]  Length   Bytes in Data.
+
+  @retval EFI_SUCCESS  Keep reading.
+  @retval Others       Stop; AsyncFileRead () returns this status.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *ASYNC_FILE_PROCESS)(
+  IN VOID        *Context,
+  IN CONST VOID  *Data,
+  IN UINTN       Length
+  );
+
+/**
+  Report whether a file handle provides the revision 2 Ex functions.
+
+  @param[in]  File  File or directory handle.
+
+  @retval TRUE   OpenEx (), ReadEx (), WriteEx () and FlushEx () are used.
+  @retval FALSE  The library falls back to blocking I/O.
+**/
+BOOLEAN
+EFIAPI
+AsyncFileSupported (
+  IN EFI_FILE_PROTOCOL  *File
+  );
+
+/**
+  Open a file with OpenEx (), or Open () on revision 1 volumes.
+
+  @param[in]   Root        Directory Path is relative to.
+  @param[out]  File        Receives the new handle.
+  @param[in]   Path        File to open.
+  @param[in]   OpenMode    EFI_FILE_MODE_* flags.
+  @param[in]   Attributes  Attributes for a newly created file.
+
+  @retval EFI_SUCCESS  The file is open.
+  @retval Others       The open failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileOpen (
+  IN  EFI_FILE_PROTOCOL  *Root,
+  OUT EFI_FILE_PROTOCOL  **File,
+  IN  CONST CHAR16       *Path,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  );
+
+/**
+  Read from the current position in overlapped chunks.
+
+  With Buffer the data lands there contiguously and Process, if given,
+  sees each chunk in place. Without Buffer the library reads into two
+  chunk-sized page buffers in turn and Process is the only consumer.
+
+  @param[in]      File       File to read.
+  @param[in,out]  Size       Bytes to read on input, MAX_UINTN for the rest
+                             of the file when Buffer is NULL; bytes read on
+                             output.
+  @param[out]     Buffer     Destination of Size bytes. Optional.
+  @param[in]      ChunkSize  Bytes per request, 0 for ASYNC_FILE_DEFAULT_CHUNK.
+  @param[in]      Process    Called for every chunk in file order. Optional.
+  @param[in]      Context    Passed to Process.
+
+  @retval EFI_SUCCESS            The data was read and processed.
+  @retval EFI_INVALID_PARAMETER  Both Buffer and Process are NULL.
+  @retval EFI_OUT_OF_RESOURCES   Buffers or events could not be allocated.
+  @retval Others                 A read failed, or Process stopped the read.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileRead (
+  IN     EFI_FILE_PROTOCOL   *File,
+  IN OUT UINTN               *Size,
+  OUT    VOID                *Buffer OPTIONAL,
+  IN     UINTN               ChunkSize,
+  IN     ASYNC_FILE_PROCESS  Process OPTIONAL,
+  IN     VOID                *Context OPTIONAL
+  );
+
+/**
+  Write at the current position in overlapped chunks.
+
+  Buffer must stay unchanged until the call returns.
+
+  @param[in]      File       File to write.
+  @param[in,out]  Size       Bytes to write on input; bytes written on output.
+  @param[in]      Buffer     Data to write.
+  @param[in]      ChunkSize  Bytes per request, 0 for ASYNC_FILE_DEFAULT_CHUNK.
+
+  @retval EFI_SUCCESS           All data was written.
+  @retval EFI_OUT_OF_RESOURCES  Events could not be created.
+  @retval Others                A write failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileWrite (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT UINTN              *Size,
+  IN     CONST VOID         *Buffer,
+  IN     UINTN              ChunkSize
+  );
+
+/**
+  Flush a file with FlushEx (), or Flush () on revision 1 volumes.
+
+  @param[in]  File  File to flush.
+
+  @retval EFI_SUCCESS  The file was flushed.
+  @retval Others       The flush failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileFlush (
+  IN EFI_FILE_PROTOCOL  *File
+  );
+
+#endif // ASYNC_FILE_LIB_H_
@@ -0,0 +1,114 @@
+/** @file
+  Benchmark Library - timing helpers shared by the UEFI Guide examples.
+
+  The performance counter is calibrated once against gBS->Stall () so the
+  examples do not depend on a TimerLib instance reporting an accurate
+  frequency (many do not on QEMU).
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef BENCHMARK_LIB_H_
+#define BENCHMARK_LIB_H_
+
+#include <Uefi.h>
+
+///
+/// Latency summary computed by BenchmarkComputeStats (). All values are in
+/// nanoseconds.
+///
+typedef struct {
+  UINTN     Count;
+  UINT64    Min;
+  UINT64    Mean;
+  UINT64    P50;
+  UINT64    P99;
+  UINT64    Max;
+} BENCHMARK_STATS;
+
+/**
+  Read the raw performance counter.
+
+  @return Current counter value in ticks.
+**/
+UINT64
+EFIAPI
+BenchmarkGetTicks (
+  VOID
+  );
+
+/**
+  Return the calibrated performance counter frequency.
+
+  The first call calibrates the counter against a 10 ms gBS->Stall ().
+
+  @return Counter frequency in Hz, or 0 if the counter does not advance.
+**/
+UINT64
+EFIAPI
+BenchmarkGetFrequency (
+  VOID
+  );
+
+/**
+  Convert a tick count to nanoseconds.
+
+  @param[in]  Ticks   Number of counter ticks.
+
+  @return Equivalent time in nanoseconds.
+**/
+UINT64
+EFIAPI
+BenchmarkTicksToNs (
+  IN UINT64  Ticks
+  );
+
+/**
+  Return the time between two counter samples in nanoseconds.
+
+  Handles counters that count down as well as up.
+
+  @param[in]  StartTicks  Value returned by BenchmarkGetTicks () at start.
+  @param[in]  EndTicks    Value returned by BenchmarkGetTicks () at end.
+
+  @return Elapsed time in nanoseconds.
+**/
+UINT64
+EFIAPI
+BenchmarkElapsedNs (
+  IN UINT64  StartTicks,
+  IN UINT64  EndTicks
+  );
+
+/**
+  Compute throughput in MB/s (10^6 bytes per second).
+
+  @param[in]  Bytes   Number of bytes transferred.
+  @param[in]  Ns      Time taken in nanoseconds.
+
+  @return Throughput in MB/s, or 0 if Ns is 0.
+**/
+UINT64
+EFIAPI
+BenchmarkMBps (
+  IN UINT64  Bytes,
+  IN UINT64  Ns
+  );
+
+/**
+  Sort latency samples in place and summarize them.
+
+  @param[in, out]  Samples  Array of samples in nanoseconds. Sorted on return.
+  @param[in]       Count    Number of samples.
+  @param[out]      Stats    Receives min, mean, p50, p99 and max.
+**/
+VOID
+EFIAPI
+BenchmarkComputeStats (
+  IN OUT UINT64           *Samples,
+  IN     UINTN            Count,
+  OUT    BENCHMARK_STATS  *Stats
+  );
+
+#endif // BENCHMARK_LIB_H_
@@ -0,0 +1,58 @@
+/** @file
+  Export File Library - write report files next to the running image.
+
+  Benchmark and trace modes export CSV, JSON and binary results to the root
+  of the volume the application was loaded from, so they can be copied off
+  the boot disk and opened on a host.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef EXPORT_FILE_LIB_H_
+#define EXPORT_FILE_LIB_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+/**
+  Create (or truncate) a file in the root of the volume this image was
+  loaded from.
+
+  @param[in]   ImageHandle  Image handle of the running application.
+  @param[in]   FileName     Root-relative path of the file.
+  @param[out]  File         Receives the open file. Close it when done.
+
+  @retval EFI_SUCCESS  The file is open for writing and empty.
+  @retval Others       The image has no file system or the file could not
+                       be created.
+**/
+EFI_STATUS
+EFIAPI
+OpenBootVolumeFile (
+  IN  EFI_HANDLE         ImageHandle,
+  IN  CHAR16             *FileName,
+  OUT EFI_FILE_PROTOCOL  **File
+  );
+
+/**
+  Write a formatted ASCII line to a file.
+
+  Output longer than 511 characters is truncated.
+
+  @param[in]  File    File to write.
+  @param[in]  Format  AsciiSPrint () format string.
+  @param[in]  ...     Arguments for Format.
+
+  @retval EFI_SUCCESS  The text was written.
+  @retval Others       File->Write () failed.
+**/
+EFI_STATUS
+EFIAPI
+FilePrint (
+  IN EFI_FILE_PROTOCOL  *File,
+  IN CONST CHAR8        *Format,
+  ...
+  );
+
+#endif // EXPORT_FILE_LIB_H_
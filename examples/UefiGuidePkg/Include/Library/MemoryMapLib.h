@@ -0,0 +1,296 @@
+/** @file
+  Memory Map Library - capture and query UEFI memory map snapshots.
+
+  MemoryMapGet () performs the usual two-call GetMemoryMap () sequence,
+  retrying if the map grows in between. MemoryMapSnapshotCapture () goes one
+  step further: it keeps the raw map, builds a sorted array of regions with
+  adjacent descriptors of identical type and attributes coalesced, and
+  tallies pages per memory type. Address lookups are then a binary search
+  over the coalesced array instead of a walk of the raw descriptor chain.
+
+  MemoryMapSnapshotDiff () compares two snapshots to show which regions
+  appeared, vanished, split, merged or changed type between them.
+
+  MemoryMapAllocateLargePages () uses a snapshot to place multi-megabyte
+  buffers on 2 MB or 1 GB boundaries so an OS can map them with large pages.
+
+  MemoryMapSnapshotExport () writes the full raw map to files, as a binary
+  image (MEMORY_MAP_EXPORT_HEADER followed by the descriptors) and as CSV.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef MEMORY_MAP_LIB_H_
+#define MEMORY_MAP_LIB_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+///
+/// One coalesced memory map region.
+///
+typedef struct {
+  EFI_PHYSICAL_ADDRESS    Start;
+  UINT64                  NumberOfPages;
+  UINT64                  Attribute;
+  UINT32                  Type;
+  UINT32                  DescriptorCount;  ///< Raw descriptors merged into this region
+} MEMORY_MAP_REGION;
+
+///
+/// A memory map captured at one point in time.
+///
+typedef struct {
+  EFI_MEMORY_DESCRIPTOR    *RawMap;           ///< Map as returned by the firmware
+  UINTN                    RawMapSize;
+  UINTN                    MapKey;
+  UINTN                    DescriptorSize;
+  UINT32                   DescriptorVersion;
+  UINTN                    DescriptorCount;
+  MEMORY_MAP_REGION        *Regions;          ///< Sorted by Start, coalesced
+  UINTN                    RegionCount;
+  UINT64                   PagesByType[EfiMaxMemoryType];
+  UINT64                   TotalPages;
+} MEMORY_MAP_SNAPSHOT;
+
+///
+/// Kinds of region change reported by MemoryMapSnapshotDiff ().
+///
+typedef enum {
+  MemoryMapChangeAppeared,     ///< New region overlaps nothing in the old map
+  MemoryMapChangeVanished,     ///< Old region overlaps nothing in the new map
+  MemoryMapChangeSplit,        ///< Old region now covered by several regions
+  MemoryMapChangeMerged,       ///< Several old regions now form one region
+  MemoryMapChangeTypeChanged,  ///< Same range, different type or attributes
+  MemoryMapChangeResized       ///< Same region grew or shrank
+} MEMORY_MAP_CHANGE_KIND;
+
+///
+/// One entry of a memory map diff.
+///
+typedef struct {
+  MEMORY_MAP_CHANGE_KIND    Kind;
+  MEMORY_MAP_REGION         Old;     ///< Old region (first piece for Merged)
+  MEMORY_MAP_REGION         New;     ///< New region (first piece for Split)
+  UINTN                     Pieces;  ///< Region count on the fragmented side
+} MEMORY_MAP_CHANGE;
+
+///
+/// Difference between two snapshots.
+///
+typedef struct {
+  MEMORY_MAP_CHANGE    *Changes;
+  UINTN                ChangeCount;
+  INTN                 DescriptorDelta;
+  INTN                 RegionDelta;
+  ///
+  /// Pages whose type changed, indexed [OldType][NewType]
+  ///
+  UINT64               Transitions[EfiMaxMemoryType][EfiMaxMemoryType];
+} MEMORY_MAP_DIFF;
+
+#define MEMORY_MAP_EXPORT_SIGNATURE  SIGNATURE_32 ('M', 'M', 'A', 'P')
+#define MEMORY_MAP_EXPORT_VERSION    1
+
+#pragma pack(1)
+
+///
+/// Header of a binary memory map export. DescriptorCount descriptors follow
+/// immediately, each DescriptorSize bytes long exactly as the firmware
+/// returned them.
+///
+typedef struct {
+  UINT32      Signature;          ///< MEMORY_MAP_EXPORT_SIGNATURE
+  UINT16      Version;            ///< MEMORY_MAP_EXPORT_VERSION
+  UINT16      HeaderSize;         ///< sizeof (MEMORY_MAP_EXPORT_HEADER)
+  UINT32      DescriptorSize;
+  UINT32      DescriptorVersion;
+  UINT64      MapKey;
+  UINT64      DescriptorCount;
+  EFI_TIME    Timestamp;          ///< Zeroed if GetTime () failed
+} MEMORY_MAP_EXPORT_HEADER;
+
+#pragma pack()
+
+/**
+  Get the current memory map in a newly allocated pool buffer.
+
+  @param[out]  MemoryMap          Receives the map. Free with FreePool ().
+  @param[out]  MemoryMapSize      Receives the size of the map in bytes.
+  @param[out]  MapKey             Receives the map key.
+  @param[out]  DescriptorSize     Receives the size of one descriptor.
+  @param[out]  DescriptorVersion  Receives the descriptor version. Optional.
+
+  @retval EFI_SUCCESS           The map was returned.
+  @retval EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+  @retval Others                GetMemoryMap () failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapGet (
+  OUT EFI_MEMORY_DESCRIPTOR  **MemoryMap,
+  OUT UINTN                  *MemoryMapSize,
+  OUT UINTN                  *MapKey,
+  OUT UINTN                  *DescriptorSize,
+  OUT UINT32                 *DescriptorVersion OPTIONAL
+  );
+
+/**
+  Capture the current memory map into a snapshot.
+
+  The coalesced region array is allocated after the map is read, so the
+  snapshot describes the map as it was just before that allocation.
+
+  @param[out]  Snapshot  Snapshot to fill. Release with MemoryMapSnapshotFree ().
+
+  @retval EFI_SUCCESS           The snapshot was captured.
+  @retval EFI_OUT_OF_RESOURCES  Memory for the snapshot could not be allocated.
+  @retval Others                GetMemoryMap () failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotCapture (
+  OUT MEMORY_MAP_SNAPSHOT  *Snapshot
+  );
+
+/**
+  Release the buffers held by a snapshot.
+
+  @param[in, out]  Snapshot  Snapshot to release. Zeroed on return.
+**/
+VOID
+EFIAPI
+MemoryMapSnapshotFree (
+  IN OUT MEMORY_MAP_SNAPSHOT  *Snapshot
+  );
+
+/**
+  Find the region containing a physical address.
+
+  @param[in]  Snapshot  Snapshot to search.
+  @param[in]  Address   Physical address to look up.
+
+  @return The containing region, or NULL if no region covers Address.
+**/
+CONST MEMORY_MAP_REGION *
+EFIAPI
+MemoryMapSnapshotFind (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_PHYSICAL_ADDRESS       Address
+  );
+
+/**
+  Return the total pages of one memory type in a snapshot.
+
+  @param[in]  Snapshot  Snapshot to query.
+  @param[in]  Type      Memory type.
+
+  @return Number of pages of that type.
+**/
+UINT64
+EFIAPI
+MemoryMapSnapshotTypePages (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN UINT32                     Type
+  );
+
+/**
+  Compare two snapshots.
+
+  Regions are matched by physical overlap, so a conventional region that had
+  a few pages allocated out of its middle is reported as one Split change,
+  and the pages involved show up in Transitions.
+
+  @param[in]   Old   Earlier snapshot.
+  @param[in]   New   Later snapshot.
+  @param[out]  Diff  Receives the changes. Release with MemoryMapDiffFree ().
+
+  @retval EFI_SUCCESS           The diff was computed.
+  @retval EFI_OUT_OF_RESOURCES  Memory for the diff could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotDiff (
+  IN  CONST MEMORY_MAP_SNAPSHOT  *Old,
+  IN  CONST MEMORY_MAP_SNAPSHOT  *New,
+  OUT MEMORY_MAP_DIFF            *Diff
+  );
+
+/**
+  Release the buffers held by a diff.
+
+  @param[in, out]  Diff  Diff to release. Zeroed on return.
+**/
+VOID
+EFIAPI
+MemoryMapDiffFree (
+  IN OUT MEMORY_MAP_DIFF  *Diff
+  );
+
+/**
+  Allocate pages aligned for large-page mappings.
+
+  Buffers of at least 1 GB are first placed on a 1 GB boundary, and buffers of
+  at least 2 MB on a 2 MB boundary. Placement scans the memory map from the
+  top for an EfiConventionalMemory range that can hold the aligned buffer and
+  claims it with AllocateAddress. If no range fits, an over-sized allocation
+  is trimmed to the alignment. If that also fails, or the buffer is smaller
+  than 2 MB, a plain page allocation is returned.
+
+  @param[in]   MemoryType  Memory type of the allocation, e.g. EfiLoaderData.
+  @param[in]   Pages       Number of 4 KB pages to allocate.
+  @param[out]  Address     Receives the base address. Free with gBS->FreePages ().
+  @param[out]  Alignment   Receives the alignment achieved. Optional.
+
+  @retval EFI_SUCCESS            The pages were allocated.
+  @retval EFI_INVALID_PARAMETER  Pages is 0 or Address is NULL.
+  @retval EFI_OUT_OF_RESOURCES   The pages could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapAllocateLargePages (
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 Pages,
+  OUT EFI_PHYSICAL_ADDRESS  *Address,
+  OUT UINTN                 *Alignment OPTIONAL
+  );
+
+/**
+  Write a snapshot's raw descriptors to a binary file and/or a CSV file.
+
+  The binary file receives a MEMORY_MAP_EXPORT_HEADER and the raw map in a
+  single write. CSV rows are formatted into a large buffer that is written
+  out as it fills, so a big map costs a handful of file writes rather than
+  one per descriptor. Neither file is flushed or closed.
+
+  @param[in]  Snapshot    Snapshot to export.
+  @param[in]  BinaryFile  File opened for writing, or NULL to skip.
+  @param[in]  CsvFile     File opened for writing, or NULL to skip.
+
+  @retval EFI_SUCCESS           The requested files were written.
+  @retval EFI_OUT_OF_RESOURCES  The CSV buffer could not be allocated.
+  @retval Others                A file write failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotExport (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_FILE_PROTOCOL          *BinaryFile OPTIONAL,
+  IN EFI_FILE_PROTOCOL          *CsvFile OPTIONAL
+  );
+
+/**
+  Return a short display name for a memory type.
+
+  @param[in]  Type  Memory type.
+
+  @return Static string such as L"Conventional".
+**/
+CONST CHAR16 *
+EFIAPI
+MemoryTypeToString (
+  IN UINT32  Type
+  );
+
+#endif // MEMORY_MAP_LIB_H_
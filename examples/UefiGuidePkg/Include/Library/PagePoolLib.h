@@ -0,0 +1,127 @@
+/** @file
+  Page Pool Library.
+
+  Recycles page runs for code that allocates and frees buffers of the same
+  few sizes over and over, such as a loader staging one file after another
+  or a block reader cycling I/O buffers. Freed runs go onto a free list per
+  page count instead of back to the firmware, so the next allocation of that
+  size is a list pop rather than a walk of the firmware memory map.
+
+  A cap bounds how many pages may sit idle in the pool; runs freed beyond it
+  are returned to the firmware at once.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef PAGE_POOL_LIB_H_
+#define PAGE_POOL_LIB_H_
+
+#include <Uefi.h>
+
+///
+/// Number of distinct run sizes a pool caches at once
+///
+#define PAGE_POOL_MAX_SIZES  8
+
+///
+/// Idle-page cap used when PagePoolInit () is given 0 (16 MB)
+///
+#define PAGE_POOL_DEFAULT_CAP  EFI_SIZE_TO_PAGES (SIZE_16MB)
+
+///
+/// Free list of runs of one size. Each idle run stores the link to the next
+/// in its first bytes.
+///
+typedef struct {
+  UINTN    Pages;                 ///< Run size; 0 when the bin is unused
+  VOID     *Head;                 ///< First idle run
+  UINTN    Count;                 ///< Idle runs on the list
+} PAGE_POOL_BIN;
+
+///
+/// Page run recycler. Initialize with PagePoolInit (); the structure itself
+/// may live on the stack or in a global.
+///
+typedef struct {
+  EFI_MEMORY_TYPE    MemoryType;        ///< Type passed to AllocatePages ()
+  UINTN              MaxCachedPages;    ///< Cap on idle pages held
+  UINTN              CachedPages;       ///< Idle pages currently held
+  UINTN              PeakCachedPages;   ///< High-water mark of CachedPages
+  UINTN              Hits;              ///< Allocations served from a bin
+  UINTN              Misses;            ///< Allocations sent to the firmware
+  UINTN              Released;          ///< Frees sent to the firmware
+  PAGE_POOL_BIN      Bins[PAGE_POOL_MAX_SIZES];
+} PAGE_POOL;
+
+/**
+  Initialize a page pool.
+
+  No memory is allocated until the first PagePoolAlloc ().
+
+  @param[out]  Pool            Pool to initialize.
+  @param[in]   MemoryType      Memory type for every run in the pool.
+  @param[in]   MaxCachedPages  Cap on idle pages. 0 selects
+                               PAGE_POOL_DEFAULT_CAP.
+
+  @retval EFI_SUCCESS            The pool was initialized.
+  @retval EFI_INVALID_PARAMETER  Pool is NULL.
+**/
+EFI_STATUS
+EFIAPI
+PagePoolInit (
+  OUT PAGE_POOL        *Pool,
+  IN  EFI_MEMORY_TYPE  MemoryType,
+  IN  UINTN            MaxCachedPages
+  );
+
+/**
+  Allocate a run of pages, reusing an idle run of the same size if any.
+
+  The returned memory is page aligned and not zeroed.
+
+  @param[in]  Pool   Pool to allocate from.
+  @param[in]  Pages  Number of 4 KB pages.
+
+  @return Pointer to the run, or NULL if Pages is 0 or the firmware is out
+          of memory.
+**/
+VOID *
+EFIAPI
+PagePoolAlloc (
+  IN PAGE_POOL  *Pool,
+  IN UINTN      Pages
+  );
+
+/**
+  Return a run of pages to the pool.
+
+  The run is kept for reuse unless that would exceed the cap or every bin
+  already holds a different size, in which case it is freed to the firmware.
+
+  @param[in]  Pool    Pool the run was allocated from.
+  @param[in]  Buffer  Run to free. NULL is ignored.
+  @param[in]  Pages   Size of the run, as passed to PagePoolAlloc ().
+**/
+VOID
+EFIAPI
+PagePoolFree (
+  IN PAGE_POOL  *Pool,
+  IN VOID       *Buffer,
+  IN UINTN      Pages
+  );
+
+/**
+  Release every idle run back to the firmware.
+
+  Runs still allocated are unaffected and may be freed to the pool later.
+
+  @param[in]  Pool  Pool to trim. It may be used again afterwards.
+**/
+VOID
+EFIAPI
+PagePoolTrim (
+  IN PAGE_POOL  *Pool
+  );
+
+#endif // PAGE_POOL_LIB_H_
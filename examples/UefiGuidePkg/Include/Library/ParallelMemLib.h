@@ -0,0 +1,109 @@
+/** @file
+  Parallel Memory Library - bulk zero, fill and copy across processors.
+
+  Operations of PARALLEL_MEM_THRESHOLD bytes or more are cut into
+  PARALLEL_MEM_CHUNK_SIZE chunks and handed to the application processors
+  through EFI_MP_SERVICES_PROTOCOL StartupAllAPs (), with the BSP taking
+  chunks too. Each processor pulls the next chunk from a shared counter, so a
+  slow core simply ends up doing fewer chunks. Smaller operations, platforms
+  without MP Services, and systems with a single enabled processor use
+  BaseMemoryLib on the BSP.
+
+  The AP workers only touch memory; they make no boot service calls.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef PARALLEL_MEM_LIB_H_
+#define PARALLEL_MEM_LIB_H_
+
+#include <Uefi.h>
+
+///
+/// Operations smaller than this run on the BSP only
+///
+#define PARALLEL_MEM_THRESHOLD   SIZE_16MB
+
+///
+/// Unit of work handed to one processor at a time
+///
+#define PARALLEL_MEM_CHUNK_SIZE  SIZE_1MB
+
+/**
+  Fill a buffer with zeros, in parallel when it is large enough.
+
+  @param[out]  Buffer  Buffer to clear.
+  @param[in]   Length  Number of bytes to clear.
+
+  @return Buffer.
+**/
+VOID *
+EFIAPI
+ParallelZeroMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length
+  );
+
+/**
+  Fill a buffer with a byte value, in parallel when it is large enough.
+
+  @param[out]  Buffer  Buffer to fill.
+  @param[in]   Length  Number of bytes to fill.
+  @param[in]   Value   Byte value to store.
+
+  @return Buffer.
+**/
+VOID *
+EFIAPI
+ParallelSetMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT8  Value
+  );
+
+/**
+  Copy a buffer, in parallel when it is large enough.
+
+  The buffers must not overlap when the copy runs in parallel; overlapping
+  copies always run on the BSP.
+
+  @param[out]  Destination  Destination buffer.
+  @param[in]   Source       Source buffer.
+  @param[in]   Length       Number of bytes to copy.
+
+  @return Destination.
+**/
+VOID *
+EFIAPI
+ParallelCopyMem (
+  OUT VOID        *Destination,
+  IN  CONST VOID  *Source,
+  IN  UINTN       Length
+  );
+
+/**
+  Return the number of enabled processors, including the BSP.
+
+  @return Processor count; 1 if MP Services is not available.
+**/
+UINTN
+EFIAPI
+ParallelMemGetProcessorCount (
+  VOID
+  );
+
+/**
+  Limit how many processors later operations may use.
+
+  @param[in]  Count  Maximum processors including the BSP. 0 means all.
+
+  @return The previous limit.
+**/
+UINTN
+EFIAPI
+ParallelMemSetMaxProcessors (
+  IN UINTN  Count
+  );
+
+#endif // PARALLEL_MEM_LIB_H_
@@ -0,0 +1,187 @@
+/** @file
+  Slab and Arena Allocator Library.
+
+  Provides two allocators layered over page allocations so hot loops do not
+  pay the firmware pool lock and free-list cost on every small allocation:
+
+  - SLAB_CACHE: fixed-size objects carved from page-sized slabs, with O(1)
+    alloc/free through an intrusive free list.
+  - ARENA: a bump allocator over a chain of page blocks. Individual
+    allocations are never freed; ArenaReset () releases them all at once.
+
+  Both support reset-all semantics: after a reset every object is free again
+  but the backing pages are kept for reuse, so the next pass allocates no
+  memory from the firmware at all.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef SLAB_ARENA_LIB_H_
+#define SLAB_ARENA_LIB_H_
+
+#include <Uefi.h>
+
+typedef struct _SLAB_HEADER   SLAB_HEADER;
+typedef struct _ARENA_BLOCK   ARENA_BLOCK;
+
+///
+/// Fixed-size object cache. Initialize with SlabCacheInit (); the structure
+/// itself may live on the stack or in a global.
+///
+typedef struct {
+  UINTN          ObjectSize;      ///< Object size rounded up to 8 bytes
+  UINTN          PagesPerSlab;    ///< Pages allocated per slab
+  UINTN          ObjectsPerSlab;  ///< Objects that fit in one slab
+  SLAB_HEADER    *FirstSlab;      ///< Head of the slab chain
+  SLAB_HEADER    *CurrentSlab;    ///< Slab currently being carved
+  UINTN          NextObject;      ///< Next never-used object in CurrentSlab
+  VOID           *FreeList;       ///< Singly linked list of freed objects
+  UINTN          SlabCount;       ///< Slabs obtained from the firmware
+  UINTN          ActiveObjects;   ///< Objects currently allocated
+  UINTN          PeakObjects;     ///< High-water mark of ActiveObjects
+} SLAB_CACHE;
+
+///
+/// Bump allocator. Initialize with ArenaInit ().
+///
+typedef struct {
+  UINTN          BlockPages;      ///< Default pages per block
+  ARENA_BLOCK    *FirstBlock;     ///< Head of the block chain
+  ARENA_BLOCK    *CurrentBlock;   ///< Block currently being bumped
+  UINTN          Offset;          ///< Next free byte in CurrentBlock
+  UINTN          BlockCount;      ///< Blocks obtained from the firmware
+  UINTN          BytesAllocated;  ///< Bytes handed out since last reset
+} ARENA;
+
+/**
+  Initialize a slab cache for objects of a fixed size.
+
+  No memory is allocated until the first SlabAlloc ().
+
+  @param[out]  Cache         Cache to initialize.
+  @param[in]   ObjectSize    Size of each object in bytes.
+  @param[in]   PagesPerSlab  Pages per slab. 0 selects a default of 16.
+
+  @retval EFI_SUCCESS            The cache was initialized.
+  @retval EFI_INVALID_PARAMETER  Cache is NULL, ObjectSize is 0, or an object
+                                 does not fit in one slab.
+**/
+EFI_STATUS
+EFIAPI
+SlabCacheInit (
+  OUT SLAB_CACHE  *Cache,
+  IN  UINTN       ObjectSize,
+  IN  UINTN       PagesPerSlab
+  );
+
+/**
+  Allocate one object from a slab cache.
+
+  The returned memory is 8-byte aligned and not zeroed.
+
+  @param[in]  Cache  Cache to allocate from.
+
+  @return Pointer to the object, or NULL if a new slab could not be allocated.
+**/
+VOID *
+EFIAPI
+SlabAlloc (
+  IN SLAB_CACHE  *Cache
+  );
+
+/**
+  Return an object to its slab cache.
+
+  @param[in]  Cache   Cache the object was allocated from.
+  @param[in]  Object  Object to free. NULL is ignored.
+**/
+VOID
+EFIAPI
+SlabFree (
+  IN SLAB_CACHE  *Cache,
+  IN VOID        *Object
+  );
+
+/**
+  Free every object in a slab cache at once, keeping the slabs for reuse.
+
+  @param[in]  Cache  Cache to reset.
+**/
+VOID
+EFIAPI
+SlabCacheReset (
+  IN SLAB_CACHE  *Cache
+  );
+
+/**
+  Release all slabs back to the firmware.
+
+  @param[in]  Cache  Cache to destroy. It may be re-initialized afterwards.
+**/
+VOID
+EFIAPI
+SlabCacheDestroy (
+  IN SLAB_CACHE  *Cache
+  );
+
+/**
+  Initialize an arena.
+
+  No memory is allocated until the first ArenaAlloc ().
+
+  @param[out]  Arena       Arena to initialize.
+  @param[in]   BlockPages  Pages per block. 0 selects a default of 64.
+
+  @retval EFI_SUCCESS            The arena was initialized.
+  @retval EFI_INVALID_PARAMETER  Arena is NULL.
+**/
+EFI_STATUS
+EFIAPI
+ArenaInit (
+  OUT ARENA  *Arena,
+  IN  UINTN  BlockPages
+  );
+
+/**
+  Allocate memory from an arena.
+
+  Requests larger than a block get a dedicated block of sufficient size.
+
+  @param[in]  Arena      Arena to allocate from.
+  @param[in]  Size       Number of bytes.
+  @param[in]  Alignment  Required alignment, a power of two. 0 means 8.
+
+  @return Pointer to the memory, or NULL on failure.
+**/
+VOID *
+EFIAPI
+ArenaAlloc (
+  IN ARENA  *Arena,
+  IN UINTN  Size,
+  IN UINTN  Alignment
+  );
+
+/**
+  Free every allocation in an arena at once, keeping the blocks for reuse.
+
+  @param[in]  Arena  Arena to reset.
+**/
+VOID
+EFIAPI
+ArenaReset (
+  IN ARENA  *Arena
+  );
+
+/**
+  Release all arena blocks back to the firmware.
+
+  @param[in]  Arena  Arena to destroy. It may be re-initialized afterwards.
+**/
+VOID
+EFIAPI
+ArenaDestroy (
+  IN ARENA  *Arena
+  );
+
+#endif // SLAB_ARENA_LIB_H_
@@ -0,0 +1,437 @@
+/** @file
+  Async File Library implementation.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/AsyncFileLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+///
+/// One queued ReadEx () or WriteEx () request.
+///
+typedef struct {
+  EFI_FILE_IO_TOKEN    Token;
+  UINT8                *Data;
+  UINTN                Requested;
+  BOOLEAN              Pending;       ///< Submitted, result not yet collected
+} ASYNC_FILE_SLOT;
+
+/**
+  Create the completion events of all slots.
+**/
+STATIC
+EFI_STATUS
+CreateSlotEvents (
+  IN ASYNC_FILE_SLOT  *Slots
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < ASYNC_FILE_SLOTS; Index++) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Slots[Index].Token.Event);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Close whatever slot events were created.
+**/
+STATIC
+VOID
+CloseSlotEvents (
+  IN ASYNC_FILE_SLOT  *Slots
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ASYNC_FILE_SLOTS; Index++) {
+    if (Slots[Index].Token.Event != NULL) {
+      gBS->CloseEvent (Slots[Index].Token.Event);
+    }
+  }
+}
+
+/**
+  Queue one read or write. Without Async the transfer completes here and
+  its result is collected by WaitSlot () like an async one.
+**/
+STATIC
+EFI_STATUS
+SubmitSlot (
+  IN EFI_FILE_PROTOCOL  *File,
+  IN BOOLEAN            Async,
+  IN BOOLEAN            Write,
+  IN ASYNC_FILE_SLOT    *Slot,
+  IN UINT8              *Data,
+  IN UINTN              Length
+  )
+{
+  EFI_STATUS  Status;
+
+  Slot->Data             = Data;
+  Slot->Requested        = Length;
+  Slot->Token.Buffer     = Data;
+  Slot->Token.BufferSize = Length;
+  Slot->Token.Status     = EFI_SUCCESS;
+
+  if (Async) {
+    Status = Write ? File->WriteEx (File, &Slot->Token) : File->ReadEx (File, &Slot->Token);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  } else if (Write) {
+    Slot->Token.Status = File->Write (File, &Slot->Token.BufferSize, Data);
+  } else {
+    Slot->Token.Status = File->Read (File, &Slot->Token.BufferSize, Data);
+  }
+
+  Slot->Pending = TRUE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait for a submitted slot and return its transfer status.
+**/
+STATIC
+EFI_STATUS
+WaitSlot (
+  IN BOOLEAN          Async,
+  IN ASYNC_FILE_SLOT  *Slot
+  )
+{
+  UINTN  Index;
+
+  if (Async) {
+    gBS->WaitForEvent (1, &Slot->Token.Event, &Index);
+  }
+
+  Slot->Pending = FALSE;
+  return Slot->Token.Status;
+}
+
+/**
+  Report whether a file handle provides the revision 2 Ex functions.
+
+  @param[in]  File  File or directory handle.
+
+  @retval TRUE   OpenEx (), ReadEx (), WriteEx () and FlushEx () are used.
+  @retval FALSE  The library falls back to blocking I/O.
+**/
+BOOLEAN
+EFIAPI
+AsyncFileSupported (
+  IN EFI_FILE_PROTOCOL  *File
+  )
+{
+  return (BOOLEAN)(File->Revision >= EFI_FILE_PROTOCOL_REVISION2);
+}
+
+/**
+  Open a file with OpenEx (), or Open () on revision 1 volumes.
+
+  @param[in]   Root        Directory Path is relative to.
+  @param[out]  File        Receives the new handle.
+  @param[in]   Path        File to open.
+  @param[in]   OpenMode    EFI_FILE_MODE_* flags.
+  @param[in]   Attributes  Attributes for a newly created file.
+
+  @retval EFI_SUCCESS  The file is open.
+  @retval Others       The open failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileOpen (
+  IN  EFI_FILE_PROTOCOL  *Root,
+  OUT EFI_FILE_PROTOCOL  **File,
+  IN  CONST CHAR16       *Path,
+  IN  UINT64             OpenMode,
+  IN  UINT64             Attributes
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_IO_TOKEN  Token;
+  UINTN              Index;
+
+  if (!AsyncFileSupported (Root)) {
+    return Root->Open (Root, File, (CHAR16 *)Path, OpenMode, Attributes);
+  }
+
+  ZeroMem (&Token, sizeof (Token));
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Token.Event);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = Root->OpenEx (Root, File, (CHAR16 *)Path, OpenMode, Attributes, &Token);
+  if (!EFI_ERROR (Status)) {
+    gBS->WaitForEvent (1, &Token.Event, &Index);
+    Status = Token.Status;
+  }
+
+  gBS->CloseEvent (Token.Event);
+  return Status;
+}
+
+/**
+  Read from the current position in overlapped chunks.
+
+  With Buffer the data lands there contiguously and Process, if given,
+  sees each chunk in place. Without Buffer the library reads into two
+  chunk-sized page buffers in turn and Process is the only consumer.
+
+  @param[in]      File       File to read.
+  @param[in,out]  Size       Bytes to read on input, MAX_UINTN for the rest
+                             of the file when Buffer is NULL; bytes read on
+                             output.
+  @param[out]     Buffer     Destination of Size bytes. Optional.
+  @param[in]      ChunkSize  Bytes per request, 0 for ASYNC_FILE_DEFAULT_CHUNK.
+  @param[in]      Process    Called for every chunk in file order. Optional.
+  @param[in]      Context    Passed to Process.
+
+  @retval EFI_SUCCESS            The data was read and processed.
+  @retval EFI_INVALID_PARAMETER  Both Buffer and Process are NULL.
+  @retval EFI_OUT_OF_RESOURCES   Buffers or events could not be allocated.
+  @retval Others                 A read failed, or Process stopped the read.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileRead (
+  IN     EFI_FILE_PROTOCOL   *File,
+  IN OUT UINTN               *Size,
+  OUT    VOID                *Buffer OPTIONAL,
+  IN     UINTN               ChunkSize,
+  IN     ASYNC_FILE_PROCESS  Process OPTIONAL,
+  IN     VOID                *Context OPTIONAL
+  )
+{
+  EFI_STATUS       Status;
+  EFI_STATUS       ReadStatus;
+  ASYNC_FILE_SLOT  Slots[ASYNC_FILE_SLOTS];
+  ASYNC_FILE_SLOT  *Slot;
+  BOOLEAN          Async;
+  BOOLEAN          EndOfFile;
+  UINT8            *Staging;
+  UINTN            StagingPages;
+  UINTN            Wanted;
+  UINTN            Submitted;
+  UINTN            Length;
+  UINTN            Next;
+  UINTN            Oldest;
+
+  if ((Buffer == NULL) && (Process == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (ChunkSize == 0) {
+    ChunkSize = ASYNC_FILE_DEFAULT_CHUNK;
+  }
+
+  Wanted = *Size;
+  *Size  = 0;
+  ZeroMem (Slots, sizeof (Slots));
+
+  //
+  // Without a destination the slots alternate between two staging chunks
+  //
+  Staging      = NULL;
+  StagingPages = 0;
+  if (Buffer == NULL) {
+    ChunkSize    = ALIGN_VALUE (ChunkSize, EFI_PAGE_SIZE);
+    StagingPages = EFI_SIZE_TO_PAGES (ChunkSize) * ASYNC_FILE_SLOTS;
+    Staging      = AllocatePages (StagingPages);
+    if (Staging == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Async  = AsyncFileSupported (File);
+  Status = Async ? CreateSlotEvents (Slots) : EFI_SUCCESS;
+
+  EndOfFile = FALSE;
+  Submitted = 0;
+  Next      = 0;
+  Oldest    = 0;
+
+  while (TRUE) {
+    //
+    // Keep every idle slot reading the next chunk
+    //
+    while (!EFI_ERROR (Status) && !EndOfFile && (Submitted < Wanted) && !Slots[Next].Pending) {
+      Length = MIN (ChunkSize, Wanted - Submitted);
+      Status = SubmitSlot (
+                 File,
+                 Async,
+                 FALSE,
+                 &Slots[Next],
+                 (Buffer != NULL) ? (UINT8 *)Buffer + Submitted : Staging + Next * ChunkSize,
+                 Length
+                 );
+      Submitted += Length;
+      Next       = (Next + 1) % ASYNC_FILE_SLOTS;
+    }
+
+    //
+    // Pending slots always follow Oldest in order, so this also drains
+    // the queue after an error
+    //
+    Slot = &Slots[Oldest];
+    if (!Slot->Pending) {
+      break;
+    }
+
+    ReadStatus = WaitSlot (Async, Slot);
+    Oldest     = (Oldest + 1) % ASYNC_FILE_SLOTS;
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    if (EFI_ERROR (ReadStatus)) {
+      Status = ReadStatus;
+      continue;
+    }
+
+    Length = Slot->Token.BufferSize;
+    if (Length < Slot->Requested) {
+      EndOfFile = TRUE;
+    }
+
+    *Size += Length;
+    if ((Length > 0) && (Process != NULL)) {
+      Status = Process (Context, Slot->Data, Length);
+    }
+  }
+
+  CloseSlotEvents (Slots);
+  if (Staging != NULL) {
+    FreePages (Staging, StagingPages);
+  }
+
+  return Status;
+}
+
+/**
+  Write at the current position in overlapped chunks.
+
+  Buffer must stay unchanged until the call returns.
+
+  @param[in]      File       File to write.
+  @param[in,out]  Size       Bytes to write on input; bytes written on output.
+  @param[in]      Buffer     Data to write.
+  @param[in]      ChunkSize  Bytes per request, 0 for ASYNC_FILE_DEFAULT_CHUNK.
+
+  @retval EFI_SUCCESS           All data was written.
+  @retval EFI_OUT_OF_RESOURCES  Events could not be created.
+  @retval Others                A write failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileWrite (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT UINTN              *Size,
+  IN     CONST VOID         *Buffer,
+  IN     UINTN              ChunkSize
+  )
+{
+  EFI_STATUS       Status;
+  EFI_STATUS       WriteStatus;
+  ASYNC_FILE_SLOT  Slots[ASYNC_FILE_SLOTS];
+  ASYNC_FILE_SLOT  *Slot;
+  BOOLEAN          Async;
+  UINTN            Wanted;
+  UINTN            Submitted;
+  UINTN            Length;
+  UINTN            Next;
+  UINTN            Oldest;
+
+  if (ChunkSize == 0) {
+    ChunkSize = ASYNC_FILE_DEFAULT_CHUNK;
+  }
+
+  Wanted = *Size;
+  *Size  = 0;
+  ZeroMem (Slots, sizeof (Slots));
+
+  Async  = AsyncFileSupported (File);
+  Status = Async ? CreateSlotEvents (Slots) : EFI_SUCCESS;
+
+  Submitted = 0;
+  Next      = 0;
+  Oldest    = 0;
+
+  while (TRUE) {
+    while (!EFI_ERROR (Status) && (Submitted < Wanted) && !Slots[Next].Pending) {
+      Length     = MIN (ChunkSize, Wanted - Submitted);
+      Status     = SubmitSlot (File, Async, TRUE, &Slots[Next], (UINT8 *)Buffer + Submitted, Length);
+      Submitted += Length;
+      Next       = (Next + 1) % ASYNC_FILE_SLOTS;
+    }
+
+    Slot = &Slots[Oldest];
+    if (!Slot->Pending) {
+      break;
+    }
+
+    WriteStatus = WaitSlot (Async, Slot);
+    Oldest      = (Oldest + 1) % ASYNC_FILE_SLOTS;
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    *Size += Slot->Token.BufferSize;
+    if (EFI_ERROR (WriteStatus)) {
+      Status = WriteStatus;
+    }
+  }
+
+  CloseSlotEvents (Slots);
+  return Status;
+}
+
+/**
+  Flush a file with FlushEx (), or Flush () on revision 1 volumes.
+
+  @param[in]  File  File to flush.
+
+  @retval EFI_SUCCESS  The file was flushed.
+  @retval Others       The flush failed.
+**/
+EFI_STATUS
+EFIAPI
+AsyncFileFlush (
+  IN EFI_FILE_PROTOCOL  *File
+  )
+{
+  EFI_STATUS         Status;
+  EFI_FILE_IO_TOKEN  Token;
+  UINTN              Index;
+
+  if (!AsyncFileSupported (File)) {
+    return File->Flush (File);
+  }
+
+  ZeroMem (&Token, sizeof (Token));
+  Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Token.Event);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = File->FlushEx (File, &Token);
+  if (!EFI_ERROR (Status)) {
+    gBS->WaitForEvent (1, &Token.Event, &Index);
+    Status = Token.Status;
+  }
+
+  gBS->CloseEvent (Token.Event);
+  return Status;
+}
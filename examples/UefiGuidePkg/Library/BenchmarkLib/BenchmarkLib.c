@@ -0,0 +1,223 @@
+/** @file
+  Benchmark Library - timing helpers shared by the UEFI Guide examples.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SortLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+//
+// Calibration interval in microseconds
+//
+#define CALIBRATION_US  10000
+
+STATIC UINT64   mFrequency;
+STATIC BOOLEAN  mCountsDown;
+STATIC BOOLEAN  mCalibrated;
+
+/**
+  Measure the counter frequency against the firmware Stall () service.
+**/
+STATIC
+VOID
+CalibrateCounter (
+  VOID
+  )
+{
+  UINT64  Start;
+  UINT64  End;
+  UINT64  Delta;
+
+  Start = GetPerformanceCounter ();
+  gBS->Stall (CALIBRATION_US);
+  End = GetPerformanceCounter ();
+
+  mCountsDown = (BOOLEAN)(End < Start);
+  Delta       = mCountsDown ? Start - End : End - Start;
+  mFrequency  = DivU64x32 (MultU64x32 (Delta, 1000000), CALIBRATION_US);
+  mCalibrated = TRUE;
+
+  DEBUG ((DEBUG_INFO, "BenchmarkLib: counter frequency %ld Hz\n", mFrequency));
+}
+
+/**
+  Read the raw performance counter.
+
+  @return Current counter value in ticks.
+**/
+UINT64
+EFIAPI
+BenchmarkGetTicks (
+  VOID
+  )
+{
+  return GetPerformanceCounter ();
+}
+
+/**
+  Return the calibrated performance counter frequency.
+
+  @return Counter frequency in Hz, or 0 if the counter does not advance.
+**/
+UINT64
+EFIAPI
+BenchmarkGetFrequency (
+  VOID
+  )
+{
+  if (!mCalibrated) {
+    CalibrateCounter ();
+  }
+
+  return mFrequency;
+}
+
+/**
+  Convert a tick count to nanoseconds.
+
+  @param[in]  Ticks   Number of counter ticks.
+
+  @return Equivalent time in nanoseconds.
+**/
+UINT64
+EFIAPI
+BenchmarkTicksToNs (
+  IN UINT64  Ticks
+  )
+{
+  UINT64  Frequency;
+  UINT64  Seconds;
+  UINT64  Remainder;
+
+  Frequency = BenchmarkGetFrequency ();
+  if (Frequency == 0) {
+    return 0;
+  }
+
+  //
+  // Split into whole seconds and remainder so Ticks * 10^9 cannot overflow
+  //
+  Seconds = DivU64x64Remainder (Ticks, Frequency, &Remainder);
+  return MultU64x32 (Seconds, 1000000000) +
+         DivU64x64Remainder (MultU64x32 (Remainder, 1000000000), Frequency, NULL);
+}
+
+/**
+  Return the time between two counter samples in nanoseconds.
+
+  @param[in]  StartTicks  Value returned by BenchmarkGetTicks () at start.
+  @param[in]  EndTicks    Value returned by BenchmarkGetTicks () at end.
+
+  @return Elapsed time in nanoseconds.
+**/
+UINT64
+EFIAPI
+BenchmarkElapsedNs (
+  IN UINT64  StartTicks,
+  IN UINT64  EndTicks
+  )
+{
+  if (!mCalibrated) {
+    CalibrateCounter ();
+  }
+
+  if (mCountsDown) {
+    return BenchmarkTicksToNs (StartTicks - EndTicks);
+  }
+
+  return BenchmarkTicksToNs (EndTicks - StartTicks);
+}
+
+/**
+  Compute throughput in MB/s (10^6 bytes per second).
+
+  @param[in]  Bytes   Number of bytes transferred.
+  @param[in]  Ns      Time taken in nanoseconds.
+
+  @return Throughput in MB/s, or 0 if Ns is 0.
+**/
+UINT64
+EFIAPI
+BenchmarkMBps (
+  IN UINT64  Bytes,
+  IN UINT64  Ns
+  )
+{
+  if (Ns == 0) {
+    return 0;
+  }
+
+  return DivU64x64Remainder (MultU64x32 (Bytes, 1000), Ns, NULL);
+}
+
+/**
+  Compare two UINT64 samples for PerformQuickSort ().
+**/
+STATIC
+INTN
+EFIAPI
+CompareSamples (
+  IN CONST VOID  *Buffer1,
+  IN CONST VOID  *Buffer2
+  )
+{
+  UINT64  Left;
+  UINT64  Right;
+
+  Left  = *(CONST UINT64 *)Buffer1;
+  Right = *(CONST UINT64 *)Buffer2;
+
+  if (Left < Right) {
+    return -1;
+  }
+
+  return (Left > Right) ? 1 : 0;
+}
+
+/**
+  Sort latency samples in place and summarize them.
+
+  @param[in, out]  Samples  Array of samples in nanoseconds. Sorted on return.
+  @param[in]       Count    Number of samples.
+  @param[out]      Stats    Receives min, mean, p50, p99 and max.
+**/
+VOID
+EFIAPI
+BenchmarkComputeStats (
+  IN OUT UINT64           *Samples,
+  IN     UINTN            Count,
+  OUT    BENCHMARK_STATS  *Stats
+  )
+{
+  UINT64  Sum;
+  UINTN   Index;
+
+  ASSERT (Stats != NULL);
+
+  ZeroMem (Stats, sizeof (*Stats));
+  Stats->Count = Count;
+  if ((Samples == NULL) || (Count == 0)) {
+    return;
+  }
+
+  PerformQuickSort (Samples, Count, sizeof (UINT64), CompareSamples);
+
+  Sum = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Sum += Samples[Index];
+  }
+
+  Stats->Min  = Samples[0];
+  Stats->Max  = Samples[Count - 1];
+  Stats->Mean = DivU64x64Remainder (Sum, Count, NULL);
+  Stats->P50  = Samples[(Count - 1) / 2];
+  Stats->P99  = Samples[((Count - 1) * 99) / 100];
+}
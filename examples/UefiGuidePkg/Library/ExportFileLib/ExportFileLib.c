@@ -0,0 +1,121 @@
+/** @file
+  Export File Library - write report files next to the running image.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/ExportFileLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/PrintLib.h>
+#include <Protocol/LoadedImage.h>
+
+/**
+  Create (or truncate) a file in the root of the volume this image was
+  loaded from.
+
+  @param[in]   ImageHandle  Image handle of the running application.
+  @param[in]   FileName     Root-relative path of the file.
+  @param[out]  File         Receives the open file. Close it when done.
+
+  @retval EFI_SUCCESS  The file is open for writing and empty.
+  @retval Others       The image has no file system or the file could not
+                       be created.
+**/
+EFI_STATUS
+EFIAPI
+OpenBootVolumeFile (
+  IN  EFI_HANDLE         ImageHandle,
+  IN  CHAR16             *FileName,
+  OUT EFI_FILE_PROTOCOL  **File
+  )
+{
+  EFI_STATUS                       Status;
+  EFI_LOADED_IMAGE_PROTOCOL        *LoadedImage;
+  EFI_SIMPLE_FILE_SYSTEM_PROTOCOL  *FileSystem;
+  EFI_FILE_PROTOCOL                *Root;
+  EFI_FILE_PROTOCOL                *Existing;
+
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiLoadedImageProtocolGuid,
+                  (VOID **)&LoadedImage
+                  );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gBS->HandleProtocol (
+                  LoadedImage->DeviceHandle,
+                  &gEfiSimpleFileSystemProtocolGuid,
+                  (VOID **)&FileSystem
+                  );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = FileSystem->OpenVolume (FileSystem, &Root);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Delete any previous copy so stale data past the new end is not kept
+  //
+  Status = Root->Open (
+                   Root,
+                   &Existing,
+                   FileName,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE,
+                   0
+                   );
+
+  if (!EFI_ERROR (Status)) {
+    Existing->Delete (Existing);
+  }
+
+  Status = Root->Open (
+                   Root,
+                   File,
+                   FileName,
+                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+                   0
+                   );
+
+  Root->Close (Root);
+  return Status;
+}
+
+/**
+  Write a formatted ASCII line to a file.
+
+  Output longer than 511 characters is truncated.
+
+  @param[in]  File    File to write.
+  @param[in]  Format  AsciiSPrint () format string.
+  @param[in]  ...     Arguments for Format.
+
+  @retval EFI_SUCCESS  The text was written.
+  @retval Others       File->Write () failed.
+**/
+EFI_STATUS
+EFIAPI
+FilePrint (
+  IN EFI_FILE_PROTOCOL  *File,
+  IN CONST CHAR8        *Format,
+  ...
+  )
+{
+  VA_LIST  Marker;
+  CHAR8    Line[512];
+  UINTN    Length;
+
+  VA_START (Marker, Format);
+  Length = AsciiVSPrint (Line, sizeof (Line), Format, Marker);
+  VA_END (Marker);
+
+  return File->Write (File, &Length, Line);
+}
@@ -0,0 +1,907 @@
+/** @file
+  Memory Map Library implementation.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/MemoryMapLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+
+//
+// Extra descriptors to allow for the map growing between the size query and
+// the real call (the pool allocation itself can split a region)
+//
+#define MEMORY_MAP_SLACK_DESCRIPTORS  8
+
+//
+// CSV export is staged in one buffer and written out whenever less than a
+// worst-case row of space is left
+//
+#define MEMORY_MAP_CSV_BUFFER_SIZE  SIZE_64KB
+#define MEMORY_MAP_CSV_MAX_ROW      160
+
+/**
+  Get the current memory map in a newly allocated pool buffer.
+
+  @param[out]  MemoryMap          Receives the map. Free with FreePool ().
+  @param[out]  MemoryMapSize      Receives the size of the map in bytes.
+  @param[out]  MapKey             Receives the map key.
+  @param[out]  DescriptorSize     Receives the size of one descriptor.
+  @param[out]  DescriptorVersion  Receives the descriptor version. Optional.
+
+  @retval EFI_SUCCESS           The map was returned.
+  @retval EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+  @retval Others                GetMemoryMap () failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapGet (
+  OUT EFI_MEMORY_DESCRIPTOR  **MemoryMap,
+  OUT UINTN                  *MemoryMapSize,
+  OUT UINTN                  *MapKey,
+  OUT UINTN                  *DescriptorSize,
+  OUT UINT32                 *DescriptorVersion OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+  UINT32      Version;
+
+  *MemoryMap     = NULL;
+  *MemoryMapSize = 0;
+
+  do {
+    Status = gBS->GetMemoryMap (
+                    MemoryMapSize,
+                    *MemoryMap,
+                    MapKey,
+                    DescriptorSize,
+                    &Version
+                    );
+
+    if (Status == EFI_BUFFER_TOO_SMALL) {
+      if (*MemoryMap != NULL) {
+        FreePool (*MemoryMap);
+      }
+
+      *MemoryMapSize += MEMORY_MAP_SLACK_DESCRIPTORS * (*DescriptorSize);
+      *MemoryMap      = AllocatePool (*MemoryMapSize);
+      if (*MemoryMap == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+    }
+  } while (Status == EFI_BUFFER_TOO_SMALL);
+
+  if (EFI_ERROR (Status)) {
+    if (*MemoryMap != NULL) {
+      FreePool (*MemoryMap);
+      *MemoryMap = NULL;
+    }
+
+    return Status;
+  }
+
+  if (DescriptorVersion != NULL) {
+    *DescriptorVersion = Version;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Sort regions by start address.
+
+  Firmware maps are normally already sorted, so insertion sort runs in
+  close to linear time here.
+**/
+STATIC
+VOID
+SortRegions (
+  IN OUT MEMORY_MAP_REGION  *Regions,
+  IN     UINTN              Count
+  )
+{
+  MEMORY_MAP_REGION  Key;
+  UINTN              Index;
+  UINTN              Slot;
+
+  for (Index = 1; Index < Count; Index++) {
+    if (Regions[Index - 1].Start <= Regions[Index].Start) {
+      continue;
+    }
+
+    CopyMem (&Key, &Regions[Index], sizeof (Key));
+    for (Slot = Index; Slot > 0 && Regions[Slot - 1].Start > Key.Start; Slot--) {
+      CopyMem (&Regions[Slot], &Regions[Slot - 1], sizeof (Key));
+    }
+
+    CopyMem (&Regions[Slot], &Key, sizeof (Key));
+  }
+}
+
+/**
+  Capture the current memory map into a snapshot.
+
+  @param[out]  Snapshot  Snapshot to fill. Release with MemoryMapSnapshotFree ().
+
+  @retval EFI_SUCCESS           The snapshot was captured.
+  @retval EFI_OUT_OF_RESOURCES  Memory for the snapshot could not be allocated.
+  @retval Others                GetMemoryMap () failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotCapture (
+  OUT MEMORY_MAP_SNAPSHOT  *Snapshot
+  )
+{
+  EFI_STATUS             Status;
+  EFI_MEMORY_DESCRIPTOR  *Entry;
+  MEMORY_MAP_REGION      *Region;
+  MEMORY_MAP_REGION      *Last;
+  UINTN                  Index;
+
+  ASSERT (Snapshot != NULL);
+
+  ZeroMem (Snapshot, sizeof (*Snapshot));
+
+  Status = MemoryMapGet (
+             &Snapshot->RawMap,
+             &Snapshot->RawMapSize,
+             &Snapshot->MapKey,
+             &Snapshot->DescriptorSize,
+             &Snapshot->DescriptorVersion
+             );
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Snapshot->DescriptorCount = Snapshot->RawMapSize / Snapshot->DescriptorSize;
+
+  Snapshot->Regions = AllocatePool (Snapshot->DescriptorCount * sizeof (MEMORY_MAP_REGION));
+  if (Snapshot->Regions == NULL) {
+    MemoryMapSnapshotFree (Snapshot);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Copy out of the variable-stride descriptor array and tally per type
+  //
+  Entry = Snapshot->RawMap;
+  for (Index = 0; Index < Snapshot->DescriptorCount; Index++) {
+    Region                  = &Snapshot->Regions[Index];
+    Region->Start           = Entry->PhysicalStart;
+    Region->NumberOfPages   = Entry->NumberOfPages;
+    Region->Attribute       = Entry->Attribute;
+    Region->Type            = Entry->Type;
+    Region->DescriptorCount = 1;
+
+    if (Entry->Type < EfiMaxMemoryType) {
+      Snapshot->PagesByType[Entry->Type] += Entry->NumberOfPages;
+    }
+
+    Snapshot->TotalPages += Entry->NumberOfPages;
+
+    Entry = NEXT_MEMORY_DESCRIPTOR (Entry, Snapshot->DescriptorSize);
+  }
+
+  SortRegions (Snapshot->Regions, Snapshot->DescriptorCount);
+
+  //
+  // Coalesce physically adjacent regions with the same type and attributes
+  //
+  Last = NULL;
+  for (Index = 0; Index < Snapshot->DescriptorCount; Index++) {
+    Region = &Snapshot->Regions[Index];
+    if ((Last != NULL) &&
+        (Last->Type == Region->Type) &&
+        (Last->Attribute == Region->Attribute) &&
+        (Last->Start + EFI_PAGES_TO_SIZE (Last->NumberOfPages) == Region->Start))
+    {
+      Last->NumberOfPages   += Region->NumberOfPages;
+      Last->DescriptorCount += Region->DescriptorCount;
+      continue;
+    }
+
+    Last = &Snapshot->Regions[Snapshot->RegionCount++];
+    if (Last != Region) {
+      CopyMem (Last, Region, sizeof (*Last));
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release the buffers held by a snapshot.
+
+  @param[in, out]  Snapshot  Snapshot to release. Zeroed on return.
+**/
+VOID
+EFIAPI
+MemoryMapSnapshotFree (
+  IN OUT MEMORY_MAP_SNAPSHOT  *Snapshot
+  )
+{
+  ASSERT (Snapshot != NULL);
+
+  if (Snapshot->RawMap != NULL) {
+    FreePool (Snapshot->RawMap);
+  }
+
+  if (Snapshot->Regions != NULL) {
+    FreePool (Snapshot->Regions);
+  }
+
+  ZeroMem (Snapshot, sizeof (*Snapshot));
+}
+
+/**
+  Find the region containing a physical address.
+
+  @param[in]  Snapshot  Snapshot to search.
+  @param[in]  Address   Physical address to look up.
+
+  @return The containing region, or NULL if no region covers Address.
+**/
+CONST MEMORY_MAP_REGION *
+EFIAPI
+MemoryMapSnapshotFind (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_PHYSICAL_ADDRESS       Address
+  )
+{
+  CONST MEMORY_MAP_REGION  *Region;
+  UINTN                    Low;
+  UINTN                    High;
+  UINTN                    Middle;
+
+  ASSERT (Snapshot != NULL);
+
+  //
+  // Find the last region starting at or below Address
+  //
+  Low  = 0;
+  High = Snapshot->RegionCount;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (Snapshot->Regions[Middle].Start <= Address) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  if (Low == 0) {
+    return NULL;
+  }
+
+  Region = &Snapshot->Regions[Low - 1];
+  if (Address - Region->Start >= EFI_PAGES_TO_SIZE (Region->NumberOfPages)) {
+    return NULL;
+  }
+
+  return Region;
+}
+
+/**
+  Return the total pages of one memory type in a snapshot.
+
+  @param[in]  Snapshot  Snapshot to query.
+  @param[in]  Type      Memory type.
+
+  @return Number of pages of that type.
+**/
+UINT64
+EFIAPI
+MemoryMapSnapshotTypePages (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN UINT32                     Type
+  )
+{
+  UINT64  Pages;
+  UINTN   Index;
+
+  ASSERT (Snapshot != NULL);
+
+  if (Type < EfiMaxMemoryType) {
+    return Snapshot->PagesByType[Type];
+  }
+
+  //
+  // OEM and OS-reserved types are not tallied; count them on demand
+  //
+  Pages = 0;
+  for (Index = 0; Index < Snapshot->RegionCount; Index++) {
+    if (Snapshot->Regions[Index].Type == Type) {
+      Pages += Snapshot->Regions[Index].NumberOfPages;
+    }
+  }
+
+  return Pages;
+}
+
+/**
+  Return the exclusive end address of a region.
+**/
+STATIC
+EFI_PHYSICAL_ADDRESS
+RegionEnd (
+  IN CONST MEMORY_MAP_REGION  *Region
+  )
+{
+  return Region->Start + EFI_PAGES_TO_SIZE (Region->NumberOfPages);
+}
+
+/**
+  Append one change to a diff.
+**/
+STATIC
+VOID
+AddChange (
+  IN OUT MEMORY_MAP_DIFF          *Diff,
+  IN     MEMORY_MAP_CHANGE_KIND   Kind,
+  IN     CONST MEMORY_MAP_REGION  *Old OPTIONAL,
+  IN     CONST MEMORY_MAP_REGION  *New OPTIONAL,
+  IN     UINTN                    Pieces
+  )
+{
+  MEMORY_MAP_CHANGE  *Change;
+
+  Change = &Diff->Changes[Diff->ChangeCount++];
+  ZeroMem (Change, sizeof (*Change));
+  Change->Kind   = Kind;
+  Change->Pieces = Pieces;
+
+  if (Old != NULL) {
+    CopyMem (&Change->Old, Old, sizeof (Change->Old));
+  }
+
+  if (New != NULL) {
+    CopyMem (&Change->New, New, sizeof (Change->New));
+  }
+}
+
+/**
+  Compare two snapshots.
+
+  @param[in]   Old   Earlier snapshot.
+  @param[in]   New   Later snapshot.
+  @param[out]  Diff  Receives the changes. Release with MemoryMapDiffFree ().
+
+  @retval EFI_SUCCESS           The diff was computed.
+  @retval EFI_OUT_OF_RESOURCES  Memory for the diff could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotDiff (
+  IN  CONST MEMORY_MAP_SNAPSHOT  *Old,
+  IN  CONST MEMORY_MAP_SNAPSHOT  *New,
+  OUT MEMORY_MAP_DIFF            *Diff
+  )
+{
+  CONST MEMORY_MAP_REGION  *OldRegion;
+  CONST MEMORY_MAP_REGION  *NewRegion;
+  UINTN                    *OldOverlaps;
+  UINTN                    *OldFirst;
+  UINTN                    *NewOverlaps;
+  UINTN                    *NewFirst;
+  UINTN                    OldIndex;
+  UINTN                    NewIndex;
+  EFI_PHYSICAL_ADDRESS     OverlapStart;
+  EFI_PHYSICAL_ADDRESS     OverlapEnd;
+
+  ASSERT (Old != NULL);
+  ASSERT (New != NULL);
+  ASSERT (Diff != NULL);
+
+  ZeroMem (Diff, sizeof (*Diff));
+  Diff->DescriptorDelta = (INTN)New->DescriptorCount - (INTN)Old->DescriptorCount;
+  Diff->RegionDelta     = (INTN)New->RegionCount - (INTN)Old->RegionCount;
+
+  //
+  // Each region yields at most one change, so Old + New entries is enough
+  //
+  Diff->Changes = AllocatePool ((Old->RegionCount + New->RegionCount + 1) * sizeof (MEMORY_MAP_CHANGE));
+  OldOverlaps   = AllocateZeroPool ((Old->RegionCount + New->RegionCount + 1) * 2 * sizeof (UINTN));
+  if ((Diff->Changes == NULL) || (OldOverlaps == NULL)) {
+    if (OldOverlaps != NULL) {
+      FreePool (OldOverlaps);
+    }
+
+    MemoryMapDiffFree (Diff);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  OldFirst    = OldOverlaps + Old->RegionCount;
+  NewOverlaps = OldFirst + Old->RegionCount;
+  NewFirst    = NewOverlaps + New->RegionCount;
+
+  //
+  // Both region arrays are sorted and non-overlapping, so one merge-style
+  // sweep finds every overlapping (old, new) pair
+  //
+  OldIndex = 0;
+  NewIndex = 0;
+  while ((OldIndex < Old->RegionCount) && (NewIndex < New->RegionCount)) {
+    OldRegion    = &Old->Regions[OldIndex];
+    NewRegion    = &New->Regions[NewIndex];
+    OverlapStart = MAX (OldRegion->Start, NewRegion->Start);
+    OverlapEnd   = MIN (RegionEnd (OldRegion), RegionEnd (NewRegion));
+
+    if (OverlapStart < OverlapEnd) {
+      if (OldOverlaps[OldIndex]++ == 0) {
+        OldFirst[OldIndex] = NewIndex;
+      }
+
+      if (NewOverlaps[NewIndex]++ == 0) {
+        NewFirst[NewIndex] = OldIndex;
+      }
+
+      if ((OldRegion->Type != NewRegion->Type) &&
+          (OldRegion->Type < EfiMaxMemoryType) &&
+          (NewRegion->Type < EfiMaxMemoryType))
+      {
+        Diff->Transitions[OldRegion->Type][NewRegion->Type] +=
+          EFI_SIZE_TO_PAGES (OverlapEnd - OverlapStart);
+      }
+    }
+
+    if (RegionEnd (OldRegion) <= RegionEnd (NewRegion)) {
+      OldIndex++;
+    } else {
+      NewIndex++;
+    }
+  }
+
+  //
+  // Classify from the old side: vanished, split, retyped or resized
+  //
+  for (OldIndex = 0; OldIndex < Old->RegionCount; OldIndex++) {
+    OldRegion = &Old->Regions[OldIndex];
+    if (OldOverlaps[OldIndex] == 0) {
+      AddChange (Diff, MemoryMapChangeVanished, OldRegion, NULL, 0);
+      continue;
+    }
+
+    NewRegion = &New->Regions[OldFirst[OldIndex]];
+    if (OldOverlaps[OldIndex] > 1) {
+      AddChange (Diff, MemoryMapChangeSplit, OldRegion, NewRegion, OldOverlaps[OldIndex]);
+      continue;
+    }
+
+    if (NewOverlaps[OldFirst[OldIndex]] > 1) {
+      //
+      // Reported once from the new side as a merge
+      //
+      continue;
+    }
+
+    if ((OldRegion->Start != NewRegion->Start) ||
+        (OldRegion->NumberOfPages != NewRegion->NumberOfPages))
+    {
+      AddChange (Diff, MemoryMapChangeResized, OldRegion, NewRegion, 1);
+    } else if ((OldRegion->Type != NewRegion->Type) ||
+               (OldRegion->Attribute != NewRegion->Attribute))
+    {
+      AddChange (Diff, MemoryMapChangeTypeChanged, OldRegion, NewRegion, 1);
+    }
+  }
+
+  //
+  // New side: appeared and merged
+  //
+  for (NewIndex = 0; NewIndex < New->RegionCount; NewIndex++) {
+    NewRegion = &New->Regions[NewIndex];
+    if (NewOverlaps[NewIndex] == 0) {
+      AddChange (Diff, MemoryMapChangeAppeared, NULL, NewRegion, 0);
+    } else if (NewOverlaps[NewIndex] > 1) {
+      AddChange (
+        Diff,
+        MemoryMapChangeMerged,
+        &Old->Regions[NewFirst[NewIndex]],
+        NewRegion,
+        NewOverlaps[NewIndex]
+        );
+    }
+  }
+
+  FreePool (OldOverlaps);
+  return EFI_SUCCESS;
+}
+
+/**
+  Release the buffers held by a diff.
+
+  @param[in, out]  Diff  Diff to release. Zeroed on return.
+**/
+VOID
+EFIAPI
+MemoryMapDiffFree (
+  IN OUT MEMORY_MAP_DIFF  *Diff
+  )
+{
+  ASSERT (Diff != NULL);
+
+  if (Diff->Changes != NULL) {
+    FreePool (Diff->Changes);
+  }
+
+  ZeroMem (Diff, sizeof (*Diff));
+}
+
+/**
+  Claim Pages at the highest Alignment boundary that fits inside a free
+  EfiConventionalMemory region of the current memory map.
+**/
+STATIC
+EFI_STATUS
+AllocateFromFreeRegion (
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 Pages,
+  IN  UINT64                Alignment,
+  OUT EFI_PHYSICAL_ADDRESS  *Address
+  )
+{
+  EFI_STATUS               Status;
+  MEMORY_MAP_SNAPSHOT      Snapshot;
+  CONST MEMORY_MAP_REGION  *Region;
+  UINT64                   Size;
+  EFI_PHYSICAL_ADDRESS     End;
+  EFI_PHYSICAL_ADDRESS     Candidate;
+  UINTN                    Index;
+
+  Status = MemoryMapSnapshotCapture (&Snapshot);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Walk down from the top, as AllocateAnyPages does, so low memory that
+  // legacy devices and the OS loader care about is left alone
+  //
+  Size   = EFI_PAGES_TO_SIZE ((UINT64)Pages);
+  Status = EFI_NOT_FOUND;
+  for (Index = Snapshot.RegionCount; Index > 0; Index--) {
+    Region = &Snapshot.Regions[Index - 1];
+    if ((Region->Type != EfiConventionalMemory) ||
+        (Region->NumberOfPages < Pages))
+    {
+      continue;
+    }
+
+    End = RegionEnd (Region);
+    if (End - 1 > MAX_ADDRESS) {
+      End = (EFI_PHYSICAL_ADDRESS)MAX_ADDRESS + 1;
+    }
+
+    if (End < Region->Start + Size) {
+      continue;
+    }
+
+    Candidate = (End - Size) & ~(Alignment - 1);
+    if (Candidate < Region->Start) {
+      continue;
+    }
+
+    //
+    // The snapshot may already be stale; AllocateAddress re-checks the range
+    //
+    Status = gBS->AllocatePages (AllocateAddress, MemoryType, Pages, &Candidate);
+    if (!EFI_ERROR (Status)) {
+      *Address = Candidate;
+      break;
+    }
+  }
+
+  MemoryMapSnapshotFree (&Snapshot);
+  return Status;
+}
+
+/**
+  Allocate Pages plus Alignment slack and return the aligned part to the
+  caller, freeing the unaligned head and the unused tail.
+**/
+STATIC
+EFI_STATUS
+AllocateAndTrim (
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 Pages,
+  IN  UINT64                Alignment,
+  OUT EFI_PHYSICAL_ADDRESS  *Address
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Memory;
+  EFI_PHYSICAL_ADDRESS  Aligned;
+  UINTN                 SlackPages;
+  UINTN                 HeadPages;
+
+  SlackPages = (UINTN)EFI_SIZE_TO_PAGES (Alignment);
+  if (Pages > MAX_UINTN - SlackPages) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = gBS->AllocatePages (AllocateAnyPages, MemoryType, Pages + SlackPages, &Memory);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Aligned   = (Memory + Alignment - 1) & ~(Alignment - 1);
+  HeadPages = (UINTN)EFI_SIZE_TO_PAGES (Aligned - Memory);
+  if (HeadPages != 0) {
+    gBS->FreePages (Memory, HeadPages);
+  }
+
+  if (SlackPages > HeadPages) {
+    gBS->FreePages (Aligned + EFI_PAGES_TO_SIZE (Pages), SlackPages - HeadPages);
+  }
+
+  *Address = Aligned;
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate pages aligned for large-page mappings.
+
+  @param[in]   MemoryType  Memory type of the allocation, e.g. EfiLoaderData.
+  @param[in]   Pages       Number of 4 KB pages to allocate.
+  @param[out]  Address     Receives the base address. Free with gBS->FreePages ().
+  @param[out]  Alignment   Receives the alignment achieved. Optional.
+
+  @retval EFI_SUCCESS            The pages were allocated.
+  @retval EFI_INVALID_PARAMETER  Pages is 0 or Address is NULL.
+  @retval EFI_OUT_OF_RESOURCES   The pages could not be allocated.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapAllocateLargePages (
+  IN  EFI_MEMORY_TYPE       MemoryType,
+  IN  UINTN                 Pages,
+  OUT EFI_PHYSICAL_ADDRESS  *Address,
+  OUT UINTN                 *Alignment OPTIONAL
+  )
+{
+  STATIC CONST UINT64  LargePageSizes[] = { SIZE_1GB, SIZE_2MB };
+  EFI_STATUS           Status;
+  UINT64               Size;
+  UINTN                Index;
+
+  if ((Pages == 0) || (Address == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Size = EFI_PAGES_TO_SIZE ((UINT64)Pages);
+  for (Index = 0; Index < ARRAY_SIZE (LargePageSizes); Index++) {
+    //
+    // A large page only helps if the buffer spans at least one of them
+    //
+    if (Size < LargePageSizes[Index]) {
+      continue;
+    }
+
+    Status = AllocateFromFreeRegion (MemoryType, Pages, LargePageSizes[Index], Address);
+    if (EFI_ERROR (Status)) {
+      Status = AllocateAndTrim (MemoryType, Pages, LargePageSizes[Index], Address);
+    }
+
+    if (!EFI_ERROR (Status)) {
+      if (Alignment != NULL) {
+        *Alignment = (UINTN)LargePageSizes[Index];
+      }
+
+      return EFI_SUCCESS;
+    }
+  }
+
+  Status = gBS->AllocatePages (AllocateAnyPages, MemoryType, Pages, Address);
+  if (EFI_ERROR (Status)) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Alignment != NULL) {
+    *Alignment = EFI_PAGE_SIZE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write a whole buffer to a file.
+**/
+STATIC
+EFI_STATUS
+WriteAll (
+  IN EFI_FILE_PROTOCOL  *File,
+  IN VOID               *Buffer,
+  IN UINTN              Size
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Written;
+
+  Written = Size;
+  Status  = File->Write (File, &Written, Buffer);
+  if (!EFI_ERROR (Status) && (Written != Size)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  return Status;
+}
+
+/**
+  Write the binary export: header, then the raw map as captured.
+**/
+STATIC
+EFI_STATUS
+ExportBinary (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_FILE_PROTOCOL          *File
+  )
+{
+  EFI_STATUS                Status;
+  MEMORY_MAP_EXPORT_HEADER  Header;
+
+  ZeroMem (&Header, sizeof (Header));
+  Header.Signature         = MEMORY_MAP_EXPORT_SIGNATURE;
+  Header.Version           = MEMORY_MAP_EXPORT_VERSION;
+  Header.HeaderSize        = sizeof (Header);
+  Header.DescriptorSize    = (UINT32)Snapshot->DescriptorSize;
+  Header.DescriptorVersion = Snapshot->DescriptorVersion;
+  Header.MapKey            = Snapshot->MapKey;
+  Header.DescriptorCount   = Snapshot->DescriptorCount;
+
+  if (EFI_ERROR (gRT->GetTime (&Header.Timestamp, NULL))) {
+    ZeroMem (&Header.Timestamp, sizeof (Header.Timestamp));
+  }
+
+  Status = WriteAll (File, &Header, sizeof (Header));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return WriteAll (File, Snapshot->RawMap, Snapshot->DescriptorCount * Snapshot->DescriptorSize);
+}
+
+/**
+  Write the CSV export, one row per raw descriptor.
+**/
+STATIC
+EFI_STATUS
+ExportCsv (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_FILE_PROTOCOL          *File
+  )
+{
+  EFI_STATUS             Status;
+  CHAR8                  *Buffer;
+  UINTN                  Used;
+  UINTN                  Index;
+  EFI_MEMORY_DESCRIPTOR  *Descriptor;
+
+  Buffer = AllocatePool (MEMORY_MAP_CSV_BUFFER_SIZE);
+  if (Buffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Used = AsciiSPrint (
+           Buffer,
+           MEMORY_MAP_CSV_BUFFER_SIZE,
+           "index,type,type_name,physical_start,virtual_start,pages,attribute\n"
+           );
+
+  Status     = EFI_SUCCESS;
+  Descriptor = Snapshot->RawMap;
+  for (Index = 0; Index < Snapshot->DescriptorCount; Index++) {
+    //
+    // Drain before the buffer could overflow
+    //
+    if (MEMORY_MAP_CSV_BUFFER_SIZE - Used < MEMORY_MAP_CSV_MAX_ROW) {
+      Status = WriteAll (File, Buffer, Used);
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      Used = 0;
+    }
+
+    Used += AsciiSPrint (
+              Buffer + Used,
+              MEMORY_MAP_CSV_BUFFER_SIZE - Used,
+              "%d,%d,%s,0x%lx,0x%lx,%ld,0x%lx\n",
+              Index,
+              Descriptor->Type,
+              MemoryTypeToString (Descriptor->Type),
+              Descriptor->PhysicalStart,
+              Descriptor->VirtualStart,
+              Descriptor->NumberOfPages,
+              Descriptor->Attribute
+              );
+
+    Descriptor = NEXT_MEMORY_DESCRIPTOR (Descriptor, Snapshot->DescriptorSize);
+  }
+
+  if (!EFI_ERROR (Status) && (Used > 0)) {
+    Status = WriteAll (File, Buffer, Used);
+  }
+
+  FreePool (Buffer);
+  return Status;
+}
+
+/**
+  Write a snapshot's raw descriptors to a binary file and/or a CSV file.
+
+  @param[in]  Snapshot    Snapshot to export.
+  @param[in]  BinaryFile  File opened for writing, or NULL to skip.
+  @param[in]  CsvFile     File opened for writing, or NULL to skip.
+
+  @retval EFI_SUCCESS           The requested files were written.
+  @retval EFI_OUT_OF_RESOURCES  The CSV buffer could not be allocated.
+  @retval Others                A file write failed.
+**/
+EFI_STATUS
+EFIAPI
+MemoryMapSnapshotExport (
+  IN CONST MEMORY_MAP_SNAPSHOT  *Snapshot,
+  IN EFI_FILE_PROTOCOL          *BinaryFile OPTIONAL,
+  IN EFI_FILE_PROTOCOL          *CsvFile OPTIONAL
+  )
+{
+  EFI_STATUS  Status;
+
+  ASSERT (Snapshot != NULL);
+
+  if (BinaryFile != NULL) {
+    Status = ExportBinary (Snapshot, BinaryFile);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  if (CsvFile != NULL) {
+    return ExportCsv (Snapshot, CsvFile);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Return a short display name for a memory type.
+
+  @param[in]  Type  Memory type.
+
+  @return Static string such as L"Conventional".
+**/
+CONST CHAR16 *
+EFIAPI
+MemoryTypeToString (
+  IN UINT32  Type
+  )
+{
+  switch (Type) {
+    case EfiReservedMemoryType:      return L"Reserved";
+    case EfiLoaderCode:              return L"LoaderCode";
+    case EfiLoaderData:              return L"LoaderData";
+    case EfiBootServicesCode:        return L"BS Code";
+    case EfiBootServicesData:        return L"BS Data";
+    case EfiRuntimeServicesCode:     return L"RT Code";
+    case EfiRuntimeServicesData:     return L"RT Data";
+    case EfiConventionalMemory:      return L"Conventional";
+    case EfiUnusableMemory:          return L"Unusable";
+    case EfiACPIReclaimMemory:       return L"ACPI Reclaim";
+    case EfiACPIMemoryNVS:           return L"ACPI NVS";
+    case EfiMemoryMappedIO:          return L"MMIO";
+    case EfiMemoryMappedIOPortSpace: return L"MMIO Port";
+    case EfiPalCode:                 return L"PAL Code";
+    case EfiPersistentMemory:        return L"Persistent";
+    default:                         return L"Unknown";
+  }
+}
@@ -0,0 +1,213 @@
+/** @file
+  Page Pool Library implementation.
+
+  Runs come from gBS->AllocatePages () so the pool can hand out any memory
+  type. Idle runs are chained through their first bytes, so the pool needs
+  no bookkeeping memory of its own beyond the PAGE_POOL structure.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/PagePoolLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+/**
+  Find the bin holding runs of a given size, or NULL.
+**/
+STATIC
+PAGE_POOL_BIN *
+FindBin (
+  IN PAGE_POOL  *Pool,
+  IN UINTN      Pages
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < PAGE_POOL_MAX_SIZES; Index++) {
+    if (Pool->Bins[Index].Pages == Pages) {
+      return &Pool->Bins[Index];
+    }
+  }
+
+  return NULL;
+}
+
+/**
+  Initialize a page pool.
+
+  @param[out]  Pool            Pool to initialize.
+  @param[in]   MemoryType      Memory type for every run in the pool.
+  @param[in]   MaxCachedPages  Cap on idle pages. 0 selects
+                               PAGE_POOL_DEFAULT_CAP.
+
+  @retval EFI_SUCCESS            The pool was initialized.
+  @retval EFI_INVALID_PARAMETER  Pool is NULL.
+**/
+EFI_STATUS
+EFIAPI
+PagePoolInit (
+  OUT PAGE_POOL        *Pool,
+  IN  EFI_MEMORY_TYPE  MemoryType,
+  IN  UINTN            MaxCachedPages
+  )
+{
+  if (Pool == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Pool, sizeof (*Pool));
+  Pool->MemoryType     = MemoryType;
+  Pool->MaxCachedPages = (MaxCachedPages == 0) ? PAGE_POOL_DEFAULT_CAP : MaxCachedPages;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate a run of pages, reusing an idle run of the same size if any.
+
+  @param[in]  Pool   Pool to allocate from.
+  @param[in]  Pages  Number of 4 KB pages.
+
+  @return Pointer to the run, or NULL if Pages is 0 or the firmware is out
+          of memory.
+**/
+VOID *
+EFIAPI
+PagePoolAlloc (
+  IN PAGE_POOL  *Pool,
+  IN UINTN      Pages
+  )
+{
+  EFI_STATUS            Status;
+  PAGE_POOL_BIN         *Bin;
+  VOID                  *Run;
+  EFI_PHYSICAL_ADDRESS  Address;
+
+  ASSERT (Pool != NULL);
+
+  if (Pages == 0) {
+    return NULL;
+  }
+
+  Bin = FindBin (Pool, Pages);
+  if ((Bin != NULL) && (Bin->Head != NULL)) {
+    Run       = Bin->Head;
+    Bin->Head = *(VOID **)Run;
+    Bin->Count--;
+    Pool->CachedPages -= Pages;
+    Pool->Hits++;
+
+    //
+    // An emptied bin is released so another size can claim it
+    //
+    if (Bin->Count == 0) {
+      Bin->Pages = 0;
+    }
+
+    return Run;
+  }
+
+  Pool->Misses++;
+  Status = gBS->AllocatePages (AllocateAnyPages, Pool->MemoryType, Pages, &Address);
+  if (EFI_ERROR (Status)) {
+    //
+    // Idle runs of other sizes may be what is standing in the way
+    //
+    if (Pool->CachedPages == 0) {
+      return NULL;
+    }
+
+    PagePoolTrim (Pool);
+    Status = gBS->AllocatePages (AllocateAnyPages, Pool->MemoryType, Pages, &Address);
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
+  }
+
+  return (VOID *)(UINTN)Address;
+}
+
+/**
+  Return a run of pages to the pool.
+
+  @param[in]  Pool    Pool the run was allocated from.
+  @param[in]  Buffer  Run to free. NULL is ignored.
+  @param[in]  Pages   Size of the run, as passed to PagePoolAlloc ().
+**/
+VOID
+EFIAPI
+PagePoolFree (
+  IN PAGE_POOL  *Pool,
+  IN VOID       *Buffer,
+  IN UINTN      Pages
+  )
+{
+  PAGE_POOL_BIN  *Bin;
+
+  ASSERT (Pool != NULL);
+
+  if ((Buffer == NULL) || (Pages == 0)) {
+    return;
+  }
+
+  ASSERT (((UINTN)Buffer & EFI_PAGE_MASK) == 0);
+
+  Bin = NULL;
+  if (Pool->CachedPages + Pages <= Pool->MaxCachedPages) {
+    Bin = FindBin (Pool, Pages);
+    if (Bin == NULL) {
+      Bin = FindBin (Pool, 0);
+    }
+  }
+
+  if (Bin == NULL) {
+    Pool->Released++;
+    gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
+    return;
+  }
+
+  Bin->Pages       = Pages;
+  *(VOID **)Buffer = Bin->Head;
+  Bin->Head        = Buffer;
+  Bin->Count++;
+
+  Pool->CachedPages    += Pages;
+  Pool->PeakCachedPages = MAX (Pool->PeakCachedPages, Pool->CachedPages);
+}
+
+/**
+  Release every idle run back to the firmware.
+
+  @param[in]  Pool  Pool to trim. It may be used again afterwards.
+**/
+VOID
+EFIAPI
+PagePoolTrim (
+  IN PAGE_POOL  *Pool
+  )
+{
+  UINTN          Index;
+  PAGE_POOL_BIN  *Bin;
+  VOID           *Run;
+
+  ASSERT (Pool != NULL);
+
+  for (Index = 0; Index < PAGE_POOL_MAX_SIZES; Index++) {
+    Bin = &Pool->Bins[Index];
+    while (Bin->Head != NULL) {
+      Run       = Bin->Head;
+      Bin->Head = *(VOID **)Run;
+      gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Run, Bin->Pages);
+    }
+
+    Bin->Pages = 0;
+    Bin->Count = 0;
+  }
+
+  Pool->CachedPages = 0;
+}
@@ -0,0 +1,320 @@
+/** @file
+  Parallel Memory Library - bulk zero, fill and copy across processors.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/ParallelMemLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/SynchronizationLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/MpService.h>
+
+typedef enum {
+  ParallelMemOpZero,
+  ParallelMemOpFill,
+  ParallelMemOpCopy
+} PARALLEL_MEM_OP;
+
+///
+/// Work shared by the BSP and every AP taking part in one operation
+///
+typedef struct {
+  PARALLEL_MEM_OP    Op;
+  UINT8              *Destination;
+  CONST UINT8        *Source;
+  UINTN              Length;
+  UINT8              Value;
+  UINT32             ChunkCount;
+  UINT32             MaxWorkers;
+  volatile UINT32    NextChunk;
+  volatile UINT32    Workers;
+} PARALLEL_MEM_JOB;
+
+STATIC EFI_MP_SERVICES_PROTOCOL  *mMpServices;
+STATIC BOOLEAN                   mMpServicesLocated;
+STATIC UINTN                     mProcessorCount = 1;
+STATIC UINTN                     mMaxProcessors;
+
+/**
+  Locate MP Services once and cache the enabled processor count.
+**/
+STATIC
+VOID
+LocateMpServices (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Total;
+  UINTN       Enabled;
+
+  if (mMpServicesLocated) {
+    return;
+  }
+
+  mMpServicesLocated = TRUE;
+
+  Status = gBS->LocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **)&mMpServices);
+  if (EFI_ERROR (Status)) {
+    mMpServices = NULL;
+    return;
+  }
+
+  Status = mMpServices->GetNumberOfProcessors (mMpServices, &Total, &Enabled);
+  if (!EFI_ERROR (Status) && (Enabled > 0)) {
+    mProcessorCount = Enabled;
+    DEBUG ((DEBUG_INFO, "ParallelMemLib: %d of %d processors enabled\n", Enabled, Total));
+  }
+}
+
+/**
+  Pull chunks from the job until none are left.
+
+  Runs on the BSP and on every AP. Only memory is touched here, which keeps
+  the procedure safe to run on APs.
+
+  @param[in]  Buffer  The PARALLEL_MEM_JOB.
+**/
+STATIC
+VOID
+EFIAPI
+ParallelMemWorker (
+  IN VOID  *Buffer
+  )
+{
+  PARALLEL_MEM_JOB  *Job;
+  UINT32            Chunk;
+  UINTN             Offset;
+  UINTN             Length;
+
+  Job = (PARALLEL_MEM_JOB *)Buffer;
+
+  //
+  // Processors beyond the limit return at once; the scaling demo relies on
+  // this to run with 1..N workers without picking individual APs
+  //
+  if (InterlockedIncrement (&Job->Workers) > Job->MaxWorkers) {
+    return;
+  }
+
+  for ( ; ;) {
+    Chunk = InterlockedIncrement (&Job->NextChunk) - 1;
+    if (Chunk >= Job->ChunkCount) {
+      break;
+    }
+
+    Offset = (UINTN)Chunk * PARALLEL_MEM_CHUNK_SIZE;
+    Length = MIN (PARALLEL_MEM_CHUNK_SIZE, Job->Length - Offset);
+
+    switch (Job->Op) {
+      case ParallelMemOpZero:
+        ZeroMem (Job->Destination + Offset, Length);
+        break;
+
+      case ParallelMemOpFill:
+        SetMem (Job->Destination + Offset, Length, Job->Value);
+        break;
+
+      case ParallelMemOpCopy:
+        CopyMem (Job->Destination + Offset, Job->Source + Offset, Length);
+        break;
+    }
+  }
+}
+
+/**
+  Run a job on the BSP and, when possible, on the APs as well.
+**/
+STATIC
+VOID
+RunJob (
+  IN OUT PARALLEL_MEM_JOB  *Job
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   Done;
+  EFI_TPL     OldTpl;
+  UINTN       Index;
+
+  Job->ChunkCount = (UINT32)((Job->Length + PARALLEL_MEM_CHUNK_SIZE - 1) / PARALLEL_MEM_CHUNK_SIZE);
+  Job->NextChunk  = 0;
+  Job->Workers    = 0;
+  Job->MaxWorkers = (UINT32)ParallelMemGetProcessorCount ();
+  if ((mMaxProcessors != 0) && (mMaxProcessors < Job->MaxWorkers)) {
+    Job->MaxWorkers = (UINT32)mMaxProcessors;
+  }
+
+  //
+  // Waiting for the APs needs the MP timer callback to run, so only fan out
+  // from TPL_APPLICATION
+  //
+  OldTpl = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  gBS->RestoreTPL (OldTpl);
+
+  Done = NULL;
+  if ((mMpServices != NULL) && (Job->MaxWorkers > 1) && (OldTpl == TPL_APPLICATION)) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Done);
+    if (!EFI_ERROR (Status)) {
+      //
+      // Non-blocking, so the BSP can take chunks while the APs run
+      //
+      Status = mMpServices->StartupAllAPs (mMpServices, ParallelMemWorker, FALSE, Done, 0, Job, NULL);
+      if (EFI_ERROR (Status)) {
+        gBS->CloseEvent (Done);
+        Done = NULL;
+      }
+    }
+  }
+
+  ParallelMemWorker (Job);
+
+  if (Done != NULL) {
+    gBS->WaitForEvent (1, &Done, &Index);
+    gBS->CloseEvent (Done);
+  }
+}
+
+/**
+  Fill a buffer with zeros, in parallel when it is large enough.
+
+  @param[out]  Buffer  Buffer to clear.
+  @param[in]   Length  Number of bytes to clear.
+
+  @return Buffer.
+**/
+VOID *
+EFIAPI
+ParallelZeroMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length
+  )
+{
+  PARALLEL_MEM_JOB  Job;
+
+  if (Length < PARALLEL_MEM_THRESHOLD) {
+    return ZeroMem (Buffer, Length);
+  }
+
+  ZeroMem (&Job, sizeof (Job));
+  Job.Op          = ParallelMemOpZero;
+  Job.Destination = Buffer;
+  Job.Length      = Length;
+  RunJob (&Job);
+
+  return Buffer;
+}
+
+/**
+  Fill a buffer with a byte value, in parallel when it is large enough.
+
+  @param[out]  Buffer  Buffer to fill.
+  @param[in]   Length  Number of bytes to fill.
+  @param[in]   Value   Byte value to store.
+
+  @return Buffer.
+**/
+VOID *
+EFIAPI
+ParallelSetMem (
+  OUT VOID   *Buffer,
+  IN  UINTN  Length,
+  IN  UINT8  Value
+  )
+{
+  PARALLEL_MEM_JOB  Job;
+
+  if (Length < PARALLEL_MEM_THRESHOLD) {
+    return SetMem (Buffer, Length, Value);
+  }
+
+  ZeroMem (&Job, sizeof (Job));
+  Job.Op          = ParallelMemOpFill;
+  Job.Destination = Buffer;
+  Job.Length      = Length;
+  Job.Value       = Value;
+  RunJob (&Job);
+
+  return Buffer;
+}
+
+/**
+  Copy a buffer, in parallel when it is large enough.
+
+  @param[out]  Destination  Destination buffer.
+  @param[in]   Source       Source buffer.
+  @param[in]   Length       Number of bytes to copy.
+
+  @return Destination.
+**/
+VOID *
+EFIAPI
+ParallelCopyMem (
+  OUT VOID        *Destination,
+  IN  CONST VOID  *Source,
+  IN  UINTN       Length
+  )
+{
+  PARALLEL_MEM_JOB  Job;
+  UINTN             Distance;
+
+  Distance = ((UINTN)Destination > (UINTN)Source) ?
+             (UINTN)Destination - (UINTN)Source :
+             (UINTN)Source - (UINTN)Destination;
+
+  //
+  // Chunks finish in any order, so overlapping copies stay on the BSP where
+  // CopyMem () handles the overlap
+  //
+  if ((Length < PARALLEL_MEM_THRESHOLD) || (Distance < Length)) {
+    return CopyMem (Destination, Source, Length);
+  }
+
+  ZeroMem (&Job, sizeof (Job));
+  Job.Op          = ParallelMemOpCopy;
+  Job.Destination = Destination;
+  Job.Source      = Source;
+  Job.Length      = Length;
+  RunJob (&Job);
+
+  return Destination;
+}
+
+/**
+  Return the number of enabled processors, including the BSP.
+
+  @return Processor count; 1 if MP Services is not available.
+**/
+UINTN
+EFIAPI
+ParallelMemGetProcessorCount (
+  VOID
+  )
+{
+  LocateMpServices ();
+  return mProcessorCount;
+}
+
+/**
+  Limit how many processors later operations may use.
+
+  @param[in]  Count  Maximum processors including the BSP. 0 means all.
+
+  @return The previous limit.
+**/
+UINTN
+EFIAPI
+ParallelMemSetMaxProcessors (
+  IN UINTN  Count
+  )
+{
+  UINTN  Previous;
+
+  Previous       = mMaxProcessors;
+  mMaxProcessors = Count;
+  return Previous;
+}
@@ -0,0 +1,413 @@
+/** @file
+  Slab and Arena Allocator Library implementation.
+
+  Slabs and arena blocks are page runs from AllocatePages (). Each run starts
+  with a small header linking it into the owner's chain; the rest is carved
+  into objects (slab) or bumped through (arena).
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/SlabArenaLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+
+#define SLAB_SIGNATURE   SIGNATURE_32 ('S', 'L', 'A', 'B')
+#define ARENA_SIGNATURE  SIGNATURE_32 ('A', 'R', 'N', 'A')
+
+#define DEFAULT_SLAB_PAGES   16
+#define DEFAULT_ARENA_PAGES  64
+#define MIN_ALIGNMENT        8
+
+struct _SLAB_HEADER {
+  UINT32         Signature;
+  UINTN          Pages;
+  SLAB_HEADER    *Next;
+};
+
+struct _ARENA_BLOCK {
+  UINT32         Signature;
+  UINTN          Pages;
+  ARENA_BLOCK    *Next;
+};
+
+#define SLAB_HEADER_SIZE   ALIGN_VALUE (sizeof (SLAB_HEADER), MIN_ALIGNMENT)
+#define ARENA_HEADER_SIZE  ALIGN_VALUE (sizeof (ARENA_BLOCK), MIN_ALIGNMENT)
+
+/**
+  Initialize a slab cache for objects of a fixed size.
+
+  @param[out]  Cache         Cache to initialize.
+  @param[in]   ObjectSize    Size of each object in bytes.
+  @param[in]   PagesPerSlab  Pages per slab. 0 selects a default of 16.
+
+  @retval EFI_SUCCESS            The cache was initialized.
+  @retval EFI_INVALID_PARAMETER  Cache is NULL, ObjectSize is 0, or an object
+                                 does not fit in one slab.
+**/
+EFI_STATUS
+EFIAPI
+SlabCacheInit (
+  OUT SLAB_CACHE  *Cache,
+  IN  UINTN       ObjectSize,
+  IN  UINTN       PagesPerSlab
+  )
+{
+  if ((Cache == NULL) || (ObjectSize == 0)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (PagesPerSlab == 0) {
+    PagesPerSlab = DEFAULT_SLAB_PAGES;
+  }
+
+  //
+  // Freed objects store the free-list link in their first bytes
+  //
+  ObjectSize = ALIGN_VALUE (MAX (ObjectSize, sizeof (VOID *)), MIN_ALIGNMENT);
+  if (ObjectSize > EFI_PAGES_TO_SIZE (PagesPerSlab) - SLAB_HEADER_SIZE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Cache, sizeof (*Cache));
+  Cache->ObjectSize     = ObjectSize;
+  Cache->PagesPerSlab   = PagesPerSlab;
+  Cache->ObjectsPerSlab = (EFI_PAGES_TO_SIZE (PagesPerSlab) - SLAB_HEADER_SIZE) / ObjectSize;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Move the cache to the next slab, allocating a new one if the chain is
+  exhausted.
+**/
+STATIC
+EFI_STATUS
+AdvanceSlab (
+  IN SLAB_CACHE  *Cache
+  )
+{
+  SLAB_HEADER  *Slab;
+
+  if ((Cache->CurrentSlab != NULL) && (Cache->CurrentSlab->Next != NULL)) {
+    Cache->CurrentSlab = Cache->CurrentSlab->Next;
+    Cache->NextObject  = 0;
+    return EFI_SUCCESS;
+  }
+
+  Slab = AllocatePages (Cache->PagesPerSlab);
+  if (Slab == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Slab->Signature = SLAB_SIGNATURE;
+  Slab->Pages     = Cache->PagesPerSlab;
+  Slab->Next      = NULL;
+
+  if (Cache->CurrentSlab == NULL) {
+    Cache->FirstSlab = Slab;
+  } else {
+    Cache->CurrentSlab->Next = Slab;
+  }
+
+  Cache->CurrentSlab = Slab;
+  Cache->NextObject  = 0;
+  Cache->SlabCount++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate one object from a slab cache.
+
+  @param[in]  Cache  Cache to allocate from.
+
+  @return Pointer to the object, or NULL if a new slab could not be allocated.
+**/
+VOID *
+EFIAPI
+SlabAlloc (
+  IN SLAB_CACHE  *Cache
+  )
+{
+  VOID  *Object;
+
+  ASSERT (Cache != NULL);
+  ASSERT (Cache->ObjectSize != 0);
+
+  if (Cache->FreeList != NULL) {
+    Object          = Cache->FreeList;
+    Cache->FreeList = *(VOID **)Object;
+  } else {
+    if ((Cache->CurrentSlab == NULL) ||
+        (Cache->NextObject >= Cache->ObjectsPerSlab))
+    {
+      if (EFI_ERROR (AdvanceSlab (Cache))) {
+        return NULL;
+      }
+    }
+
+    Object = (UINT8 *)Cache->CurrentSlab + SLAB_HEADER_SIZE +
+             Cache->NextObject * Cache->ObjectSize;
+    Cache->NextObject++;
+  }
+
+  Cache->ActiveObjects++;
+  if (Cache->ActiveObjects > Cache->PeakObjects) {
+    Cache->PeakObjects = Cache->ActiveObjects;
+  }
+
+  return Object;
+}
+
+/**
+  Return an object to its slab cache.
+
+  @param[in]  Cache   Cache the object was allocated from.
+  @param[in]  Object  Object to free. NULL is ignored.
+**/
+VOID
+EFIAPI
+SlabFree (
+  IN SLAB_CACHE  *Cache,
+  IN VOID        *Object
+  )
+{
+  ASSERT (Cache != NULL);
+
+  if (Object == NULL) {
+    return;
+  }
+
+  ASSERT (Cache->ActiveObjects > 0);
+
+  *(VOID **)Object = Cache->FreeList;
+  Cache->FreeList  = Object;
+  Cache->ActiveObjects--;
+}
+
+/**
+  Free every object in a slab cache at once, keeping the slabs for reuse.
+
+  @param[in]  Cache  Cache to reset.
+**/
+VOID
+EFIAPI
+SlabCacheReset (
+  IN SLAB_CACHE  *Cache
+  )
+{
+  ASSERT (Cache != NULL);
+
+  Cache->CurrentSlab   = Cache->FirstSlab;
+  Cache->NextObject    = 0;
+  Cache->FreeList      = NULL;
+  Cache->ActiveObjects = 0;
+}
+
+/**
+  Release all slabs back to the firmware.
+
+  @param[in]  Cache  Cache to destroy. It may be re-initialized afterwards.
+**/
+VOID
+EFIAPI
+SlabCacheDestroy (
+  IN SLAB_CACHE  *Cache
+  )
+{
+  SLAB_HEADER  *Slab;
+  SLAB_HEADER  *Next;
+
+  ASSERT (Cache != NULL);
+
+  for (Slab = Cache->FirstSlab; Slab != NULL; Slab = Next) {
+    ASSERT (Slab->Signature == SLAB_SIGNATURE);
+    Next = Slab->Next;
+    FreePages (Slab, Slab->Pages);
+  }
+
+  Cache->FirstSlab   = NULL;
+  Cache->SlabCount   = 0;
+  SlabCacheReset (Cache);
+}
+
+/**
+  Initialize an arena.
+
+  @param[out]  Arena       Arena to initialize.
+  @param[in]   BlockPages  Pages per block. 0 selects a default of 64.
+
+  @retval EFI_SUCCESS            The arena was initialized.
+  @retval EFI_INVALID_PARAMETER  Arena is NULL.
+**/
+EFI_STATUS
+EFIAPI
+ArenaInit (
+  OUT ARENA  *Arena,
+  IN  UINTN  BlockPages
+  )
+{
+  if (Arena == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  ZeroMem (Arena, sizeof (*Arena));
+  Arena->BlockPages = (BlockPages == 0) ? DEFAULT_ARENA_PAGES : BlockPages;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Append a new block to the arena large enough for Size bytes at Alignment.
+**/
+STATIC
+EFI_STATUS
+GrowArena (
+  IN ARENA  *Arena,
+  IN UINTN  Size,
+  IN UINTN  Alignment
+  )
+{
+  ARENA_BLOCK  *Block;
+  UINTN        Pages;
+
+  Pages = EFI_SIZE_TO_PAGES (ARENA_HEADER_SIZE + Alignment + Size);
+  Pages = MAX (Pages, Arena->BlockPages);
+
+  Block = AllocatePages (Pages);
+  if (Block == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Block->Signature = ARENA_SIGNATURE;
+  Block->Pages     = Pages;
+  Block->Next      = NULL;
+
+  if (Arena->CurrentBlock == NULL) {
+    Arena->FirstBlock = Block;
+  } else {
+    //
+    // Keep any blocks already chained after the current one
+    //
+    Block->Next                = Arena->CurrentBlock->Next;
+    Arena->CurrentBlock->Next  = Block;
+  }
+
+  Arena->CurrentBlock = Block;
+  Arena->Offset       = ARENA_HEADER_SIZE;
+  Arena->BlockCount++;
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate memory from an arena.
+
+  @param[in]  Arena      Arena to allocate from.
+  @param[in]  Size       Number of bytes.
+  @param[in]  Alignment  Required alignment, a power of two. 0 means 8.
+
+  @return Pointer to the memory, or NULL on failure.
+**/
+VOID *
+EFIAPI
+ArenaAlloc (
+  IN ARENA  *Arena,
+  IN UINTN  Size,
+  IN UINTN  Alignment
+  )
+{
+  ARENA_BLOCK  *Block;
+  UINTN        Start;
+  UINTN        Limit;
+
+  ASSERT (Arena != NULL);
+
+  if (Alignment == 0) {
+    Alignment = MIN_ALIGNMENT;
+  }
+
+  ASSERT ((Alignment & (Alignment - 1)) == 0);
+
+  if (Size > MAX_UINTN - ARENA_HEADER_SIZE - Alignment - EFI_PAGE_MASK) {
+    return NULL;
+  }
+
+  while (TRUE) {
+    Block = Arena->CurrentBlock;
+    if (Block != NULL) {
+      Start = ALIGN_VALUE ((UINTN)Block + Arena->Offset, Alignment);
+      Limit = (UINTN)Block + EFI_PAGES_TO_SIZE (Block->Pages);
+      if ((Start <= Limit) && (Size <= Limit - Start)) {
+        Arena->Offset          = Start + Size - (UINTN)Block;
+        Arena->BytesAllocated += Size;
+        return (VOID *)Start;
+      }
+
+      //
+      // Reuse a block kept from before the last reset if it fits
+      //
+      if ((Block->Next != NULL) &&
+          (ARENA_HEADER_SIZE + Alignment + Size <= EFI_PAGES_TO_SIZE (Block->Next->Pages)))
+      {
+        Arena->CurrentBlock = Block->Next;
+        Arena->Offset       = ARENA_HEADER_SIZE;
+        continue;
+      }
+    }
+
+    if (EFI_ERROR (GrowArena (Arena, Size, Alignment))) {
+      return NULL;
+    }
+  }
+}
+
+/**
+  Free every allocation in an arena at once, keeping the blocks for reuse.
+
+  @param[in]  Arena  Arena to reset.
+**/
+VOID
+EFIAPI
+ArenaReset (
+  IN ARENA  *Arena
+  )
+{
+  ASSERT (Arena != NULL);
+
+  Arena->CurrentBlock   = Arena->FirstBlock;
+  Arena->Offset         = ARENA_HEADER_SIZE;
+  Arena->BytesAllocated = 0;
+}
+
+/**
+  Release all arena blocks back to the firmware.
+
+  @param[in]  Arena  Arena to destroy. It may be re-initialized afterwards.
+**/
+VOID
+EFIAPI
+ArenaDestroy (
+  IN ARENA  *Arena
+  )
+{
+  ARENA_BLOCK  *Block;
+  ARENA_BLOCK  *Next;
+
+  ASSERT (Arena != NULL);
+
+  for (Block = Arena->FirstBlock; Block != NULL; Block = Next) {
+    ASSERT (Block->Signature == ARENA_SIGNATURE);
+    Next = Block->Next;
+    FreePages (Block, Block->Pages);
+  }
+
+  Arena->FirstBlock = NULL;
+  Arena->BlockCount = 0;
+  ArenaReset (Arena);
+}
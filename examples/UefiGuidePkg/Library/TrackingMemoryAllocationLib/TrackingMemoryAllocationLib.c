@@ -0,0 +1,1040 @@
+/** @file
+  Tracking Memory Allocation Library - leak and double-free detection.
+
+  A drop-in MemoryAllocationLib instance for UEFI applications. Every pool
+  and page allocation is recorded in a hash table keyed by address, together
+  with its size, call site, sequence number and timestamp. Frees look the
+  address up, so double frees and pool/page mismatches are reported. The
+  free itself always goes to the firmware, which rejects a real double free
+  without the tracker having to guess. When the application exits, the library
+  destructor prints the allocations still outstanding and the peak number of
+  bytes that were live at once.
+
+  The MemoryAllocationLib interface carries no __FILE__/__LINE__, so the call
+  site is the caller's return address, printed as an offset into the image.
+  Resolve it with addr2line (or the linker map) against the .debug file.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/LoadedImage.h>
+
+#define TRACK_HASH_BUCKETS      512
+#define TRACK_RECENT_FREES      64
+#define TRACK_MAX_LEAKS_SHOWN   32
+#define TRACK_CALIBRATION_US    1000
+
+typedef enum {
+  TrackPool,
+  TrackPages,
+  TrackAlignedPages
+} TRACK_KIND;
+
+typedef struct _TRACK_RECORD  TRACK_RECORD;
+
+struct _TRACK_RECORD {
+  TRACK_RECORD    *Next;
+  VOID            *Buffer;
+  UINTN           Size;       ///< Bytes; whole pages for page allocations
+  VOID            *CallSite;
+  UINT64          Ticks;
+  UINT32          Sequence;
+  TRACK_KIND      Kind;
+};
+
+///
+/// Records are carved out of untracked pages so the table never recurses
+/// into itself. Each page starts with a link to the next one.
+///
+typedef struct _TRACK_RECORD_PAGE  TRACK_RECORD_PAGE;
+
+struct _TRACK_RECORD_PAGE {
+  TRACK_RECORD_PAGE    *Next;
+};
+
+#define TRACK_RECORDS_PER_PAGE \
+  ((EFI_PAGE_SIZE - sizeof (TRACK_RECORD_PAGE)) / sizeof (TRACK_RECORD))
+
+STATIC TRACK_RECORD       *mBuckets[TRACK_HASH_BUCKETS];
+STATIC TRACK_RECORD       *mFreeRecords;
+STATIC TRACK_RECORD_PAGE  *mRecordPages;
+
+//
+// Addresses freed most recently. An untracked free of one of them is a
+// likely double free, though the firmware may also have handed the address
+// out again (e.g. LocateHandleBuffer), so it only adds a hint to the log.
+//
+STATIC VOID  *mRecentFrees[TRACK_RECENT_FREES];
+STATIC VOID  *mRecentFreeSites[TRACK_RECENT_FREES];
+STATIC UINTN  mRecentFreeNext;
+
+STATIC UINT64  mStartTicks;
+STATIC UINT32  mSequence;
+STATIC UINTN   mLiveCount;
+STATIC UINT64  mLiveBytes;
+STATIC UINT64  mPeakBytes;
+STATIC UINTN   mTotalAllocations;
+STATIC UINTN   mTotalFrees;
+STATIC UINTN   mUntrackedAllocations;
+STATIC UINTN   mUntrackedFrees;
+STATIC UINTN   mRejectedFrees;
+STATIC UINTN   mMismatchedFrees;
+
+/**
+  Hash a buffer address into a bucket index.
+**/
+STATIC
+UINTN
+TrackHash (
+  IN CONST VOID  *Buffer
+  )
+{
+  UINTN  Value;
+
+  Value = (UINTN)Buffer;
+  return ((Value >> 4) ^ (Value >> 13)) % TRACK_HASH_BUCKETS;
+}
+
+/**
+  Take a record from the free list, adding a page of records when empty.
+**/
+STATIC
+TRACK_RECORD *
+TrackNewRecord (
+  VOID
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Memory;
+  TRACK_RECORD_PAGE     *Page;
+  TRACK_RECORD          *Records;
+  TRACK_RECORD          *Record;
+  UINTN                 Index;
+
+  if (mFreeRecords == NULL) {
+    Status = gBS->AllocatePages (AllocateAnyPages, EfiBootServicesData, 1, &Memory);
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
+
+    Page         = (TRACK_RECORD_PAGE *)(UINTN)Memory;
+    Page->Next   = mRecordPages;
+    mRecordPages = Page;
+
+    Records = (TRACK_RECORD *)(Page + 1);
+    for (Index = 0; Index < TRACK_RECORDS_PER_PAGE; Index++) {
+      Records[Index].Next = mFreeRecords;
+      mFreeRecords        = &Records[Index];
+    }
+  }
+
+  Record       = mFreeRecords;
+  mFreeRecords = Record->Next;
+  return Record;
+}
+
+/**
+  Record a successful allocation.
+**/
+STATIC
+VOID
+TrackAllocation (
+  IN VOID        *Buffer,
+  IN UINTN       Size,
+  IN TRACK_KIND  Kind,
+  IN VOID        *CallSite
+  )
+{
+  TRACK_RECORD  *Record;
+  UINTN         Bucket;
+  UINTN         Index;
+
+  if (Buffer == NULL) {
+    return;
+  }
+
+  //
+  // The address is live again; a later free of it is not a double free
+  //
+  for (Index = 0; Index < TRACK_RECENT_FREES; Index++) {
+    if (mRecentFrees[Index] == Buffer) {
+      mRecentFrees[Index] = NULL;
+    }
+  }
+
+  mTotalAllocations++;
+
+  Record = TrackNewRecord ();
+  if (Record == NULL) {
+    //
+    // Not counted as live, so it cannot show up as a leak; its free will
+    // be counted as untracked
+    //
+    mUntrackedAllocations++;
+    return;
+  }
+
+  mLiveCount++;
+  mLiveBytes += Size;
+  mPeakBytes  = MAX (mPeakBytes, mLiveBytes);
+
+  Record->Buffer   = Buffer;
+  Record->Size     = Size;
+  Record->CallSite = CallSite;
+  Record->Ticks    = GetPerformanceCounter ();
+  Record->Sequence = ++mSequence;
+  Record->Kind     = Kind;
+
+  Bucket           = TrackHash (Buffer);
+  Record->Next     = mBuckets[Bucket];
+  mBuckets[Bucket] = Record;
+}
+
+/**
+  Remove the record of a buffer about to be freed.
+
+  Untracked and mismatched frees are only logged; the caller passes every
+  free on to the firmware.
+**/
+STATIC
+VOID
+TrackRelease (
+  IN VOID        *Buffer,
+  IN UINTN       Size,
+  IN TRACK_KIND  Kind,
+  IN VOID        *CallSite
+  )
+{
+  TRACK_RECORD  **Link;
+  TRACK_RECORD  *Record;
+  UINTN         Index;
+
+  for (Link = &mBuckets[TrackHash (Buffer)]; *Link != NULL; Link = &(*Link)->Next) {
+    if ((*Link)->Buffer == Buffer) {
+      break;
+    }
+  }
+
+  Record = *Link;
+  if (Record == NULL) {
+    //
+    // Allocated by the firmware, before tracking started, or without a
+    // record; or already freed
+    //
+    mUntrackedFrees++;
+    for (Index = 0; Index < TRACK_RECENT_FREES; Index++) {
+      if (mRecentFrees[Index] == Buffer) {
+        DEBUG ((
+          DEBUG_WARN,
+          "TrackingMemoryAllocationLib: untracked free of %p at %p, possibly a double free (last freed at %p)\n",
+          Buffer,
+          CallSite,
+          mRecentFreeSites[Index]
+          ));
+        break;
+      }
+    }
+
+    return;
+  }
+
+  if ((Record->Kind != Kind) || ((Size != 0) && (Record->Size != Size))) {
+    mMismatchedFrees++;
+    DEBUG ((
+      DEBUG_ERROR,
+      "TrackingMemoryAllocationLib: mismatched free of %p (%d bytes) at %p, allocated at %p\n",
+      Buffer,
+      Record->Size,
+      CallSite,
+      Record->CallSite
+      ));
+  }
+
+  *Link        = Record->Next;
+  Record->Next = mFreeRecords;
+  mFreeRecords = Record;
+
+  mTotalFrees++;
+  mLiveCount--;
+  mLiveBytes -= Record->Size;
+
+  mRecentFrees[mRecentFreeNext]     = Buffer;
+  mRecentFreeSites[mRecentFreeNext] = CallSite;
+  mRecentFreeNext                   = (mRecentFreeNext + 1) % TRACK_RECENT_FREES;
+}
+
+/**
+  Log a free the firmware refused, typically a double free.
+**/
+STATIC
+VOID
+TrackFreeResult (
+  IN VOID        *Buffer,
+  IN EFI_STATUS  Status,
+  IN VOID        *CallSite
+  )
+{
+  if (EFI_ERROR (Status)) {
+    mRejectedFrees++;
+    DEBUG ((
+      DEBUG_ERROR,
+      "TrackingMemoryAllocationLib: firmware rejected free of %p at %p: %r\n",
+      Buffer,
+      CallSite,
+      Status
+      ));
+  }
+}
+
+/**
+  Allocate pages and record them.
+**/
+STATIC
+VOID *
+InternalAllocatePages (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            Pages,
+  IN VOID             *CallSite
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Memory;
+
+  if (Pages == 0) {
+    return NULL;
+  }
+
+  Status = gBS->AllocatePages (AllocateAnyPages, MemoryType, Pages, &Memory);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  TrackAllocation ((VOID *)(UINTN)Memory, EFI_PAGES_TO_SIZE (Pages), TrackPages, CallSite);
+  return (VOID *)(UINTN)Memory;
+}
+
+/**
+  Allocate aligned pages and record them.
+**/
+STATIC
+VOID *
+InternalAllocateAlignedPages (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            Pages,
+  IN UINTN            Alignment,
+  IN VOID             *CallSite
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Memory;
+  UINTN                 AlignedMemory;
+  UINTN                 AlignmentMask;
+  UINTN                 UnalignedPages;
+  UINTN                 RealPages;
+
+  //
+  // Alignment must be a power of two or zero
+  //
+  ASSERT ((Alignment & (Alignment - 1)) == 0);
+
+  if (Pages == 0) {
+    return NULL;
+  }
+
+  if (Alignment > EFI_PAGE_SIZE) {
+    //
+    // Over-allocate by the alignment, then free the unaligned head and tail
+    //
+    RealPages = Pages + EFI_SIZE_TO_PAGES (Alignment);
+    ASSERT (RealPages > Pages);
+
+    Status = gBS->AllocatePages (AllocateAnyPages, MemoryType, RealPages, &Memory);
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
+
+    AlignmentMask  = Alignment - 1;
+    AlignedMemory  = ((UINTN)Memory + AlignmentMask) & ~AlignmentMask;
+    UnalignedPages = EFI_SIZE_TO_PAGES (AlignedMemory - (UINTN)Memory);
+    if (UnalignedPages > 0) {
+      gBS->FreePages (Memory, UnalignedPages);
+    }
+
+    Memory         = AlignedMemory + EFI_PAGES_TO_SIZE (Pages);
+    UnalignedPages = RealPages - Pages - UnalignedPages;
+    if (UnalignedPages > 0) {
+      gBS->FreePages (Memory, UnalignedPages);
+    }
+  } else {
+    Status = gBS->AllocatePages (AllocateAnyPages, MemoryType, Pages, &Memory);
+    if (EFI_ERROR (Status)) {
+      return NULL;
+    }
+
+    AlignedMemory = (UINTN)Memory;
+  }
+
+  TrackAllocation ((VOID *)AlignedMemory, EFI_PAGES_TO_SIZE (Pages), TrackAlignedPages, CallSite);
+  return (VOID *)AlignedMemory;
+}
+
+/**
+  Allocate pool and record it.
+**/
+STATIC
+VOID *
+InternalAllocatePool (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            AllocationSize,
+  IN VOID             *CallSite
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Memory;
+
+  Status = gBS->AllocatePool (MemoryType, AllocationSize, &Memory);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+
+  TrackAllocation (Memory, AllocationSize, TrackPool, CallSite);
+  return Memory;
+}
+
+/**
+  Allocate zeroed pool and record it.
+**/
+STATIC
+VOID *
+InternalAllocateZeroPool (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            AllocationSize,
+  IN VOID             *CallSite
+  )
+{
+  VOID  *Memory;
+
+  Memory = InternalAllocatePool (MemoryType, AllocationSize, CallSite);
+  if (Memory != NULL) {
+    Memory = ZeroMem (Memory, AllocationSize);
+  }
+
+  return Memory;
+}
+
+/**
+  Allocate pool initialised from a buffer and record it.
+**/
+STATIC
+VOID *
+InternalAllocateCopyPool (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            AllocationSize,
+  IN CONST VOID       *Buffer,
+  IN VOID             *CallSite
+  )
+{
+  VOID  *Memory;
+
+  ASSERT (Buffer != NULL);
+  ASSERT (AllocationSize <= (MAX_ADDRESS - (UINTN)Buffer + 1));
+
+  Memory = InternalAllocatePool (MemoryType, AllocationSize, CallSite);
+  if (Memory != NULL) {
+    Memory = CopyMem (Memory, Buffer, AllocationSize);
+  }
+
+  return Memory;
+}
+
+/**
+  Free pool if the tracker agrees it is live.
+**/
+STATIC
+VOID
+InternalFreePool (
+  IN VOID  *Buffer,
+  IN VOID  *CallSite
+  )
+{
+  EFI_STATUS  Status;
+
+  TrackRelease (Buffer, 0, TrackPool, CallSite);
+  Status = gBS->FreePool (Buffer);
+  TrackFreeResult (Buffer, Status, CallSite);
+}
+
+/**
+  Reallocate pool, recording the new buffer against the caller.
+**/
+STATIC
+VOID *
+InternalReallocatePool (
+  IN EFI_MEMORY_TYPE  MemoryType,
+  IN UINTN            OldSize,
+  IN UINTN            NewSize,
+  IN VOID             *OldBuffer OPTIONAL,
+  IN VOID             *CallSite
+  )
+{
+  VOID  *NewBuffer;
+
+  NewBuffer = InternalAllocateZeroPool (MemoryType, NewSize, CallSite);
+  if ((NewBuffer != NULL) && (OldBuffer != NULL)) {
+    CopyMem (NewBuffer, OldBuffer, MIN (OldSize, NewSize));
+    InternalFreePool (OldBuffer, CallSite);
+  }
+
+  return NewBuffer;
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiBootServicesData.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocatePages (
+  IN UINTN  Pages
+  )
+{
+  return InternalAllocatePages (EfiBootServicesData, Pages, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiRuntimeServicesData.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateRuntimePages (
+  IN UINTN  Pages
+  )
+{
+  return InternalAllocatePages (EfiRuntimeServicesData, Pages, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiReservedMemoryType.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateReservedPages (
+  IN UINTN  Pages
+  )
+{
+  return InternalAllocatePages (EfiReservedMemoryType, Pages, RETURN_ADDRESS (0));
+}
+
+/**
+  Frees one or more 4KB pages that were previously allocated with one of the
+  page allocation functions in the Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer of pages to free.
+  @param  Pages                 The number of 4 KB pages to free.
+**/
+VOID
+EFIAPI
+FreePages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  EFI_STATUS  Status;
+
+  ASSERT (Pages != 0);
+
+  TrackRelease (Buffer, EFI_PAGES_TO_SIZE (Pages), TrackPages, RETURN_ADDRESS (0));
+  Status = gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
+  TrackFreeResult (Buffer, Status, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiBootServicesData at a specified
+  alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation.
+                                Must be a power of two.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateAlignedPages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  return InternalAllocateAlignedPages (EfiBootServicesData, Pages, Alignment, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiRuntimeServicesData at a
+  specified alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation.
+                                Must be a power of two.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateAlignedRuntimePages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  return InternalAllocateAlignedPages (EfiRuntimeServicesData, Pages, Alignment, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates one or more 4KB pages of type EfiReservedMemoryType at a
+  specified alignment.
+
+  @param  Pages                 The number of 4 KB pages to allocate.
+  @param  Alignment             The requested alignment of the allocation.
+                                Must be a power of two.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateAlignedReservedPages (
+  IN UINTN  Pages,
+  IN UINTN  Alignment
+  )
+{
+  return InternalAllocateAlignedPages (EfiReservedMemoryType, Pages, Alignment, RETURN_ADDRESS (0));
+}
+
+/**
+  Frees one or more 4KB pages that were previously allocated with one of the
+  aligned page allocation functions in the Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer of pages to free.
+  @param  Pages                 The number of 4 KB pages to free.
+**/
+VOID
+EFIAPI
+FreeAlignedPages (
+  IN VOID   *Buffer,
+  IN UINTN  Pages
+  )
+{
+  EFI_STATUS  Status;
+
+  ASSERT (Pages != 0);
+
+  TrackRelease (Buffer, EFI_PAGES_TO_SIZE (Pages), TrackAlignedPages, RETURN_ADDRESS (0));
+  Status = gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
+  TrackFreeResult (Buffer, Status, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates a buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocatePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocatePool (EfiBootServicesData, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates a buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateRuntimePool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocatePool (EfiRuntimeServicesData, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates a buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateReservedPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocatePool (EfiReservedMemoryType, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates and zeros a buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocateZeroPool (EfiBootServicesData, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates and zeros a buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateRuntimeZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocateZeroPool (EfiRuntimeServicesData, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Allocates and zeros a buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateReservedZeroPool (
+  IN UINTN  AllocationSize
+  )
+{
+  return InternalAllocateZeroPool (EfiReservedMemoryType, AllocationSize, RETURN_ADDRESS (0));
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiBootServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  return InternalAllocateCopyPool (EfiBootServicesData, AllocationSize, Buffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiRuntimeServicesData.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateRuntimeCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  return InternalAllocateCopyPool (EfiRuntimeServicesData, AllocationSize, Buffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Copies a buffer to an allocated buffer of type EfiReservedMemoryType.
+
+  @param  AllocationSize        The number of bytes to allocate and zero.
+  @param  Buffer                The buffer to copy to the allocated buffer.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+AllocateReservedCopyPool (
+  IN UINTN       AllocationSize,
+  IN CONST VOID  *Buffer
+  )
+{
+  return InternalAllocateCopyPool (EfiReservedMemoryType, AllocationSize, Buffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Reallocates a buffer of type EfiBootServicesData.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. Optional.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+ReallocatePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  return InternalReallocatePool (EfiBootServicesData, OldSize, NewSize, OldBuffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Reallocates a buffer of type EfiRuntimeServicesData.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. Optional.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+ReallocateRuntimePool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  return InternalReallocatePool (EfiRuntimeServicesData, OldSize, NewSize, OldBuffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Reallocates a buffer of type EfiReservedMemoryType.
+
+  @param  OldSize        The size, in bytes, of OldBuffer.
+  @param  NewSize        The size, in bytes, of the buffer to reallocate.
+  @param  OldBuffer      The buffer to copy to the allocated buffer. Optional.
+
+  @return A pointer to the allocated buffer or NULL if allocation fails.
+**/
+VOID *
+EFIAPI
+ReallocateReservedPool (
+  IN UINTN  OldSize,
+  IN UINTN  NewSize,
+  IN VOID   *OldBuffer  OPTIONAL
+  )
+{
+  return InternalReallocatePool (EfiReservedMemoryType, OldSize, NewSize, OldBuffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Frees a buffer that was previously allocated with one of the pool
+  allocation functions in the Memory Allocation Library.
+
+  @param  Buffer                The pointer to the buffer to free.
+**/
+VOID
+EFIAPI
+FreePool (
+  IN VOID  *Buffer
+  )
+{
+  InternalFreePool (Buffer, RETURN_ADDRESS (0));
+}
+
+/**
+  Print one report line to the console.
+
+  UefiLib Print () allocates pool, so the report formats into a static
+  buffer instead to keep the table stable while it is walked.
+**/
+STATIC
+VOID
+EFIAPI
+TrackPrint (
+  IN CONST CHAR16  *Format,
+  ...
+  )
+{
+  STATIC CHAR16  Buffer[160];
+  VA_LIST        Marker;
+
+  VA_START (Marker, Format);
+  UnicodeVSPrint (Buffer, sizeof (Buffer), Format, Marker);
+  VA_END (Marker);
+
+  if ((gST != NULL) && (gST->ConOut != NULL)) {
+    gST->ConOut->OutputString (gST->ConOut, Buffer);
+  }
+}
+
+/**
+  Constructor: remember when tracking started.
+
+  @param  ImageHandle   The image handle of the application.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   Always.
+**/
+EFI_STATUS
+EFIAPI
+TrackingMemoryAllocationLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  mStartTicks = GetPerformanceCounter ();
+  return EFI_SUCCESS;
+}
+
+/**
+  Destructor: report outstanding allocations and peak usage, then release
+  the tracking table.
+
+  @param  ImageHandle   The image handle of the application.
+  @param  SystemTable   A pointer to the EFI System Table.
+
+  @retval EFI_SUCCESS   Always.
+**/
+EFI_STATUS
+EFIAPI
+TrackingMemoryAllocationLibDestructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_LOADED_IMAGE_PROTOCOL  *LoadedImage;
+  UINTN                      ImageBase;
+  UINTN                      ImageEnd;
+  UINT64                     Start;
+  UINT64                     End;
+  UINT64                     TicksPerMs;
+  TRACK_RECORD               *Record;
+  TRACK_RECORD_PAGE          *Page;
+  UINTN                      Bucket;
+  UINTN                      Shown;
+  UINTN                      Site;
+  UINT64                     Age;
+
+  ImageBase = 0;
+  ImageEnd  = 0;
+  Status    = gBS->HandleProtocol (ImageHandle, &gEfiLoadedImageProtocolGuid, (VOID **)&LoadedImage);
+  if (!EFI_ERROR (Status)) {
+    ImageBase = (UINTN)LoadedImage->ImageBase;
+    ImageEnd  = ImageBase + (UINTN)LoadedImage->ImageSize;
+  }
+
+  //
+  // A 1 ms calibration is enough to turn timestamps into milliseconds
+  //
+  Start = GetPerformanceCounter ();
+  gBS->Stall (TRACK_CALIBRATION_US);
+  End        = GetPerformanceCounter ();
+  TicksPerMs = (End >= Start) ? End - Start : Start - End;
+
+  TrackPrint (
+    L"\r\n[alloc] %d allocations, %d frees, peak %ld bytes, %d leaked (%ld bytes)\r\n",
+    mTotalAllocations,
+    mTotalFrees,
+    mPeakBytes,
+    mLiveCount,
+    mLiveBytes
+    );
+
+  if ((mRejectedFrees != 0) || (mMismatchedFrees != 0) || (mUntrackedFrees != 0)) {
+    TrackPrint (
+      L"[alloc] %d frees rejected by the firmware, %d mismatched frees, %d frees of untracked memory\r\n",
+      mRejectedFrees,
+      mMismatchedFrees,
+      mUntrackedFrees
+      );
+  }
+
+  if (mUntrackedAllocations != 0) {
+    TrackPrint (
+      L"[alloc] %d allocations could not be recorded and are not in the leak count\r\n",
+      mUntrackedAllocations
+      );
+  }
+
+  Shown = 0;
+  for (Bucket = 0; Bucket < TRACK_HASH_BUCKETS; Bucket++) {
+    for (Record = mBuckets[Bucket]; Record != NULL; Record = Record->Next) {
+      if (Shown++ >= TRACK_MAX_LEAKS_SHOWN) {
+        continue;
+      }
+
+      Site = (UINTN)Record->CallSite;
+      if ((Site >= ImageBase) && (Site < ImageEnd)) {
+        Site -= ImageBase;
+      }
+
+      Age = (Record->Ticks >= mStartTicks) ? Record->Ticks - mStartTicks : mStartTicks - Record->Ticks;
+      Age = (TicksPerMs == 0) ? 0 : DivU64x64Remainder (Age, TicksPerMs, NULL);
+
+      TrackPrint (
+        L"[alloc]   #%d %a %p %d bytes from %a0x%lx at %ld ms\r\n",
+        Record->Sequence,
+        (Record->Kind == TrackPool) ? "pool " : "pages",
+        Record->Buffer,
+        Record->Size,
+        ((UINTN)Record->CallSite != Site) ? "image+" : "",
+        (UINT64)Site,
+        Age
+        );
+    }
+  }
+
+  if (Shown > TRACK_MAX_LEAKS_SHOWN) {
+    TrackPrint (L"[alloc]   ... and %d more\r\n", Shown - TRACK_MAX_LEAKS_SHOWN);
+  }
+
+  //
+  // Leaked buffers stay allocated; only the table itself is released
+  //
+  while (mRecordPages != NULL) {
+    Page         = mRecordPages;
+    mRecordPages = Page->Next;
+    gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Page, 1);
+  }
+
+  ZeroMem (mBuckets, sizeof (mBuckets));
+  mFreeRecords = NULL;
+
+  return EFI_SUCCESS;
+}
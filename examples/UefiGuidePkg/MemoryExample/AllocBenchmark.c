@@ -0,0 +1,356 @@
+/** @file
+  Memory Services Example - allocation latency sweep.
+
+  Times each allocation service at power-of-two sizes from 16 B to 64 MB
+  and reports p50/p99/max latency and throughput per size. Results are also
+  written to \MemBench.csv on the boot volume, including a log2 latency
+  histogram per size, so runs on different firmware builds can be diffed.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/ExportFileLib.h>
+
+#include "MemoryExample.h"
+
+#define BENCH_MIN_SIZE        16
+#define BENCH_MAX_SIZE        SIZE_64MB
+#define BENCH_MAX_ITERATIONS  1000
+#define BENCH_MIN_ITERATIONS  8
+#define BENCH_BYTES_PER_SIZE  SIZE_64MB
+#define BENCH_ALIGNMENT       SIZE_64KB
+#define BENCH_CSV_FILE        L"\\MemBench.csv"
+
+//
+// Histogram bucket N counts samples below 2^(N + 7) ns; the last bucket
+// collects everything slower.
+//
+#define HISTOGRAM_BUCKETS     16
+#define HISTOGRAM_FIRST_SHIFT 7
+
+typedef enum {
+  BenchAllocatePool,
+  BenchAllocateZeroPool,
+  BenchAllocateCopyPool,
+  BenchAllocateAnyPages,
+  BenchAllocateMaxAddress,
+  BenchAllocateAlignedPages,
+  BenchMethodMax
+} ALLOC_BENCH_METHOD;
+
+STATIC CONST CHAR8  *mMethodNames[BenchMethodMax] = {
+  "AllocatePool",
+  "AllocateZeroPool",
+  "AllocateCopyPool",
+  "AllocatePages(Any)",
+  "AllocatePages(<4GB)",
+  "AllocateAlignedPages"
+};
+
+/**
+  Allocate one buffer with the given method.
+**/
+STATIC
+VOID *
+BenchAllocate (
+  IN ALLOC_BENCH_METHOD  Method,
+  IN UINTN               Size,
+  IN CONST VOID          *Source
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Address;
+
+  switch (Method) {
+    case BenchAllocatePool:
+      return AllocatePool (Size);
+
+    case BenchAllocateZeroPool:
+      return AllocateZeroPool (Size);
+
+    case BenchAllocateCopyPool:
+      return AllocateCopyPool (Size, Source);
+
+    case BenchAllocateAnyPages:
+    case BenchAllocateMaxAddress:
+      Address = (Method == BenchAllocateMaxAddress) ? 0xFFFFFFFF : 0;
+      Status  = gBS->AllocatePages (
+                       (Method == BenchAllocateMaxAddress) ? AllocateMaxAddress : AllocateAnyPages,
+                       EfiBootServicesData,
+                       EFI_SIZE_TO_PAGES (Size),
+                       &Address
+                       );
+      return EFI_ERROR (Status) ? NULL : (VOID *)(UINTN)Address;
+
+    case BenchAllocateAlignedPages:
+      return AllocateAlignedPages (EFI_SIZE_TO_PAGES (Size), BENCH_ALIGNMENT);
+
+    default:
+      return NULL;
+  }
+}
+
+/**
+  Free a buffer allocated by BenchAllocate ().
+**/
+STATIC
+VOID
+BenchFree (
+  IN ALLOC_BENCH_METHOD  Method,
+  IN UINTN               Size,
+  IN VOID                *Buffer
+  )
+{
+  switch (Method) {
+    case BenchAllocateAnyPages:
+    case BenchAllocateMaxAddress:
+      gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, EFI_SIZE_TO_PAGES (Size));
+      break;
+
+    case BenchAllocateAlignedPages:
+      FreeAlignedPages (Buffer, EFI_SIZE_TO_PAGES (Size));
+      break;
+
+    default:
+      FreePool (Buffer);
+      break;
+  }
+}
+
+/**
+  Format a byte count as B/KB/MB for display.
+**/
+STATIC
+VOID
+FormatSize (
+  IN  UINTN   Size,
+  OUT CHAR16  *Buffer,
+  IN  UINTN   BufferSize
+  )
+{
+  if (Size >= SIZE_1MB) {
+    UnicodeSPrint (Buffer, BufferSize, L"%d MB", Size / SIZE_1MB);
+  } else if (Size >= SIZE_1KB) {
+    UnicodeSPrint (Buffer, BufferSize, L"%d KB", Size / SIZE_1KB);
+  } else {
+    UnicodeSPrint (Buffer, BufferSize, L"%d B", Size);
+  }
+}
+
+/**
+  Run one method at one size, filling Samples with per-call latency in ns.
+**/
+STATIC
+EFI_STATUS
+RunBenchmark (
+  IN  ALLOC_BENCH_METHOD  Method,
+  IN  UINTN               Size,
+  IN  CONST VOID          *Source,
+  IN  UINTN               Iterations,
+  OUT UINT64              *Samples
+  )
+{
+  VOID    *Buffer;
+  UINTN   Index;
+  UINT64  Start;
+  UINT64  End;
+
+  for (Index = 0; Index < Iterations; Index++) {
+    Start  = BenchmarkGetTicks ();
+    Buffer = BenchAllocate (Method, Size, Source);
+    End    = BenchmarkGetTicks ();
+
+    if (Buffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Samples[Index] = BenchmarkElapsedNs (Start, End);
+    BenchFree (Method, Size, Buffer);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Write one CSV row: summary columns followed by the latency histogram.
+**/
+STATIC
+VOID
+WriteCsvRow (
+  IN EFI_FILE_PROTOCOL      *File,
+  IN ALLOC_BENCH_METHOD     Method,
+  IN UINTN                  Size,
+  IN CONST BENCHMARK_STATS  *Stats,
+  IN UINT64                 MBps,
+  IN CONST UINT64           *Samples
+  )
+{
+  UINTN  Histogram[HISTOGRAM_BUCKETS];
+  UINTN  Index;
+  UINTN  Bucket;
+
+  ZeroMem (Histogram, sizeof (Histogram));
+  for (Index = 0; Index < Stats->Count; Index++) {
+    Bucket = 0;
+    if (Samples[Index] != 0) {
+      Bucket = (UINTN)HighBitSet64 (Samples[Index]) + 1;
+      Bucket = (Bucket > HISTOGRAM_FIRST_SHIFT) ? Bucket - HISTOGRAM_FIRST_SHIFT : 0;
+    }
+
+    Histogram[MIN (Bucket, HISTOGRAM_BUCKETS - 1)]++;
+  }
+
+  FilePrint (
+    File,
+    "%a,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld",
+    mMethodNames[Method],
+    (UINT64)Size,
+    (UINT64)Stats->Count,
+    Stats->Min,
+    Stats->P50,
+    Stats->P99,
+    Stats->Max,
+    Stats->Mean,
+    MBps
+    );
+
+  for (Bucket = 0; Bucket < HISTOGRAM_BUCKETS; Bucket++) {
+    FilePrint (File, ",%ld", (UINT64)Histogram[Bucket]);
+  }
+
+  FilePrint (File, "\n");
+}
+
+/**
+  Write the CSV header row.
+**/
+STATIC
+VOID
+WriteCsvHeader (
+  IN EFI_FILE_PROTOCOL  *File
+  )
+{
+  UINTN  Bucket;
+
+  FilePrint (
+    File,
+    "# firmware=%s revision=0x%08x\n",
+    gST->FirmwareVendor,
+    gST->FirmwareRevision
+    );
+  FilePrint (File, "method,size,iterations,min_ns,p50_ns,p99_ns,max_ns,mean_ns,mb_per_s");
+  for (Bucket = 0; Bucket < HISTOGRAM_BUCKETS - 1; Bucket++) {
+    FilePrint (File, ",lt_%ldns", LShiftU64 (1, Bucket + HISTOGRAM_FIRST_SHIFT));
+  }
+
+  FilePrint (File, ",ge_%ldns\n", LShiftU64 (1, HISTOGRAM_BUCKETS - 2 + HISTOGRAM_FIRST_SHIFT));
+}
+
+/**
+  Sweep the allocation services across sizes and report latency percentiles.
+**/
+EFI_STATUS
+DemoAllocBenchmark (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS          Status;
+  EFI_FILE_PROTOCOL   *CsvFile;
+  UINTN               Method;
+  UINT64              *Samples;
+  VOID                *Source;
+  UINTN               Size;
+  UINTN               Iterations;
+  UINT64              TotalNs;
+  UINT64              MBps;
+  UINTN               Index;
+  BENCHMARK_STATS     Stats;
+  CHAR16              SizeText[16];
+
+  Print (L"\n=== Allocation Latency Sweep ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Samples = AllocatePool (BENCH_MAX_ITERATIONS * sizeof (UINT64));
+  Source  = AllocatePages (EFI_SIZE_TO_PAGES (BENCH_MAX_SIZE));
+  if ((Samples == NULL) || (Source == NULL)) {
+    Print (L"Failed to allocate benchmark buffers\n");
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  SetMem (Source, BENCH_MAX_SIZE, 0x5A);
+
+  Status = OpenBootVolumeFile (ImageHandle, BENCH_CSV_FILE, &CsvFile);
+  if (EFI_ERROR (Status)) {
+    Print (L"CSV output disabled (%r)\n", Status);
+    CsvFile = NULL;
+  } else {
+    WriteCsvHeader (CsvFile);
+  }
+
+  for (Method = 0; Method < BenchMethodMax; Method++) {
+    Print (L"\n%a\n", mMethodNames[Method]);
+    Print (L"    Size   Iter    p50 ns    p99 ns     max ns      MB/s\n");
+    Print (L"-------- ------ --------- --------- ---------- ---------\n");
+
+    for (Size = BENCH_MIN_SIZE; Size <= BENCH_MAX_SIZE; Size *= 2) {
+      Iterations = BENCH_BYTES_PER_SIZE / Size;
+      Iterations = MAX (MIN (Iterations, BENCH_MAX_ITERATIONS), BENCH_MIN_ITERATIONS);
+
+      FormatSize (Size, SizeText, sizeof (SizeText));
+
+      Status = RunBenchmark ((ALLOC_BENCH_METHOD)Method, Size, Source, Iterations, Samples);
+      if (EFI_ERROR (Status)) {
+        Print (L"%8s   allocation failed: %r\n", SizeText, Status);
+        continue;
+      }
+
+      TotalNs = 0;
+      for (Index = 0; Index < Iterations; Index++) {
+        TotalNs += Samples[Index];
+      }
+
+      MBps = BenchmarkMBps (MultU64x32 (Size, (UINT32)Iterations), TotalNs);
+      BenchmarkComputeStats (Samples, Iterations, &Stats);
+
+      Print (L"%8s %6d %9ld %9ld %10ld %9ld\n",
+             SizeText, Iterations, Stats.P50, Stats.P99, Stats.Max, MBps);
+
+      if (CsvFile != NULL) {
+        WriteCsvRow (CsvFile, (ALLOC_BENCH_METHOD)Method, Size, &Stats, MBps, Samples);
+      }
+    }
+  }
+
+  Status = EFI_SUCCESS;
+
+  if (CsvFile != NULL) {
+    CsvFile->Flush (CsvFile);
+    CsvFile->Close (CsvFile);
+    Print (L"\nResults written to %s\n", BENCH_CSV_FILE);
+  }
+
+Done:
+  if (Source != NULL) {
+    FreePages (Source, EFI_SIZE_TO_PAGES (BENCH_MAX_SIZE));
+  }
+
+  if (Samples != NULL) {
+    FreePool (Samples);
+  }
+
+  return Status;
+}
@@ -7,6 +7,10 @@
   3. Get the memory map
   4. Use memory allocation library
 
+  Usage: MemoryExample.efi [mode]
+         Without a mode the basic pool/page/memory map demos run.
+         "MemoryExample.efi help" lists the benchmark modes.
+
   Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
@@ -15,37 +19,40 @@
 #include <Library/UefiApplicationEntryPoint.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryMapLib.h>
+#include <Protocol/ShellParameters.h>
 
-/**
-  Display memory type as a string.
-**/
-CONST CHAR16 *
-GetMemoryTypeString (
-  IN EFI_MEMORY_TYPE  Type
-  )
-{
-  switch (Type) {
-    case EfiReservedMemoryType:      return L"Reserved";
-    case EfiLoaderCode:              return L"LoaderCode";
-    case EfiLoaderData:              return L"LoaderData";
-    case EfiBootServicesCode:        return L"BS Code";
-    case EfiBootServicesData:        return L"BS Data";
-    case EfiRuntimeServicesCode:     return L"RT Code";
-    case EfiRuntimeServicesData:     return L"RT Data";
-    case EfiConventionalMemory:      return L"Conventional";
-    case EfiUnusableMemory:          return L"Unusable";
-    case EfiACPIReclaimMemory:       return L"ACPI Reclaim";
-    case EfiACPIMemoryNVS:           return L"ACPI NVS";
-    case EfiMemoryMappedIO:          return L"MMIO";
-    case EfiMemoryMappedIOPortSpace: return L"MMIO Port";
-    case EfiPalCode:                 return L"PAL Code";
-    case EfiPersistentMemory:        return L"Persistent";
-    default:                         return L"Unknown";
-  }
-}
+#include "MemoryExample.h"
+
+typedef
+EFI_STATUS
+(*MEMORY_EXAMPLE_MODE_FUNCTION)(
+  IN EFI_HANDLE  ImageHandle
+  );
+
+typedef struct {
+  CONST CHAR16                    *Name;
+  MEMORY_EXAMPLE_MODE_FUNCTION    Function;
+  CONST CHAR16                    *Description;
+} MEMORY_EXAMPLE_MODE;
+
+//
+// Optional modes selected by the first command line argument
+//
+STATIC CONST MEMORY_EXAMPLE_MODE  mModes[] = {
+  { L"slab",      DemoSlabArena,       L"Slab/arena allocators vs AllocatePool (ns/op)" },
+  { L"bench",     DemoAllocBenchmark,  L"Allocation latency sweep 16 B - 64 MB (+CSV)"  },
+  { L"diff",      DemoMemoryMapDiff,   L"Memory map diff across allocation phases"      },
+  { L"largepage", DemoLargePages,      L"2 MB / 1 GB aligned EfiLoaderData allocations" },
+  { L"parallel",  DemoParallelFill,    L"Zero/fill/copy GB/s scaling across processors" },
+  { L"stream",    DemoStreamBenchmark, L"STREAM bandwidth and pointer-chase latency"    },
+  { L"export",    DemoMemoryMapExport, L"Write memory map to \\MemMap.bin and .csv"     },
+  { L"recycle",   DemoPagePool,        L"Page pool recycler vs AllocatePages/FreePages" },
+};
 
 /**
   Demonstrate pool memory allocation.
@@ -214,84 +221,119 @@ DemoMemoryMap (
   VOID
   )
 {
-  EFI_STATUS             Status;
-  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
-  EFI_MEMORY_DESCRIPTOR  *Entry;
-  UINTN                  MemoryMapSize;
-  UINTN                  MapKey;
-  UINTN                  DescriptorSize;
-  UINT32                 DescriptorVersion;
-  UINTN                  Index;
-  UINTN                  EntryCount;
+  EFI_STATUS               Status;
+  MEMORY_MAP_SNAPSHOT      Snapshot;
+  CONST MEMORY_MAP_REGION  *Region;
+  UINTN                    Index;
+  UINT32                   Type;
 
   Print (L"\n=== Memory Map ===\n\n");
 
   //
-  // First call to get required buffer size
+  // MemoryMapLib does the two-call GetMemoryMap () sequence, then sorts and
+  // coalesces adjacent descriptors with identical type and attributes
   //
-  MemoryMapSize = 0;
-  Status = gBS->GetMemoryMap (
-                  &MemoryMapSize,
-                  NULL,
-                  &MapKey,
-                  &DescriptorSize,
-                  &DescriptorVersion
-                  );
-
-  if (Status != EFI_BUFFER_TOO_SMALL) {
-    Print (L"Unexpected error: %r\n", Status);
+  Status = MemoryMapSnapshotCapture (&Snapshot);
+  if (EFI_ERROR (Status)) {
+    Print (L"GetMemoryMap failed: %r\n", Status);
     return Status;
   }
 
-  //
-  // Allocate buffer (add extra space for map changes during allocation)
-  //
-  MemoryMapSize += 2 * DescriptorSize;
-  MemoryMap = AllocatePool (MemoryMapSize);
-  if (MemoryMap == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  Print (L"Memory map has %d descriptors, %d regions after coalescing\n",
+         Snapshot.DescriptorCount, Snapshot.RegionCount);
+  Print (L"Descriptor size: %d bytes, version %d\n\n",
+         Snapshot.DescriptorSize, Snapshot.DescriptorVersion);
+
+  Print (L"Regions (showing first 10):\n\n");
+  Print (L"Type           Physical Start   Pages      Attributes       Desc\n");
+  Print (L"-------------- ---------------- ---------- ---------------- ----\n");
+
+  for (Index = 0; Index < Snapshot.RegionCount && Index < 10; Index++) {
+    Region = &Snapshot.Regions[Index];
+    Print (L"%-14s %016lx %10ld %016lx %4d\n",
+           MemoryTypeToString (Region->Type),
+           Region->Start,
+           Region->NumberOfPages,
+           Region->Attribute,
+           Region->DescriptorCount
+           );
+  }
+
+  if (Snapshot.RegionCount > 10) {
+    Print (L"... and %d more regions\n", Snapshot.RegionCount - 10);
+  }
+
+  Print (L"\nTotals by type:\n");
+  for (Type = 0; Type < EfiMaxMemoryType; Type++) {
+    if (Snapshot.PagesByType[Type] != 0) {
+      Print (L"  %-14s %10ld pages (%ld MB)\n",
+             MemoryTypeToString (Type),
+             Snapshot.PagesByType[Type],
+             RShiftU64 (Snapshot.PagesByType[Type], 8)
+             );
+    }
   }
 
   //
-  // Get the actual memory map
+  // Binary search: which region holds this function's code and our stack?
   //
-  Status = gBS->GetMemoryMap (
-                  &MemoryMapSize,
-                  MemoryMap,
-                  &MapKey,
-                  &DescriptorSize,
-                  &DescriptorVersion
-                  );
+  Print (L"\nAddress lookup:\n");
+  Region = MemoryMapSnapshotFind (&Snapshot, (EFI_PHYSICAL_ADDRESS)(UINTN)DemoMemoryMap);
+  if (Region != NULL) {
+    Print (L"  Code  0x%lx is in %s region at 0x%lx\n",
+           (UINT64)(UINTN)DemoMemoryMap, MemoryTypeToString (Region->Type), Region->Start);
+  }
 
-  if (EFI_ERROR (Status)) {
-    Print (L"GetMemoryMap failed: %r\n", Status);
-    FreePool (MemoryMap);
-    return Status;
+  Region = MemoryMapSnapshotFind (&Snapshot, (EFI_PHYSICAL_ADDRESS)(UINTN)&Snapshot);
+  if (Region != NULL) {
+    Print (L"  Stack 0x%lx is in %s region at 0x%lx\n",
+           (UINT64)(UINTN)&Snapshot, MemoryTypeToString (Region->Type), Region->Start);
   }
 
-  EntryCount = MemoryMapSize / DescriptorSize;
-  Print (L"Memory map has %d entries (showing first 10):\n\n", EntryCount);
-  Print (L"Type           Physical Start   Pages      Attributes\n");
-  Print (L"-------------- ---------------- ---------- ----------------\n");
-
-  Entry = MemoryMap;
-  for (Index = 0; Index < EntryCount && Index < 10; Index++) {
-    Print (L"%-14s %016lx %10ld %016lx\n",
-           GetMemoryTypeString (Entry->Type),
-           Entry->PhysicalStart,
-           Entry->NumberOfPages,
-           Entry->Attribute
-           );
+  MemoryMapSnapshotFree (&Snapshot);
+  return EFI_SUCCESS;
+}
 
-    Entry = NEXT_MEMORY_DESCRIPTOR (Entry, DescriptorSize);
-  }
+/**
+  Get the mode argument passed on the shell command line, if any.
+**/
+CONST CHAR16 *
+GetModeArgument (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
 
-  if (EntryCount > 10) {
-    Print (L"... and %d more entries\n", EntryCount - 10);
+  Status = gBS->HandleProtocol (
+                  ImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **)&ShellParameters
+                  );
+
+  if (EFI_ERROR (Status) || (ShellParameters->Argc < 2)) {
+    return NULL;
   }
 
-  FreePool (MemoryMap);
-  return EFI_SUCCESS;
+  return ShellParameters->Argv[1];
+}
+
+/**
+  Print the available modes.
+**/
+VOID
+PrintUsage (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  Print (L"\nUsage: MemoryExample.efi [mode]\n\n");
+  Print (L"Without a mode the basic allocation demos run.\n\n");
+  Print (L"Modes:\n");
+  for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+    Print (L"  %-10s %s\n", mModes[Index].Name, mModes[Index].Description);
+  }
 }
 
 /**
@@ -304,11 +346,25 @@ MemoryExampleMain (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
-  EFI_STATUS  Status;
+  EFI_STATUS    Status;
+  CONST CHAR16  *Mode;
+  UINTN         Index;
 
   Print (L"Memory Services Example\n");
   Print (L"=======================\n");
 
+  Mode = GetModeArgument (ImageHandle);
+  if (Mode != NULL) {
+    for (Index = 0; Index < ARRAY_SIZE (mModes); Index++) {
+      if (StrCmp (Mode, mModes[Index].Name) == 0) {
+        return mModes[Index].Function (ImageHandle);
+      }
+    }
+
+    PrintUsage ();
+    return (StrCmp (Mode, L"help") == 0) ? EFI_SUCCESS : EFI_INVALID_PARAMETER;
+  }
+
   Status = DemoPoolAllocation ();
   if (EFI_ERROR (Status)) {
     return Status;
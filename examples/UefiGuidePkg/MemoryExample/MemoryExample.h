@@ -0,0 +1,78 @@
+/** @file
+  Memory Services Example - shared declarations for the example modes.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef MEMORY_EXAMPLE_H_
+#define MEMORY_EXAMPLE_H_
+
+#include <Uefi.h>
+#include <Protocol/SimpleFileSystem.h>
+
+/**
+  Benchmark slab and arena allocators against gBS->AllocatePool.
+**/
+EFI_STATUS
+DemoSlabArena (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Sweep the allocation services across sizes and report latency percentiles.
+**/
+EFI_STATUS
+DemoAllocBenchmark (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Snapshot the memory map at labelled phases and print the diffs.
+**/
+EFI_STATUS
+DemoMemoryMapDiff (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Compare plain and large-page-aligned placement of multi-megabyte buffers.
+**/
+EFI_STATUS
+DemoLargePages (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Measure multi-processor zero/fill/copy throughput from 1 to N cores.
+**/
+EFI_STATUS
+DemoParallelFill (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Measure memory bandwidth (STREAM) and load latency (pointer chase).
+**/
+EFI_STATUS
+DemoStreamBenchmark (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Export the current memory map to binary and CSV files on the boot volume.
+**/
+EFI_STATUS
+DemoMemoryMapExport (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+/**
+  Compare the page pool recycler with direct page allocation.
+**/
+EFI_STATUS
+DemoPagePool (
+  IN EFI_HANDLE  ImageHandle
+  );
+
+#endif // MEMORY_EXAMPLE_H_
@@ -0,0 +1,307 @@
+/** @file
+  Memory Services Example - memory map diff across phases.
+
+  Captures labelled memory map snapshots at the start of the run, after a
+  burst of page and pool allocations, and just before exit, then prints what
+  changed between each pair: regions that appeared, vanished, split, merged
+  or changed type, the raw descriptor count delta, and how many pages moved
+  between EfiConventionalMemory and boot services / loader data. A phase
+  that fragments conventional memory shows up as a growing descriptor count,
+  which is what makes the GetMemoryMap/ExitBootServices retry loop slower.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MemoryMapLib.h>
+
+#include "MemoryExample.h"
+
+#define CHURN_PAGE_ALLOCATIONS  32
+#define CHURN_POOL_ALLOCATIONS  256
+#define MAX_CHANGES_SHOWN       16
+
+typedef enum {
+  PhaseStart,
+  PhaseAfterAllocations,
+  PhaseBeforeExit,
+  PhaseMax
+} DIFF_PHASE;
+
+typedef struct {
+  CONST CHAR16           *Label;
+  MEMORY_MAP_SNAPSHOT    Snapshot;
+} LABELLED_SNAPSHOT;
+
+STATIC CONST CHAR16  *mChangeNames[] = {
+  L"Appeared",
+  L"Vanished",
+  L"Split",
+  L"Merged",
+  L"TypeChanged",
+  L"Resized"
+};
+
+//
+// Types whose page transitions are summarised after each diff
+//
+STATIC CONST UINT32  mTrackedTypes[] = {
+  EfiConventionalMemory,
+  EfiBootServicesData,
+  EfiLoaderData
+};
+
+/**
+  Print one region as "Type Start+Pages".
+**/
+STATIC
+VOID
+PrintRegion (
+  IN CONST MEMORY_MAP_REGION  *Region
+  )
+{
+  Print (L"%-12s %012lx+%-8ld",
+         MemoryTypeToString (Region->Type),
+         Region->Start,
+         Region->NumberOfPages
+         );
+}
+
+/**
+  Print the diff between two labelled snapshots.
+**/
+STATIC
+EFI_STATUS
+PrintSnapshotDiff (
+  IN CONST LABELLED_SNAPSHOT  *Old,
+  IN CONST LABELLED_SNAPSHOT  *New
+  )
+{
+  EFI_STATUS               Status;
+  MEMORY_MAP_DIFF          Diff;
+  CONST MEMORY_MAP_CHANGE  *Change;
+  UINTN                    Counts[ARRAY_SIZE (mChangeNames)];
+  UINTN                    Index;
+  UINTN                    From;
+  UINTN                    To;
+  UINT64                   Pages;
+
+  Status = MemoryMapSnapshotDiff (&Old->Snapshot, &New->Snapshot, &Diff);
+  if (EFI_ERROR (Status)) {
+    Print (L"Diff failed: %r\n", Status);
+    return Status;
+  }
+
+  Print (L"\n--- \"%s\" -> \"%s\" ---\n", Old->Label, New->Label);
+  Print (L"Descriptors: %d -> %d (%s%d)   Regions: %d -> %d (%s%d)\n",
+         Old->Snapshot.DescriptorCount,
+         New->Snapshot.DescriptorCount,
+         (Diff.DescriptorDelta >= 0) ? L"+" : L"",
+         Diff.DescriptorDelta,
+         Old->Snapshot.RegionCount,
+         New->Snapshot.RegionCount,
+         (Diff.RegionDelta >= 0) ? L"+" : L"",
+         Diff.RegionDelta
+         );
+
+  ZeroMem (Counts, sizeof (Counts));
+  for (Index = 0; Index < Diff.ChangeCount; Index++) {
+    Counts[Diff.Changes[Index].Kind]++;
+  }
+
+  Print (L"Changes:");
+  for (Index = 0; Index < ARRAY_SIZE (mChangeNames); Index++) {
+    Print (L" %s=%d", mChangeNames[Index], Counts[Index]);
+  }
+
+  Print (L"\n");
+
+  for (Index = 0; Index < Diff.ChangeCount && Index < MAX_CHANGES_SHOWN; Index++) {
+    Change = &Diff.Changes[Index];
+    Print (L"  %-11s ", mChangeNames[Change->Kind]);
+    switch (Change->Kind) {
+      case MemoryMapChangeAppeared:
+        PrintRegion (&Change->New);
+        break;
+
+      case MemoryMapChangeVanished:
+        PrintRegion (&Change->Old);
+        break;
+
+      case MemoryMapChangeSplit:
+        PrintRegion (&Change->Old);
+        Print (L" -> %d pieces", Change->Pieces);
+        break;
+
+      case MemoryMapChangeMerged:
+        Print (L"%d pieces -> ", Change->Pieces);
+        PrintRegion (&Change->New);
+        break;
+
+      default:
+        PrintRegion (&Change->Old);
+        Print (L" -> ");
+        PrintRegion (&Change->New);
+        break;
+    }
+
+    Print (L"\n");
+  }
+
+  if (Diff.ChangeCount > MAX_CHANGES_SHOWN) {
+    Print (L"  ... and %d more changes\n", Diff.ChangeCount - MAX_CHANGES_SHOWN);
+  }
+
+  //
+  // Pages that changed hands between conventional memory and the data types
+  // an application or loader allocates from
+  //
+  Print (L"Pages moved:\n");
+  for (From = 0; From < ARRAY_SIZE (mTrackedTypes); From++) {
+    for (To = 0; To < ARRAY_SIZE (mTrackedTypes); To++) {
+      Pages = Diff.Transitions[mTrackedTypes[From]][mTrackedTypes[To]];
+      if (Pages != 0) {
+        Print (L"  %-12s -> %-12s %8ld pages (%ld KB)\n",
+               MemoryTypeToString (mTrackedTypes[From]),
+               MemoryTypeToString (mTrackedTypes[To]),
+               Pages,
+               MultU64x32 (Pages, 4)
+               );
+      }
+    }
+  }
+
+  MemoryMapDiffFree (&Diff);
+  return EFI_SUCCESS;
+}
+
+/**
+  Allocate pages of alternating type and size, then free every other one so
+  the survivors leave holes in conventional memory.
+**/
+STATIC
+VOID
+ChurnAllocate (
+  OUT EFI_PHYSICAL_ADDRESS  *PageBuffers,
+  OUT VOID                  **PoolBuffers
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < CHURN_PAGE_ALLOCATIONS; Index++) {
+    Status = gBS->AllocatePages (
+                    AllocateAnyPages,
+                    ((Index & 1) != 0) ? EfiLoaderData : EfiBootServicesData,
+                    (Index % 7) + 1,
+                    &PageBuffers[Index]
+                    );
+    if (EFI_ERROR (Status)) {
+      PageBuffers[Index] = 0;
+    }
+  }
+
+  for (Index = 0; Index < CHURN_PAGE_ALLOCATIONS; Index += 2) {
+    if (PageBuffers[Index] != 0) {
+      gBS->FreePages (PageBuffers[Index], (Index % 7) + 1);
+      PageBuffers[Index] = 0;
+    }
+  }
+
+  for (Index = 0; Index < CHURN_POOL_ALLOCATIONS; Index++) {
+    PoolBuffers[Index] = AllocatePool (16 << (Index % 10));
+  }
+}
+
+/**
+  Release everything ChurnAllocate () left allocated.
+**/
+STATIC
+VOID
+ChurnFree (
+  IN EFI_PHYSICAL_ADDRESS  *PageBuffers,
+  IN VOID                  **PoolBuffers
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < CHURN_PAGE_ALLOCATIONS; Index++) {
+    if (PageBuffers[Index] != 0) {
+      gBS->FreePages (PageBuffers[Index], (Index % 7) + 1);
+    }
+  }
+
+  for (Index = 0; Index < CHURN_POOL_ALLOCATIONS; Index++) {
+    if (PoolBuffers[Index] != NULL) {
+      FreePool (PoolBuffers[Index]);
+    }
+  }
+}
+
+/**
+  Snapshot the memory map at labelled phases and print the diffs.
+**/
+EFI_STATUS
+DemoMemoryMapDiff (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS            Status;
+  LABELLED_SNAPSHOT     Phases[PhaseMax];
+  EFI_PHYSICAL_ADDRESS  PageBuffers[CHURN_PAGE_ALLOCATIONS];
+  VOID                  *PoolBuffers[CHURN_POOL_ALLOCATIONS];
+  UINTN                 Index;
+
+  Print (L"\n=== Memory Map Diff ===\n");
+
+  ZeroMem (Phases, sizeof (Phases));
+  Phases[PhaseStart].Label            = L"start";
+  Phases[PhaseAfterAllocations].Label = L"after allocations";
+  Phases[PhaseBeforeExit].Label       = L"before exit";
+
+  //
+  // Snapshots are pool allocations themselves, so each capture adds a little
+  // BS data churn of its own; it is small next to the phases being measured
+  //
+  Status = MemoryMapSnapshotCapture (&Phases[PhaseStart].Snapshot);
+  if (EFI_ERROR (Status)) {
+    Print (L"Snapshot \"%s\" failed: %r\n", Phases[PhaseStart].Label, Status);
+    return Status;
+  }
+
+  ChurnAllocate (PageBuffers, PoolBuffers);
+
+  Status = MemoryMapSnapshotCapture (&Phases[PhaseAfterAllocations].Snapshot);
+  ChurnFree (PageBuffers, PoolBuffers);
+  if (EFI_ERROR (Status)) {
+    Print (L"Snapshot \"%s\" failed: %r\n", Phases[PhaseAfterAllocations].Label, Status);
+    goto Done;
+  }
+
+  Status = MemoryMapSnapshotCapture (&Phases[PhaseBeforeExit].Snapshot);
+  if (EFI_ERROR (Status)) {
+    Print (L"Snapshot \"%s\" failed: %r\n", Phases[PhaseBeforeExit].Label, Status);
+    goto Done;
+  }
+
+  PrintSnapshotDiff (&Phases[PhaseStart], &Phases[PhaseAfterAllocations]);
+  PrintSnapshotDiff (&Phases[PhaseAfterAllocations], &Phases[PhaseBeforeExit]);
+
+  //
+  // Anything left here is churn that survived the whole run
+  //
+  PrintSnapshotDiff (&Phases[PhaseStart], &Phases[PhaseBeforeExit]);
+
+Done:
+  for (Index = 0; Index < PhaseMax; Index++) {
+    MemoryMapSnapshotFree (&Phases[Index].Snapshot);
+  }
+
+  return Status;
+}
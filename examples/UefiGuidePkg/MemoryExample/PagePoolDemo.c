@@ -0,0 +1,260 @@
+/** @file
+  Memory Services Example - page pool recycler benchmark.
+
+  Compares gBS->AllocatePages/FreePages with a PAGE_POOL for the pattern a
+  multi-image loader produces: a buffer is allocated for a file, the file is
+  staged, the buffer is freed, and the next file asks for a similar size.
+  The first table times one allocate/free pair per size; the second replays
+  a sequence of mixed file sizes several times, the way a loader staging a
+  kernel, initrd and a few dozen modules would.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/PagePoolLib.h>
+
+#include "MemoryExample.h"
+
+#define RECYCLE_ITERATIONS  500
+#define LOADER_PASSES       8
+
+//
+// Sizes timed individually in the first table
+//
+STATIC CONST UINTN  mRunSizes[] = {
+  SIZE_4KB,
+  SIZE_64KB,
+  SIZE_512KB,
+  SIZE_2MB,
+  SIZE_8MB,
+  SIZE_32MB
+};
+
+//
+// File sizes of one simulated loader pass, in staging order
+//
+STATIC CONST UINTN  mLoaderFiles[] = {
+  SIZE_8MB,   SIZE_32MB,  SIZE_64KB,  SIZE_64KB,  SIZE_512KB, SIZE_64KB,
+  SIZE_64KB,  SIZE_512KB, SIZE_64KB,  SIZE_2MB,   SIZE_64KB,  SIZE_64KB,
+  SIZE_512KB, SIZE_64KB,  SIZE_64KB,  SIZE_64KB,  SIZE_2MB,   SIZE_64KB,
+  SIZE_64KB,  SIZE_512KB, SIZE_64KB,  SIZE_64KB,  SIZE_64KB,  SIZE_512KB
+};
+
+/**
+  Time RECYCLE_ITERATIONS allocate/free pairs at one size, in ns per pair.
+
+  Pool is NULL to go straight to gBS->AllocatePages/FreePages.
+**/
+STATIC
+EFI_STATUS
+TimeRecycle (
+  IN  PAGE_POOL  *Pool OPTIONAL,
+  IN  UINTN      Pages,
+  OUT UINT64     *Samples
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Address;
+  VOID                  *Buffer;
+  UINTN                 Index;
+  UINT64                Start;
+
+  for (Index = 0; Index < RECYCLE_ITERATIONS; Index++) {
+    Start = BenchmarkGetTicks ();
+    if (Pool == NULL) {
+      Status = gBS->AllocatePages (AllocateAnyPages, EfiLoaderData, Pages, &Address);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      *(volatile UINT8 *)(UINTN)Address = (UINT8)Index;
+      gBS->FreePages (Address, Pages);
+    } else {
+      Buffer = PagePoolAlloc (Pool, Pages);
+      if (Buffer == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+
+      *(volatile UINT8 *)Buffer = (UINT8)Index;
+      PagePoolFree (Pool, Buffer, Pages);
+    }
+
+    Samples[Index] = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Replay LOADER_PASSES passes over mLoaderFiles and return the total in ns.
+
+  Each file's buffer is allocated, written once and freed before the next
+  file, as a loader that hands each image off before staging the next does.
+**/
+STATIC
+EFI_STATUS
+TimeLoader (
+  IN  PAGE_POOL  *Pool OPTIONAL,
+  OUT UINT64     *ElapsedNs
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Address;
+  VOID                  *Buffer;
+  UINTN                 Pass;
+  UINTN                 Index;
+  UINTN                 Pages;
+  UINT64                Start;
+
+  Start = BenchmarkGetTicks ();
+  for (Pass = 0; Pass < LOADER_PASSES; Pass++) {
+    for (Index = 0; Index < ARRAY_SIZE (mLoaderFiles); Index++) {
+      Pages = EFI_SIZE_TO_PAGES (mLoaderFiles[Index]);
+      if (Pool == NULL) {
+        Status = gBS->AllocatePages (AllocateAnyPages, EfiLoaderData, Pages, &Address);
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+
+        Buffer = (VOID *)(UINTN)Address;
+      } else {
+        Buffer = PagePoolAlloc (Pool, Pages);
+        if (Buffer == NULL) {
+          return EFI_OUT_OF_RESOURCES;
+        }
+      }
+
+      *(volatile UINT8 *)Buffer = (UINT8)Index;
+
+      if (Pool == NULL) {
+        gBS->FreePages ((EFI_PHYSICAL_ADDRESS)(UINTN)Buffer, Pages);
+      } else {
+        PagePoolFree (Pool, Buffer, Pages);
+      }
+    }
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return EFI_SUCCESS;
+}
+
+/**
+  Print a p50 ratio as "N.NNx".
+**/
+STATIC
+VOID
+PrintSpeedup (
+  IN UINT64  BaselineNs,
+  IN UINT64  Ns
+  )
+{
+  UINT64  SpeedupX100;
+
+  SpeedupX100 = (Ns == 0) ? 0 : DivU64x64Remainder (MultU64x32 (BaselineNs, 100), Ns, NULL);
+  Print (L"  %4ld.%02dx\n", DivU64x32 (SpeedupX100, 100), ModU64x32 (SpeedupX100, 100));
+}
+
+/**
+  Compare the page pool recycler with direct page allocation.
+**/
+EFI_STATUS
+DemoPagePool (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS       Status;
+  PAGE_POOL        Pool;
+  UINT64           *Samples;
+  UINTN            Index;
+  UINTN            Pages;
+  BENCHMARK_STATS  Direct;
+  BENCHMARK_STATS  Pooled;
+  UINT64           DirectNs;
+  UINT64           PooledNs;
+
+  Print (L"\n=== Page Pool Recycler ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Samples = AllocatePool (RECYCLE_ITERATIONS * sizeof (UINT64));
+  if (Samples == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Cap the pool at 64 MB so the largest loader file fits alongside the rest
+  //
+  PagePoolInit (&Pool, EfiLoaderData, EFI_SIZE_TO_PAGES (SIZE_64MB));
+
+  Print (L"Allocate + free pair, %d iterations per size\n\n", RECYCLE_ITERATIONS);
+  Print (L"    Size  AllocatePages p50/p99 ns   PagePool p50/p99 ns     Speedup\n");
+  Print (L"--------  -------------------------  ---------------------  --------\n");
+
+  for (Index = 0; Index < ARRAY_SIZE (mRunSizes); Index++) {
+    Pages = EFI_SIZE_TO_PAGES (mRunSizes[Index]);
+
+    Status = TimeRecycle (NULL, Pages, Samples);
+    if (!EFI_ERROR (Status)) {
+      BenchmarkComputeStats (Samples, RECYCLE_ITERATIONS, &Direct);
+      Status = TimeRecycle (&Pool, Pages, Samples);
+    }
+
+    if (EFI_ERROR (Status)) {
+      Print (L"%5d KB   allocation failed: %r\n", mRunSizes[Index] / SIZE_1KB, Status);
+      continue;
+    }
+
+    BenchmarkComputeStats (Samples, RECYCLE_ITERATIONS, &Pooled);
+
+    Print (L"%5d KB  %12ld / %-10ld  %9ld / %-9ld",
+           mRunSizes[Index] / SIZE_1KB,
+           Direct.P50,
+           Direct.P99,
+           Pooled.P50,
+           Pooled.P99
+           );
+    PrintSpeedup (Direct.P50, Pooled.P50);
+  }
+
+  PagePoolTrim (&Pool);
+  FreePool (Samples);
+
+  Print (L"\nLoader replay: %d files x %d passes\n\n", ARRAY_SIZE (mLoaderFiles), LOADER_PASSES);
+
+  Status = TimeLoader (NULL, &DirectNs);
+  if (!EFI_ERROR (Status)) {
+    Pool.Hits     = 0;
+    Pool.Misses   = 0;
+    Pool.Released = 0;
+    Status        = TimeLoader (&Pool, &PooledNs);
+  }
+
+  if (EFI_ERROR (Status)) {
+    Print (L"Loader replay failed: %r\n", Status);
+    PagePoolTrim (&Pool);
+    return Status;
+  }
+
+  Print (L"AllocatePages/FreePages  %8ld us\n", DivU64x32 (DirectNs, 1000));
+  Print (L"PagePool                 %8ld us", DivU64x32 (PooledNs, 1000));
+  PrintSpeedup (DirectNs, PooledNs);
+  Print (L"Pool hits %d, misses %d, released %d, peak idle %d KB\n",
+         Pool.Hits,
+         Pool.Misses,
+         Pool.Released,
+         EFI_PAGES_TO_SIZE (Pool.PeakCachedPages) / SIZE_1KB
+         );
+
+  PagePoolTrim (&Pool);
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,191 @@
+/** @file
+  Memory Services Example - multi-processor zero/fill/copy scaling.
+
+  Times ParallelZeroMem (), ParallelSetMem () and ParallelCopyMem () on a
+  large page allocation with 1, 2, 4 ... N processors and prints GB/s and
+  the speedup over a single core. Run under QEMU with -smp to see scaling.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/ParallelMemLib.h>
+
+#include "MemoryExample.h"
+
+//
+// Largest buffer tried first; halved until the allocation succeeds
+//
+#define PARALLEL_MAX_BUFFER  SIZE_512MB
+#define PARALLEL_MIN_BUFFER  (2 * PARALLEL_MEM_THRESHOLD)
+#define PARALLEL_REPEATS     3
+
+typedef enum {
+  ParallelDemoZero,
+  ParallelDemoFill,
+  ParallelDemoCopy,
+  ParallelDemoMax
+} PARALLEL_DEMO_OP;
+
+STATIC CONST CHAR16  *mOpNames[ParallelDemoMax] = {
+  L"Zero",
+  L"Fill",
+  L"Copy"
+};
+
+/**
+  Run one operation PARALLEL_REPEATS times and return the best time in ns.
+**/
+STATIC
+UINT64
+TimeOperation (
+  IN PARALLEL_DEMO_OP  Op,
+  IN UINT8             *Buffer,
+  IN UINTN             Size
+  )
+{
+  UINTN   Repeat;
+  UINT64  Start;
+  UINT64  Elapsed;
+  UINT64  Best;
+
+  Best = MAX_UINT64;
+  for (Repeat = 0; Repeat < PARALLEL_REPEATS; Repeat++) {
+    Start = BenchmarkGetTicks ();
+    switch (Op) {
+      case ParallelDemoZero:
+        ParallelZeroMem (Buffer, Size);
+        break;
+
+      case ParallelDemoFill:
+        ParallelSetMem (Buffer, Size, 0xA5);
+        break;
+
+      default:
+        //
+        // Copy moves the first half of the buffer onto the second half
+        //
+        ParallelCopyMem (Buffer + Size / 2, Buffer, Size / 2);
+        break;
+    }
+
+    Elapsed = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    Best    = MIN (Best, Elapsed);
+  }
+
+  return Best;
+}
+
+/**
+  Print one throughput cell: GB/s and speedup over one core.
+**/
+STATIC
+VOID
+PrintCell (
+  IN UINT64  MBps,
+  IN UINT64  Ns,
+  IN UINT64  BaselineNs
+  )
+{
+  UINT64  SpeedupX10;
+
+  SpeedupX10 = (Ns == 0) ? 0 : DivU64x64Remainder (MultU64x32 (BaselineNs, 10), Ns, NULL);
+  Print (L"  %4ld.%02d GB/s %3ld.%dx",
+         DivU64x32 (MBps, 1000),
+         ModU64x32 (MBps, 1000) / 10,
+         DivU64x32 (SpeedupX10, 10),
+         ModU64x32 (SpeedupX10, 10)
+         );
+}
+
+/**
+  Measure multi-processor zero/fill/copy throughput from 1 to N cores.
+**/
+EFI_STATUS
+DemoParallelFill (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  UINT8   *Buffer;
+  UINTN   Size;
+  UINTN   Processors;
+  UINTN   Workers;
+  UINTN   Op;
+  UINT64  Ns;
+  UINT64  Bytes;
+  UINT64  MBps;
+  UINT64  BaselineNs[ParallelDemoMax];
+
+  Print (L"\n=== Parallel Zero/Fill/Copy Scaling ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Buffer = NULL;
+  for (Size = PARALLEL_MAX_BUFFER; Size >= PARALLEL_MIN_BUFFER; Size /= 2) {
+    Buffer = AllocatePages (EFI_SIZE_TO_PAGES (Size));
+    if (Buffer != NULL) {
+      break;
+    }
+  }
+
+  if (Buffer == NULL) {
+    Print (L"Could not allocate a %d MB buffer\n", PARALLEL_MIN_BUFFER / SIZE_1MB);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Processors = ParallelMemGetProcessorCount ();
+  Print (L"Buffer: %d MB, %d enabled processor(s), %d MB chunks\n",
+         Size / SIZE_1MB, Processors, PARALLEL_MEM_CHUNK_SIZE / SIZE_1MB);
+  Print (L"Copy moves half the buffer; best of %d runs\n\n", PARALLEL_REPEATS);
+
+  //
+  // Touch every page once so first-use faults are not timed
+  //
+  ParallelZeroMem (Buffer, Size);
+
+  Print (L"Cores");
+  for (Op = 0; Op < ParallelDemoMax; Op++) {
+    Print (L"  %-20s", mOpNames[Op]);
+  }
+
+  Print (L"\n");
+
+  Workers = 1;
+  while (TRUE) {
+    ParallelMemSetMaxProcessors (Workers);
+    Print (L"%5d", Workers);
+
+    for (Op = 0; Op < ParallelDemoMax; Op++) {
+      Ns    = TimeOperation ((PARALLEL_DEMO_OP)Op, Buffer, Size);
+      Bytes = (Op == ParallelDemoCopy) ? Size / 2 : Size;
+      MBps  = BenchmarkMBps (Bytes, Ns);
+      if (Workers == 1) {
+        BaselineNs[Op] = Ns;
+      }
+
+      PrintCell (MBps, Ns, BaselineNs[Op]);
+    }
+
+    Print (L"\n");
+
+    if (Workers == Processors) {
+      break;
+    }
+
+    Workers = MIN (Workers * 2, Processors);
+  }
+
+  ParallelMemSetMaxProcessors (0);
+  FreePages (Buffer, EFI_SIZE_TO_PAGES (Size));
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/** @file
+  Memory Services Example - slab/arena allocator benchmark.
+
+  Performs one million small allocations through gBS->AllocatePool, a
+  SLAB_CACHE and an ARENA, holding a batch of objects live at a time the way
+  a directory walk or boot-option scan would, and prints ns/op for each.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BenchmarkLib.h>
+#include <Library/SlabArenaLib.h>
+
+#include "MemoryExample.h"
+
+#define SMALL_ALLOC_SIZE   64
+#define ALLOC_ITERATIONS   1000000
+#define ALLOC_BATCH        250
+
+/**
+  Print one benchmark result row.
+**/
+STATIC
+VOID
+PrintResult (
+  IN CONST CHAR16  *Name,
+  IN UINT64        ElapsedNs,
+  IN UINT64        BaselineNs
+  )
+{
+  UINT64  NsPerOpX100;
+  UINT64  SpeedupX100;
+
+  NsPerOpX100 = DivU64x32 (MultU64x32 (ElapsedNs, 100), ALLOC_ITERATIONS);
+  SpeedupX100 = (ElapsedNs == 0) ? 0 :
+                DivU64x64Remainder (MultU64x32 (BaselineNs, 100), ElapsedNs, NULL);
+
+  Print (L"%-14s %8ld ms %6ld.%02d ns/op   %3ld.%02dx\n",
+         Name,
+         DivU64x32 (ElapsedNs, 1000000),
+         DivU64x32 (NsPerOpX100, 100),
+         ModU64x32 (NsPerOpX100, 100),
+         DivU64x32 (SpeedupX100, 100),
+         ModU64x32 (SpeedupX100, 100)
+         );
+}
+
+/**
+  Time ALLOC_ITERATIONS allocations through gBS->AllocatePool/FreePool.
+**/
+STATIC
+EFI_STATUS
+BenchmarkPool (
+  OUT UINT64  *ElapsedNs
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Objects[ALLOC_BATCH];
+  UINTN       Done;
+  UINTN       Index;
+  UINT64      Start;
+
+  Start = BenchmarkGetTicks ();
+  for (Done = 0; Done < ALLOC_ITERATIONS; Done += ALLOC_BATCH) {
+    for (Index = 0; Index < ALLOC_BATCH; Index++) {
+      Status = gBS->AllocatePool (EfiBootServicesData, SMALL_ALLOC_SIZE, &Objects[Index]);
+      if (EFI_ERROR (Status)) {
+        while (Index > 0) {
+          gBS->FreePool (Objects[--Index]);
+        }
+        return Status;
+      }
+      *(UINT8 *)Objects[Index] = (UINT8)Index;
+    }
+
+    for (Index = 0; Index < ALLOC_BATCH; Index++) {
+      gBS->FreePool (Objects[Index]);
+    }
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return EFI_SUCCESS;
+}
+
+/**
+  Time ALLOC_ITERATIONS allocations through a slab cache.
+**/
+STATIC
+EFI_STATUS
+BenchmarkSlab (
+  IN  SLAB_CACHE  *Cache,
+  OUT UINT64      *ElapsedNs
+  )
+{
+  VOID    *Objects[ALLOC_BATCH];
+  UINTN   Done;
+  UINTN   Index;
+  UINT64  Start;
+
+  Start = BenchmarkGetTicks ();
+  for (Done = 0; Done < ALLOC_ITERATIONS; Done += ALLOC_BATCH) {
+    for (Index = 0; Index < ALLOC_BATCH; Index++) {
+      Objects[Index] = SlabAlloc (Cache);
+      if (Objects[Index] == NULL) {
+        SlabCacheReset (Cache);
+        return EFI_OUT_OF_RESOURCES;
+      }
+      *(UINT8 *)Objects[Index] = (UINT8)Index;
+    }
+
+    for (Index = 0; Index < ALLOC_BATCH; Index++) {
+      SlabFree (Cache, Objects[Index]);
+    }
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return EFI_SUCCESS;
+}
+
+/**
+  Time ALLOC_ITERATIONS allocations through an arena, resetting per batch.
+**/
+STATIC
+EFI_STATUS
+BenchmarkArena (
+  IN  ARENA   *Arena,
+  OUT UINT64  *ElapsedNs
+  )
+{
+  VOID    *Object;
+  UINTN   Done;
+  UINTN   Index;
+  UINT64  Start;
+
+  Start = BenchmarkGetTicks ();
+  for (Done = 0; Done < ALLOC_ITERATIONS; Done += ALLOC_BATCH) {
+    for (Index = 0; Index < ALLOC_BATCH; Index++) {
+      Object = ArenaAlloc (Arena, SMALL_ALLOC_SIZE, 0);
+      if (Object == NULL) {
+        ArenaReset (Arena);
+        return EFI_OUT_OF_RESOURCES;
+      }
+      *(UINT8 *)Object = (UINT8)Index;
+    }
+
+    ArenaReset (Arena);
+  }
+
+  *ElapsedNs = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+  return EFI_SUCCESS;
+}
+
+/**
+  Benchmark slab and arena allocators against gBS->AllocatePool.
+**/
+EFI_STATUS
+DemoSlabArena (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS  Status;
+  SLAB_CACHE  Cache;
+  ARENA       Arena;
+  UINT64      PoolNs;
+  UINT64      SlabNs;
+  UINT64      ArenaNs;
+
+  Print (L"\n=== Slab/Arena Allocator Benchmark ===\n\n");
+  Print (L"%d allocations of %d bytes, %d live at a time\n",
+         ALLOC_ITERATIONS, SMALL_ALLOC_SIZE, ALLOC_BATCH);
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Print (L"Counter frequency: %ld Hz\n\n", BenchmarkGetFrequency ());
+
+  Status = BenchmarkPool (&PoolNs);
+  if (EFI_ERROR (Status)) {
+    Print (L"AllocatePool benchmark failed: %r\n", Status);
+    return Status;
+  }
+
+  SlabCacheInit (&Cache, SMALL_ALLOC_SIZE, 0);
+  Status = BenchmarkSlab (&Cache, &SlabNs);
+  if (EFI_ERROR (Status)) {
+    Print (L"Slab benchmark failed: %r\n", Status);
+    SlabCacheDestroy (&Cache);
+    return Status;
+  }
+
+  ArenaInit (&Arena, 0);
+  Status = BenchmarkArena (&Arena, &ArenaNs);
+  if (EFI_ERROR (Status)) {
+    Print (L"Arena benchmark failed: %r\n", Status);
+    SlabCacheDestroy (&Cache);
+    ArenaDestroy (&Arena);
+    return Status;
+  }
+
+  Print (L"Allocator         Total        Per op      Speedup\n");
+  Print (L"-------------- ----------- ------------- ---------\n");
+  PrintResult (L"AllocatePool", PoolNs, PoolNs);
+  PrintResult (L"Slab cache", SlabNs, PoolNs);
+  PrintResult (L"Arena", ArenaNs, PoolNs);
+
+  Print (L"\nSlab: %d slab(s) of %d pages, peak %d objects\n",
+         Cache.SlabCount, Cache.PagesPerSlab, Cache.PeakObjects);
+  Print (L"Arena: %d block(s) of %d pages\n",
+         Arena.BlockCount, Arena.BlockPages);
+
+  SlabCacheDestroy (&Cache);
+  ArenaDestroy (&Arena);
+
+  return EFI_SUCCESS;
+}
@@ -0,0 +1,391 @@
+/** @file
+  Memory Services Example - STREAM-style bandwidth and latency probe.
+
+  Runs the four STREAM kernels (copy, scale, add, triad) over page-allocated
+  arrays from 4 KB to 64 MB each, then a dependent pointer chase over a
+  randomly linked buffer from 4 KB to 256 MB. Bandwidth drops and latency
+  steps mark the L1/L2/L3/DRAM transitions; a DRAM figure well below the
+  platform's expected numbers usually means mis-populated DIMMs.
+
+  The kernels use UINT64 elements and integer arithmetic since firmware
+  code does not use floating point; the memory traffic is the same as the
+  double-precision original.
+
+  Copyright (c) 2024, UEFI Guide Tutorial. All rights reserved.
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/BenchmarkLib.h>
+
+#include "MemoryExample.h"
+
+#define STREAM_MIN_ARRAY      SIZE_4KB
+#define STREAM_MAX_ARRAY      SIZE_64MB
+#define STREAM_BYTES_PER_RUN  SIZE_256MB
+#define STREAM_TRIALS         3
+#define STREAM_SCALAR         3
+
+#define CHASE_MIN_SIZE        SIZE_4KB
+#define CHASE_MAX_SIZE        SIZE_256MB
+#define CHASE_NODE_SIZE       64
+#define CHASE_STEPS           1000000
+
+typedef enum {
+  StreamCopy,
+  StreamScale,
+  StreamAdd,
+  StreamTriad,
+  StreamKernelMax
+} STREAM_KERNEL;
+
+//
+// Arrays touched per element by each kernel, for the byte count
+//
+STATIC CONST UINTN  mStreamArrays[StreamKernelMax] = { 2, 2, 3, 3 };
+
+//
+// Keeps the pointer chase result live so the loop is not optimised away
+//
+STATIC volatile UINTN  mChaseSink;
+
+/**
+  Run one STREAM kernel once over Count elements.
+**/
+STATIC
+VOID
+RunKernel (
+  IN     STREAM_KERNEL  Kernel,
+  IN OUT UINT64         *A,
+  IN OUT UINT64         *B,
+  IN OUT UINT64         *C,
+  IN     UINTN          Count
+  )
+{
+  UINTN  Index;
+
+  switch (Kernel) {
+    case StreamCopy:
+      //
+      // A plain element loop is turned into a memcpy () call by the
+      // compiler, which firmware does not provide; CopyMem () is the
+      // equivalent
+      //
+      CopyMem (C, A, Count * sizeof (UINT64));
+      break;
+
+    case StreamScale:
+      for (Index = 0; Index < Count; Index++) {
+        B[Index] = STREAM_SCALAR * C[Index];
+      }
+
+      break;
+
+    case StreamAdd:
+      for (Index = 0; Index < Count; Index++) {
+        C[Index] = A[Index] + B[Index];
+      }
+
+      break;
+
+    default:
+      for (Index = 0; Index < Count; Index++) {
+        A[Index] = B[Index] + STREAM_SCALAR * C[Index];
+      }
+
+      break;
+  }
+}
+
+/**
+  Measure each STREAM kernel at one array size; fills MBps per kernel.
+**/
+STATIC
+VOID
+MeasureStream (
+  IN  UINT64  *A,
+  IN  UINT64  *B,
+  IN  UINT64  *C,
+  IN  UINTN   ArraySize,
+  OUT UINT64  *MBps
+  )
+{
+  UINTN   Count;
+  UINTN   Repeats;
+  UINTN   Kernel;
+  UINTN   Trial;
+  UINTN   Repeat;
+  UINT64  Start;
+  UINT64  Elapsed;
+  UINT64  Best;
+  UINT64  Bytes;
+
+  Count   = ArraySize / sizeof (UINT64);
+  Repeats = MAX (STREAM_BYTES_PER_RUN / ArraySize / 2, 1);
+
+  for (Kernel = 0; Kernel < StreamKernelMax; Kernel++) {
+    Bytes = MultU64x32 ((UINT64)ArraySize * mStreamArrays[Kernel], (UINT32)Repeats);
+
+    //
+    // Like STREAM, report the best of several trials; small arrays repeat
+    // the kernel within a trial so the timer resolution does not dominate
+    //
+    Best = MAX_UINT64;
+    for (Trial = 0; Trial < STREAM_TRIALS; Trial++) {
+      Start = BenchmarkGetTicks ();
+      for (Repeat = 0; Repeat < Repeats; Repeat++) {
+        RunKernel ((STREAM_KERNEL)Kernel, A, B, C, Count);
+      }
+
+      Elapsed = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+      Best    = MIN (Best, Elapsed);
+    }
+
+    MBps[Kernel] = BenchmarkMBps (Bytes, Best);
+  }
+}
+
+/**
+  Run the STREAM kernels across array sizes.
+**/
+STATIC
+EFI_STATUS
+RunStream (
+  VOID
+  )
+{
+  UINT64  *A;
+  UINT64  *B;
+  UINT64  *C;
+  UINTN   Pages;
+  UINTN   ArraySize;
+  UINT64  MBps[StreamKernelMax];
+
+  Pages = EFI_SIZE_TO_PAGES (STREAM_MAX_ARRAY);
+  A     = AllocatePages (Pages);
+  B     = AllocatePages (Pages);
+  C     = AllocatePages (Pages);
+  if ((A == NULL) || (B == NULL) || (C == NULL)) {
+    Print (L"Failed to allocate 3 x %d MB STREAM arrays\n", STREAM_MAX_ARRAY / SIZE_1MB);
+    if (A != NULL) {
+      FreePages (A, Pages);
+    }
+
+    if (B != NULL) {
+      FreePages (B, Pages);
+    }
+
+    if (C != NULL) {
+      FreePages (C, Pages);
+    }
+
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Populate every page before timing
+  //
+  SetMem64 (A, STREAM_MAX_ARRAY, 1);
+  SetMem64 (B, STREAM_MAX_ARRAY, 2);
+  SetMem64 (C, STREAM_MAX_ARRAY, 0);
+
+  Print (L"STREAM (UINT64 elements, best of %d trials)\n\n", STREAM_TRIALS);
+  Print (L"  Array   Copy MB/s  Scale MB/s    Add MB/s  Triad MB/s\n");
+  Print (L"------- ----------- ----------- ----------- -----------\n");
+
+  for (ArraySize = STREAM_MIN_ARRAY; ArraySize <= STREAM_MAX_ARRAY; ArraySize *= 4) {
+    MeasureStream (A, B, C, ArraySize, MBps);
+    if (ArraySize >= SIZE_1MB) {
+      Print (L"%4d MB", ArraySize / SIZE_1MB);
+    } else {
+      Print (L"%4d KB", ArraySize / SIZE_1KB);
+    }
+
+    Print (L" %11ld %11ld %11ld %11ld\n",
+           MBps[StreamCopy], MBps[StreamScale], MBps[StreamAdd], MBps[StreamTriad]);
+  }
+
+  FreePages (A, Pages);
+  FreePages (B, Pages);
+  FreePages (C, Pages);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Small xorshift generator; quality only needs to defeat the prefetcher.
+**/
+STATIC
+UINT32
+NextRandom (
+  IN OUT UINT32  *State
+  )
+{
+  UINT32  Value;
+
+  Value  = *State;
+  Value ^= Value << 13;
+  Value ^= Value >> 17;
+  Value ^= Value << 5;
+  *State = Value;
+  return Value;
+}
+
+/**
+  Link every node of Buffer into a single random cycle and return its head.
+
+  Sattolo's algorithm shuffles the node order so the cycle visits each node
+  exactly once, which defeats both the hardware prefetcher and any reuse.
+**/
+STATIC
+UINTN *
+BuildChase (
+  IN UINT8   *Buffer,
+  IN UINTN   Size,
+  IN UINT32  *Order
+  )
+{
+  UINTN   NodeCount;
+  UINTN   Index;
+  UINTN   Swap;
+  UINT32  Temp;
+  UINT32  Seed;
+
+  NodeCount = Size / CHASE_NODE_SIZE;
+  for (Index = 0; Index < NodeCount; Index++) {
+    Order[Index] = (UINT32)Index;
+  }
+
+  Seed = 0x2545F491;
+  for (Index = NodeCount - 1; Index > 0; Index--) {
+    Swap         = NextRandom (&Seed) % Index;
+    Temp         = Order[Index];
+    Order[Index] = Order[Swap];
+    Order[Swap]  = Temp;
+  }
+
+  for (Index = 0; Index < NodeCount; Index++) {
+    *(UINTN *)(Buffer + (UINTN)Order[Index] * CHASE_NODE_SIZE) =
+      (UINTN)(Buffer + (UINTN)Order[(Index + 1) % NodeCount] * CHASE_NODE_SIZE);
+  }
+
+  return (UINTN *)(Buffer + (UINTN)Order[0] * CHASE_NODE_SIZE);
+}
+
+/**
+  Run the dependent-load latency test across working-set sizes.
+**/
+STATIC
+EFI_STATUS
+RunPointerChase (
+  VOID
+  )
+{
+  UINT8   *Buffer;
+  UINT32  *Order;
+  UINTN   MaxSize;
+  UINTN   Size;
+  UINTN   *Node;
+  UINTN   Step;
+  UINT64  Start;
+  UINT64  Elapsed;
+  UINT64  PsPerLoad;
+
+  Buffer = NULL;
+  Order  = NULL;
+
+  //
+  // Fall back to smaller working sets on machines with little free memory
+  //
+  for (MaxSize = CHASE_MAX_SIZE; MaxSize >= SIZE_16MB; MaxSize /= 2) {
+    Buffer = AllocatePages (EFI_SIZE_TO_PAGES (MaxSize));
+    Order  = AllocatePages (EFI_SIZE_TO_PAGES (MaxSize / CHASE_NODE_SIZE * sizeof (UINT32)));
+    if ((Buffer != NULL) && (Order != NULL)) {
+      break;
+    }
+
+    if (Buffer != NULL) {
+      FreePages (Buffer, EFI_SIZE_TO_PAGES (MaxSize));
+    }
+
+    if (Order != NULL) {
+      FreePages (Order, EFI_SIZE_TO_PAGES (MaxSize / CHASE_NODE_SIZE * sizeof (UINT32)));
+    }
+
+    Buffer = NULL;
+    Order  = NULL;
+  }
+
+  if (Buffer == NULL) {
+    Print (L"Failed to allocate pointer chase buffer\n");
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Print (L"\nPointer chase (%d byte nodes, random cycle, %d loads)\n\n",
+         CHASE_NODE_SIZE, CHASE_STEPS);
+  Print (L"Working set    ns/load\n");
+  Print (L"----------- ----------\n");
+
+  for (Size = CHASE_MIN_SIZE; Size <= MaxSize; Size *= 4) {
+    Node = BuildChase (Buffer, Size, Order);
+
+    //
+    // One warm-up lap through the cycle, capped for the large sizes
+    //
+    for (Step = 0; Step < MIN (Size / CHASE_NODE_SIZE, CHASE_STEPS); Step++) {
+      Node = (UINTN *)*Node;
+    }
+
+    Start = BenchmarkGetTicks ();
+    for (Step = 0; Step < CHASE_STEPS; Step++) {
+      Node = (UINTN *)*Node;
+    }
+
+    Elapsed    = BenchmarkElapsedNs (Start, BenchmarkGetTicks ());
+    mChaseSink = (UINTN)Node;
+
+    PsPerLoad = DivU64x32 (MultU64x32 (Elapsed, 1000), CHASE_STEPS);
+    if (Size >= SIZE_1MB) {
+      Print (L"%8d MB", Size / SIZE_1MB);
+    } else {
+      Print (L"%8d KB", Size / SIZE_1KB);
+    }
+
+    Print (L" %6ld.%02d\n", DivU64x32 (PsPerLoad, 1000), ModU64x32 (PsPerLoad, 1000) / 10);
+  }
+
+  FreePages (Buffer, EFI_SIZE_TO_PAGES (MaxSize));
+  FreePages (Order, EFI_SIZE_TO_PAGES (MaxSize / CHASE_NODE_SIZE * sizeof (UINT32)));
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Measure memory bandwidth (STREAM) and load latency (pointer chase).
+**/
+EFI_STATUS
+DemoStreamBenchmark (
+  IN EFI_HANDLE  ImageHandle
+  )
+{
+  EFI_STATUS  Status;
+
+  Print (L"\n=== Memory Bandwidth and Latency ===\n\n");
+
+  if (BenchmarkGetFrequency () == 0) {
+    Print (L"Performance counter not available\n");
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = RunStream ();
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return RunPointerChase ();
+}
@@ -257,6 +257,14 @@ DemoDnsLookup (
     } else {
       Print (L"DNS lookup timed out or failed\n");
     }
+
+    // The caller owns the response data
+    if (Token.RspData.H2AData != NULL) {
+      if (Token.RspData.H2AData->IpList != NULL) {
+        FreePool (Token.RspData.H2AData->IpList);
+      }
+      FreePool (Token.RspData.H2AData);
+    }
   }
 
   // Cleanup
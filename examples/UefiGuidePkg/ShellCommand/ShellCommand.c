@@ -20,9 +20,11 @@
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/UefiLib.h>
 #include <Library/ShellLib.h>
+#include <Library/BaseLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/PrintLib.h>
+#include <Library/MemoryMapLib.h>
 #include <Protocol/Shell.h>
 #include <Guid/GlobalVariable.h>
 
@@ -74,61 +76,31 @@ PrintMemoryInfo (
   IN BOOLEAN  Verbose
   )
 {
-  EFI_STATUS             Status;
-  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
-  UINTN                  MemoryMapSize;
-  UINTN                  MapKey;
-  UINTN                  DescriptorSize;
-  UINT32                 DescriptorVersion;
-  UINT64                 TotalMemory = 0;
-  UINT64                 FreeMemory = 0;
+  EFI_STATUS           Status;
+  MEMORY_MAP_SNAPSHOT  Snapshot;
+  UINT64               FreePages;
 
   Print (L"\n=== Memory Information ===\n\n");
 
-  // Get memory map
-  MemoryMapSize = 0;
-  Status = gBS->GetMemoryMap (&MemoryMapSize, NULL, &MapKey,
-                              &DescriptorSize, &DescriptorVersion);
-
-  if (Status != EFI_BUFFER_TOO_SMALL) {
+  // Capture the memory map once; totals come from the per-type tally
+  Status = MemoryMapSnapshotCapture (&Snapshot);
+  if (EFI_ERROR (Status)) {
     Print (L"Failed to get memory map\n");
     return;
   }
 
-  MemoryMapSize += 2 * DescriptorSize;
-  MemoryMap = AllocatePool (MemoryMapSize);
-  if (MemoryMap == NULL) {
-    return;
-  }
-
-  Status = gBS->GetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey,
-                              &DescriptorSize, &DescriptorVersion);
-
-  if (!EFI_ERROR (Status)) {
-    EFI_MEMORY_DESCRIPTOR *Entry = MemoryMap;
-    UINTN EntryCount = MemoryMapSize / DescriptorSize;
+  FreePages = MemoryMapSnapshotTypePages (&Snapshot, EfiConventionalMemory);
 
-    for (UINTN i = 0; i < EntryCount; i++) {
-      UINT64 Size = Entry->NumberOfPages * 4096;
+  Print (L"Total Memory: %ld MB\n", RShiftU64 (Snapshot.TotalPages, 8));
+  Print (L"Free Memory: %ld MB\n", RShiftU64 (FreePages, 8));
 
-      if (Entry->Type == EfiConventionalMemory) {
-        FreeMemory += Size;
-      }
-      TotalMemory += Size;
-
-      Entry = NEXT_MEMORY_DESCRIPTOR (Entry, DescriptorSize);
-    }
-
-    Print (L"Total Memory: %ld MB\n", TotalMemory / (1024 * 1024));
-    Print (L"Free Memory: %ld MB\n", FreeMemory / (1024 * 1024));
-
-    if (Verbose) {
-      Print (L"Memory Map Entries: %d\n", EntryCount);
-      Print (L"Descriptor Size: %d bytes\n", DescriptorSize);
-    }
+  if (Verbose) {
+    Print (L"Memory Map Entries: %d\n", Snapshot.DescriptorCount);
+    Print (L"Coalesced Regions: %d\n", Snapshot.RegionCount);
+    Print (L"Descriptor Size: %d bytes\n", Snapshot.DescriptorSize);
   }
 
-  FreePool (MemoryMap);
+  MemoryMapSnapshotFree (&Snapshot);
 }
 
 /**